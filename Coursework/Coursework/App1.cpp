@@ -1,9 +1,74 @@
 #include "App1.h"
 
-// Perlin noise height map texture parameters (.x - frequency, .y - amplitude)
-XMFLOAT2 paramsHM = XMFLOAT2(3.6969f, 6.9f);
+// Perlin noise height map texture parameters (.x - frequency, .y - amplitude, .z - persistence)
+XMFLOAT3 paramsHM = XMFLOAT3(3.6969f, 6.9f, 0.5f);
 float paramsDMFreq = 0.1;
 
+// Height map generation benchmark results (in ms, for 256^2 to 8192^2)
+const int benchmarkSizesHM = 6;
+float benchmarkTimesHM[benchmarkSizesHM] = {};
+
+// Per-sample vs batch path noise benchmark results (samples per second over the same 1024^2 height map grid)
+const int batchBenchmarkSize = 1024;
+SimplexNoise::BatchBenchmark batchBenchmark = {};
+
+// Density map generation benchmark results (in ms, for 64^3 to 256^3)
+const int benchmarkSizesDM = 3;
+float benchmarkTimesDM[benchmarkSizesDM] = {};
+
+// Animated density ring generation benchmark results (in ms per time slice, for 32^3 to 128^3)
+const int benchmarkSizesRing = 3;
+float benchmarkTimesRing[benchmarkSizesRing] = {};
+
+// Height map smoothing parameters (filter radius in texels, passes per smooth, Gaussian or box filter) and last smoothing time (in ms)
+int smoothRadius = 1;
+int smoothPasses = 1;
+bool smoothGaussian = false;
+float smoothTime = 0;
+
+// Erosion settings, CPU time per frame for the erosion in progress, and names of the erosion modes (Erosion::Mode order)
+Erosion::Settings erosionSettings;
+const float erosionBudgetMs = 4.f;
+const char* erosionModeNames[] = { "Hydraulic", "Thermal" };
+
+// Erosion benchmark results (256^2 to 1024^2, hydraulic at 0.25 droplets per texel, thermal over 16 sweeps)
+const int benchmarkSizesErosion = 3;
+Erosion::Benchmark benchmarkErosionHydraulic[benchmarkSizesErosion] = {}, benchmarkErosionThermal[benchmarkSizesErosion] = {};
+
+// Horizon map bake benchmark results (in ms, 256^2 to 4096^2)
+const int benchmarkSizesHorizon = 5;
+float benchmarkTimesHorizon[benchmarkSizesHorizon] = {};
+
+// Normal map check results (bake time, largest angles to the gradient and five-tap shader normals)
+PerlinNoiseTexture::NormalMapCheck normalMapCheck = {};
+
+// fBm kernel comparison results (runtime vs compile-time specialised, 1024^2 height map and 128^3 density volume)
+SimplexNoise::FractalBenchmark kernelBenchmarkHM = {}, kernelBenchmarkDM = {};
+
+// Noise graph comparison results (hand-written fBm vs fBm noise graph, 1024^2 height map)
+NoiseGraph::Benchmark graphBenchmark = {};
+
+// Names of the noise graph shapes, for the shape combos
+const char* shapeNames[(int)NoiseGraph::Shape::Count] = {};
+
+// Camera movement benchmark results (movement updates per second on a 4096^2 terrain: shared height field, per-update copy)
+const int movementBenchmarkSize = 4096;
+Camera::MovementBenchmark movementBenchmark = {};
+
+// Height query benchmark results (scalar vs batched bicubic heights at 65536 points of the terrain)
+const int queryBenchmarkPoints = 65536;
+HeightFieldQuery::Benchmark queryBenchmark = {};
+
+// Ray cast benchmark results (min/max pyramid vs marching every cell, 16384 rays on 1024^2 and 8192^2 terrains)
+const int raycastBenchmarkSizes[2] = { 1024, 8192 };
+const int raycastBenchmarkRays = 16384;
+HeightPyramid::RaycastBenchmark raycastBenchmarks[2] = {};
+
+// Quadtree selection benchmark results (256 views on 1024^2 and 8192^2 terrains)
+const int quadtreeBenchmarkSizes[2] = { 1024, 8192 };
+const int quadtreeBenchmarkViews = 256;
+TerrainQuadtree::SelectionBenchmark quadtreeBenchmarks[2] = {};
+
 // Screen-Related Variables
 int screenWidthVar, screenHeightVar;  // Holds the width and height of the screen for rendering
 float aspectRatio;  // Stores the aspect ratio of the screen for correct projection
@@ -25,9 +90,7 @@ XMFLOAT3 radius = XMFLOAT3(70, 70, 70);  // Radius of light's movement
 XMFLOAT3 camPos = XMFLOAT3();  // Camera position in world space
 XMFLOAT3 sphereScale = XMFLOAT3(.25, .25, .25);  // Scaling factor for the sphere
 XMFLOAT3 cottagePosition = XMFLOAT3(22, 20, 20);  // Position of the cottage
-XMFLOAT2 cottageGridPos = XMFLOAT2(cottagePosition.x - 1, cottagePosition.z - 1); // Position of the cottage on the terrain grid (X-Z plane)
 XMFLOAT3 spotlightModelPosition = XMFLOAT3(cottagePosition.x, 20, cottagePosition.z + 2);  // Position of the spotlight model
-XMFLOAT2 spotlightGridPos = XMFLOAT2(spotlightModelPosition.x - 1, spotlightModelPosition.z - 1); // Position of the spotlight model on the terrain grid (X-Z plane)
 XMFLOAT3 sceneCentre = XMFLOAT3(25, 25, 25);  // The center of the scene, used for light positioning
 XMFLOAT3 cloudBoxSize = XMFLOAT3(100, 50, 100); // The size of the volumetric cloud box
 XMFLOAT3 cloudBoxPosition = XMFLOAT3(); // Position of the cloud box
@@ -40,6 +103,7 @@ XMFLOAT2 coinPositionsXZ[5] = {					// Positions for various coins
 	XMFLOAT2(13.75, 13.19),
 	XMFLOAT2(11.61, 33.58)
 };
+float coinHeights[5] = {};						// Terrain height under each coin (updated every frame)
 bool coinCollected[5] = {						// Coin collection status
 	false,
 	false,
@@ -60,6 +124,8 @@ float g = 0.25f;								// Phase function isotropy parameter
 float gasDensity = 0.055f;						// density of the gas
 float speedX = 0;								// cloud speed in X
 float speedY = 0.02;							// clouds speed in Y
+bool animatedClouds = false;					// evolve the cloud density over time (looping ring of 4D noise slices)
+float cloudLoopPeriod = 30.f;					// seconds per loop of the animated density
 
 // Texturing related variables
 XMFLOAT2 grassTexVals = XMFLOAT2(-.5, .2);		// height control values for grass texture
@@ -88,6 +154,8 @@ float saturation = 1.25;  // Saturation of the colors in the scene
 bool postProcessingBool = true;  // Determines if post-processing effects should be applied
 bool timeBool = true;  // Determines if the time progression is enabled
 bool shadowBool = true;  // Enables or disables shadow rendering
+bool horizonShadowBool = true;  // Shadows the terrain from the sun with its horizon map instead of the shadow map
+const float horizonBudgetMs = 1.f;  // CPU time per frame for rebaking the horizon map after the heights change
 bool resetBool = false;  // Flag for resetting the scene
 bool debugBool = false;  // Enables or disables debug mode, typically for troubleshooting
 bool smooth = false;  // Enables or disables terrain smoothing
@@ -95,6 +163,16 @@ bool camFlightMode = false;  // Enables or disables camera flight mode
 bool generateHM = false;  // Flag for generating a new terrain map
 bool generateDM = false; // Flag for generating a new density map
 bool gravity = true; // Flag for gravity
+bool liveRegeneration = false; // Regenerate the maps in the background while the sliders are dragged
+bool streamedTerrainBool = false; // Walk on the unbounded streamed terrain instead of the height map
+bool quadtreeTerrainBool = true; // Draw the height map as the quadtree nodes selected per view instead of the whole main mesh
+std::vector<TerrainQuadtree::Node> terrainNodes; // Quadtree nodes selected for the view being drawn
+int terrainNodesSelected[2 + lightSize] = {}; // Nodes selected per view last frame (camera, clouds depth, lights)
+float terrainSelectionTime = 0.f; // Time spent selecting nodes this frame (in microseconds)
+int meshBudgetMB = 64; // Memory budget of the built meshes (in MB), meshes unused last frame are released over it
+const int skyDomeResolution = 20; // Quads per side of a cube face of the sky dome
+const int sunResolution = 10; // Quads per side of a cube face of the sun sphere
+bool equalAreaSkyDome = false; // Builds the sky dome with the equal-area cube sphere mapping (evenly sized quads)
 
 App1::App1()
 {
@@ -129,16 +207,19 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	// Sun texture sourced from https://it.pinterest.com/pin/417357090443735050/
 	textureMgr->loadTexture(L"sunTex", L"res/sunTex.jpg"); // Load sun texture.
 
-	// Step 4: Initialize mesh objects.
-	// Create meshes used in the scene (plane, sphere, models).
-	mainMesh = new PlaneMesh(renderer->getDevice(), renderer->getDeviceContext(), 50); // Plane mesh.
-	volumetricCloudBox = new CubeMesh(renderer->getDevice(), renderer->getDeviceContext()); // Box mesh for volumetric clouds.
-	spotlightModel = new AModel(renderer->getDevice(), "res/models/Street_Lamp.FBX"); // Spotlight model.
-	cottageModel = new AModel(renderer->getDevice(), "res/models/cottage_fbx.fbx"); // Cottage model.
-	coinModel = new AModel(renderer->getDevice(), "res/coin.fbx"); // Coin model.
-	skyDome = new SphereMesh(renderer->getDevice(), renderer->getDeviceContext()); // Sky dome class for the background.
-	cloudsPlane = new PlaneMesh(renderer->getDevice(), renderer->getDeviceContext(), 1000); // Clouds plane.
-	sunSphere = new SphereMesh(renderer->getDevice(), renderer->getDeviceContext(), 10); // Sun sphere.
+	// Step 4: Register mesh objects.
+	// Meshes used in the scene (plane, sphere, models) are built by the mesh manager the first time they are drawn, and
+	// released again while unused if the meshes go over its budget.
+	meshMgr->setBudget((size_t)meshBudgetMB << 20);
+	meshMgr->registerMesh("terrain", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new PlaneMesh(device, deviceContext, 50); }); // Plane mesh.
+	meshMgr->registerMesh("terrain chunk", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new PlaneMesh(device, deviceContext, TerrainChunks::chunkCells + 1, TerrainChunks::GetTextureScale(), TerrainChunks::GetTextureOffset()); }); // Streamed terrain chunk mesh (vertices on the chunk texel centres).
+	meshMgr->registerMesh("cloud box", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new CubeMesh(device, deviceContext); }); // Box mesh for volumetric clouds.
+	meshMgr->registerMesh("spotlight", [](ID3D11Device* device, ID3D11DeviceContext*) { return new AModel(device, "res/models/Street_Lamp.FBX"); }); // Spotlight model.
+	meshMgr->registerMesh("cottage", [](ID3D11Device* device, ID3D11DeviceContext*) { return new AModel(device, "res/models/cottage_fbx.fbx"); }); // Cottage model.
+	meshMgr->registerMesh("coin", [](ID3D11Device* device, ID3D11DeviceContext*) { return new AModel(device, "res/coin.fbx"); }); // Coin model.
+	meshMgr->registerMesh("sky dome", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new SphereMesh(device, deviceContext, skyDomeResolution, equalAreaSkyDome, VertexPacking::PackedVertex); }); // Sky dome class for the background (packed vertices, see SkyDomeShader).
+	meshMgr->registerMesh("clouds plane", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new PlaneMesh(device, deviceContext, 1000); }); // Clouds plane (not drawn by the volumetric clouds, so never built).
+	meshMgr->registerMesh("sun", [](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new SphereMesh(device, deviceContext, sunResolution, false, VertexPacking::PackedVertex); }); // Sun sphere (packed vertices, see SunShader).
 
 	// Step 5: Initialize render textures.
 	// Set up multiple render textures for various purposes (rendering to a texture for bloom, sun sphere, etc.).
@@ -275,16 +356,21 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 
 	// Step 11: Generate Perlin Noise textures (Density and Height map).
 	perlinNoiseTexture = new PerlinNoiseTexture(50, cloudBoxSize.x, cloudBoxSize.y, cloudBoxSize.z); // Initialising the generator with terrain size and required references.
-	perlinNoiseTexture->GeneratePerlinNoiseTextureDM(renderer->getDevice(), textureMgr, paramsDMFreq); // Generate 3D density texture for volumetric clouds.
-	perlinNoiseTexture->SmoothHeightMap(renderer->getDevice(), textureMgr); // Smooth/Reset the initial values for Height map
-	perlinNoiseTexture->GeneratePerlinNoiseTextureHM(renderer->getDevice(), textureMgr, paramsHM.x, paramsHM.y); // Generate height map for the terrain
-	for (int i = 0; i < 2; i++) {	// Multiple smooth calls for the desired effect
-		perlinNoiseTexture->SmoothHeightMap(renderer->getDevice(), textureMgr);
-	}
+	perlinNoiseTexture->LoadOrGeneratePerlinNoiseTextureDM(renderer->getDevice(), textureMgr, paramsDMFreq); // Load (or generate) the 3D density texture for volumetric clouds.
+	perlinNoiseTexture->LoadOrGeneratePerlinNoiseTextureHM(renderer->getDevice(), textureMgr, paramsHM.x, paramsHM.y, paramsHM.z, smoothRadius, 2, smoothGaussian); // Load (or generate) the terrain height map with two fused smoothing passes
+	for (int i = 0; i < (int)NoiseGraph::Shape::Count; i++) shapeNames[i] = NoiseGraph::GetShapeName((NoiseGraph::Shape)i); // Names for the shape combos
+
+	// Streamed terrain, with the same height parameters and seed (chunks are only generated once it is enabled)
+	terrainChunks = new TerrainChunks({ paramsHM.x, paramsHM.y, paramsHM.z, perlinNoiseTexture->GetSeed() });
+
+	// Quadtree over the height map's pyramid (follows the heights as they change), and the grid meshes of its nodes
+	terrainQuadtree = new TerrainQuadtree(&perlinNoiseTexture->GetHeightPyramid(), TerrainQuadtree::Settings());
+	const int leafCells = terrainQuadtree->GetSettings().leafCells;
+	meshMgr->registerMesh("terrain node", [leafCells](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new PlaneMesh(device, deviceContext, leafCells + 1); });
+	meshMgr->registerMesh("terrain quadrant", [leafCells](ID3D11Device* device, ID3D11DeviceContext* deviceContext) { return new PlaneMesh(device, deviceContext, leafCells / 2 + 1); });
 
 	// Step 12: Initialise camera variables.
-	camera->noiseData = perlinNoiseTexture->GetHeightDataRaw(); // Set the height data in Camera class for collision detection and camera movement.
-	camera->size = perlinNoiseTexture->GetTerrainSize(); // Set the size of the terrain in Camera class.
+	camera->terrain = &perlinNoiseTexture->GetHeightField(); // Share the height field with the Camera class for collision detection and camera movement (kept current by the generator).
 	camera->flightMode = false; // Set flight mode to false.
 	camera->setPosition(22, 6, 23); // Set initial Position.
 }
@@ -313,15 +399,7 @@ App1::~App1()
 	SAFE_DELETE(colorFilterShader);
 	SAFE_DELETE(sunShader);
 
-	// Step 3: Clean up meshes
-	SAFE_DELETE(mainMesh);
-	SAFE_DELETE(cloudsPlane);
-	SAFE_DELETE(volumetricCloudBox);
-	SAFE_DELETE(spotlightModel);
-	SAFE_DELETE(cottageModel);
-	SAFE_DELETE(coinModel);
-	SAFE_DELETE(skyDome);
-	SAFE_DELETE(sunSphere);
+	// Step 3: Meshes are released by the mesh manager
 
 	// Step 4: Clean up render textures
 	SAFE_DELETE(renderTextureSource);
@@ -352,8 +430,10 @@ App1::~App1()
 		SAFE_DELETE(shadowMaps[i]);
 	}
 
-	// Step 8: Clean up noise texture generator
+	// Step 8: Clean up noise texture generator and the streamed terrain
 	SAFE_DELETE(perlinNoiseTexture);
+	SAFE_DELETE(terrainChunks);
+	SAFE_DELETE(terrainQuadtree);
 }
 
 // Handles the main frame updates for the application, including rendering.
@@ -361,36 +441,93 @@ bool App1::frame()
 {
 	bool result;
 
-	// Step 1: Call the base class frame function, which may handle common tasks like input or updating base components.
+	// Step 1: Swap in any maps finished by the background regeneration (frame boundary, never waits for generation).
+	// The camera reads the shared height field, so it follows the new heights without a copy.
+	perlinNoiseTexture->SwapRegeneratedMaps(renderer->getDeviceContext());
+
+	// An erosion in progress runs for a fixed time every frame, and publishes its heights now and then.
+	perlinNoiseTexture->UpdateErosion(renderer->getDeviceContext(), erosionBudgetMs);
+
+	// The horizon map of changed heights is rebaked a little every frame, and its texture updated once complete.
+	perlinNoiseTexture->UpdateHorizonMap(renderer->getDeviceContext(), horizonBudgetMs);
+
+	// The streamed terrain uploads the chunks finished by its workers and queues the ones now in reach of the camera.
+	if (streamedTerrainBool) {
+		XMFLOAT3 cameraPosition = camera->getPosition();
+		float cameraYaw = camera->getRotation().y * 0.0174532f;
+		terrainChunks->Update(renderer->getDevice(), cameraPosition.x, cameraPosition.z, sinf(cameraYaw), cosf(cameraYaw));
+	}
+
+	// The terrain nodes are selected per view while rendering.
+	terrainSelectionTime = 0.f;
+
+	// Step 2: Call the base class frame function, which may handle common tasks like input or updating base components.
 	result = BaseApplication::frame();
 	if (!result)
 	{
 		return false;  // If the base frame function fails, return false to stop execution.
 	}
 
-	// Step 2: Call the render function to render the graphics for the current frame.
+	// Step 3: Call the render function to render the graphics for the current frame.
 	result = render();
 	if (!result)
 	{
 		return false;  // If rendering fails, return false to stop execution.
 	}
 
-	// Step 3: Return true if both the base frame and rendering were successful.
+	// Step 4: Return true if both the base frame and rendering were successful.
 	return true;
 }
 
+// Selects the quadtree nodes of the height map in the frustum of a view into terrainNodes, at the LODs of their distance to the camera
+// (in the light views too, so the shadows are cast by the terrain as the camera sees it).
+void App1::selectTerrainNodes(const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, int view) {
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, viewMatrix * projectionMatrix);
+	XMFLOAT3 cameraPosition = camera->getPosition();
+	auto startTime = std::chrono::high_resolution_clock::now();
+	terrainNodesSelected[view] = terrainQuadtree->Select(TerrainQuadtree::Frustum::FromMatrix(&viewProjection.m[0][0]), cameraPosition.x, cameraPosition.z, terrainNodes);
+	terrainSelectionTime += std::chrono::duration<float, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Constants of a selected node for the tessellated shaders (height map coordinates as the main mesh's: one texel per world unit).
+TerrainQuadtree::NodeConstants App1::terrainNodeConstants(const TerrainQuadtree::Node& node) {
+	XMFLOAT3 cameraPosition = camera->getPosition();
+	TerrainQuadtree::NodeConstants constants;
+	terrainQuadtree->GetNodeConstants(node, cameraPosition.x, cameraPosition.y, cameraPosition.z, 1.f / perlinNoiseTexture->GetTerrainSize(), constants);
+	return constants;
+}
+
 void App1::UpdatePositions() {
 	// Step 1: Update time and camera positions for further calculations.
 	timeFloat += timer->getTime();
 	camPos = camera->getPosition();
 
-	if (gravity) { // Checking if gravity is enabled
+	// Step 2: Fetch the terrain heights under the cottage, the spotlight model and the coins in one batched query.
+	float entityXs[7] = { cottagePosition.x, spotlightModelPosition.x };
+	float entityZs[7] = { cottagePosition.z, spotlightModelPosition.z };
+	for (int i = 0; i < 5; i++) {
+		entityXs[2 + i] = coinPositionsXZ[i].x;
+		entityZs[2 + i] = coinPositionsXZ[i].y;
+	}
+	float entityHeights[7];
+	if (streamedTerrainBool) {
+		// Entities over chunks that are not generated yet stay where they are
+		entityHeights[0] = cottagePosition.y - 0.4f;
+		entityHeights[1] = spotlightModelPosition.y;
+		for (int i = 0; i < 5; i++) entityHeights[2 + i] = coinHeights[i];
+		terrainChunks->SampleHeights(entityXs, entityZs, entityHeights, 7);
+	}
+	else {
+		HeightFieldQuery::SampleBilinear(perlinNoiseTexture->GetHeightField(), entityXs, entityZs, entityHeights, 7);
+	}
+	for (int i = 0; i < 5; i++) {
+		coinHeights[i] = entityHeights[2 + i];
+	}
 
-		// Step 2: Update grid positions for objects and fetch the height value at it from the perlin texture.
-		cottageGridPos = XMFLOAT2((int)(cottagePosition.x - 1), (int)(cottagePosition.z - 1)); // Grid position for cottage
-		float heightValueAtCottage = (perlinNoiseTexture->GetHeightAt(cottageGridPos.x, cottageGridPos.y)); // Height value at cottage grid position
-		spotlightGridPos = XMFLOAT2(spotlightModelPosition.x - 1, spotlightModelPosition.z - 1); // Grid position for spotlight model
-		float heightValueAtSpotlight = (perlinNoiseTexture->GetHeightAt(spotlightGridPos.x, spotlightGridPos.y)); // Height value at spotlight model grid position
+	if (gravity) { // Checking if gravity is enabled
+		float heightValueAtCottage = entityHeights[0]; // Height value under the cottage
+		float heightValueAtSpotlight = entityHeights[1]; // Height value under the spotlight model
 
 		// Step 3: Update the positions of the cottage and spotlight model based on the height values and artificial gravity.
 		if (cottagePosition.y > heightValueAtCottage + 0.4f) {
@@ -488,13 +625,14 @@ void App1::renderSunSphere() {
 		XMMATRIX projectionMatrix = renderer->getProjectionMatrix(); // Projection matrix for 3D rendering.
 
 		// Step 3: Send the sun sphere data to the GPU.
-		sunSphere->sendData(renderer->getDeviceContext());    // Send the sphere data for rendering.
+		BaseMesh* sunMesh = meshMgr->getMesh("sun");
+		sunMesh->sendData(renderer->getDeviceContext());    // Send the sphere data for rendering.
 
 		// Step 4: Set the shader parameters for the sun sphere rendering, including position, scale, and texture.
 		// Apply transformations (scaling and translation), texture, and sun color.
 		sunShader->setShaderParameters(
 			renderer->getDeviceContext(),
-			worldMatrix * XMMatrixScaling(1.5, 1.5, 1.5) * XMMatrixTranslation(position[0].x, position[0].y, position[0].z), // Scaling and translating the sun sphere.
+			sunMesh->getPositionTransform() * worldMatrix * XMMatrixScaling(1.5, 1.5, 1.5) * XMMatrixTranslation(position[0].x, position[0].y, position[0].z), // Dequantising, scaling and translating the sun sphere.
 			viewMatrix,    // View matrix for camera positioning.
 			projectionMatrix, // Projection matrix for perspective.
 			textureMgr->getTexture(L"sunTex"), // Sun texture to apply.
@@ -502,7 +640,7 @@ void App1::renderSunSphere() {
 		);
 
 		// Step 5: Render the sun sphere with the sun shader applied.
-		sunShader->render(renderer->getDeviceContext(), sunSphere->getIndexCount()); // Render the sun sphere.
+		sunShader->render(renderer->getDeviceContext(), sunMesh->getIndexCount()); // Render the sun sphere.
 	}
 }
 
@@ -517,18 +655,45 @@ void App1::Clouds(RenderTexture* renderTextureSource) {
 	// Step 2: Capture the linear depth of the scene objects
 	depthTexture->setRenderTarget(renderer->getDeviceContext());
 	depthTexture->clearRenderTarget(renderer->getDeviceContext(), 1, 1, 1, 1);
-	// Main mesh
-	mainMesh->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
-	linearDepthShaderTess->setShaderParametersLinearDepthTess(renderer->getDeviceContext(), worldMatrix, viewMatrix, camProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
-	linearDepthShaderTess->render(renderer->getDeviceContext(), mainMesh->getIndexCount());
+	// Main mesh (or the streamed terrain chunks, or the quadtree nodes in view)
+	if (streamedTerrainBool) {
+		BaseMesh* chunkGrid = meshMgr->getMesh("terrain chunk");
+		for (const TerrainChunks::Chunk* chunk : terrainChunks->GetDrawList()) {
+			chunkGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+			linearDepthShaderTess->setShaderParametersLinearDepthTess(renderer->getDeviceContext(), worldMatrix * XMMatrixTranslation(chunk->originX, 0, chunk->originZ), viewMatrix, camProjectionMatrix, camera->getPosition(), chunk->heightSRV);
+			linearDepthShaderTess->render(renderer->getDeviceContext(), chunkGrid->getIndexCount());
+		}
+	}
+	else if (quadtreeTerrainBool) {
+		selectTerrainNodes(viewMatrix, camProjectionMatrix, 1);
+		BaseMesh* nodeGrids[2] = {}; // Node and quadrant grids, looked up when first drawn.
+		for (const TerrainQuadtree::Node& node : terrainNodes) {
+			BaseMesh*& nodeGrid = nodeGrids[node.quadrant];
+			if (!nodeGrid) {
+				nodeGrid = meshMgr->getMesh(node.quadrant ? "terrain quadrant" : "terrain node");
+			}
+			TerrainQuadtree::NodeConstants constants = terrainNodeConstants(node);
+			nodeGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+			linearDepthShaderTess->setShaderParametersLinearDepthTess(renderer->getDeviceContext(), worldMatrix, viewMatrix, camProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"), &constants);
+			linearDepthShaderTess->render(renderer->getDeviceContext(), nodeGrid->getIndexCount());
+		}
+	}
+	else {
+		BaseMesh* terrainGrid = meshMgr->getMesh("terrain");
+		terrainGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+		linearDepthShaderTess->setShaderParametersLinearDepthTess(renderer->getDeviceContext(), worldMatrix, viewMatrix, camProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
+		linearDepthShaderTess->render(renderer->getDeviceContext(), terrainGrid->getIndexCount());
+	}
 	// Cottage
-	cottageModel->sendData(renderer->getDeviceContext());
+	BaseMesh* cottageMesh = meshMgr->getMesh("cottage");
+	cottageMesh->sendData(renderer->getDeviceContext());
 	linearDepthShader->setShaderParametersLinearDepth(renderer->getDeviceContext(), worldMatrix * XMMatrixRotationX(XM_PI / 2) * XMMatrixScaling(1, .4, .75) * XMMatrixTranslation(cottagePosition.x, cottagePosition.y, cottagePosition.z), viewMatrix, camProjectionMatrix, camera->getPosition());
-	linearDepthShader->render(renderer->getDeviceContext(), cottageModel->getIndexCount());
+	linearDepthShader->render(renderer->getDeviceContext(), cottageMesh->getIndexCount());
 	// Sportlight model
-	spotlightModel->sendData(renderer->getDeviceContext());
+	BaseMesh* spotlightMesh = meshMgr->getMesh("spotlight");
+	spotlightMesh->sendData(renderer->getDeviceContext());
 	linearDepthShader->setShaderParametersLinearDepth(renderer->getDeviceContext(), worldMatrix * XMMatrixScaling(0.05, 0.05, 0.05) * XMMatrixRotationX(XM_PI / 2) * XMMatrixRotationY(-XM_PI / 2) * XMMatrixTranslation(spotlightModelPosition.x, spotlightModelPosition.y, spotlightModelPosition.z), viewMatrix, camProjectionMatrix, camera->getPosition());
-	linearDepthShader->render(renderer->getDeviceContext(), spotlightModel->getIndexCount());
+	linearDepthShader->render(renderer->getDeviceContext(), spotlightMesh->getIndexCount());
 
 	// Step 3: Set the render target to the cloud texture.
 	renderTextureClouds->setRenderTarget(renderer->getDeviceContext());
@@ -545,14 +710,23 @@ void App1::Clouds(RenderTexture* renderTextureSource) {
 	// Step 6: Change culling mode
 	renderer->setFaceCulling(D3D11_CULL_NONE); // Disable culling so that both sides of the clouds are visible.
 
-	// Step 7: Send the cloud box data to the GPU for rendering.
-	volumetricCloudBox->sendData(renderer->getDeviceContext());
+	// Step 7: Pick the density slices (the two ring slices around the current point of the loop when animated).
+	ID3D11ShaderResourceView* densityTexture = textureMgr->getTexture(L"densityVolumeTexture");
+	ID3D11ShaderResourceView* nextDensityTexture = densityTexture;
+	float sliceBlend = 0.f;
+	if (animatedClouds && perlinNoiseTexture->HasDensityRing()) {
+		perlinNoiseTexture->GetDensityRingFrame(timeFloat / cloudLoopPeriod, densityTexture, nextDensityTexture, sliceBlend);
+	}
+
+	// Step 8: Send the cloud box data to the GPU for rendering.
+	BaseMesh* cloudBoxMesh = meshMgr->getMesh("cloud box");
+	cloudBoxMesh->sendData(renderer->getDeviceContext());
 	cloudsShader->setShaderParameters(
 		renderer->getDeviceContext(),
 		worldMatrix * XMMatrixScaling(cloudBoxSize.x, cloudBoxSize.y, cloudBoxSize.z) * XMMatrixTranslation(cloudBoxPosition.x, cloudBoxPosition.y, cloudBoxPosition.z),  // Position the clouds correctly.
 		viewMatrix,               // Camera view for proper positioning.
 		projectionMatrix,         // Project the clouds into 3D space.
-		textureMgr->getTexture(L"densityVolumeTexture"), // 3D density texture for volumetric clouds.
+		densityTexture, // 3D density texture for volumetric clouds.
 		depthTexture->getShaderResourceView(),
 		camera->getPosition(), // Camera position for volumetric calculations.
 		cloudBoxPosition, // Cloud box position for volumetric calculations.
@@ -564,15 +738,17 @@ void App1::Clouds(RenderTexture* renderTextureSource) {
 		timeFloat, // Time for cloud movement.
 		gasColor,
 		XMFLOAT3(sigma_a, sampleNumbers, g),
-		gasDensity
+		gasDensity,
+		nextDensityTexture, // Next time slice of the density (same texture when not animated).
+		sliceBlend
 	);
-	cloudsShader->render(renderer->getDeviceContext(), volumetricCloudBox->getIndexCount());
+	cloudsShader->render(renderer->getDeviceContext(), cloudBoxMesh->getIndexCount());
 
-	// Step 8: Set the render target to the blended cloud texture.
+	// Step 9: Set the render target to the blended cloud texture.
 	renderTextureCloudBlended->setRenderTarget(renderer->getDeviceContext());
 	renderTextureCloudBlended->clearRenderTarget(renderer->getDeviceContext(), 0, 0, 0, 1); // Clear the render target.
 
-	// Step 9: Blend the cloud texture with source texture and write onto the cloud blend texture.
+	// Step 10: Blend the cloud texture with source texture and write onto the cloud blend texture.
 	orthoMeshFull->sendData(renderer->getDeviceContext());
 	worldMatrix = renderer->getWorldMatrix();
 	viewMatrix = camera->getOrthoViewMatrix();
@@ -587,7 +763,7 @@ void App1::Clouds(RenderTexture* renderTextureSource) {
 	);
 	cloudBlendShader->render(renderer->getDeviceContext(), orthoMeshFull->getIndexCount());
 
-	// Step 10: Reset the culling mode back
+	// Step 11: Reset the culling mode back
 	renderer->setFaceCulling(D3D11_CULL_BACK);
 }
 
@@ -613,12 +789,15 @@ void App1::SkyBox() {
 	worldMatrix = XMMatrixTranslation(camPosition.x, camPosition.y, camPosition.z);  // Translate the skybox to the camera's position.
 
 	// Step 5: Render the skybox.
-	skyDome->sendData(renderer->getDeviceContext());  // Render the sky dome geometry.
+	BaseMesh* skyDomeMesh = meshMgr->getMesh("sky dome");
+	skyDomeMesh->sendData(renderer->getDeviceContext());  // Render the sky dome geometry.
 
 	// Step 6: Set shader parameters for the skybox and apply the shader.
+	// The packed positions are dequantised ahead of the world matrix (the gradient reads them as they are: quantised over
+	// the bounds of the unit sphere, they are its positions).
 	skyDomeShader->setShaderParameters(
 		renderer->getDeviceContext(),
-		worldMatrix,          // World matrix (position the skybox around the camera).
+		skyDomeMesh->getPositionTransform() * worldMatrix,          // World matrix (position the skybox around the camera).
 		viewMatrix,           // View matrix (camera's position and orientation).
 		projectionMatrix,     // Projection matrix.
 		apexColorVal,         // Color for the apex (top) of the skybox.
@@ -627,7 +806,7 @@ void App1::SkyBox() {
 	);
 
 	// Step 7: Render the skybox using the applied shader.
-	skyDomeShader->render(renderer->getDeviceContext(), skyDome->getIndexCount());  // Render the sky dome with the shader applied.
+	skyDomeShader->render(renderer->getDeviceContext(), skyDomeMesh->getIndexCount());  // Render the sky dome with the shader applied.
 
 	// Step 8: Restore render states.
 	renderer->setFaceCulling(D3D11_CULL_BACK);  // Re-enable back face culling for subsequent rendering.
@@ -842,26 +1021,59 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 		shadowMapsRSV[i] = shadowMaps[i]->getDepthMapSRV(); // Get shadow map for each light source.
 	}
 
-	// Step 5: Render main mesh with tessellation and lighting effects.
-	mainMesh->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST); // Send main mesh data.
-	lightShaderTess->setShaderParametersTess(
-			renderer->getDeviceContext(),
-			worldMatrix,        // World matrix for transformations.
-			viewMatrix,         // View matrix for the camera's perspective.
-			projectionMatrix,   // Projection matrix for 3D scene rendering.
-			textureMgr->getTexture(L"perlinNoiseHeightMap"), // Height map texture for terrain.
-			textureMgr->getTexture(L"Grass Tex"), // Grass texture for the terrain.
-		    textureMgr->getTexture(L"Rock Tex"), // Rock texture for terrain.
-		    textureMgr->getTexture(L"Snow Tex"), // Snow texture for terrain.
-		    grassTexVals, // Grass values for height based shading.
-		    rockTextVals,  // Rock values for height based shading.
-		    snowTexVals,     // Snow values for height based shading.
-			light,              // Lights to be applied.
-			lightType,          // Light types (e.g., directional, spotlight).
-			camera->getPosition(), // Camera position for lighting calculations.
-			shadowMapsRSV       // Shadow maps for all lights.
-		);
-	lightShaderTess->render(renderer->getDeviceContext(), mainMesh->getIndexCount()); // Render with tessellated shader.
+	// Step 5: Render main mesh with tessellation and lighting effects (or the streamed terrain chunks, without horizon maps,
+	// or the quadtree nodes in view).
+	if (streamedTerrainBool) {
+		BaseMesh* chunkGrid = meshMgr->getMesh("terrain chunk");
+		for (const TerrainChunks::Chunk* chunk : terrainChunks->GetDrawList()) {
+			chunkGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+			lightShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix * XMMatrixTranslation(chunk->originX, 0, chunk->originZ), viewMatrix, projectionMatrix,
+				chunk->heightSRV, chunk->normalSRV, nullptr, textureMgr->getTexture(L"Grass Tex"), textureMgr->getTexture(L"Rock Tex"), textureMgr->getTexture(L"Snow Tex"),
+				grassTexVals, rockTextVals, snowTexVals, light, lightType, camera->getPosition(), shadowMapsRSV);
+			lightShaderTess->render(renderer->getDeviceContext(), chunkGrid->getIndexCount());
+		}
+	}
+	else if (quadtreeTerrainBool) {
+		selectTerrainNodes(viewMatrix, projectionMatrix, 0);
+		BaseMesh* nodeGrids[2] = {}; // Node and quadrant grids, looked up when first drawn.
+		for (const TerrainQuadtree::Node& node : terrainNodes) {
+			BaseMesh*& nodeGrid = nodeGrids[node.quadrant];
+			if (!nodeGrid) {
+				nodeGrid = meshMgr->getMesh(node.quadrant ? "terrain quadrant" : "terrain node");
+			}
+			TerrainQuadtree::NodeConstants constants = terrainNodeConstants(node);
+			nodeGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+			lightShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, viewMatrix, projectionMatrix,
+				textureMgr->getTexture(L"perlinNoiseHeightMap"), textureMgr->getTexture(L"perlinNoiseNormalMap"), horizonShadowBool ? textureMgr->getTexture(L"perlinNoiseHorizonMap") : nullptr,
+				textureMgr->getTexture(L"Grass Tex"), textureMgr->getTexture(L"Rock Tex"), textureMgr->getTexture(L"Snow Tex"),
+				grassTexVals, rockTextVals, snowTexVals, light, lightType, camera->getPosition(), shadowMapsRSV, &constants);
+			lightShaderTess->render(renderer->getDeviceContext(), nodeGrid->getIndexCount());
+		}
+	}
+	else {
+		BaseMesh* terrainGrid = meshMgr->getMesh("terrain");
+		terrainGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST); // Send main mesh data.
+		lightShaderTess->setShaderParametersTess(
+				renderer->getDeviceContext(),
+				worldMatrix,        // World matrix for transformations.
+				viewMatrix,         // View matrix for the camera's perspective.
+				projectionMatrix,   // Projection matrix for 3D scene rendering.
+				textureMgr->getTexture(L"perlinNoiseHeightMap"), // Height map texture for terrain.
+				textureMgr->getTexture(L"perlinNoiseNormalMap"), // Normal map baked from the height map.
+				horizonShadowBool ? textureMgr->getTexture(L"perlinNoiseHorizonMap") : nullptr, // Horizon map for the sun's terrain self-shadowing.
+				textureMgr->getTexture(L"Grass Tex"), // Grass texture for the terrain.
+			    textureMgr->getTexture(L"Rock Tex"), // Rock texture for terrain.
+			    textureMgr->getTexture(L"Snow Tex"), // Snow texture for terrain.
+			    grassTexVals, // Grass values for height based shading.
+			    rockTextVals,  // Rock values for height based shading.
+			    snowTexVals,     // Snow values for height based shading.
+				light,              // Lights to be applied.
+				lightType,          // Light types (e.g., directional, spotlight).
+				camera->getPosition(), // Camera position for lighting calculations.
+				shadowMapsRSV       // Shadow maps for all lights.
+			);
+		lightShaderTess->render(renderer->getDeviceContext(), terrainGrid->getIndexCount()); // Render with tessellated shader.
+	}
 
 	// Step 6: Render additional objects (cottage, coins, spotlight model) with the lighting shader and check for gameplay logic.
 	// Gameplay logic: check if all coins are collected and if the player is near the cottage.
@@ -879,7 +1091,8 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 		}
 	}
 	// Render cottage model.
-	cottageModel->sendData(renderer->getDeviceContext());
+	BaseMesh* cottageMesh = meshMgr->getMesh("cottage");
+	cottageMesh->sendData(renderer->getDeviceContext());
 	lightShader->setShaderParameters(
 		renderer->getDeviceContext(),
 		worldMatrix * XMMatrixRotationX(XM_PI / 2) * XMMatrixScaling(1, .4, .75) * XMMatrixTranslation(cottagePosition.x, cottagePosition.y, cottagePosition.z),
@@ -891,9 +1104,10 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 		camera->getPosition(),
 		shadowMapsRSV
 	);
-	lightShader->render(renderer->getDeviceContext(), cottageModel->getIndexCount()); // Render cottage model.
+	lightShader->render(renderer->getDeviceContext(), cottageMesh->getIndexCount()); // Render cottage model.
 	// Render spotlight model.
-	spotlightModel->sendData(renderer->getDeviceContext());
+	BaseMesh* spotlightMesh = meshMgr->getMesh("spotlight");
+	spotlightMesh->sendData(renderer->getDeviceContext());
 	lightShader->setShaderParameters(
 		renderer->getDeviceContext(),
 		worldMatrix * XMMatrixScaling(0.05, 0.05, 0.05) * XMMatrixRotationX(XM_PI / 2) * XMMatrixRotationY(-XM_PI / 2) * XMMatrixTranslation(spotlightModelPosition.x, spotlightModelPosition.y, spotlightModelPosition.z),
@@ -905,12 +1119,13 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 		camera->getPosition(),
 		shadowMapsRSV
 	);
-	lightShader->render(renderer->getDeviceContext(), spotlightModel->getIndexCount()); // Render spotlight model.
-	// Render the coins based on their collection state and positions.
+	lightShader->render(renderer->getDeviceContext(), spotlightMesh->getIndexCount()); // Render spotlight model.
+	// Render the coins based on their collection state and positions (the coin mesh is looked up for the first coin drawn).
+	BaseMesh* coinMesh = nullptr;
 	for (int i = 0; i < 5; i++) {
 		camera->update();
 		XMFLOAT3 playerPos = camera->getPosition();
-		float height = perlinNoiseTexture->GetHeightAt((int)(coinPositionsXZ[i].x - 1), (int)(coinPositionsXZ[i].y - 1));
+		float height = coinHeights[i];
 		XMFLOAT3 coinPos = XMFLOAT3(coinPositionsXZ[i].x, height, coinPositionsXZ[i].y);
 		XMVECTOR pPos = XMLoadFloat3(&playerPos);
 		XMVECTOR cPos = XMLoadFloat3(&coinPos);
@@ -927,7 +1142,10 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 		}
 
 		if (!coinCollected[i]) {
-			coinModel->sendData(renderer->getDeviceContext());
+			if (!coinMesh) {
+				coinMesh = meshMgr->getMesh("coin");
+			}
+			coinMesh->sendData(renderer->getDeviceContext());
 			textureShader->setShaderParameters(
 				renderer->getDeviceContext(),
 				worldMatrix * XMMatrixRotationY(2 * timeFloat) * XMMatrixTranslation(coinPositionsXZ[i].x, height, coinPositionsXZ[i].y),
@@ -935,7 +1153,7 @@ void App1::lighting(RenderTexture* renderTexture, bool clear) {
 				projectionMatrix,
 				textureMgr->getTexture(L"Coin Tex") // Spotlight texture.
 			);
-			textureShader->render(renderer->getDeviceContext(), coinModel->getIndexCount()); // Render coin model.
+			textureShader->render(renderer->getDeviceContext(), coinMesh->getIndexCount()); // Render coin model.
 		}
 	}
 }
@@ -946,6 +1164,16 @@ void App1::shadowDepth() {
 	XMMATRIX lightViewMatrix, lightOrthoMatrix, lightProjectionMatrix, worldMatrix;
 	camera->update(); // Update camera position and rotation.
 
+	// Look the casters up once for all the lights (only the terrain meshes drawn are built).
+	BaseMesh* chunkGrid = streamedTerrainBool ? meshMgr->getMesh("terrain chunk") : nullptr;
+	BaseMesh* terrainGrid = !streamedTerrainBool && !quadtreeTerrainBool ? meshMgr->getMesh("terrain") : nullptr;
+	BaseMesh* nodeGrids[2] = {}; // Node and quadrant grids, looked up when first drawn.
+	BaseMesh* cottageMesh = meshMgr->getMesh("cottage");
+	BaseMesh* spotlightMesh = meshMgr->getMesh("spotlight");
+
+	// With horizon shadows the terrain is shadowed from the sun by its horizon map, and the streamed chunks have none.
+	const bool horizonTerrain = horizonShadowBool && !streamedTerrainBool;
+
 	// Loop through each light to generate shadows for both directional and spotlight lights.
 	for (int i = 0; i < lightSize; i++) {
 		// Set the shadow map as the render target for depth information.
@@ -961,19 +1189,44 @@ void App1::shadowDepth() {
 			lightOrthoMatrix = light[i]->getOrthoMatrix();
 			worldMatrix = renderer->getWorldMatrix(); // Get world matrix for rendering.
 
-			// Render the main mesh with tessellation for the shadow map.
-			mainMesh->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
-			depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightOrthoMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
-			depthShaderTess->render(renderer->getDeviceContext(), mainMesh->getIndexCount());
+			// Render the main mesh with tessellation for the shadow map, unless the horizon map shadows the terrain: then the
+			// sun's map only holds the objects, and the terrain is not drawn a second time into 4096^2 texels every frame.
+			if (!horizonTerrain) {
+				if (streamedTerrainBool) {
+					for (const TerrainChunks::Chunk* chunk : terrainChunks->GetDrawList()) {
+						chunkGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+						depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix * XMMatrixTranslation(chunk->originX, 0, chunk->originZ), lightViewMatrix, lightOrthoMatrix, camera->getPosition(), chunk->heightSRV);
+						depthShaderTess->render(renderer->getDeviceContext(), chunkGrid->getIndexCount());
+					}
+				}
+				else if (quadtreeTerrainBool) {
+					selectTerrainNodes(lightViewMatrix, lightOrthoMatrix, 2 + i);
+					for (const TerrainQuadtree::Node& node : terrainNodes) {
+						BaseMesh*& nodeGrid = nodeGrids[node.quadrant];
+						if (!nodeGrid) {
+							nodeGrid = meshMgr->getMesh(node.quadrant ? "terrain quadrant" : "terrain node");
+						}
+						TerrainQuadtree::NodeConstants constants = terrainNodeConstants(node);
+						nodeGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+						depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightOrthoMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"), &constants);
+						depthShaderTess->render(renderer->getDeviceContext(), nodeGrid->getIndexCount());
+					}
+				}
+				else {
+					terrainGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+					depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightOrthoMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
+					depthShaderTess->render(renderer->getDeviceContext(), terrainGrid->getIndexCount());
+				}
+			}
 
 			// Render additional objects like the cottage, and spotlight model.
-			cottageModel->sendData(renderer->getDeviceContext());
+			cottageMesh->sendData(renderer->getDeviceContext());
 			depthShader->setShaderParameters(renderer->getDeviceContext(), worldMatrix * XMMatrixRotationX(XM_PI / 2) * XMMatrixScaling(1, .4, .75) * XMMatrixTranslation(cottagePosition.x, cottagePosition.y, cottagePosition.z), lightViewMatrix, lightOrthoMatrix);
-			depthShader->render(renderer->getDeviceContext(), cottageModel->getIndexCount());
+			depthShader->render(renderer->getDeviceContext(), cottageMesh->getIndexCount());
 
-			spotlightModel->sendData(renderer->getDeviceContext());
+			spotlightMesh->sendData(renderer->getDeviceContext());
 			depthShader->setShaderParameters(renderer->getDeviceContext(), worldMatrix * XMMatrixScaling(0.05, 0.05, 0.05) * XMMatrixRotationX(XM_PI / 2) * XMMatrixRotationY(-XM_PI / 2) * XMMatrixTranslation(spotlightModelPosition.x, spotlightModelPosition.y, spotlightModelPosition.z), lightViewMatrix, lightOrthoMatrix);
-			depthShader->render(renderer->getDeviceContext(), spotlightModel->getIndexCount());
+			depthShader->render(renderer->getDeviceContext(), spotlightMesh->getIndexCount());
 		}
 		// If the light is a spotlight, use perspective projection for depth capture.
 		else {
@@ -982,19 +1235,41 @@ void App1::shadowDepth() {
 			lightProjectionMatrix = light[i]->getProjectionMatrix();
 			worldMatrix = renderer->getWorldMatrix(); // Get world matrix for rendering.
 
-			// Render the main mesh with tessellation for the shadow map.
-			mainMesh->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
-			depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
-			depthShaderTess->render(renderer->getDeviceContext(), mainMesh->getIndexCount());
+			// Render the main mesh (or the streamed terrain chunks) with tessellation for the shadow map.
+			if (streamedTerrainBool) {
+				for (const TerrainChunks::Chunk* chunk : terrainChunks->GetDrawList()) {
+					chunkGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+					depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix * XMMatrixTranslation(chunk->originX, 0, chunk->originZ), lightViewMatrix, lightProjectionMatrix, camera->getPosition(), chunk->heightSRV);
+					depthShaderTess->render(renderer->getDeviceContext(), chunkGrid->getIndexCount());
+				}
+			}
+			else if (quadtreeTerrainBool) {
+				selectTerrainNodes(lightViewMatrix, lightProjectionMatrix, 2 + i);
+				for (const TerrainQuadtree::Node& node : terrainNodes) {
+					BaseMesh*& nodeGrid = nodeGrids[node.quadrant];
+					if (!nodeGrid) {
+						nodeGrid = meshMgr->getMesh(node.quadrant ? "terrain quadrant" : "terrain node");
+					}
+					TerrainQuadtree::NodeConstants constants = terrainNodeConstants(node);
+					nodeGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+					depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"), &constants);
+					depthShaderTess->render(renderer->getDeviceContext(), nodeGrid->getIndexCount());
+				}
+			}
+			else {
+				terrainGrid->sendData(renderer->getDeviceContext(), D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+				depthShaderTess->setShaderParametersTess(renderer->getDeviceContext(), worldMatrix, lightViewMatrix, lightProjectionMatrix, camera->getPosition(), textureMgr->getTexture(L"perlinNoiseHeightMap"));
+				depthShaderTess->render(renderer->getDeviceContext(), terrainGrid->getIndexCount());
+			}
 
 			// Render additional objects (cottage, and spotlight model) for the shadow map.
-			cottageModel->sendData(renderer->getDeviceContext());
+			cottageMesh->sendData(renderer->getDeviceContext());
 			depthShader->setShaderParameters(renderer->getDeviceContext(), worldMatrix * XMMatrixRotationX(XM_PI / 2) * XMMatrixScaling(1, .4, .75) * XMMatrixTranslation(cottagePosition.x, cottagePosition.y, cottagePosition.z), lightViewMatrix, lightProjectionMatrix);
-			depthShader->render(renderer->getDeviceContext(), cottageModel->getIndexCount());
+			depthShader->render(renderer->getDeviceContext(), cottageMesh->getIndexCount());
 
-			spotlightModel->sendData(renderer->getDeviceContext());
+			spotlightMesh->sendData(renderer->getDeviceContext());
 			depthShader->setShaderParameters(renderer->getDeviceContext(), worldMatrix * XMMatrixScaling(0.05, 0.05, 0.05) * XMMatrixRotationX(XM_PI / 2) * XMMatrixRotationY(-XM_PI / 2) * XMMatrixTranslation(spotlightModelPosition.x, spotlightModelPosition.y, spotlightModelPosition.z), lightViewMatrix, lightProjectionMatrix);
-			depthShader->render(renderer->getDeviceContext(), spotlightModel->getIndexCount());
+			depthShader->render(renderer->getDeviceContext(), spotlightMesh->getIndexCount());
 		}
 	}
 
@@ -1339,6 +1614,16 @@ void App1::finalRender(RenderTexture* renderTexture) {
 	renderer->setZBuffer(true);
 }
 
+// View of size x size benchmark heights, placed as the terrain's (texel centres at world x + 0.5)
+static HeightField BenchmarkHeightField(const std::vector<float>& heights, int size) {
+	HeightField field;
+	field.heights = heights.data();
+	field.size = size;
+	field.originX = field.originZ = 0.5f;
+	field.version = 1;
+	return field;
+}
+
 // Renders the application's graphical user interface using ImGui.
 // Cornut, O. (n.d.) Dear ImGui(1.63)[Library / Framework]. Adapted from: https://github.com/ocornut/imgui#dear-imgui.
 void App1::gui() {
@@ -1403,31 +1688,249 @@ void App1::gui() {
 			ImGui::SliderFloat2("Snow texturing\nX - min height val\nY - max height val", (float*)&snowTexVals, -20, 20, "%.2f");
 		}
 
+		// Noise evaluation controls (batch SIMD path, for comparing generation timings)
+		if (ImGui::CollapsingHeader("Noise Evaluation")) {
+			const char* batchPaths[] = { "Scalar", "SSE4.1 (4-wide)", "AVX2 (8-wide)" };
+			int batchPath = (int)SimplexNoise::getBatchPath();
+			if (ImGui::Combo("Batch SIMD path", &batchPath, batchPaths, IM_ARRAYSIZE(batchPaths))) {
+				SimplexNoise::setBatchPath((SimplexNoise::BatchPath)batchPath);
+			}
+			ImGui::Text("Best supported path: %s", batchPaths[(int)SimplexNoise::detectBatchPath()]);
+			int generationThreads = perlinNoiseTexture->GetThreadCount();
+			if (ImGui::SliderInt("Generation threads", &generationThreads, 1, ThreadPool::GetHardwareThreadCount())) {
+				perlinNoiseTexture->SetThreadCount(generationThreads);
+			}
+			ImGui::Text("Last HM generation: %.3f ms (%s)", perlinNoiseTexture->GetGenerationTimeHM(), perlinNoiseTexture->WasHeightMapLoaded() ? "map cache" : perlinNoiseTexture->WasHeightMapCached() ? "cached octaves" : "evaluated");
+			ImGui::Text("Last DM generation: %.3f ms (%s)", perlinNoiseTexture->GetGenerationTimeDM(), perlinNoiseTexture->WasDensityMapLoaded() ? "map cache" : "evaluated");
+
+			// Persistent map cache of the startup maps
+			MapCache& mapCache = perlinNoiseTexture->GetMapCache();
+			ImGui::Text("Map cache: %d entries, %.1f / %.0f MB", mapCache.GetEntryCount(), mapCache.GetSizeBytes() / 1048576.0, mapCache.GetMaxBytes() / 1048576.0);
+			ImGui::Text("Hits %d, misses %d (corrupt %d), evicted %d", mapCache.GetHits(), mapCache.GetMisses(), mapCache.GetCorrupt(), mapCache.GetEvicted());
+			if (ImGui::Button("Clear map cache")) {
+				mapCache.Clear();
+			}
+			ImGui::Text("HM hash: %016llx", perlinNoiseTexture->HashHeightData());
+
+			// Height map generation benchmark (256^2 to 8192^2)
+			if (ImGui::Button("Benchmark HM generation")) {
+				for (int i = 0; i < benchmarkSizesHM; i++) {
+					benchmarkTimesHM[i] = perlinNoiseTexture->BenchmarkHeightMap(256 << i, paramsHM.x, paramsHM.y, paramsHM.z);
+				}
+				batchBenchmark = SimplexNoise::benchmarkBatchPaths(batchBenchmarkSize, paramsHM.x, PerlinNoiseTexture::heightOctaves, PerlinNoiseTexture::heightNoiseScale, &perlinNoiseTexture->GetThreadPool());
+			}
+			for (int i = 0; i < benchmarkSizesHM; i++) {
+				if (benchmarkTimesHM[i] > 0) {
+					int size = 256 << i;
+					ImGui::Text("%5d^2: %9.2f ms (%.1f Msamples/s)", size, benchmarkTimesHM[i], ((float)size * size) / (benchmarkTimesHM[i] * 1000.f));
+				}
+			}
+			if (batchBenchmark.noiseRate[0] > 0) {
+				ImGui::Text("%d^2 Msamples/s: per sample | Scalar | SSE4.1 | AVX2 (%s)", batchBenchmarkSize, batchBenchmark.identical ? "identical" : "different");
+				ImGui::Text("noise:      %8.1f | %8.1f | %8.1f | %8.1f", batchBenchmark.noiseRate[0] / 1e6f, batchBenchmark.noiseRate[1] / 1e6f, batchBenchmark.noiseRate[2] / 1e6f, batchBenchmark.noiseRate[3] / 1e6f);
+				ImGui::Text("fBm %2d oct: %8.2f | %8.2f | %8.2f | %8.2f", PerlinNoiseTexture::heightOctaves, batchBenchmark.fractalRate[0] / 1e6f, batchBenchmark.fractalRate[1] / 1e6f, batchBenchmark.fractalRate[2] / 1e6f, batchBenchmark.fractalRate[3] / 1e6f);
+			}
+
+			// Density map generation benchmark (64^3 to 256^3)
+			if (ImGui::Button("Benchmark DM generation")) {
+				for (int i = 0; i < benchmarkSizesDM; i++) {
+					benchmarkTimesDM[i] = perlinNoiseTexture->BenchmarkDensityMap(64 << i, paramsDMFreq);
+				}
+			}
+			for (int i = 0; i < benchmarkSizesDM; i++) {
+				if (benchmarkTimesDM[i] > 0) {
+					int size = 64 << i;
+					ImGui::Text("%5d^3: %9.2f ms (%.1f Msamples/s)", size, benchmarkTimesDM[i], ((float)size * size * size) / (benchmarkTimesDM[i] * 1000.f));
+				}
+			}
+
+			// Animated density ring generation benchmark (32^3 to 128^3, per time slice)
+			if (ImGui::Button("Benchmark DM ring generation")) {
+				for (int i = 0; i < benchmarkSizesRing; i++) {
+					benchmarkTimesRing[i] = perlinNoiseTexture->BenchmarkDensityRing(32 << i, paramsDMFreq);
+				}
+			}
+			for (int i = 0; i < benchmarkSizesRing; i++) {
+				if (benchmarkTimesRing[i] > 0) {
+					int size = 32 << i;
+					ImGui::Text("%5d^3: %9.2f ms per slice (%.1f Msamples/s)", size, benchmarkTimesRing[i], ((float)size * size * size) / (benchmarkTimesRing[i] * 1000.f));
+				}
+			}
+
+			// Smoothing benchmark with the current smoothing parameters (height map is left unchanged)
+			if (ImGui::Button("Benchmark HM smoothing")) {
+				smoothTime = perlinNoiseTexture->BenchmarkSmoothing(smoothRadius, smoothPasses, smoothGaussian);
+			}
+			if (smoothTime > 0) {
+				ImGui::Text("Smoothing: %.3f ms", smoothTime);
+			}
+
+			// Horizon map bake benchmark (256^2 to 4096^2)
+			if (ImGui::Button("Benchmark horizon map")) {
+				for (int i = 0; i < benchmarkSizesHorizon; i++) {
+					const int size = 256 << i;
+					const std::vector<float> heights = perlinNoiseTexture->GenerateHeights(size, paramsHM.x, paramsHM.y, paramsHM.z);
+					benchmarkTimesHorizon[i] = HorizonMap::BenchmarkBake(BenchmarkHeightField(heights, size), PerlinNoiseTexture::terrainWorldSize / size, PerlinNoiseTexture::terrainDisplacementScale, &perlinNoiseTexture->GetThreadPool());
+				}
+			}
+			for (int i = 0; i < benchmarkSizesHorizon; i++) {
+				if (benchmarkTimesHorizon[i] > 0) {
+					int size = 256 << i;
+					ImGui::Text("%5d^2: %9.2f ms (%.1f Mtexels/s, %d azimuths)", size, benchmarkTimesHorizon[i], ((float)size * size) / (benchmarkTimesHorizon[i] * 1000.f), HorizonMap::azimuthCount);
+				}
+			}
+
+			// Erosion benchmark (256^2 to 1024^2), each run compared with the same run on one thread
+			if (ImGui::Button("Benchmark erosion")) {
+				Erosion::Settings hydraulic = erosionSettings, thermal = erosionSettings;
+				hydraulic.mode = Erosion::Mode::Hydraulic;
+				hydraulic.dropletsPerTexel = 0.25f;
+				thermal.mode = Erosion::Mode::Thermal;
+				thermal.sweeps = 16;
+				// Texels as far apart as the terrain's, so the droplets and slopes behave as on the live map
+				const float spacing = PerlinNoiseTexture::terrainWorldSize / perlinNoiseTexture->GetTerrainSize();
+				for (int i = 0; i < benchmarkSizesErosion; i++) {
+					const int size = 256 << i;
+					const std::vector<float> heights = perlinNoiseTexture->GenerateHeights(size, paramsHM.x, paramsHM.y, paramsHM.z);
+					const HeightField field = BenchmarkHeightField(heights, size);
+					benchmarkErosionHydraulic[i] = Erosion::BenchmarkRun(field, spacing, PerlinNoiseTexture::terrainDisplacementScale, hydraulic, perlinNoiseTexture->GetSeed(), &perlinNoiseTexture->GetThreadPool());
+					benchmarkErosionThermal[i] = Erosion::BenchmarkRun(field, spacing, PerlinNoiseTexture::terrainDisplacementScale, thermal, perlinNoiseTexture->GetSeed(), &perlinNoiseTexture->GetThreadPool());
+				}
+			}
+			for (int i = 0; i < benchmarkSizesErosion; i++) {
+				if (benchmarkErosionHydraulic[i].time > 0) {
+					int size = 256 << i;
+					const Erosion::Benchmark& hydraulic = benchmarkErosionHydraulic[i];
+					const Erosion::Benchmark& thermal = benchmarkErosionThermal[i];
+					ImGui::Text("%5d^2: hydraulic %.2f Mdroplets/s, thermal %.1f sweeps/s (%.1f Mtexels/s)%s", size, hydraulic.rate / 1e6, thermal.rate, thermal.rate * size * size / 1e6,
+						hydraulic.deterministic && thermal.deterministic ? "" : " - differs on one thread");
+				}
+			}
+
+			// Normal map bake time, and how far the baked normals are from the shader's gradient and five-tap normals
+			if (ImGui::Button("Check normal map")) {
+				normalMapCheck = perlinNoiseTexture->CheckNormalMap();
+			}
+			if (normalMapCheck.bakeTime > 0) {
+				ImGui::Text("Normal map: %.3f ms bake, %.2f deg from gradients, %.2f deg from five taps", normalMapCheck.bakeTime, normalMapCheck.maxErrorGradient, normalMapCheck.maxErrorFiniteDifference);
+			}
+
+			// Band-limited fBm (octaves above the grid's Nyquist limit are skipped), and the octave evaluations it saved
+			bool bandLimited = perlinNoiseTexture->GetBandLimited();
+			if (ImGui::Checkbox("Band-limited fBm", &bandLimited)) {
+				perlinNoiseTexture->SetBandLimited(bandLimited);
+			}
+			bool bandLimitFade = perlinNoiseTexture->GetBandLimitFade();
+			if (ImGui::Checkbox("Fade last octave", &bandLimitFade)) {
+				perlinNoiseTexture->SetBandLimitFade(bandLimitFade);
+			}
+			ImGui::Text("Octave evaluations saved: HM %llu, DM %llu, DM ring %llu", perlinNoiseTexture->GetSavedOctavesHM(), perlinNoiseTexture->GetSavedOctavesDM(), perlinNoiseTexture->GetSavedOctavesRing());
+
+			// fBm kernel selection and comparison (specialised kernels must stay within SimplexNoise::fractalMaxUlp of the runtime ones)
+			bool specialisedFractal = perlinNoiseTexture->GetSpecialisedFractal();
+			if (ImGui::Checkbox("Specialised fBm kernels", &specialisedFractal)) {
+				perlinNoiseTexture->SetSpecialisedFractal(specialisedFractal);
+			}
+			if (ImGui::Button("Benchmark fBm kernels")) {
+				kernelBenchmarkHM = SimplexNoise::benchmarkFractal2D(1024, paramsHM.x, PerlinNoiseTexture::heightNoiseScale, &perlinNoiseTexture->GetThreadPool());
+				kernelBenchmarkDM = SimplexNoise::benchmarkFractal3D(128, paramsDMFreq, PerlinNoiseTexture::densityNoiseScale, &perlinNoiseTexture->GetThreadPool());
+			}
+			if (kernelBenchmarkHM.runtimeTime > 0) {
+				ImGui::Text("15 oct 2D: %8.2f -> %8.2f ms (%d ULP, %s)", kernelBenchmarkHM.runtimeTime, kernelBenchmarkHM.specialisedTime, kernelBenchmarkHM.maxUlp, kernelBenchmarkHM.maxUlp <= SimplexNoise::fractalMaxUlp ? "ok" : "FAIL");
+				ImGui::Text("10 oct 3D: %8.2f -> %8.2f ms (%d ULP, %s)", kernelBenchmarkDM.runtimeTime, kernelBenchmarkDM.specialisedTime, kernelBenchmarkDM.maxUlp, kernelBenchmarkDM.maxUlp <= SimplexNoise::fractalMaxUlp ? "ok" : "FAIL");
+			}
+
+			// Hand-written fBm vs the same fBm through the noise graph
+			if (ImGui::Button("Benchmark noise graph")) {
+				graphBenchmark = NoiseGraph::BenchmarkFbm(1024, paramsHM.x, PerlinNoiseTexture::heightOctaves, PerlinNoiseTexture::heightNoiseScale, &perlinNoiseTexture->GetThreadPool());
+			}
+			if (graphBenchmark.handWrittenTime > 0) {
+				ImGui::Text("fBm 1024^2: %8.2f ms, graph: %8.2f ms (%d ULP)", graphBenchmark.handWrittenTime, graphBenchmark.graphTime, graphBenchmark.maxUlp);
+				ImGui::Text("Graph: %d instructions, %d registers", graphBenchmark.instructions, graphBenchmark.registers);
+			}
+		}
+
 		// Perlin Noise controls
 		if (ImGui::CollapsingHeader("Perlin Noise Height Map")) {
-			ImGui::SliderFloat("HM Frequency:", (float*)&paramsHM.x, -20, 20, "%.3f");
-			ImGui::SliderFloat("HM Amplitude:", (float*)&paramsHM.y, -40, 40, "%.1f");
-			generateHM = ImGui::Button("Generate perlin map");
+			// Maps are regenerated on a background thread and swapped in at the start of a later frame
+			ImGui::Checkbox("Regenerate while dragging", &liveRegeneration);
+			// The seed is shared by every map, so a new seed also regenerates the density map (and ring)
+			int seed = (int)perlinNoiseTexture->GetSeed();
+			bool seedChanged = ImGui::InputInt("World seed", &seed);
+			if (seedChanged) {
+				perlinNoiseTexture->SetSeed((uint32_t)(seed < 0 ? 0 : seed));
+				perlinNoiseTexture->RequestDensityMap(paramsDMFreq);
+				if (animatedClouds) perlinNoiseTexture->RequestDensityRing(paramsDMFreq);
+			}
+			int heightShape = (int)perlinNoiseTexture->GetHeightShape();
+			bool shapeChangedHM = ImGui::Combo("HM Shape", &heightShape, shapeNames, IM_ARRAYSIZE(shapeNames));
+			if (shapeChangedHM) perlinNoiseTexture->SetHeightShape((NoiseGraph::Shape)heightShape);
+			bool editedHM = ImGui::SliderFloat("HM Frequency:", (float*)&paramsHM.x, -20, 20, "%.3f");
+			editedHM |= ImGui::SliderFloat("HM Amplitude:", (float*)&paramsHM.y, -40, 40, "%.1f");
+			editedHM |= ImGui::SliderFloat("HM Persistence:", (float*)&paramsHM.z, 0.05f, 1, "%.2f");
+			generateHM = ImGui::Button("Generate perlin map") || seedChanged || shapeChangedHM || (liveRegeneration && editedHM);
 			if (generateHM) {
-				perlinNoiseTexture->GeneratePerlinNoiseTextureHM(renderer->getDevice(), textureMgr, paramsHM.x, paramsHM.y);
-				camera->noiseData = perlinNoiseTexture->GetHeightDataRaw();
-				camera->size = perlinNoiseTexture->GetTerrainSize();
+				perlinNoiseTexture->RequestHeightMap(paramsHM.x, paramsHM.y, paramsHM.z);
+				terrainChunks->SetParameters({ paramsHM.x, paramsHM.y, paramsHM.z, perlinNoiseTexture->GetSeed() }); // The streamed terrain follows (plain fBm, any shape)
 				generateHM = false;
 			}
+			ImGui::SliderInt("Smooth radius", &smoothRadius, 1, 8);
+			ImGui::SliderInt("Smooth passes", &smoothPasses, 1, 4);
+			ImGui::Checkbox("Gaussian smoothing", &smoothGaussian);
 			smooth = ImGui::Button("Smooth Height Map");
 			if (smooth) {
-				perlinNoiseTexture->SmoothHeightMap(renderer->getDevice(), textureMgr);
-				camera->noiseData = perlinNoiseTexture->GetHeightDataRaw();
-				camera->size = perlinNoiseTexture->GetTerrainSize();
+				perlinNoiseTexture->RequestSmoothing(smoothRadius, smoothPasses, smoothGaussian);
+			}
+			if (perlinNoiseTexture->IsRegenerating()) {
+				ImGui::Text("Regenerating...");
+			}
+
+			// Erosion of the live heights, spread over frames (new heights from the sliders stop it)
+			int erosionMode = (int)erosionSettings.mode;
+			if (ImGui::Combo("Erosion", &erosionMode, erosionModeNames, IM_ARRAYSIZE(erosionModeNames))) erosionSettings.mode = (Erosion::Mode)erosionMode;
+			if (erosionSettings.mode == Erosion::Mode::Hydraulic) {
+				ImGui::SliderFloat("Droplets per texel", &erosionSettings.dropletsPerTexel, 0.1f, 8.f, "%.2f");
+				ImGui::SliderFloat("Erode rate", &erosionSettings.erodeRate, 0.01f, 1.f, "%.2f");
+				ImGui::SliderFloat("Deposit rate", &erosionSettings.depositRate, 0.01f, 1.f, "%.2f");
+			}
+			else {
+				ImGui::SliderInt("Thermal sweeps", &erosionSettings.sweeps, 1, 500);
+				ImGui::SliderFloat("Talus angle", &erosionSettings.talusAngle, 5.f, 60.f, "%.1f deg");
+			}
+			if (ImGui::Button("Erode Height Map")) {
+				perlinNoiseTexture->StartErosion(erosionSettings);
+			}
+			const Erosion& erosion = perlinNoiseTexture->GetErosion();
+			if (erosion.IsRunning()) {
+				ImGui::SameLine();
+				if (ImGui::Button("Stop erosion")) perlinNoiseTexture->StopErosion(renderer->getDeviceContext());
+				ImGui::Text("Eroding: %.0f%%", erosion.GetProgress() * 100.f);
+			}
+			if (erosion.GetIterations() > 0) {
+				ImGui::Text("Erosion: %llu %s, %.0f per second", erosion.GetIterations(), erosion.GetMode() == Erosion::Mode::Hydraulic ? "droplets" : "sweeps", erosion.GetRate());
 			}
 		}
 		if (ImGui::CollapsingHeader("Perlin Noise Density Map")) {
-			ImGui::SliderFloat("DM Frequency:", (float*)&paramsDMFreq, -2, 2, "% .3f");
-			generateDM = ImGui::Button("Generate density map");
+			// The shape applies to the static density map (the animated ring stays plain fBm)
+			int densityShape = (int)perlinNoiseTexture->GetDensityShape();
+			bool shapeChangedDM = ImGui::Combo("DM Shape", &densityShape, shapeNames, IM_ARRAYSIZE(shapeNames));
+			if (shapeChangedDM) perlinNoiseTexture->SetDensityShape((NoiseGraph::Shape)densityShape);
+			bool editedDM = ImGui::SliderFloat("DM Frequency:", (float*)&paramsDMFreq, -2, 2, "% .3f");
+			generateDM = ImGui::Button("Generate density map") || shapeChangedDM || (liveRegeneration && editedDM);
 			if (generateDM) {
-				perlinNoiseTexture->GeneratePerlinNoiseTextureDM(renderer->getDevice(), textureMgr, paramsDMFreq);
+				perlinNoiseTexture->RequestDensityMap(paramsDMFreq);
+				if (animatedClouds) perlinNoiseTexture->RequestDensityRing(paramsDMFreq);
 				generateDM = false;
 			}
+			// The ring is baked when first enabled, then regenerated in the background with the density map
+			if (ImGui::Checkbox("Animated density (looping)", &animatedClouds) && animatedClouds) {
+				if (!perlinNoiseTexture->HasDensityRing()) perlinNoiseTexture->GeneratePerlinNoiseTextureDMRing(renderer->getDevice(), paramsDMFreq);
+				else perlinNoiseTexture->RequestDensityRing(paramsDMFreq);
+			}
+			ImGui::SliderFloat("Loop period (s)", &cloudLoopPeriod, 5, 120, "%.1f");
+			if (perlinNoiseTexture->HasDensityRing()) {
+				ImGui::Text("Ring: %d slices, %.3f ms per slice", perlinNoiseTexture->GetDensityRingSlices(), perlinNoiseTexture->GetGenerationTimeRing());
+			}
 		}
 
 		// Directional Light Controls.
@@ -1519,6 +2022,55 @@ void App1::gui() {
 	// Player Data.
 	if (ImGui::CollapsingHeader("Player")) {
 		ImGui::Indent();
+		if (ImGui::Button("Benchmark movement")) {
+			movementBenchmark = Camera::benchmarkMovement(movementBenchmarkSize);
+		}
+		if (movementBenchmark.viewRate > 0) {
+			ImGui::Text("%d^2 terrain: %.1f M updates/s (shared view), %.1f updates/s (copy per update)", movementBenchmarkSize, movementBenchmark.viewRate / 1e6f, movementBenchmark.copyRate);
+		}
+		if (ImGui::Button("Benchmark height queries")) {
+			queryBenchmark = HeightFieldQuery::BenchmarkBicubic(perlinNoiseTexture->GetHeightField(), queryBenchmarkPoints);
+		}
+		if (queryBenchmark.scalarTime > 0) {
+			ImGui::Text("%d bicubic queries: scalar %.3f ms, batched %.3f ms (%s)", queryBenchmarkPoints, queryBenchmark.scalarTime, queryBenchmark.batchedTime, queryBenchmark.identical ? "identical" : "different");
+		}
+		if (ImGui::Button("Benchmark ray casts")) {
+			for (int i = 0; i < 2; i++) {
+				const std::vector<float> heights = perlinNoiseTexture->GenerateHeights(raycastBenchmarkSizes[i], paramsHM.x, paramsHM.y, paramsHM.z);
+				raycastBenchmarks[i] = HeightPyramid::BenchmarkRaycast(BenchmarkHeightField(heights, raycastBenchmarkSizes[i]), raycastBenchmarkRays, &perlinNoiseTexture->GetThreadPool());
+			}
+		}
+		for (int i = 0; i < 2; i++) {
+			if (raycastBenchmarks[i].buildTime > 0) {
+				ImGui::Text("%d^2 terrain: build %.1f ms, pyramid %.2f M rays/s, march %.2f M rays/s (%d mismatches)", raycastBenchmarkSizes[i], raycastBenchmarks[i].buildTime, raycastBenchmarks[i].pyramidRate / 1e6f, raycastBenchmarks[i].marchRate / 1e6f, raycastBenchmarks[i].mismatches);
+			}
+		}
+		if (ImGui::Button("Benchmark quadtree selection")) {
+			for (int i = 0; i < 2; i++) {
+				const std::vector<float> heights = perlinNoiseTexture->GenerateHeights(quadtreeBenchmarkSizes[i], paramsHM.x, paramsHM.y, paramsHM.z);
+				quadtreeBenchmarks[i] = TerrainQuadtree::BenchmarkSelection(BenchmarkHeightField(heights, quadtreeBenchmarkSizes[i]), quadtreeBenchmarkViews, &perlinNoiseTexture->GetThreadPool());
+			}
+		}
+		for (int i = 0; i < 2; i++) {
+			const TerrainQuadtree::SelectionBenchmark& result = quadtreeBenchmarks[i];
+			if (result.lods > 0) {
+				ImGui::Text("%d^2 terrain (%d LODs): camera %.1f nodes (%.1f visited, %.1f culled) in %.2f us", quadtreeBenchmarkSizes[i], result.lods, result.cameraSelected, result.cameraVisited, result.cameraCulled, result.cameraTime);
+				ImGui::Text("%d^2 terrain (%d LODs): light %.1f nodes (%.1f visited, %.1f culled) in %.2f us", quadtreeBenchmarkSizes[i], result.lods, result.lightSelected, result.lightVisited, result.lightCulled, result.lightTime);
+			}
+		}
+
+		// Terrain under the crosshair (a ray along the view direction, cast through the pyramid)
+		XMFLOAT3 viewRotation = camera->getRotation(), viewPosition = camera->getPosition();
+		float viewPitch = viewRotation.x * 0.0174532f, viewYaw = viewRotation.y * 0.0174532f;
+		HeightPyramid::Ray viewRay = { viewPosition.x, viewPosition.y, viewPosition.z, sinf(viewYaw) * cosf(viewPitch), -sinf(viewPitch), cosf(viewYaw) * cosf(viewPitch), 1000.f };
+		HeightPyramid::Hit viewHit;
+		perlinNoiseTexture->GetHeightPyramid().Intersect(&viewRay, &viewHit, 1);
+		if (viewHit.hit) {
+			ImGui::Text("Crosshair: terrain at %.2f, normal X: %.3f, Y: %.3f, Z: %.3f", viewHit.t, viewHit.normalX, viewHit.normalY, viewHit.normalZ);
+		}
+		else {
+			ImGui::Text("Crosshair: no terrain");
+		}
 		ImGui::Text("Player's Position: X: %.4f, Y: %.4f, Z: %.4f", camera->getPosition().x, camera->getPosition().y, camera->getPosition().z);
 		ImGui::Text("Player's Rotation: X: %.4f, Y: %.4f, Z: %.4f", camera->getRotation().x, camera->getRotation().y, camera->getRotation().z);
 		ImGui::Unindent();
@@ -1528,6 +2080,28 @@ void App1::gui() {
 	if (ImGui::CollapsingHeader("Scene Enhancements")) {
 		ImGui::Indent();
 		ImGui::Checkbox("Shadows?", &shadowBool);
+		ImGui::Checkbox("Horizon map terrain shadows?", &horizonShadowBool);
+		if (perlinNoiseTexture->GetHorizonMap().IsBaking()) {
+			ImGui::Text("Rebaking horizon map: %.0f%%", perlinNoiseTexture->GetHorizonMap().GetProgress() * 100.f);
+		}
+		// Streamed terrain: unbounded, generated in chunks around the camera (the height map's edits and shadows stay on the height map)
+		if (ImGui::Checkbox("Streamed terrain? (unbounded)", &streamedTerrainBool)) {
+			if (streamedTerrainBool) camera->terrain = terrainChunks;
+			else {
+				camera->terrain = &perlinNoiseTexture->GetHeightField();
+				camera->setPosition(28, 10, 27);
+			}
+		}
+		if (streamedTerrainBool) {
+			ImGui::Text("Chunks: %d resident (%.1f / %.0f MB), %d pending", terrainChunks->GetResidentCount(), terrainChunks->GetMemoryBytes() / 1048576.f, terrainChunks->GetMemoryBudget() / 1048576.f, terrainChunks->GetPendingCount());
+			ImGui::Text("Chunks: %llu generated (%.2f ms each), %llu evicted", terrainChunks->GetGeneratedCount(), terrainChunks->GetMeanGenerationTime(), terrainChunks->GetEvictedCount());
+		}
+		// Quadtree terrain: the height map drawn as the CDLOD nodes in each view's frustum, instead of the whole main mesh in every pass
+		ImGui::Checkbox("Quadtree terrain? (CDLOD, culled per view)", &quadtreeTerrainBool);
+		if (quadtreeTerrainBool && !streamedTerrainBool) {
+			ImGui::Text("Quadtree: %d LODs, nodes: camera %d, clouds depth %d, lights %d / %d", terrainQuadtree->GetLodCount(), terrainNodesSelected[0], terrainNodesSelected[1], terrainNodesSelected[2], terrainNodesSelected[3]);
+			ImGui::Text("Quadtree: selection %.1f us per frame", terrainSelectionTime);
+		}
 		ImGui::Checkbox("Post-Processing?", &postProcessingBool);
 		ImGui::Checkbox("Time?", &timeBool);
 		ImGui::Checkbox("Gravity?", &gravity);
@@ -1544,6 +2118,36 @@ void App1::gui() {
 		ImGui::Unindent();
 	}
 
+	// Meshes Section: the meshes of the mesh manager (built on first use, released over the budget when unused), with their
+	// memory and the vertex reuse of the indexed ones (see VertexCache).
+	if (ImGui::CollapsingHeader("Meshes")) {
+		ImGui::Indent();
+		if (ImGui::SliderInt("Mesh budget (MB)", &meshBudgetMB, 1, 512)) {
+			meshMgr->setBudget((size_t)meshBudgetMB << 20);
+		}
+		for (int i = 0; i < meshMgr->getEntryCount(); i++) {
+			const MeshManager::Entry& entry = meshMgr->getEntry(i);
+			BaseMesh* mesh = entry.mesh;
+			if (!mesh) {
+				ImGui::Text("%s: not built (built %d times)", entry.uid.c_str(), entry.builds);
+				continue;
+			}
+			const int indexBits = mesh->getIndexCount() > 0 ? (int)(mesh->getIndexBytes() / mesh->getIndexCount()) * 8 : 0;
+			if (mesh->getACMR() > 0.f)
+				ImGui::Text("%s: %d vertices (%u bytes), %d indices (%d-bit), GPU %.1f KB, CPU %.1f KB, built in %.2f ms, ACMR %.3f, ATVR %.3f", entry.uid.c_str(), mesh->getVertexCount(), mesh->getVertexStride(), mesh->getIndexCount(), indexBits, entry.gpuBytes / 1024.f, entry.cpuBytes / 1024.f, entry.buildTime, mesh->getACMR(), mesh->getATVR());
+			else
+				ImGui::Text("%s: %d vertices (%u bytes), %d indices (%d-bit), GPU %.1f KB, CPU %.1f KB, built in %.2f ms", entry.uid.c_str(), mesh->getVertexCount(), mesh->getVertexStride(), mesh->getIndexCount(), indexBits, entry.gpuBytes / 1024.f, entry.cpuBytes / 1024.f, entry.buildTime);
+		}
+		ImGui::Text("Total: %d of %d meshes built, GPU %.2f MB, CPU %.2f MB of a %d MB budget", meshMgr->getBuiltCount(), meshMgr->getEntryCount(), meshMgr->getGpuBytes() / (1024.f * 1024.f), meshMgr->getCpuBytes() / (1024.f * 1024.f), meshBudgetMB);
+		ImGui::Text("Built in %.1f ms in all, %llu released over the budget", meshMgr->getBuildTime(), meshMgr->getEvictedCount());
+
+		// The sky dome is rebuilt when drawn next with the other mapping.
+		if (ImGui::Checkbox("Equal-area sky dome", &equalAreaSkyDome)) {
+			meshMgr->releaseMesh("sky dome");
+		}
+		ImGui::Unindent();
+	}
+
 	// Reset Time Section.
 	if (ImGui::CollapsingHeader("Reset Time")) {
 		ImGui::Indent();
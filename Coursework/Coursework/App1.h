@@ -22,6 +22,9 @@ static const int lightSize = 2;
 #include "ColorGradingShader.h"  // Color grading shader header
 #include "SunShader.h"           // Sun shader header for sun rendering
 #include "PerlinNoiseTexture.h"  // Perlin noise texture generator for perlin based terrain manipulation
+#include "HeightFieldQuery.h"    // Batched height queries on the terrain height field
+#include "TerrainChunks.h"       // Unbounded terrain streamed in chunks around the camera
+#include "TerrainQuadtree.h"     // CDLOD quadtree selecting the terrain patches of each view
 
 // Main application class that handles initialization, rendering, and various post-processing effects.
 class App1 : public BaseApplication
@@ -63,6 +66,10 @@ protected:
     // Function to update positions of objects based on collision and height of others.
     void UpdatePositions();
 
+    // Functions to select the terrain quadtree nodes in view (LODs from the camera) and get the constants to draw one of them.
+    void selectTerrainNodes(const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, int view);
+    TerrainQuadtree::NodeConstants terrainNodeConstants(const TerrainQuadtree::Node& node);
+
 private:
     // Shader objects
     DepthShader* linearDepthShaderTess;      // Tessellated linear depth shader (for clouds)
@@ -82,15 +89,9 @@ private:
     ColorGradingShader* colorFilterShader;   // Shader for color grading
     SunShader* sunShader;                    // Sun rendering shader
 
-    // Mesh objects
-    PlaneMesh* mainMesh;                // Main plane mesh for terrain or background
-    PlaneMesh* cloudsPlane;             // Plane mesh for clouds
-	CubeMesh* volumetricCloudBox;       // Box mesh for volumetric clouds
-    AModel* spotlightModel;             // Model for spotlight
-    AModel* cottageModel;               // Model for a cottage or similar object
-	AModel* coinModel;			        // Model for a coin or similar object
-    SphereMesh* skyDome;                // SkyDome class for rendering the sky
-    SphereMesh* sunSphere;              // Sphere mesh for the sun
+    // Mesh objects are registered with the mesh manager (meshMgr) by name: "terrain" (main plane mesh), "terrain chunk"
+    // (shared by the streamed terrain chunks), "terrain node" and "terrain quadrant" (grids of the quadtree nodes and of
+    // their quadrants), "clouds plane", "cloud box", "spotlight", "cottage", "coin", "sky dome" and "sun"
 
     // Render targets for various passes
     RenderTexture* renderTextureSource;         // Source texture for the first render pass
@@ -115,6 +116,8 @@ private:
     // Miscellaneous
     bool wireframeToggle;                       // Flag for enabling/disabling wireframe mode
     PerlinNoiseTexture* perlinNoiseTexture;     // Perlin noise texture generator
+    TerrainChunks* terrainChunks;               // Streamed terrain chunks (generated in the background around the camera)
+    TerrainQuadtree* terrainQuadtree;           // Quadtree over the height map's pyramid, selecting the terrain nodes to draw
 };
 
 #endif
\ No newline at end of file
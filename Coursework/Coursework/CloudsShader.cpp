@@ -136,7 +136,8 @@ void CloudsShader::initShader(const wchar_t* vsFilename, const wchar_t* psFilena
 }
 
 // Set the shader parameters for the pixel and vertex shaders, including the scroll speed and time.
-void CloudsShader::setShaderParameters(ID3D11DeviceContext* deviceContext, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* depthTexture, XMFLOAT3 cameraPos, XMFLOAT3 cloudBoxCentre, XMFLOAT3 halfSize, XMFLOAT3 lightDirection, XMFLOAT4 lightColor, float sigma_s, XMFLOAT2 scrollSpeed, float time, XMFLOAT4 gasColor, XMFLOAT3 sA_SamNo_G, float gasDensity)
+// nextTexture is the next time slice of an animated density (the density texture itself when not animated).
+void CloudsShader::setShaderParameters(ID3D11DeviceContext* deviceContext, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* depthTexture, XMFLOAT3 cameraPos, XMFLOAT3 cloudBoxCentre, XMFLOAT3 halfSize, XMFLOAT3 lightDirection, XMFLOAT4 lightColor, float sigma_s, XMFLOAT2 scrollSpeed, float time, XMFLOAT4 gasColor, XMFLOAT3 sA_SamNo_G, float gasDensity, ID3D11ShaderResourceView* nextTexture, float sliceBlend)
 {
     HRESULT result;
     D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -190,7 +191,7 @@ void CloudsShader::setShaderParameters(ID3D11DeviceContext* deviceContext, const
     scrollPtr = (ScrollBuffer*)mappedResource.pData;
     scrollPtr->scrollSpeed = scrollSpeed;
     scrollPtr->time = time;
-    scrollPtr->padding = 0.f;
+    scrollPtr->sliceBlend = nextTexture ? sliceBlend : 0.f;
     deviceContext->Unmap(scrollBuffer, 0);
     deviceContext->PSSetConstantBuffers(3, 1, &scrollBuffer);
 
@@ -207,5 +208,7 @@ void CloudsShader::setShaderParameters(ID3D11DeviceContext* deviceContext, const
     // Set shader texture and sampler resources in the pixel shader.
     deviceContext->PSSetShaderResources(0, 1, &texture);
     deviceContext->PSSetShaderResources(1, 1, &depthTexture);
+    if (!nextTexture) nextTexture = texture;
+    deviceContext->PSSetShaderResources(2, 1, &nextTexture);
     deviceContext->PSSetSamplers(0, 1, &sampleState);
 }
\ No newline at end of file
@@ -33,7 +33,7 @@ private:
     struct ScrollBuffer {
         XMFLOAT2 scrollSpeed;               // Scrolling speed in X and Y   
         float time;                         // elapsed time
-        float padding;                      
+        float sliceBlend;                   // blend from the density texture to the next density time slice
     };
 
     // Structure to hold the gas properties data
@@ -53,7 +53,8 @@ public:
     // Method to set parameters for the shader
     void setShaderParameters(ID3D11DeviceContext* deviceContext,
         const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection,
-        ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* depthTexture, XMFLOAT3 cameraPos, XMFLOAT3 cloudBoxCentre, XMFLOAT3 halfSize, XMFLOAT3 lightDirection, XMFLOAT4 lightColor, float sigma_s, XMFLOAT2 scrollSpeed, float time, XMFLOAT4 gasColor, XMFLOAT3 sA_SamNo_G, float gasDensity);
+        ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* depthTexture, XMFLOAT3 cameraPos, XMFLOAT3 cloudBoxCentre, XMFLOAT3 halfSize, XMFLOAT3 lightDirection, XMFLOAT4 lightColor, float sigma_s, XMFLOAT2 scrollSpeed, float time, XMFLOAT4 gasColor, XMFLOAT3 sA_SamNo_G, float gasDensity,
+        ID3D11ShaderResourceView* nextTexture = nullptr, float sliceBlend = 0.f);
 
 private:
     // Initializes the shader and its resources
@@ -1,6 +1,7 @@
 // Texture and sampler for applying textures
 Texture3D texture0 : register(t0); // The density texture
 Texture2D depthTex : register(t1); // The linear depth texture
+Texture3D texture1 : register(t2); // The next time slice of the density texture (animated density)
 SamplerState Sampler0 : register(s0); // The sampler state for the texture
 
 // Constant buffer for camera position
@@ -29,7 +30,7 @@ cbuffer ScrollBuffer : register(b3)
 {
     float2 scrollSpeed;
     float time;
-    float padding;
+    float sliceBlend; // blend towards the next density time slice
 }
 
 // Constant buffer for gas properties
@@ -134,7 +135,7 @@ float4 main(InputType input) : SV_TARGET
         // evaluating the perlin value
         float3 uvw = (samplePoint - boxMin) / (boxMax - boxMin);
         uvw += float3(scrollSpeed.x * time, 0, scrollSpeed.y * time);
-        float perlinVal = texture0.SampleLevel(Sampler0, uvw, 0).r;
+        float perlinVal = lerp(texture0.SampleLevel(Sampler0, uvw, 0).r, texture1.SampleLevel(Sampler0, uvw, 0).r, sliceBlend);
         
         // Combined density
         rho = density * (perlinVal * 0.5 + 0.5);
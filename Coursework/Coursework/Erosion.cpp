@@ -0,0 +1,329 @@
+#include "Erosion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Distance a droplet may travel out of its tile: its brush and deposits then stay clear of the tiles of the same colour
+// (2 * (reach + maxBrushRadius + 1) < tileSize)
+static const int tileReach = Erosion::tileSize / 2 - Erosion::maxBrushRadius - 2;
+
+// Mixing a 64-bit value into a well-distributed one (splitmix64 finaliser)
+static uint64_t MixBits(uint64_t z) {
+	z += 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+// Random generator of a tile's droplets (xorshift64*), seeded from the run seed, the pass and the tile
+struct DropletRandom {
+	uint64_t state;
+
+	DropletRandom(uint32_t seed, int pass, int tileX, int tileY) {
+		state = MixBits(MixBits(MixBits(seed) ^ (uint64_t)pass) ^ ((uint64_t)(uint32_t)tileY << 32 | (uint32_t)tileX));
+		if (state == 0) state = 1;
+	}
+
+	// Uniform float in [0, 1)
+	float Next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (float)((state * 0x2545F4914F6CDD1Dull) >> 40) * (1.f / 16777216.f);
+	}
+};
+
+// Constructor with initialisation (no run until Begin)
+Erosion::Erosion() {
+	seed = 0;
+	size = 0;
+	toCells = 1.f;
+	pass = passCount = 0;
+	colour = nextTile = nextRow = 0;
+	iterations = 0;
+	runTime = 0.0;
+	tileOffsetX = tileOffsetY = tilesX = tilesY = 0;
+}
+
+// Starting a run over a copy of the heights (scaled to world units per sample spacing)
+void Erosion::Begin(const HeightField& heightField, float sampleSpacing, float heightScale, const Settings& runSettings, uint32_t runSeed) {
+	settings = runSettings;
+	settings.brushRadius = std::max(1, std::min(settings.brushRadius, (int)maxBrushRadius));
+	seed = runSeed;
+	size = heightField.isValid() ? heightField.size : 0;
+	toCells = heightScale / sampleSpacing;
+	heights.resize((size_t)size * size);
+	for (size_t i = 0; i < heights.size(); i++) heights[i] = heightField.heights[i] * toCells;
+
+	// Brush weights falling off linearly to the radius
+	const int radius = settings.brushRadius;
+	brushX.clear();
+	brushY.clear();
+	brushWeights.clear();
+	float weightSum = 0.f;
+	for (int y = -radius; y <= radius; y++) {
+		for (int x = -radius; x <= radius; x++) {
+			const float weight = radius - sqrtf((float)(x * x + y * y));
+			if (weight <= 0.f) continue;
+			brushX.push_back(x);
+			brushY.push_back(y);
+			brushWeights.push_back(weight);
+			weightSum += weight;
+		}
+	}
+	for (float& weight : brushWeights) weight /= weightSum;
+
+	pass = colour = nextTile = nextRow = 0;
+	if (size < 2) passCount = 0;
+	else if (settings.mode == Mode::Hydraulic) passCount = std::max(1, (int)ceilf(settings.dropletsPerTexel * texelsPerDroplet));
+	else {
+		passCount = std::max(settings.sweeps, 0);
+		nextSweep.resize(heights.size());
+	}
+	iterations = 0;
+	runTime = 0.0;
+	if (IsRunning() && settings.mode == Mode::Hydraulic) PlaceTiles();
+}
+
+// Moving the tile grid by a pseudo-random offset of the pass
+void Erosion::PlaceTiles() {
+	const uint64_t offset = MixBits(MixBits(seed) ^ ~(uint64_t)pass);
+	tileOffsetX = (int)(offset % tileSize);
+	tileOffsetY = (int)((offset >> 32) % tileSize);
+	tilesX = (size + tileOffsetX + tileSize - 1) / tileSize;
+	tilesY = (size + tileOffsetY + tileSize - 1) / tileSize;
+}
+
+// Tiles of a colour: every other tile along x (starting at colour bit 0) and y (starting at colour bit 1)
+int Erosion::TileCount(int tileColour) const {
+	return ((tilesX - (tileColour & 1) + 1) / 2) * ((tilesY - (tileColour >> 1) + 1) / 2);
+}
+
+void Erosion::TileOf(int tileColour, int index, int& tileX, int& tileY) const {
+	const int perRow = (tilesX - (tileColour & 1) + 1) / 2;
+	tileX = (tileColour & 1) + 2 * (index % perRow);
+	tileY = (tileColour >> 1) + 2 * (index / perRow);
+}
+
+// Droplets of a tile, one per texelsPerDroplet texels, starting anywhere in the tile (clipped to the map)
+int Erosion::ErodeTile(int tileX, int tileY) {
+	const int x0 = std::max(tileX * tileSize - tileOffsetX, 0), x1 = std::min((tileX + 1) * tileSize - tileOffsetX, size - 1);
+	const int y0 = std::max(tileY * tileSize - tileOffsetY, 0), y1 = std::min((tileY + 1) * tileSize - tileOffsetY, size - 1);
+	if (x1 <= x0 || y1 <= y0) return 0;
+	const int droplets = std::max((x1 - x0) * (y1 - y0) / texelsPerDroplet, 1);
+	DropletRandom random(seed, pass, tileX, tileY);
+	for (int d = 0; d < droplets; d++) {
+		const float x = x0 + random.Next() * (x1 - x0);
+		const float y = y0 + random.Next() * (y1 - y0);
+		RunDroplet(x, y, (float)(x0 - tileReach), (float)(y0 - tileReach), (float)(x1 + tileReach), (float)(y1 + tileReach));
+	}
+	return droplets;
+}
+
+// Following a droplet downhill (Beyer, 2015)
+// Each step moves one texel along the droplet's direction, turned towards the downhill gradient (bilinear over its cell).
+// Going down, the droplet erodes around its cell up to its sediment capacity (never more than the drop, so it cannot dig
+// a pit), going up or over capacity it deposits on the corners of its cell.
+// Wherever the droplet stops (in a pit, at the map or tile edge, or out of steps), it leaves the rest of its sediment around
+// its last cell, so no material is lost (otherwise the map edges keep sinking as droplets carry material out of the map).
+void Erosion::RunDroplet(float x, float y, float minX, float minY, float maxX, float maxY) {
+	const Settings& s = settings;
+	float* h = heights.data();
+	minX = std::max(minX, 0.f);
+	minY = std::max(minY, 0.f);
+	maxX = std::min(maxX, (float)(size - 1));
+	maxY = std::min(maxY, (float)(size - 1));
+
+	float dirX = 0.f, dirY = 0.f, speed = 1.f, water = 1.f, sediment = 0.f;
+	for (int step = 0; step < s.maxSteps; step++) {
+		const int cellX = (int)x, cellY = (int)y;
+		const float u = x - cellX, v = y - cellY;
+		const size_t cell = (size_t)cellY * size + cellX;
+		const float h00 = h[cell], h10 = h[cell + 1], h01 = h[cell + size], h11 = h[cell + size + 1];
+		const float height = (h00 * (1.f - u) + h10 * u) * (1.f - v) + (h01 * (1.f - u) + h11 * u) * v;
+		const float gradientX = (h10 - h00) * (1.f - v) + (h11 - h01) * v;
+		const float gradientY = (h01 - h00) * (1.f - u) + (h11 - h10) * u;
+
+		dirX = dirX * s.inertia - gradientX * (1.f - s.inertia);
+		dirY = dirY * s.inertia - gradientY * (1.f - s.inertia);
+		const float length = sqrtf(dirX * dirX + dirY * dirY);
+		if (length < 1e-6f) break;
+		dirX /= length;
+		dirY /= length;
+		if (x + dirX < minX || y + dirY < minY || x + dirX >= maxX || y + dirY >= maxY) break;
+		x += dirX;
+		y += dirY;
+
+		// Height at the new position (its cell may be the same one, already eroded this step)
+		const int nextX = (int)x, nextY = (int)y;
+		const float nu = x - nextX, nv = y - nextY;
+		const size_t next = (size_t)nextY * size + nextX;
+		const float newHeight = (h[next] * (1.f - nu) + h[next + 1] * nu) * (1.f - nv) + (h[next + size] * (1.f - nu) + h[next + size + 1] * nu) * nv;
+		const float drop = newHeight - height;
+
+		const float capacity = std::max(-drop * speed * water * s.capacity, s.minCapacity);
+		if (sediment > capacity || drop > 0.f) {
+			const float amount = drop > 0.f ? std::min(drop, sediment) : (sediment - capacity) * s.depositRate;
+			sediment -= amount;
+			h[cell] += amount * (1.f - u) * (1.f - v);
+			h[cell + 1] += amount * u * (1.f - v);
+			h[cell + size] += amount * (1.f - u) * v;
+			h[cell + size + 1] += amount * u * v;
+		}
+		else {
+			const float amount = std::min((capacity - sediment) * s.erodeRate, -drop);
+			ApplyBrush(cellX, cellY, -amount);
+			sediment += amount;
+		}
+
+		speed = sqrtf(std::max(speed * speed - drop * s.gravity, 0.f));
+		water *= 1.f - s.evaporation;
+	}
+
+	// Remaining sediment, spread around the cell of the last position the droplet was at
+	ApplyBrush((int)x, (int)y, sediment);
+}
+
+// Adding the brush weights times amount around a cell
+// Brush cells outside the map are skipped, the others take their share of the whole amount.
+void Erosion::ApplyBrush(int cellX, int cellY, float amount) {
+	float* h = heights.data();
+	const int radius = settings.brushRadius;
+	const bool clipped = cellX < radius || cellY < radius || cellX >= size - radius || cellY >= size - radius;
+	float weightSum = 1.f;
+	if (clipped) {
+		weightSum = 0.f;
+		for (size_t b = 0; b < brushWeights.size(); b++) {
+			const int bx = cellX + brushX[b], by = cellY + brushY[b];
+			if (bx >= 0 && by >= 0 && bx < size && by < size) weightSum += brushWeights[b];
+		}
+	}
+	const float scale = amount / weightSum;
+	for (size_t b = 0; b < brushWeights.size(); b++) {
+		const int bx = cellX + brushX[b], by = cellY + brushY[b];
+		if (clipped && (bx < 0 || by < 0 || bx >= size || by >= size)) continue;
+		h[(size_t)by * size + bx] += scale * brushWeights[b];
+	}
+}
+
+// Material moved between each texel and its 8 neighbours, read from the last sweep
+// A pair whose slope is over the talus slope moves a share of the excess downhill. Every pair is evaluated from both of
+// its texels with the same difference, so the material leaving one texel is exactly what the other receives.
+// A texel gives at most half its excess (8 neighbours at rate 1 / 16), so the sweeps stay stable.
+void Erosion::SweepRows(int firstRow, int lastRow) {
+	const float talus = tanf(settings.talusAngle * 0.0174532925f);
+	const float talusDiagonal = talus * 1.41421356f;
+	const float rate = std::min(std::max(settings.thermalRate, 0.f), 1.f) / 16.f;
+	const float* h = heights.data();
+	for (int y = firstRow; y < lastRow; y++) {
+		for (int x = 0; x < size; x++) {
+			const float height = h[(size_t)y * size + x];
+			float change = 0.f;
+			for (int dy = -1; dy <= 1; dy++) {
+				const int ny = y + dy;
+				if (ny < 0 || ny >= size) continue;
+				for (int dx = -1; dx <= 1; dx++) {
+					const int nx = x + dx;
+					if ((dx == 0 && dy == 0) || nx < 0 || nx >= size) continue;
+					const float difference = height - h[(size_t)ny * size + nx];
+					const float limit = (dx != 0 && dy != 0) ? talusDiagonal : talus;
+					if (difference > limit) change -= rate * (difference - limit);
+					else if (difference < -limit) change += rate * (-difference - limit);
+				}
+			}
+			nextSweep[(size_t)y * size + x] = height + change;
+		}
+	}
+}
+
+// Eroding up to tilesPerStep tiles of the current colour, then moving on to the next colour or pass
+void Erosion::StepHydraulic(ThreadPool* pool) {
+	const int first = nextTile;
+	const int count = std::min((int)tilesPerStep, TileCount(colour) - first);
+	std::vector<int> droplets(count, 0);
+	ThreadPool::Task tiles = [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			int tileX, tileY;
+			TileOf(colour, first + t, tileX, tileY);
+			droplets[t] = ErodeTile(tileX, tileY);
+		}
+	};
+	if (!pool || !pool->TryParallelFor(count, 1, tiles)) tiles(0, count);
+	for (int d : droplets) iterations += d;
+
+	nextTile += count;
+	if (nextTile < TileCount(colour)) return;
+	nextTile = 0;
+	if (++colour < 4) return;
+	colour = 0;
+	if (++pass < passCount) PlaceTiles();
+}
+
+// Sweeping up to rowsPerStep rows, then swapping the sweep in once every row is done
+void Erosion::StepThermal(ThreadPool* pool) {
+	const int first = nextRow;
+	const int count = std::min((int)rowsPerStep, size - first);
+	ThreadPool::Task rows = [&](int begin, int end) { SweepRows(first + begin, first + end); };
+	if (!pool || !pool->TryParallelFor(count, rowsPerBlock, rows)) rows(0, count);
+
+	nextRow += count;
+	if (nextRow < size) return;
+	nextRow = 0;
+	heights.swap(nextSweep);
+	iterations++;
+	pass++;
+}
+
+// Running steps until the budget runs out
+bool Erosion::Run(ThreadPool* pool, float budgetMs) {
+	if (!IsRunning()) return false;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	float elapsed = 0.f;
+	while (IsRunning()) {
+		if (settings.mode == Mode::Hydraulic) StepHydraulic(pool);
+		else StepThermal(pool);
+		elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		if (budgetMs >= 0.f && elapsed >= budgetMs) break;
+	}
+	runTime += elapsed;
+	return !IsRunning();
+}
+
+// Passes done, with the part of the current pass
+float Erosion::GetProgress() const {
+	if (!IsRunning()) return 1.f;
+	float part;
+	if (settings.mode == Mode::Hydraulic) part = (colour + (float)nextTile / std::max(TileCount(colour), 1)) / 4.f;
+	else part = (float)nextRow / size;
+	return (pass + part) / passCount;
+}
+
+// Scaling the heights back to height units
+void Erosion::GetHeights(float* out) const {
+	const float toHeights = 1.f / toCells;
+	for (size_t i = 0; i < heights.size(); i++) out[i] = heights[i] * toHeights;
+}
+
+// Timing a run over a height field on the pool, then checking the run on the calling thread matches it
+Erosion::Benchmark Erosion::BenchmarkRun(const HeightField& heightField, float sampleSpacing, float heightScale, const Settings& runSettings,
+	uint32_t runSeed, ThreadPool* pool) {
+	Benchmark result;
+	Erosion run;
+	run.Begin(heightField, sampleSpacing, heightScale, runSettings, runSeed);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	run.Run(pool, -1.f);
+	result.time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	result.rate = run.GetRate();
+
+	Erosion reference;
+	reference.Begin(heightField, sampleSpacing, heightScale, runSettings, runSeed);
+	reference.Run(nullptr, -1.f);
+	const size_t count = (size_t)heightField.size * heightField.size;
+	std::vector<float> eroded(count), expected(count);
+	run.GetHeights(eroded.data());
+	reference.GetHeights(expected.data());
+	result.deterministic = memcmp(eroded.data(), expected.data(), count * sizeof(float)) == 0;
+	return result;
+}
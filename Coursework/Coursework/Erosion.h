@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "HeightField.h"
+#include "ThreadPool.h"
+
+// Class for eroding a height field, hydraulically (water droplets carrying sediment) or thermally (material sliding
+// down slopes steeper than the talus angle)
+// Works on its own copy of the heights, in world units per sample spacing, so the settings do not depend on the map size.
+// Hydraulic passes split the map into tiles of tileSize texels in 4 colours (2 x 2): the droplets of a tile never reach
+// a tile of the same colour, so the tiles of a colour erode in parallel, and each tile seeds its droplets from the seed,
+// the pass and its index. Thermal sweeps read the last sweep and write the next, in parallel over rows.
+// Either way the result only depends on the seed and the settings, never on the threads or the budget per call.
+// Runs in steps (spread over frames with a time budget), and the heights can be read between steps.
+class Erosion {
+public:
+	enum class Mode { Hydraulic, Thermal };
+
+	// Settings of an erosion run
+	struct Settings {
+		Mode mode = Mode::Hydraulic;
+
+		// Hydraulic: droplets per texel (rounded up to whole passes of one droplet per texelsPerDroplet texels), then the
+		// droplet model (direction kept per step, sediment capacity per unit of slope, speed and water, lowest capacity,
+		// fractions eroded and deposited per step, water evaporated per step, gravity, steps and erosion brush radius)
+		float dropletsPerTexel = 1.f;
+		float inertia = 0.05f;
+		float capacity = 4.f, minCapacity = 0.01f;
+		float erodeRate = 0.3f, depositRate = 0.3f;
+		float evaporation = 0.02f;
+		float gravity = 4.f;
+		int maxSteps = 30;
+		int brushRadius = 3;
+
+		// Thermal: sweeps over the map, steepest stable slope (in degrees) and fraction of the excess moved per sweep
+		int sweeps = 50;
+		float talusAngle = 35.f;
+		float thermalRate = 0.5f;
+	};
+
+	// Time of a run (in ms), iterations per second (droplets, or sweeps), and whether running it on the calling thread
+	// alone gave the same heights
+	struct Benchmark {
+		float time;
+		double rate;
+		bool deterministic;
+	};
+
+	// Tile size of the hydraulic passes, largest brush radius, and texels per droplet of a pass
+	static const int tileSize = 64;
+	static const int maxBrushRadius = 4;
+	static const int texelsPerDroplet = 16;
+
+private:
+	Settings settings;
+	uint32_t seed;
+	int size;
+	float toCells;  // heights to world units per sample spacing
+
+	// Heights being eroded (in world units per sample spacing), and the next sweep of a thermal run
+	std::vector<float> heights;
+	std::vector<float> nextSweep;
+
+	// Erosion brush: offsets around the droplet's cell and their weights (summing to 1)
+	std::vector<int> brushX, brushY;
+	std::vector<float> brushWeights;
+
+	// Progress of the run (pass == passCount when there is none): colour and next tile of a hydraulic pass,
+	// next row of a thermal sweep
+	int pass, passCount;
+	int colour, nextTile;
+	int nextRow;
+	static const int tilesPerStep = 16;
+	static const int rowsPerStep = 64;
+	static const int rowsPerBlock = 8;
+
+	// Iterations (droplets, or sweeps) done by the run and the time spent on them (in ms)
+	unsigned long long iterations;
+	double runTime;
+
+	// Tiles of a hydraulic pass: offset of the tile grid (moved every pass, so the tile edges do not leave marks) and tiles per side
+	int tileOffsetX, tileOffsetY, tilesX, tilesY;
+
+	// method to place the tile grid of a pass
+	void PlaceTiles();
+
+	// method to get the number of tiles of a colour, and the tile coordinates of one of them
+	int TileCount(int tileColour) const;
+	void TileOf(int tileColour, int index, int& tileX, int& tileY) const;
+
+	// method to run the droplets of a tile, returns the number of droplets
+	int ErodeTile(int tileX, int tileY);
+
+	// method to erode a droplet's path starting at (x, y), without leaving [minX, maxX) x [minY, maxY)
+	void RunDroplet(float x, float y, float minX, float minY, float maxX, float maxY);
+
+	// method to add amount to the heights around a cell, spread by the brush weights (negative to erode)
+	void ApplyBrush(int cellX, int cellY, float amount);
+
+	// method to move material between the rows [firstRow, lastRow) of the heights and their neighbours, into the next sweep
+	void SweepRows(int firstRow, int lastRow);
+
+	// methods to do one step of a run (a few tiles of a hydraulic pass, or a few rows of a thermal sweep)
+	void StepHydraulic(ThreadPool* pool);
+	void StepThermal(ThreadPool* pool);
+
+public:
+	// method to start eroding a copy of a height field (restarts any run in progress)
+	void Begin(const HeightField& heightField, float sampleSpacing, float heightScale, const Settings& runSettings, uint32_t runSeed);
+
+	// method to continue the run for about budgetMs (all of it if negative), returns true when it completed in this call
+	// (the work of a step is shared with the pool when it is free, otherwise done on the calling thread)
+	bool Run(ThreadPool* pool, float budgetMs);
+
+	// method to stop the run in progress (the heights stay as eroded so far)
+	void Cancel() { pass = passCount; }
+
+	// methods to check for a run in progress and get its progress (0 to 1)
+	bool IsRunning() const { return pass < passCount; }
+	float GetProgress() const;
+
+	// method to copy the heights eroded so far (in height units) into size x size heights
+	void GetHeights(float* out) const;
+
+	// methods to get the mode of the run, and its iterations (droplets or sweeps) and iterations per second so far
+	Mode GetMode() const { return settings.mode; }
+	unsigned long long GetIterations() const { return iterations; }
+	double GetRate() const { return runTime > 0.0 ? iterations * 1000.0 / runTime : 0.0; }
+
+	// method to time a run over a height field on the pool, and compare it with the same run on the calling thread alone
+	static Benchmark BenchmarkRun(const HeightField& heightField, float sampleSpacing, float heightScale, const Settings& runSettings,
+		uint32_t runSeed, ThreadPool* pool);
+
+	Erosion();
+};
@@ -0,0 +1,77 @@
+#include "HeightFieldQuery.h"
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include "SimplexNoise.h"
+#include "HeightFieldQueryKernels.h"
+
+// Bilinear heights: full vectors on the batch path, the remaining points through the scalar query
+void HeightFieldQuery::SampleBilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	if (!field.isValid()) return;
+	int done = 0;
+	switch (SimplexNoise::getBatchPath()) {
+	case SimplexNoise::BatchPath::AVX2:  done = HeightFieldQueryAVX2::Bilinear(field, xs, zs, heights, count); break;
+	case SimplexNoise::BatchPath::SSE41: done = HeightFieldQuerySSE41::Bilinear(field, xs, zs, heights, count); break;
+	default: break;
+	}
+	for (int i = done; i < count; i++) {
+		heights[i] = field.sampleBilinear(xs[i], zs[i]);
+	}
+}
+
+// Bicubic heights
+void HeightFieldQuery::SampleBicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	if (!field.isValid()) return;
+	int done = 0;
+	switch (SimplexNoise::getBatchPath()) {
+	case SimplexNoise::BatchPath::AVX2:  done = HeightFieldQueryAVX2::Bicubic(field, xs, zs, heights, count); break;
+	case SimplexNoise::BatchPath::SSE41: done = HeightFieldQuerySSE41::Bicubic(field, xs, zs, heights, count); break;
+	default: break;
+	}
+	for (int i = done; i < count; i++) {
+		heights[i] = field.sampleBicubic(xs[i], zs[i]);
+	}
+}
+
+// Bicubic normals: the slopes go through nx/nz, then are turned into normals
+void HeightFieldQuery::SampleNormals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count) {
+	if (!field.isValid()) return;
+	int done = 0;
+	switch (SimplexNoise::getBatchPath()) {
+	case SimplexNoise::BatchPath::AVX2:  done = HeightFieldQueryAVX2::Normals(field, xs, zs, nx, ny, nz, count); break;
+	case SimplexNoise::BatchPath::SSE41: done = HeightFieldQuerySSE41::Normals(field, xs, zs, nx, ny, nz, count); break;
+	default: break;
+	}
+	for (int i = done; i < count; i++) {
+		field.sampleNormal(xs[i], zs[i], nx[i], ny[i], nz[i]);
+	}
+}
+
+// Scalar loop vs batched bicubic heights over the same random points (fixed LCG, so every run uses the same points)
+HeightFieldQuery::Benchmark HeightFieldQuery::BenchmarkBicubic(const HeightField& field, int count) {
+	Benchmark result = {};
+	if (!field.isValid()) return result;
+
+	std::vector<float> xs(count), zs(count), scalar(count), batched(count);
+	uint32_t state = 12345u;
+	for (int i = 0; i < count; i++) {
+		state = state * 1664525u + 1013904223u;
+		xs[i] = field.originX + (state >> 8) * (1.f / 16777216.f) * field.getExtent();
+		state = state * 1664525u + 1013904223u;
+		zs[i] = field.originZ + (state >> 8) * (1.f / 16777216.f) * field.getExtent();
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < count; i++) {
+		scalar[i] = field.sampleBicubic(xs[i], zs[i]);
+	}
+	result.scalarTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	startTime = std::chrono::high_resolution_clock::now();
+	SampleBicubic(field, xs.data(), zs.data(), batched.data(), count);
+	result.batchedTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	result.identical = scalar == batched;
+	return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "HeightField.h"
+
+// Class for batched height field queries
+// Each query runs over arrays of world x/z points: the SIMD paths gather the corner samples of 4 (SSE4.1) or 8 (AVX2)
+// points at once, with the same arithmetic as the scalar HeightField queries, so every path returns the same values.
+// The instruction set is the batch path of the noise (SimplexNoise::getBatchPath).
+class HeightFieldQuery {
+public:
+	// method to get the bilinear heights at count points
+	static void SampleBilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+
+	// method to get the bicubic heights at count points
+	static void SampleBicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+
+	// method to get the unit normals of the bicubic surface at count points (one array per component)
+	static void SampleNormals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count);
+
+	// Timings of count scalar queries and of the same queries batched (in ms), and whether the results matched exactly
+	struct Benchmark {
+		float scalarTime, batchedTime;
+		bool identical;
+	};
+
+	// method to compare the scalar and batched bicubic heights at count random points of field
+	static Benchmark BenchmarkBicubic(const HeightField& field, int count);
+};
@@ -0,0 +1,65 @@
+#include <cstdint>
+#include <immintrin.h>
+#include "HeightFieldQueryKernels.h"
+
+// The project compiles this file with /arch:AVX2 (MSVC), GCC and clang get the target pragma below (without FMA, so no contraction).
+// Everything below is compiled for AVX2, the headers above are not (their inline functions are shared with the other files).
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace {
+
+// 8-wide lanes (hardware gathers)
+struct QueryLanesAVX2 {
+	typedef __m256 F;
+	typedef __m256i I;
+	static const int width = 8;
+	static F load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+	static F set1(float v) { return _mm256_set1_ps(v); }
+	static I set1i(int32_t v) { return _mm256_set1_epi32(v); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static F min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F max(F a, F b) { return _mm256_max_ps(a, b); }
+	static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	static F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+	static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+	static F convert(I a) { return _mm256_cvtepi32_ps(a); }
+	static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I mini(I a, I b) { return _mm256_min_epi32(a, b); }
+	static I maxi(I a, I b) { return _mm256_max_epi32(a, b); }
+	static I mullo(I a, I b) { return _mm256_mullo_epi32(a, b); }
+	static F gather(const float* base, I index) { return _mm256_i32gather_ps(base, index, 4); }
+};
+
+}
+
+#include "HeightFieldQueryLanes.h"
+
+int HeightFieldQueryAVX2::Bilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	return bilinearLanes<QueryLanesAVX2>(field, xs, zs, heights, count);
+}
+
+int HeightFieldQueryAVX2::Bicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	return bicubicLanes<QueryLanesAVX2>(field, xs, zs, heights, nullptr, nullptr, count);
+}
+
+// The slopes go through nx/nz, then are turned into normals
+int HeightFieldQueryAVX2::Normals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count) {
+	const int done = bicubicLanes<QueryLanesAVX2>(field, xs, zs, nullptr, nx, nz, count);
+	normalsLanes<QueryLanesAVX2>(nx, ny, nz, done);
+	return done;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "HeightField.h"
+
+// SIMD kernels of HeightFieldQuery, one translation unit per instruction set (HeightFieldQuerySSE41.cpp, HeightFieldQueryAVX2.cpp)
+// so only those files are compiled for it. Each kernel does the full vectors of points and returns how many points it did,
+// HeightFieldQuery does the rest through the scalar queries.
+namespace HeightFieldQuerySSE41 {
+	int Bilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+	int Bicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+	int Normals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count);
+}
+
+namespace HeightFieldQueryAVX2 {
+	int Bilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+	int Bicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count);
+	int Normals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count);
+}
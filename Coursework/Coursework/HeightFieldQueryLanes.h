@@ -0,0 +1,114 @@
+#pragma once
+
+// Lane-wise height field queries, generic over the lanes L of an instruction set.
+// Only included by the translation unit of an instruction set, after its lanes and its target selection:
+// every function is static, so none of them is shared with a translation unit compiled for another instruction set.
+
+#include "HeightFieldQueryKernels.h"
+
+// Cell and fraction of world coordinates (HeightField::cellOf for a vector of coordinates)
+template <typename L>
+static inline void cellLanes(const HeightField& field, typename L::F world, float origin, typename L::I& cell, typename L::F& t) {
+	typename L::F s = L::div(L::sub(world, L::set1(origin)), L::set1(field.spacing));
+	s = L::max(s, L::set1(0.f));
+	s = L::min(s, L::set1((float)(field.size - 1)));
+	cell = L::mini(L::truncate(s), L::set1i(field.size - 2));
+	t = L::sub(s, L::convert(cell));
+}
+
+// Catmull-Rom weights and derivatives of a vector of fractions (HeightField::cubicWeights)
+template <typename L>
+static inline void cubicWeightsLanes(typename L::F t, typename L::F* w, typename L::F* d) {
+	w[0] = L::mul(L::sub(L::mul(L::add(L::mul(L::set1(-0.5f), t), L::set1(1.f)), t), L::set1(0.5f)), t);
+	w[1] = L::add(L::mul(L::mul(L::sub(L::mul(L::set1(1.5f), t), L::set1(2.5f)), t), t), L::set1(1.f));
+	w[2] = L::mul(L::add(L::mul(L::add(L::mul(L::set1(-1.5f), t), L::set1(2.f)), t), L::set1(0.5f)), t);
+	w[3] = L::mul(L::mul(L::sub(L::mul(L::set1(0.5f), t), L::set1(0.5f)), t), t);
+	d[0] = L::sub(L::mul(L::add(L::mul(L::set1(-1.5f), t), L::set1(2.f)), t), L::set1(0.5f));
+	d[1] = L::mul(L::sub(L::mul(L::set1(4.5f), t), L::set1(5.f)), t);
+	d[2] = L::add(L::mul(L::add(L::mul(L::set1(-4.5f), t), L::set1(4.f)), t), L::set1(0.5f));
+	d[3] = L::mul(L::sub(L::mul(L::set1(1.5f), t), L::set1(1.f)), t);
+}
+
+// Bilinear heights of the full vectors of points, returns the number of points done (the rest is left to the scalar query)
+template <typename L>
+static int bilinearLanes(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	typedef typename L::F F;
+	typedef typename L::I I;
+	const I size = L::set1i(field.size);
+	const I one = L::set1i(1);
+	int i = 0;
+	for (; i + L::width <= count; i += L::width) {
+		I cx, cz;
+		F tx, tz;
+		cellLanes<L>(field, L::load(xs + i), field.originX, cx, tx);
+		cellLanes<L>(field, L::load(zs + i), field.originZ, cz, tz);
+		const I index = L::addi(L::mullo(cz, size), cx);
+		const F h00 = L::gather(field.heights, index);
+		const F h10 = L::gather(field.heights, L::addi(index, one));
+		const F h01 = L::gather(field.heights, L::addi(index, size));
+		const F h11 = L::gather(field.heights, L::addi(L::addi(index, size), one));
+		const F h0 = L::add(h00, L::mul(L::sub(h10, h00), tx));
+		const F h1 = L::add(h01, L::mul(L::sub(h11, h01), tx));
+		L::store(heights + i, L::add(h0, L::mul(L::sub(h1, h0), tz)));
+	}
+	return i;
+}
+
+// Bicubic heights (and slopes, when dhdx is not null) of the full vectors of points, returns the number of points done
+template <typename L>
+static int bicubicLanes(const HeightField& field, const float* xs, const float* zs, float* heights, float* dhdx, float* dhdz, int count) {
+	typedef typename L::F F;
+	typedef typename L::I I;
+	const I size = L::set1i(field.size);
+	const I zero = L::set1i(0);
+	const I last = L::set1i(field.size - 1);
+	int p = 0;
+	for (; p + L::width <= count; p += L::width) {
+		I cx, cz;
+		F tx, tz, wx[4], dx[4], wz[4], dz[4];
+		cellLanes<L>(field, L::load(xs + p), field.originX, cx, tx);
+		cellLanes<L>(field, L::load(zs + p), field.originZ, cz, tz);
+		cubicWeightsLanes<L>(tx, wx, dx);
+		cubicWeightsLanes<L>(tz, wz, dz);
+
+		I columns[4];
+		for (int i = 0; i < 4; i++) {
+			columns[i] = L::mini(L::maxi(L::addi(cx, L::set1i(i - 1)), zero), last);
+		}
+
+		F height = L::set1(0.f), slopeX = L::set1(0.f), slopeZ = L::set1(0.f);
+		for (int j = 0; j < 4; j++) {
+			const I row = L::mullo(L::mini(L::maxi(L::addi(cz, L::set1i(j - 1)), zero), last), size);
+			F value = L::set1(0.f), derivative = L::set1(0.f);
+			for (int i = 0; i < 4; i++) {
+				const F sample = L::gather(field.heights, L::addi(row, columns[i]));
+				value = L::add(value, L::mul(wx[i], sample));
+				derivative = L::add(derivative, L::mul(dx[i], sample));
+			}
+			height = L::add(height, L::mul(wz[j], value));
+			slopeX = L::add(slopeX, L::mul(wz[j], derivative));
+			slopeZ = L::add(slopeZ, L::mul(dz[j], value));
+		}
+		if (heights) L::store(heights + p, height);
+		if (dhdx) {
+			L::store(dhdx + p, L::div(slopeX, L::set1(field.spacing)));
+			L::store(dhdz + p, L::div(slopeZ, L::set1(field.spacing)));
+		}
+	}
+	return p;
+}
+
+// Normals from the slopes (HeightField::sampleNormal), in place: nx and nz hold the slopes on entry
+template <typename L>
+static int normalsLanes(float* nx, float* ny, float* nz, int count) {
+	typedef typename L::F F;
+	int p = 0;
+	for (; p + L::width <= count; p += L::width) {
+		const F dhdx = L::load(nx + p), dhdz = L::load(nz + p);
+		const F length = L::sqrt(L::add(L::add(L::mul(dhdx, dhdx), L::set1(1.f)), L::mul(dhdz, dhdz)));
+		L::store(nx + p, L::div(L::neg(dhdx), length));
+		L::store(ny + p, L::div(L::set1(1.f), length));
+		L::store(nz + p, L::div(L::neg(dhdz), length));
+	}
+	return p;
+}
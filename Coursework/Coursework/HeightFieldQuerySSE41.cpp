@@ -0,0 +1,69 @@
+#include <cstdint>
+#include <immintrin.h>
+#include "HeightFieldQueryKernels.h"
+
+// MSVC needs no option for SSE4.1 intrinsics, GCC and clang get the target pragma below.
+// Everything below is compiled for SSE4.1, the headers above are not (their inline functions are shared with the other files).
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace {
+
+// 4-wide lanes (SSE4.1 has no gather: the 4 samples are loaded one by one)
+struct QueryLanesSSE41 {
+	typedef __m128 F;
+	typedef __m128i I;
+	static const int width = 4;
+	static F load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+	static F set1(float v) { return _mm_set1_ps(v); }
+	static I set1i(int32_t v) { return _mm_set1_epi32(v); }
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm_div_ps(a, b); }
+	static F min(F a, F b) { return _mm_min_ps(a, b); }
+	static F max(F a, F b) { return _mm_max_ps(a, b); }
+	static F sqrt(F a) { return _mm_sqrt_ps(a); }
+	static F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+	static I truncate(F a) { return _mm_cvttps_epi32(a); }
+	static F convert(I a) { return _mm_cvtepi32_ps(a); }
+	static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+	static I mini(I a, I b) { return _mm_min_epi32(a, b); }
+	static I maxi(I a, I b) { return _mm_max_epi32(a, b); }
+	static I mullo(I a, I b) { return _mm_mullo_epi32(a, b); }
+	static F gather(const float* base, I index) {
+		alignas(16) int32_t i[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(i), index);
+		return _mm_set_ps(base[i[3]], base[i[2]], base[i[1]], base[i[0]]);
+	}
+};
+
+}
+
+#include "HeightFieldQueryLanes.h"
+
+int HeightFieldQuerySSE41::Bilinear(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	return bilinearLanes<QueryLanesSSE41>(field, xs, zs, heights, count);
+}
+
+int HeightFieldQuerySSE41::Bicubic(const HeightField& field, const float* xs, const float* zs, float* heights, int count) {
+	return bicubicLanes<QueryLanesSSE41>(field, xs, zs, heights, nullptr, nullptr, count);
+}
+
+// The slopes go through nx/nz, then are turned into normals
+int HeightFieldQuerySSE41::Normals(const HeightField& field, const float* xs, const float* zs, float* nx, float* ny, float* nz, int count) {
+	const int done = bicubicLanes<QueryLanesSSE41>(field, xs, zs, nullptr, nx, nz, count);
+	normalsLanes<QueryLanesSSE41>(nx, ny, nz, done);
+	return done;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
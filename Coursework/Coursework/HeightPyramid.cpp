@@ -0,0 +1,354 @@
+#include "HeightPyramid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Constructor with initialisation (empty until the first Refresh)
+HeightPyramid::HeightPyramid() {
+	cells = 0;
+}
+
+// Pointing at the height field, reallocating the levels if its size changed, then rebuilding all of it if it changed
+void HeightPyramid::Refresh(const HeightField& heightField, ThreadPool* pool) {
+	if (!heightField.isValid()) {
+		field = heightField;
+		cells = 0;
+		levels.clear();
+		return;
+	}
+	const bool resized = heightField.size - 1 != cells;
+	if (!resized && !levels.empty() && heightField.version == field.version && heightField.heights == field.heights) return;
+
+	field = heightField;
+	if (resized) {
+		cells = field.size - 1;
+		levels.clear();
+		int width = cells;
+		do {
+			width = (width + 1) / 2;
+			Level level;
+			level.width = level.height = width;
+			level.bounds.resize((size_t)width * width * 2);
+			levels.push_back(level);
+		} while (width > 1);
+	}
+	UpdateRegion(0, 0, field.size - 1, field.size - 1, pool);
+}
+
+// Rebuilding the nodes over a region of changed samples, level by level (each level only reads the one below)
+void HeightPyramid::UpdateRegion(int x0, int z0, int x1, int z1, ThreadPool* pool) {
+	if (levels.empty()) return;
+
+	// Cells touching the changed samples, then their level 1 nodes
+	int nx0 = std::max(x0 - 1, 0) / 2, nz0 = std::max(z0 - 1, 0) / 2;
+	int nx1 = std::min(x1, cells - 1) / 2, nz1 = std::min(z1, cells - 1) / 2;
+	if (nx0 > nx1 || nz0 > nz1) return;
+
+	for (size_t l = 0; l < levels.size(); l++) {
+		Level& level = levels[l];
+		const int firstRow = nz0, firstColumn = nx0, lastColumn = nx1;
+		auto rows = [&](int first, int last) {
+			for (int j = firstRow + first; j < firstRow + last; j++) {
+				for (int i = firstColumn; i <= lastColumn; i++) {
+					float lo, hi;
+					if (l == 0) {
+						// Level 1 from the heights: the corners of its (up to) 2x2 cells
+						const int sx1 = std::min(2 * i + 2, cells), sz1 = std::min(2 * j + 2, cells);
+						lo = hi = field.heights[(size_t)(2 * j) * field.size + 2 * i];
+						for (int sz = 2 * j; sz <= sz1; sz++) {
+							const float* row = field.heights + (size_t)sz * field.size;
+							for (int sx = 2 * i; sx <= sx1; sx++) {
+								lo = std::min(lo, row[sx]);
+								hi = std::max(hi, row[sx]);
+							}
+						}
+					}
+					else {
+						// Upper levels from the (up to) 2x2 nodes below
+						const Level& below = levels[l - 1];
+						const int cx1 = std::min(2 * i + 1, below.width - 1), cz1 = std::min(2 * j + 1, below.height - 1);
+						lo = hi = below.bounds[((size_t)(2 * j) * below.width + 2 * i) * 2];
+						for (int cz = 2 * j; cz <= cz1; cz++) {
+							for (int cx = 2 * i; cx <= cx1; cx++) {
+								const float* b = &below.bounds[((size_t)cz * below.width + cx) * 2];
+								lo = std::min(lo, b[0]);
+								hi = std::max(hi, b[1]);
+							}
+						}
+					}
+					float* b = &level.bounds[((size_t)j * level.width + i) * 2];
+					b[0] = lo;
+					b[1] = hi;
+				}
+			}
+		};
+		const int rowCount = nz1 - nz0 + 1;
+		if (!pool || rowCount <= rowsPerBlock || !pool->TryParallelFor(rowCount, rowsPerBlock, rows)) rows(0, rowCount);
+
+		nx0 /= 2;
+		nz0 /= 2;
+		nx1 /= 2;
+		nz1 /= 2;
+	}
+}
+
+// Memory of the stored levels
+size_t HeightPyramid::GetMemoryBytes() const {
+	size_t bytes = 0;
+	for (size_t l = 0; l < levels.size(); l++) {
+		bytes += levels[l].bounds.size() * sizeof(float);
+	}
+	return bytes;
+}
+
+// World space to grid space (a zero direction component gets a huge finite inverse, so the slab tests stay finite)
+HeightPyramid::GridRay HeightPyramid::ToGrid(const Ray& ray) const {
+	GridRay grid;
+	grid.ox = (ray.originX - field.originX) / field.spacing;
+	grid.oy = ray.originY;
+	grid.oz = (ray.originZ - field.originZ) / field.spacing;
+	grid.dx = ray.dirX / field.spacing;
+	grid.dy = ray.dirY;
+	grid.dz = ray.dirZ / field.spacing;
+	grid.ix = grid.dx != 0.f ? 1.f / grid.dx : 1e30f;
+	grid.iy = grid.dy != 0.f ? 1.f / grid.dy : 1e30f;
+	grid.iz = grid.dz != 0.f ? 1.f / grid.dz : 1e30f;
+	return grid;
+}
+
+// Height range of a node
+void HeightPyramid::NodeBounds(int level, int i, int j, float& lo, float& hi) const {
+	if (level == 0) {
+		const float* row0 = field.heights + (size_t)j * field.size + i;
+		const float* row1 = row0 + field.size;
+		lo = std::min(std::min(row0[0], row0[1]), std::min(row1[0], row1[1]));
+		hi = std::max(std::max(row0[0], row0[1]), std::max(row1[0], row1[1]));
+		return;
+	}
+	const Level& stored = levels[level - 1];
+	const float* b = &stored.bounds[((size_t)j * stored.width + i) * 2];
+	lo = b[0];
+	hi = b[1];
+}
+
+// Ray against the bilinear patch of a cell
+// Along the ray the patch height is quadratic in t, so the height of the ray above it is f(t) = C + B t + A t^2
+// and the hit is its first root after tEnter (or tEnter itself if the ray enters the cell at or under the surface).
+bool HeightPyramid::IntersectCell(int i, int j, const GridRay& ray, float tEnter, float tExit, Hit& hit) const {
+	const float* row0 = field.heights + (size_t)j * field.size + i;
+	const float* row1 = row0 + field.size;
+	const double h00 = row0[0], a = row0[1] - h00, b = row1[0] - h00, c = h00 - row0[1] - row1[0] + row1[1];
+	const double u0 = ray.ox - i, v0 = ray.oz - j;
+	const double C = ray.oy - (h00 + a * u0 + b * v0 + c * u0 * v0);
+	const double B = ray.dy - (a * ray.dx + b * ray.dz + c * (u0 * ray.dz + v0 * ray.dx));
+	const double A = -c * ray.dx * ray.dz;
+
+	double t = tEnter;
+	if (C + (B + A * t) * t > 0.0) {
+		if (std::fabs(A) < 1e-12) {
+			if (B >= 0.0) return false;
+			t = -C / B;
+		}
+		else {
+			const double discriminant = B * B - 4.0 * A * C;
+			if (discriminant < 0.0) return false;
+			const double root = std::sqrt(discriminant);
+			const double q = -0.5 * (B >= 0.0 ? B + root : B - root);
+			double r0 = q / A, r1 = q != 0.0 ? C / q : r0;
+			if (r0 > r1) std::swap(r0, r1);
+			t = r0 >= tEnter ? r0 : r1;
+			if (t < tEnter) return false;
+		}
+		// Slightly past tExit still belongs to this cell (the slab tests round in float)
+		if (t > tExit + 1e-5 * (1.0 + tExit)) return false;
+	}
+
+	// Normal of the patch at the hit, from its slopes per world unit
+	const double u = std::min(std::max(u0 + ray.dx * t, 0.0), 1.0), v = std::min(std::max(v0 + ray.dz * t, 0.0), 1.0);
+	const double slopeX = (a + c * v) / field.spacing, slopeZ = (b + c * u) / field.spacing;
+	const double length = std::sqrt(slopeX * slopeX + 1.0 + slopeZ * slopeZ);
+	hit.hit = true;
+	hit.t = (float)t;
+	hit.normalX = (float)(-slopeX / length);
+	hit.normalY = (float)(1.0 / length);
+	hit.normalZ = (float)(-slopeZ / length);
+	return true;
+}
+
+// Rays in packets
+void HeightPyramid::Intersect(const Ray* rays, Hit* hits, int count) const {
+	for (int first = 0; first < count; first += packetSize) {
+		IntersectPacket(rays + first, hits + first, std::min(packetSize, count - first));
+	}
+}
+
+// Packet traversal: a stack of nodes with the mask of the rays still active in each
+// The terrain is solid under its surface, so a ray stays active in a node while it is under the node's max height
+// within its x/z extent, before its closest hit so far; a ray that enters a node under its min height hits right there. Children are pushed front to back for the first active ray, which is the order for every ray of
+// a coherent packet; for the others the closest hit still wins, it only costs extra visits.
+void HeightPyramid::IntersectPacket(const Ray* rays, Hit* hits, int count) const {
+	GridRay grid[packetSize];
+	for (int r = 0; r < count; r++) {
+		hits[r].hit = false;
+		hits[r].t = rays[r].tMax;
+		hits[r].normalX = hits[r].normalZ = 0.f;
+		hits[r].normalY = 1.f;
+		grid[r] = ToGrid(rays[r]);
+	}
+	if (levels.empty()) return;
+
+	struct Entry {
+		int level, i, j;
+		unsigned int mask;
+	};
+	Entry stack[4 * 32];
+	int top = 0;
+	stack[top++] = { (int)levels.size(), 0, 0, (1u << count) - 1 };
+
+	while (top > 0) {
+		const Entry node = stack[--top];
+		float lo, hi;
+		NodeBounds(node.level, node.i, node.j, lo, hi);
+		const int span = 1 << node.level;
+		const float x0 = (float)(node.i * span), x1 = (float)std::min((node.i + 1) * span, cells);
+		const float z0 = (float)(node.j * span), z1 = (float)std::min((node.j + 1) * span, cells);
+
+		unsigned int mask = 0;
+		float enter[packetSize], exit[packetSize];
+		for (int r = 0; r < count; r++) {
+			if (!(node.mask & (1u << r))) continue;
+			const GridRay& ray = grid[r];
+			float tx0 = (x0 - ray.ox) * ray.ix, tx1 = (x1 - ray.ox) * ray.ix;
+			float tz0 = (z0 - ray.oz) * ray.iz, tz1 = (z1 - ray.oz) * ray.iz;
+			if (tx0 > tx1) std::swap(tx0, tx1);
+			if (tz0 > tz1) std::swap(tz0, tz1);
+			// The node is solid up to hi: the ray is inside it after going under hi (downwards) or until going over it (upwards)
+			const float tTop = (hi - ray.oy) * ray.iy;
+			const float ty0 = ray.dy < 0.f ? tTop : -1e30f, ty1 = ray.dy < 0.f ? 1e30f : tTop;
+			const float tn = std::max(std::max(tx0, tz0), std::max(ty0, 0.f));
+			const float tf = std::min(std::min(tx1, tz1), std::min(ty1, hits[r].t));
+			if (tn > tf) continue;
+
+			// Under every height of the node where it enters it: the hit is right there, in the cell under the entry point
+			if (node.level > 0 && ray.oy + ray.dy * tn <= lo) {
+				const int ci = std::min(std::max((int)std::floor(ray.ox + ray.dx * tn), (int)x0), (int)x1 - 1);
+				const int cj = std::min(std::max((int)std::floor(ray.oz + ray.dz * tn), (int)z0), (int)z1 - 1);
+				if (IntersectCell(ci, cj, ray, tn, tn, hits[r])) continue;
+			}
+			mask |= 1u << r;
+			enter[r] = tn;
+			exit[r] = tf;
+		}
+		if (!mask) continue;
+
+		if (node.level == 0) {
+			for (int r = 0; r < count; r++) {
+				if (mask & (1u << r)) IntersectCell(node.i, node.j, grid[r], enter[r], exit[r], hits[r]);
+			}
+			continue;
+		}
+
+		// Children, pushed back to front so the nearest one is visited first
+		int first = 0;
+		while (!(mask & (1u << first))) first++;
+		const int flipX = grid[first].dx < 0.f ? 1 : 0, flipZ = grid[first].dz < 0.f ? 1 : 0;
+		const int childWidth = node.level == 1 ? cells : levels[node.level - 2].width;
+		for (int k = 3; k >= 0; k--) {
+			const int ci = 2 * node.i + ((k & 1) ^ flipX), cj = 2 * node.j + ((k >> 1) ^ flipZ);
+			if (ci < childWidth && cj < childWidth) stack[top++] = { node.level - 1, ci, cj, mask };
+		}
+	}
+}
+
+// Brute force: walk every cell the ray crosses (grid DDA) and intersect its patch, stopping at the first hit
+void HeightPyramid::IntersectMarch(const Ray& worldRay, Hit& hit) const {
+	hit.hit = false;
+	hit.t = worldRay.tMax;
+	hit.normalX = hit.normalZ = 0.f;
+	hit.normalY = 1.f;
+	if (levels.empty()) return;
+
+	const GridRay ray = ToGrid(worldRay);
+	float tx0 = (0.f - ray.ox) * ray.ix, tx1 = ((float)cells - ray.ox) * ray.ix;
+	float tz0 = (0.f - ray.oz) * ray.iz, tz1 = ((float)cells - ray.oz) * ray.iz;
+	if (tx0 > tx1) std::swap(tx0, tx1);
+	if (tz0 > tz1) std::swap(tz0, tz1);
+	float t = std::max(std::max(tx0, tz0), 0.f);
+	const float tEnd = std::min(std::min(tx1, tz1), worldRay.tMax);
+	if (t > tEnd) return;
+
+	int i = std::min(std::max((int)std::floor(ray.ox + ray.dx * t), 0), cells - 1);
+	int j = std::min(std::max((int)std::floor(ray.oz + ray.dz * t), 0), cells - 1);
+	const int stepX = ray.dx >= 0.f ? 1 : -1, stepZ = ray.dz >= 0.f ? 1 : -1;
+	float nextX = ((float)(stepX > 0 ? i + 1 : i) - ray.ox) * ray.ix;
+	float nextZ = ((float)(stepZ > 0 ? j + 1 : j) - ray.oz) * ray.iz;
+	const float deltaX = std::fabs(ray.ix), deltaZ = std::fabs(ray.iz);
+
+	while (true) {
+		const float tNext = std::min(std::min(nextX, nextZ), tEnd);
+		if (IntersectCell(i, j, ray, t, tNext, hit)) return;
+		if (tNext >= tEnd) return;
+		if (nextX < nextZ) {
+			i += stepX;
+			t = nextX;
+			nextX += deltaX;
+		}
+		else {
+			j += stepZ;
+			t = nextZ;
+			nextZ += deltaZ;
+		}
+		if (i < 0 || i >= cells || j < 0 || j >= cells) return;
+	}
+}
+
+// Casting the same rays through a pyramid and by marching, over a height field
+// Rays come in packets of 8 from one point above the highest height, spread by up to a degree around a direction
+// pitched 1 to 30 degrees down (the coherence of neighbouring pixels of a view), from a fixed seed.
+HeightPyramid::RaycastBenchmark HeightPyramid::BenchmarkRaycast(const HeightField& heightField, int rayCount, ThreadPool* pool) {
+	RaycastBenchmark result = {};
+	const size_t count = (size_t)heightField.size * heightField.size;
+	const float maxHeight = *std::max_element(heightField.heights, heightField.heights + count);
+
+	HeightPyramid pyramid;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	pyramid.Refresh(heightField, pool);
+	result.buildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	uint32_t state = 12345u;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / 16777216.f;
+	};
+	const float degrees = 3.14159265f / 180.f;
+	const float extent = heightField.getExtent();
+	std::vector<Ray> rays(rayCount);
+	for (int first = 0; first < rayCount; first += packetSize) {
+		const float x = heightField.originX + random() * extent, z = heightField.originZ + random() * extent;
+		const float y = maxHeight + 0.02f * heightField.size * heightField.spacing;
+		const float yaw = random() * 360.f * degrees, pitch = (1.f + random() * 29.f) * degrees;
+		for (int r = first; r < std::min(first + packetSize, rayCount); r++) {
+			const float rayYaw = yaw + (random() - 0.5f) * degrees, rayPitch = pitch + (random() - 0.5f) * degrees;
+			rays[r] = { x, y, z, sinf(rayYaw) * cosf(rayPitch), -sinf(rayPitch), cosf(rayYaw) * cosf(rayPitch), 1e30f };
+		}
+	}
+
+	std::vector<Hit> pyramidHits(rayCount), marchHits(rayCount);
+	startTime = std::chrono::high_resolution_clock::now();
+	pyramid.Intersect(rays.data(), pyramidHits.data(), rayCount);
+	float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	result.pyramidRate = rayCount / std::max(seconds, 1e-6f);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < rayCount; r++) pyramid.IntersectMarch(rays[r], marchHits[r]);
+	seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	result.marchRate = rayCount / std::max(seconds, 1e-6f);
+
+	// Hits only differ by rounding where a ray grazes the surface
+	for (int r = 0; r < rayCount; r++) {
+		const Hit& a = pyramidHits[r];
+		const Hit& b = marchHits[r];
+		if (a.hit != b.hit || (a.hit && fabsf(a.t - b.t) > 1e-3f * (1.f + b.t))) result.mismatches++;
+	}
+	return result;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include "HeightField.h"
+#include "ThreadPool.h"
+
+// Class for a min/max pyramid over a height field, for ray-terrain intersection
+// Level 0 is the grid of (size - 1)^2 cells, each a bilinear patch bounded by its 4 corner heights (computed on the fly,
+// never stored). Every level above stores the min/max height of 2x2 nodes of the level below, up to a single root.
+// Rays walk the pyramid front to back and skip every node whose height range they pass over, then intersect the
+// bilinear patches of the cells they reach exactly, so a ray costs O(log n) nodes instead of O(n) cells.
+// The pyramid keeps a view of the heights: it must be refreshed whenever they change (only the changed region
+// is rebuilt), and queried while they stay alive.
+class HeightPyramid {
+public:
+	// Ray in world space (direction need not be unit length: t is in multiples of it), hits are kept for t in [0, tMax]
+	struct Ray {
+		float originX, originY, originZ;
+		float dirX, dirY, dirZ;
+		float tMax;
+	};
+
+	// Closest hit of a ray: distance along the ray and the unit normal of the bilinear surface there
+	struct Hit {
+		bool hit;
+		float t;
+		float normalX, normalY, normalZ;
+	};
+
+	// Rays traversed together (they share the node fetches of the pyramid)
+	static constexpr int packetSize = 8;
+
+	// Time to build a pyramid (in ms), rays per second cast through it and by marching every cell,
+	// and the number of rays whose hits differed
+	struct RaycastBenchmark {
+		float buildTime;
+		float pyramidRate, marchRate;
+		int mismatches;
+	};
+
+private:
+	// Stored level: min/max pairs of width x height nodes
+	struct Level {
+		int width, height;
+		std::vector<float> bounds;
+	};
+
+	HeightField field;
+	int cells;                  // cells per side of level 0
+	std::vector<Level> levels;  // levels 1 and up (levels[l - 1] is level l)
+	static const int rowsPerBlock = 32;
+
+	// Ray in grid space (x/z in cells, y in height units, same t), with the inverse direction for the slab tests
+	struct GridRay {
+		float ox, oy, oz, dx, dy, dz, ix, iy, iz;
+	};
+
+	// method to convert a world space ray to grid space
+	GridRay ToGrid(const Ray& ray) const;
+
+	// method to get the height range of a node (level 0 nodes are cells, computed from their corners)
+	void NodeBounds(int level, int i, int j, float& lo, float& hi) const;
+
+	// method to intersect a ray with the bilinear patch of cell (i, j) over [tEnter, tExit], sets t and the normal on a hit
+	bool IntersectCell(int i, int j, const GridRay& ray, float tEnter, float tExit, Hit& hit) const;
+
+	// method to intersect up to packetSize rays, walking the pyramid once for the packet
+	void IntersectPacket(const Ray* rays, Hit* hits, int count) const;
+
+public:
+	// method to point the pyramid at a height field and rebuild it if the heights changed (new version, view or size)
+	void Refresh(const HeightField& heightField, ThreadPool* pool = nullptr);
+
+	// method to rebuild the part of the pyramid over the samples [x0, x1] x [z0, z1] (after an edit of those heights)
+	void UpdateRegion(int x0, int z0, int x1, int z1, ThreadPool* pool = nullptr);
+
+	// method to intersect count rays with the terrain (in packets of packetSize rays)
+	void Intersect(const Ray* rays, Hit* hits, int count) const;
+
+	// method to intersect one ray by marching through every cell along it (reference for the pyramid, O(n) per ray)
+	void IntersectMarch(const Ray& ray, Hit& hit) const;
+
+	// method to compare ray casts through a pyramid and by marching against a height field (rayCount rays)
+	static RaycastBenchmark BenchmarkRaycast(const HeightField& heightField, int rayCount, ThreadPool* pool = nullptr);
+
+	// method to get the number of stored levels and their memory (in bytes)
+	int GetLevelCount() const { return (int)levels.size(); }
+	size_t GetMemoryBytes() const;
+
+	// methods to get the nodes per side of a level (level 0: the cells), and the height range of node (i, j) of a level,
+	// which covers the cells [i * 2^level, (i + 1) * 2^level) along x (and likewise along z)
+	int GetLevelWidth(int level) const { return level == 0 ? cells : levels[level - 1].width; }
+	void GetNodeBounds(int level, int i, int j, float& lo, float& hi) const { NodeBounds(level, i, j, lo, hi); }
+
+	// method to get the view of the heights the pyramid was built over (placement of the cells in the world)
+	const HeightField& GetHeightField() const { return field; }
+
+	HeightPyramid();
+};
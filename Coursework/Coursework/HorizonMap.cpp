@@ -0,0 +1,134 @@
+#include "HorizonMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Steps between neighbouring texels towards each azimuth
+static const int azimuthSteps[HorizonMap::azimuthCount][2] = {
+	{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+};
+
+// Constructor with initialisation (no texels until the first bake)
+HorizonMap::HorizonMap() {
+	spacing = 1.f;
+	heightScale = 1.f;
+	size = 0;
+	nextAzimuth = azimuthCount;
+	nextLine = 0;
+}
+
+// Starting a bake over the heights (the texels of a new size start flat, until the bake completes)
+void HorizonMap::Begin(const HeightField& heightField, float sampleSpacing, float scale) {
+	field = heightField;
+	spacing = sampleSpacing;
+	heightScale = scale;
+	if (heightField.size != size) {
+		size = heightField.size;
+		texels.assign((size_t)sliceCount * size * size * 4, 0);
+	}
+	baking.resize(texels.size());
+	nextAzimuth = field.isValid() ? 0 : azimuthCount;
+	nextLine = 0;
+}
+
+// Lines along an azimuth: one per row or column, or one per diagonal
+int HorizonMap::LineCount(int azimuth) const {
+	const int* step = azimuthSteps[azimuth];
+	return step[0] != 0 && step[1] != 0 ? 2 * size - 1 : size;
+}
+
+// Walking a line backwards from its far end, with the upper convex hull of the heights ahead on a stack
+// Each texel pops the hull points below its tangent to the next one (they are below every later tangent too), then its
+// horizon is the slope to the top of the stack, and it is pushed as the nearest point of the hull.
+// The heights along the line are gathered first, and slopes are compared without dividing (the distances are positive).
+void HorizonMap::BakeLine(int azimuth, int line, LineScratch& scratch) {
+	const int dx = azimuthSteps[azimuth][0], dy = azimuthSteps[azimuth][1];
+	const int edgeX = dx > 0 ? 0 : size - 1, edgeY = dy > 0 ? 0 : size - 1;
+
+	// First texel of the line, on the edges it starts from
+	int x, y;
+	if (dy == 0) { x = edgeX; y = line; }
+	else if (dx == 0) { x = line; y = edgeY; }
+	else if (line < size) { x = edgeX; y = line; }
+	else { x = edgeX + dx * (line - size + 1); y = edgeY; }
+
+	int count = 0;
+	while (x + dx * count >= 0 && x + dx * count < size && y + dy * count >= 0 && y + dy * count < size) count++;
+
+	const float stepLength = spacing * (dx != 0 && dy != 0 ? 1.41421356f : 1.f);
+	const ptrdiff_t stride = (ptrdiff_t)dy * size + dx;
+	const float* source = field.heights + (size_t)y * size + x;
+	std::vector<float>& heights = scratch.heights;
+	heights.resize(count);
+	for (int k = 0; k < count; k++) heights[k] = source[k * stride];
+
+	const size_t plane = (size_t)size * size;
+	uint8_t* texel = &baking[((azimuth / 4) * plane + (size_t)y * size + x) * 4 + azimuth % 4];
+	const float toSlope = heightScale / stepLength;
+	std::vector<int>& hull = scratch.hull;
+	hull.clear();
+	for (int k = count - 1; k >= 0; k--) {
+		const float height = heights[k];
+		while (hull.size() >= 2) {
+			const int a = hull[hull.size() - 1], b = hull[hull.size() - 2];
+			if ((heights[a] - height) * (b - k) > (heights[b] - height) * (a - k)) break;
+			hull.pop_back();
+		}
+		float angle = 0.f;
+		if (!hull.empty()) angle = atanf(std::max((heights[hull.back()] - height) * toSlope / (hull.back() - k), 0.f));
+		texel[k * stride * 4] = (uint8_t)lrintf(angle * (255.f / 1.57079633f));
+		hull.push_back(k);
+	}
+}
+
+// Baking steps of lines until the budget runs out, swapping the bake in when it completes
+bool HorizonMap::Bake(ThreadPool* pool, float budgetMs) {
+	if (!IsBaking()) return false;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	while (IsBaking()) {
+		const int azimuth = nextAzimuth, first = nextLine;
+		const int count = std::min(linesPerStep, LineCount(azimuth) - first);
+		ThreadPool::Task lines = [&](int begin, int end) {
+			LineScratch scratch;
+			for (int line = first + begin; line < first + end; line++) BakeLine(azimuth, line, scratch);
+		};
+		if (!pool || !pool->TryParallelFor(count, linesPerBlock, lines)) lines(0, count);
+
+		nextLine += count;
+		if (nextLine == LineCount(azimuth)) {
+			nextAzimuth++;
+			nextLine = 0;
+		}
+		if (budgetMs >= 0.f && std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() >= budgetMs) break;
+	}
+	if (IsBaking()) return false;
+	texels.swap(baking);
+	return true;
+}
+
+// Lines baked over all lines of all azimuths
+float HorizonMap::GetProgress() const {
+	if (!IsBaking()) return 1.f;
+	int done = nextLine, total = 0;
+	for (int azimuth = 0; azimuth < azimuthCount; azimuth++) {
+		total += LineCount(azimuth);
+		if (azimuth < nextAzimuth) done += LineCount(azimuth);
+	}
+	return (float)done / total;
+}
+
+// Unpacking a horizon angle
+float HorizonMap::GetHorizon(int x, int y, int azimuth) const {
+	const size_t plane = (size_t)size * size;
+	return texels[(azimuth / 4) * plane * 4 + ((size_t)y * size + x) * 4 + azimuth % 4] * (1.57079633f / 255.f);
+}
+
+// Timing a full bake of a height field in one call
+float HorizonMap::BenchmarkBake(const HeightField& heightField, float sampleSpacing, float heightScale, ThreadPool* pool) {
+	HorizonMap map;
+	map.Begin(heightField, sampleSpacing, heightScale);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	map.Bake(pool, -1.f);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "HeightField.h"
+#include "ThreadPool.h"
+
+// Class for a horizon map of a height field, for terrain self-shadowing from the sun
+// Stores per texel the elevation angle of the horizon towards azimuthCount azimuths (every 45 degrees from +x towards +z,
+// so each one follows a row, a column or a diagonal of the map). A texel is lit by the sun while the sun is above the
+// horizon towards its azimuth, which the terrain shader tests with a lookup instead of rendering a shadow map.
+// Along each line the horizon of every texel is the tangent to the upper convex hull of the heights ahead of it,
+// kept on a stack while walking the line backwards, so a bake is O(size^2) per azimuth, exact on the samples.
+// Bakes run in steps of lines (spread over frames with a time budget) into a second buffer, and the texels only
+// change when a bake completes, so they never mix two maps.
+class HorizonMap {
+public:
+	// Azimuths, packed 4 per RGBA texel (slice s holds azimuths 4s to 4s + 3)
+	static const int azimuthCount = 8;
+	static const int sliceCount = azimuthCount / 4;
+
+private:
+	HeightField field;
+	float spacing, heightScale;  // world distance between samples, and world height of a height unit
+	int size;
+
+	// Horizon angles as fractions of 90 degrees (0 to 255), sliceCount slices of size x size RGBA texels
+	std::vector<uint8_t> texels;  // last completed bake
+	std::vector<uint8_t> baking;  // bake in progress
+
+	// Progress of the bake in progress (nextAzimuth == azimuthCount when there is none)
+	int nextAzimuth, nextLine;
+	static constexpr int linesPerStep = 256;
+	static const int linesPerBlock = 16;
+
+	// method to get the number of lines along an azimuth (rows or columns: size, diagonals: 2 * size - 1)
+	int LineCount(int azimuth) const;
+
+	// Scratch space of a thread baking lines: the heights along a line, and the hull (positions along the line)
+	struct LineScratch {
+		std::vector<float> heights;
+		std::vector<int> hull;
+	};
+
+	// method to bake the horizons of the texels of a line into the bake in progress
+	void BakeLine(int azimuth, int line, LineScratch& scratch);
+
+public:
+	// method to start baking the horizons of a height field (restarts any bake in progress, the texels stay the last bake's)
+	void Begin(const HeightField& heightField, float sampleSpacing, float heightScale);
+
+	// method to continue the bake for about budgetMs (all of it if negative), returns true when it completed in this call
+	// (the lines of a step are shared with the pool when it is free, otherwise baked on the calling thread)
+	bool Bake(ThreadPool* pool, float budgetMs);
+
+	// methods to check for a bake in progress and get its progress (0 to 1)
+	bool IsBaking() const { return nextAzimuth < azimuthCount; }
+	float GetProgress() const;
+
+	// method to get the texels of the last completed bake (see texels), and their size
+	const std::vector<uint8_t>& GetTexels() const { return texels; }
+	int GetSize() const { return size; }
+
+	// method to get the horizon angle (in radians) of a texel towards an azimuth, from the last completed bake
+	float GetHorizon(int x, int y, int azimuth) const;
+
+	// method to time a full bake of a height field (in ms)
+	static float BenchmarkBake(const HeightField& heightField, float sampleSpacing, float heightScale, ThreadPool* pool = nullptr);
+
+	HorizonMap();
+};
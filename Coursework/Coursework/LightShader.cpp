@@ -48,6 +48,12 @@ LightShader::~LightShader()
 		camBuffer = 0;
 	}
 
+	// Release the terrain node constant buffer.
+	if (nodeBuffer) {
+		nodeBuffer->Release();
+		nodeBuffer = 0;
+	}
+
 	// Release base shader components.
 	BaseShader::~BaseShader();
 }
@@ -111,6 +117,8 @@ void LightShader::initShader(const wchar_t* vsFilename, const wchar_t* psFilenam
 	texHeightBufferDesc.MiscFlags = 0;
 	texHeightBufferDesc.StructureByteStride = 0;
 	renderer->CreateBuffer(&texHeightBufferDesc, NULL, &texHeightBuffer);
+
+	nodeBuffer = nullptr;
 }
 
 void LightShader::initShader(const wchar_t* vsFilename, const wchar_t* hsFilename, const wchar_t* dsFilename, const wchar_t* psFilename) {
@@ -118,12 +126,30 @@ void LightShader::initShader(const wchar_t* vsFilename, const wchar_t* hsFilenam
 	initShader(vsFilename, psFilename);
 	loadHullShader(hsFilename);
 	loadDomainShader(dsFilename);
+
+	// Setup the terrain node constant buffer for the vertex shader.
+	D3D11_BUFFER_DESC nodeBufferDesc;
+	nodeBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	nodeBufferDesc.ByteWidth = sizeof(TerrainQuadtree::NodeConstants);
+	nodeBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	nodeBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	nodeBufferDesc.MiscFlags = 0;
+	nodeBufferDesc.StructureByteStride = 0;
+	renderer->CreateBuffer(&nodeBufferDesc, NULL, &nodeBuffer);
 }
 
-void LightShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, ID3D11ShaderResourceView* heightMap, ID3D11ShaderResourceView* textureGrass, ID3D11ShaderResourceView* textureRock, ID3D11ShaderResourceView* textureSnow, XMFLOAT2 grassHeights, XMFLOAT2 rockHeights, XMFLOAT2 snowHeights, Light* light[lightSizeLightShader], XMFLOAT4 lightType[lightSizeLightShader], XMFLOAT3 camPos, ID3D11ShaderResourceView* depthMap[lightSizeLightShader]) {
+void LightShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, ID3D11ShaderResourceView* heightMap, ID3D11ShaderResourceView* normalMap, ID3D11ShaderResourceView* horizonMap, ID3D11ShaderResourceView* textureGrass, ID3D11ShaderResourceView* textureRock, ID3D11ShaderResourceView* textureSnow, XMFLOAT2 grassHeights, XMFLOAT2 rockHeights, XMFLOAT2 snowHeights, Light* light[lightSizeLightShader], XMFLOAT4 lightType[lightSizeLightShader], XMFLOAT3 camPos, ID3D11ShaderResourceView* depthMap[lightSizeLightShader], const TerrainQuadtree::NodeConstants* node) {
 	D3D11_MAPPED_SUBRESOURCE mappedResource;
 	MatrixBufferType* dataPtr;
 
+	// Terrain node for the vertex shader (zeros leave the vertices of other meshes as they are).
+	deviceContext->Map(nodeBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	TerrainQuadtree::NodeConstants* nodePtr = (TerrainQuadtree::NodeConstants*)mappedResource.pData;
+	if (node) *nodePtr = *node;
+	else *nodePtr = TerrainQuadtree::NodeConstants();
+	deviceContext->Unmap(nodeBuffer, 0);
+	deviceContext->VSSetConstantBuffers(0, 1, &nodeBuffer);
+
 	// Transpose matrices for shader compatibility (HLSL expects column-major format).
 	XMMATRIX tworld = XMMatrixTranspose(world);
 	XMMATRIX tview = XMMatrixTranspose(view);
@@ -163,6 +189,8 @@ void LightShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, co
 	texHPtr->grassHeights = grassHeights;
 	texHPtr->rockHeights = rockHeights;
 	texHPtr->snowHeights = snowHeights;
+	texHPtr->horizonShadows = horizonMap ? 1.f : 0.f;
+	texHPtr->padding = 0.f;
 	deviceContext->Unmap(texHeightBuffer, 0);
 	deviceContext->PSSetConstantBuffers(1, 1, &texHeightBuffer);
 
@@ -198,8 +226,9 @@ void LightShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, co
 	deviceContext->PSSetShaderResources(0, 1, &textureGrass);
 	deviceContext->PSSetShaderResources(1, 1, &textureRock);
 	deviceContext->PSSetShaderResources(2, 1, &textureSnow);
-	deviceContext->PSSetShaderResources(3, 1, &heightMap); // Heightmap for debugging
+	deviceContext->PSSetShaderResources(3, 1, &normalMap); // Baked terrain normals
 	deviceContext->PSSetShaderResources(4, 2, depthMap);
+	deviceContext->PSSetShaderResources(6, 1, &horizonMap); // Terrain horizons for the sun's self-shadowing
 	deviceContext->DSSetShaderResources(0, 1, &heightMap); // Heightmap for domain shader
 
 	// Set texture samplers for both pixel and domain shaders.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DXF.h" // Include DirectX Framework for base shader functionalities
+#include "TerrainQuadtree.h" // Constants of the terrain quadtree nodes
 
 // Define the number of lights supported by the light shader
 static const int lightSizeLightShader = 2;
@@ -33,7 +34,8 @@ private:
         XMFLOAT2 grassHeights;
         XMFLOAT2 rockHeights;
         XMFLOAT2 snowHeights;
-        XMFLOAT2 padding;
+        float horizonShadows; // 1 when a horizon map shadows the terrain from the directional light
+        float padding;
     };
 
 public:
@@ -50,6 +52,8 @@ public:
     void setShaderParametersTess(ID3D11DeviceContext* deviceContext,
         const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection,
         ID3D11ShaderResourceView* heightMap,
+        ID3D11ShaderResourceView* normalMap,
+        ID3D11ShaderResourceView* horizonMap,  // nullptr to leave the terrain self-shadowing to the shadow maps
         ID3D11ShaderResourceView* textureGrass, 
         ID3D11ShaderResourceView* textureRock, 
         ID3D11ShaderResourceView* textureSnow, 
@@ -59,7 +63,8 @@ public:
         Light* light[lightSizeLightShader],
         XMFLOAT4 lightType[lightSizeLightShader],
         XMFLOAT3 camPos,
-        ID3D11ShaderResourceView* depthMap[lightSizeLightShader]);
+        ID3D11ShaderResourceView* depthMap[lightSizeLightShader],
+        const TerrainQuadtree::NodeConstants* node = nullptr);  // quadtree node drawn with the node mesh, nullptr for other meshes
 
     // Set shader parameters for non-tessellated rendering
     void setShaderParameters(ID3D11DeviceContext* deviceContext,
@@ -82,6 +87,7 @@ private:
     ID3D11Buffer* lightBuffer;        // Buffer for storing light data
     ID3D11Buffer* camBuffer;          // Buffer for storing camera data
     ID3D11Buffer* texHeightBuffer;    // Buffer for storing texturing height data
+    ID3D11Buffer* nodeBuffer;         // Buffer for storing the terrain quadtree node (tessellated only)
 
     // Sampler state for texture sampling
     ID3D11SamplerState* sampleState;
@@ -0,0 +1,319 @@
+#include "MapCache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static const char cacheMagic[4] = { 'N', 'M', 'A', 'P' };
+static const wchar_t cacheExtension[] = L".nmap";
+
+// Read-only memory map of a whole file (closed by the destructor)
+struct MappedFile {
+#if defined(_WIN32)
+	HANDLE file, mapping;
+#else
+	int file;
+#endif
+	const unsigned char* data;
+	size_t size;
+
+	MappedFile() {
+#if defined(_WIN32)
+		file = INVALID_HANDLE_VALUE;
+		mapping = nullptr;
+#else
+		file = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	~MappedFile() { Close(); }
+
+	bool Open(const fs::path& path) {
+#if defined(_WIN32)
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return false;
+		size = (size_t)fileSize.QuadPart;
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) return false;
+		data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		file = open(path.c_str(), O_RDONLY);
+		if (file < 0) return false;
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0) return false;
+		size = (size_t)info.st_size;
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view == MAP_FAILED) return false;
+		data = static_cast<const unsigned char*>(view);
+#endif
+		return data != nullptr;
+	}
+
+	void Close() {
+#if defined(_WIN32)
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+		mapping = nullptr;
+#else
+		if (data) munmap(const_cast<unsigned char*>(data), size);
+		if (file >= 0) close(file);
+		file = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+};
+
+// Constructor with initialisation
+MapCache::MapCache(const std::wstring& dir, unsigned long long maxB) {
+	directory = dir;
+	maxBytes = maxB;
+
+	lastLoadTime = 0.f;
+	hits = misses = corrupt = evicted = 0;
+	entryCount = 0;
+	sizeBytes = 0;
+
+	std::error_code error;
+	fs::create_directories(directory, error);
+
+	// Counting the entries left by previous sessions (and evicting them down to the limit)
+	Evict(0);
+}
+
+// Entry file of a key: the key in hexadecimal in the cache directory
+std::wstring MapCache::EntryPath(unsigned long long key) {
+	static const wchar_t digits[] = L"0123456789abcdef";
+	std::wstring name(16, L'0');
+	for (int i = 15; i >= 0; i--, key >>= 4) {
+		name[i] = digits[key & 15];
+	}
+	return (fs::path(directory) / (name + cacheExtension)).wstring();
+}
+
+// Checksum of bytes: FNV-1a over 64-bit words (8x fewer multiplies than per byte), then over the remaining bytes
+unsigned long long MapCache::Checksum(const void* data, size_t bytes) {
+	const unsigned char* b = static_cast<const unsigned char*>(data);
+	unsigned long long hash = 14695981039346656037ull;
+	size_t i = 0;
+	for (; i + 8 <= bytes; i += 8) {
+		unsigned long long word;
+		memcpy(&word, b + i, 8);
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	for (; i < bytes; i++) {
+		hash ^= b[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Offsets of the arrays after the header, each aligned to arrayAlignment, and the size of the whole file
+void MapCache::ArrayOffsets(const unsigned long long* counts, int arrayCount, size_t* offsets, size_t& fileSize) {
+	size_t offset = sizeof(FileHeader);
+	for (int a = 0; a < arrayCount; a++) {
+		offset = (offset + arrayAlignment - 1) / arrayAlignment * arrayAlignment;
+		offsets[a] = offset;
+		offset += (size_t)counts[a] * sizeof(float);
+	}
+	fileSize = offset;
+}
+
+// Load an entry: map the file, check the header and every array checksum, then copy the arrays out
+// A file that exists but fails a check is corrupt (truncated, damaged or written by another format) and is deleted.
+bool MapCache::Load(unsigned long long key, std::initializer_list<std::vector<float>*> arrays) {
+	auto startTime = std::chrono::high_resolution_clock::now();
+	const std::wstring path = EntryPath(key);
+
+	MappedFile file;
+	if (!file.Open(path)) {
+		misses++;
+		return false;
+	}
+
+	// Header: magic, version, key, layout and its own checksum
+	bool valid = file.size >= sizeof(FileHeader);
+	FileHeader header;
+	size_t offsets[maxArrays];
+	if (valid) {
+		memcpy(&header, file.data, sizeof(FileHeader));
+		valid = memcmp(header.magic, cacheMagic, 4) == 0 && header.version == formatVersion && header.key == key
+			&& header.headerChecksum == Checksum(&header, offsetof(FileHeader, headerChecksum))
+			&& header.arrayCount == arrays.size() && header.arrayCount <= (uint32_t)maxArrays;
+	}
+	if (valid) {
+		size_t fileSize;
+		ArrayOffsets(header.counts, header.arrayCount, offsets, fileSize);
+		valid = file.size == fileSize;
+	}
+
+	// Arrays: the sizes the caller expects, then the checksums (before anything is copied, so a miss leaves them unchanged)
+	int a = 0;
+	for (std::vector<float>* array : arrays) {
+		if (!valid) break;
+		valid = header.counts[a] == array->size()
+			&& header.checksums[a] == Checksum(file.data + offsets[a], array->size() * sizeof(float));
+		a++;
+	}
+	if (valid) {
+		a = 0;
+		for (std::vector<float>* array : arrays) {
+			memcpy(array->data(), file.data + offsets[a], array->size() * sizeof(float));
+			a++;
+		}
+	}
+	const unsigned long long fileBytes = file.size;
+	file.Close();
+
+	std::error_code error;
+	if (!valid) {
+		corrupt++;
+		misses++;
+		if (fs::remove(path, error)) {
+			entryCount--;
+			sizeBytes -= std::min(fileBytes, sizeBytes);
+		}
+		return false;
+	}
+
+	// Refreshing the file time, so eviction keeps the recently used entries
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+	hits++;
+	lastLoadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return true;
+}
+
+// Store an entry: write the header and arrays to a temporary file, then rename it over the entry
+// Readers never see a partially written entry, and an interrupted write only leaves a temporary file (removed by Evict).
+bool MapCache::Store(unsigned long long key, std::initializer_list<const std::vector<float>*> arrays) {
+	if (arrays.size() == 0 || arrays.size() > (size_t)maxArrays) return false;
+
+	FileHeader header;
+	memset(&header, 0, sizeof(FileHeader));
+	memcpy(header.magic, cacheMagic, 4);
+	header.version = formatVersion;
+	header.key = key;
+	header.arrayCount = (uint32_t)arrays.size();
+	int a = 0;
+	for (const std::vector<float>* array : arrays) {
+		header.counts[a] = array->size();
+		header.checksums[a] = Checksum(array->data(), array->size() * sizeof(float));
+		a++;
+	}
+	header.headerChecksum = Checksum(&header, offsetof(FileHeader, headerChecksum));
+
+	size_t offsets[maxArrays], fileSize;
+	ArrayOffsets(header.counts, header.arrayCount, offsets, fileSize);
+	if (fileSize > maxBytes) return false;
+
+	const std::wstring path = EntryPath(key);
+	const fs::path tempPath = fs::path(path + L".tmp");
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out) return false;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+		size_t offset = sizeof(FileHeader);
+		a = 0;
+		for (const std::vector<float>* array : arrays) {
+			static const char padding[arrayAlignment] = {};
+			out.write(padding, offsets[a] - offset);
+			out.write(reinterpret_cast<const char*>(array->data()), array->size() * sizeof(float));
+			offset = offsets[a] + array->size() * sizeof(float);
+			a++;
+		}
+		if (!out) {
+			out.close();
+			std::error_code error;
+			fs::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(tempPath, path, error);
+	if (error) {
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	Evict(key);
+	return true;
+}
+
+// Evict the least recently used entries (oldest file time first) until the entries fit in maxBytes
+void MapCache::Evict(unsigned long long keep) {
+	struct Entry {
+		fs::file_time_type time;
+		unsigned long long bytes;
+		fs::path path;
+	};
+	std::vector<Entry> entries;
+	unsigned long long total = 0;
+	int count = 0;
+
+	std::error_code error;
+	const std::wstring keepName = fs::path(EntryPath(keep)).filename().wstring();
+	for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+		const fs::path& path = it->path();
+		std::error_code fileError;
+		if (path.extension() == L".tmp") {
+			// Left over from an interrupted Store
+			fs::remove(path, fileError);
+			continue;
+		}
+		if (path.extension() != cacheExtension) continue;
+		Entry entry;
+		entry.bytes = fs::file_size(path, fileError);
+		entry.time = fs::last_write_time(path, fileError);
+		if (fileError) continue;
+		entry.path = path;
+		total += entry.bytes;
+		count++;
+		if (path.filename().wstring() != keepName) entries.push_back(entry);
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+	for (size_t i = 0; i < entries.size() && total > maxBytes; i++) {
+		std::error_code fileError;
+		if (fs::remove(entries[i].path, fileError)) {
+			total -= entries[i].bytes;
+			count--;
+			evicted++;
+		}
+	}
+	entryCount = count;
+	sizeBytes = total;
+}
+
+// Delete every entry of the cache directory
+void MapCache::Clear() {
+	std::error_code error;
+	std::vector<fs::path> paths;
+	for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+		if (it->path().extension() == cacheExtension || it->path().extension() == L".tmp") paths.push_back(it->path());
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		fs::remove(paths[i], error);
+	}
+	Evict(0);  // counting whatever could not be deleted
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+// Class for a persistent on-disk cache of generated maps
+// Each entry is one file named after the hash of the parameters that generated it (content-addressed), holding one or
+// more float arrays in a versioned binary format with a checksum of the header and of every array.
+// Entries are loaded through a memory map and copied straight into the caller's arrays, so a hit skips the generation.
+// Missing, corrupt or mismatched entries are treated as misses (corrupt files are deleted). When the entries go over the
+// size limit, the least recently used ones are evicted (a hit refreshes the file time).
+// Only one thread should use a cache directory at a time.
+class MapCache {
+public:
+	// Builder of a cache key: FNV-1a hash of every parameter added, in order
+	class Key {
+	private:
+		unsigned long long hash;
+
+	public:
+		Key() { hash = 14695981039346656037ull; }
+
+		// method to add raw bytes, or one parameter value
+		Key& Add(const void* data, size_t bytes) {
+			const unsigned char* b = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < bytes; i++) {
+				hash ^= b[i];
+				hash *= 1099511628211ull;
+			}
+			return *this;
+		}
+		template <typename T>
+		Key& Add(T value) { return Add(&value, sizeof(T)); }
+
+		unsigned long long Get() const { return hash; }
+	};
+
+	// Version of the file format (files of other versions are misses)
+	static const uint32_t formatVersion = 1;
+
+	// Largest number of arrays in one entry
+	static const int maxArrays = 4;
+
+private:
+	// File header, followed by the arrays (each one starting on an arrayAlignment boundary)
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		unsigned long long key;
+		uint32_t arrayCount, reserved;
+		unsigned long long counts[maxArrays];     // floats per array
+		unsigned long long checksums[maxArrays];  // checksum of each array
+		unsigned long long headerChecksum;        // checksum of the header up to this member
+	};
+	static const size_t arrayAlignment = 64;
+
+	std::wstring directory;
+	unsigned long long maxBytes;
+
+	// Statistics of the last load (time to map, verify and copy, in ms)
+	float lastLoadTime;
+	int hits, misses, corrupt, evicted;
+
+	// Number and total size of the entries, counted by Evict (after every Store and Clear) and kept up to date by Load,
+	// so reading them does not scan the directory
+	int entryCount;
+	unsigned long long sizeBytes;
+
+	// method to get the file of a key
+	std::wstring EntryPath(unsigned long long key);
+
+	// method to get the offset of each array in a file
+	static void ArrayOffsets(const unsigned long long* counts, int arrayCount, size_t* offsets, size_t& fileSize);
+
+	// method to evict the least recently used entries until the cache fits in maxBytes (never the entry of keep),
+	// counting the entries left
+	void Evict(unsigned long long keep);
+
+public:
+	// method to checksum bytes (FNV-1a over 64-bit words, then over the remaining bytes)
+	static unsigned long long Checksum(const void* data, size_t bytes);
+
+	// method to load the entry of key into arrays (each one must already have the stored size), returns true on a hit
+	bool Load(unsigned long long key, std::initializer_list<std::vector<float>*> arrays);
+
+	// method to store arrays as the entry of key (written to a temporary file, then renamed), then evict over the limit
+	bool Store(unsigned long long key, std::initializer_list<const std::vector<float>*> arrays);
+
+	// method to delete every entry
+	void Clear();
+
+	// methods to get the number and total size of the entries
+	int GetEntryCount() { return entryCount; }
+	unsigned long long GetSizeBytes() { return sizeBytes; }
+	unsigned long long GetMaxBytes() { return maxBytes; }
+	void SetMaxBytes(unsigned long long bytes) { maxBytes = bytes; Evict(0); }
+
+	// methods to get the statistics of this session
+	float GetLastLoadTime() { return lastLoadTime; }
+	int GetHits() { return hits; }
+	int GetMisses() { return misses; }
+	int GetCorrupt() { return corrupt; }
+	int GetEvicted() { return evicted; }
+
+	// Constructor with the cache directory (created if needed) and the size limit of all entries
+	MapCache(const std::wstring& directory, unsigned long long maxBytes);
+};
@@ -0,0 +1,372 @@
+#include "NoiseGraph.h"
+#include <chrono>
+#include <cmath>
+
+// Constructor with initialisation (an empty graph evaluates to nothing until compiled)
+NoiseGraph::NoiseGraph(uint32_t seed) : noise(1.0f, 1.0f, 2.0f, 0.5f, seed) {
+	registerCount = 0;
+	outputRegister = -1;
+}
+
+// Adding a node after every node it depends on, so the nodes are always in evaluation order
+NoiseGraph::Node NoiseGraph::AddNode(Op op, Node a, Node b, Node c, int octaves, float p0, float p1, float p2, float p3) {
+	NodeDesc node;
+	node.op = op;
+	node.inputs[0] = a;
+	node.inputs[1] = b;
+	node.inputs[2] = c;
+	node.octaves = octaves;
+	node.params[0] = p0;
+	node.params[1] = p1;
+	node.params[2] = p2;
+	node.params[3] = p3;
+	nodes.push_back(node);
+	return (Node)nodes.size() - 1;
+}
+
+// Noise nodes (z is -1 for 2D noise)
+NoiseGraph::Node NoiseGraph::Fbm(Node x, Node y, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Fbm, x, y, -1, octaves, frequency, lacunarity, persistence);
+}
+
+NoiseGraph::Node NoiseGraph::Fbm(Node x, Node y, Node z, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Fbm, x, y, z, octaves, frequency, lacunarity, persistence);
+}
+
+NoiseGraph::Node NoiseGraph::Ridged(Node x, Node y, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Ridged, x, y, -1, octaves, frequency, lacunarity, persistence);
+}
+
+NoiseGraph::Node NoiseGraph::Ridged(Node x, Node y, Node z, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Ridged, x, y, z, octaves, frequency, lacunarity, persistence);
+}
+
+NoiseGraph::Node NoiseGraph::Billow(Node x, Node y, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Billow, x, y, -1, octaves, frequency, lacunarity, persistence);
+}
+
+NoiseGraph::Node NoiseGraph::Billow(Node x, Node y, Node z, int octaves, float frequency, float persistence, float lacunarity) {
+	return AddNode(Op::Billow, x, y, z, octaves, frequency, lacunarity, persistence);
+}
+
+// Piecewise linear curve, its control points are kept in curvePoints
+NoiseGraph::Node NoiseGraph::Curve(Node a, const std::vector<float>& points) {
+	Node node = AddNode(Op::Curve, a, -1, -1, 0, (float)(curvePoints.size() / 2), (float)(points.size() / 2));
+	curvePoints.insert(curvePoints.end(), points.begin(), points.begin() + (points.size() / 2) * 2);
+	return node;
+}
+
+// Domain warp: both coordinates move by an fBm, the second one sampled far away so the two offsets are unrelated
+void NoiseGraph::DomainWarp(Node& x, Node& y, float strength, int octaves, float frequency) {
+	const float shift = (frequency != 0.f) ? 17.3f / std::fabs(frequency) : 0.f;
+	Node offsetX = Fbm(x, y, octaves, frequency);
+	Node offsetY = Fbm(ScaleBias(x, 1.f, shift), ScaleBias(y, 1.f, shift), octaves, frequency);
+	x = Add(x, ScaleBias(offsetX, strength, 0.f));
+	y = Add(y, ScaleBias(offsetY, strength, 0.f));
+}
+
+// Compiling the graph: drop the nodes output does not depend on, then give each remaining node a register,
+// handing the registers of values past their last use to the next nodes
+void NoiseGraph::Compile(Node output) {
+	program.clear();
+	registerCount = 0;
+	outputRegister = -1;
+	if (output < 0 || output >= (Node)nodes.size()) return;
+
+	// Nodes output depends on (inputs are always earlier nodes)
+	std::vector<bool> live(output + 1, false);
+	live[output] = true;
+	for (Node n = output; n >= 0; n--) {
+		if (!live[n]) continue;
+		for (Node input : nodes[n].inputs) {
+			if (input >= 0) live[input] = true;
+		}
+	}
+
+	// Last node reading each value (the output is never released)
+	std::vector<Node> lastUse(output + 1, -1);
+	for (Node n = 0; n <= output; n++) {
+		if (!live[n]) continue;
+		for (Node input : nodes[n].inputs) {
+			if (input >= 0) lastUse[input] = n;
+		}
+	}
+	lastUse[output] = output + 1;
+
+	std::vector<int> nodeRegister(output + 1, -1);
+	std::vector<int> freeRegisters;
+	auto allocate = [&]() {
+		if (freeRegisters.empty()) return registerCount++;
+		int reg = freeRegisters.back();
+		freeRegisters.pop_back();
+		return reg;
+	};
+	auto release = [&](Node n) {
+		for (int k = 0; k < 3; k++) {
+			Node input = nodes[n].inputs[k];
+			if (input < 0 || lastUse[input] != n) continue;
+			bool repeated = false;  // the same input read twice is only released once
+			for (int j = 0; j < k; j++) repeated |= (nodes[n].inputs[j] == input);
+			if (!repeated) freeRegisters.push_back(nodeRegister[input]);
+		}
+	};
+
+	for (Node n = 0; n <= output; n++) {
+		if (!live[n]) continue;
+		const NodeDesc& node = nodes[n];
+		Instruction instruction;
+		instruction.op = node.op;
+		instruction.octaves = node.octaves;
+		for (int k = 0; k < 3; k++) instruction.src[k] = (node.inputs[k] >= 0) ? nodeRegister[node.inputs[k]] : -1;
+		for (int k = 0; k < 4; k++) instruction.params[k] = node.params[k];
+
+		// Element-wise ops can write over an input they read for the last time, the noise ops cannot
+		if (ReadsAfterWrite(node.op)) {
+			instruction.dst = allocate();
+			release(n);
+		}
+		else {
+			release(n);
+			instruction.dst = allocate();
+		}
+		nodeRegister[n] = instruction.dst;
+		program.push_back(instruction);
+	}
+	outputRegister = nodeRegister[output];
+}
+
+// Evaluating a noise instruction over a block: the same operations, in the same order, as SimplexNoise::fractalRow
+void NoiseGraph::RunNoise(const Instruction& instruction, float* registers, float* temp, int count) const {
+	float* output = registers + (size_t)instruction.dst * blockSize;
+	const float* xs = registers + (size_t)instruction.src[0] * blockSize;
+	const float* ys = registers + (size_t)instruction.src[1] * blockSize;
+	const float* zs = (instruction.src[2] >= 0) ? registers + (size_t)instruction.src[2] * blockSize : nullptr;
+	float* xf = temp;
+	float* yf = temp + blockSize;
+	float* zf = temp + 2 * blockSize;
+	float* octave = temp + 3 * blockSize;
+
+	for (int i = 0; i < count; i++) {
+		output[i] = 0.f;
+	}
+
+	float denom = 0.f;
+	float frequency = instruction.params[0];
+	float amplitude = 1.f;
+	for (int o = 0; o < instruction.octaves; o++) {
+		for (int i = 0; i < count; i++) {
+			xf[i] = xs[i] * frequency;
+			yf[i] = ys[i] * frequency;
+		}
+		if (zs) {
+			for (int i = 0; i < count; i++) {
+				zf[i] = zs[i] * frequency;
+			}
+			noise.noisePoints(xf, yf, zf, octave, count);
+		}
+		else {
+			noise.noisePoints(xf, yf, octave, count);
+		}
+
+		if (instruction.op == Op::Ridged) {
+			for (int i = 0; i < count; i++) {
+				float ridge = 1.f - std::fabs(octave[i]);
+				octave[i] = ridge * ridge;
+			}
+		}
+		else if (instruction.op == Op::Billow) {
+			for (int i = 0; i < count; i++) {
+				octave[i] = 2.f * std::fabs(octave[i]) - 1.f;
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			output[i] += (amplitude * octave[i]);
+		}
+		denom += amplitude;
+
+		frequency *= instruction.params[1];
+		amplitude *= instruction.params[2];
+	}
+
+	for (int i = 0; i < count; i++) {
+		output[i] = (output[i] / denom);
+	}
+	if (instruction.op == Op::Ridged) {
+		for (int i = 0; i < count; i++) {
+			output[i] = 2.f * output[i] - 1.f;  // [0, 1] to [-1, 1]
+		}
+	}
+}
+
+// Evaluating a row block by block, running the whole instruction stream on each block
+void NoiseGraph::EvaluateRow(float x0, float dx, float y, float z, float* out, int count, float* scratch) const {
+	if (outputRegister < 0) return;
+	float* registers = scratch;
+	float* temp = scratch + (size_t)registerCount * blockSize;
+
+	for (int first = 0; first < count; first += blockSize) {
+		const int n = (count - first < blockSize) ? (count - first) : blockSize;
+		for (const Instruction& instruction : program) {
+			float* dst = registers + (size_t)instruction.dst * blockSize;
+			const float* a = (instruction.src[0] >= 0) ? registers + (size_t)instruction.src[0] * blockSize : nullptr;
+			const float* b = (instruction.src[1] >= 0) ? registers + (size_t)instruction.src[1] * blockSize : nullptr;
+			const float* c = (instruction.src[2] >= 0) ? registers + (size_t)instruction.src[2] * blockSize : nullptr;
+			const float* p = instruction.params;
+
+			switch (instruction.op) {
+			case Op::X:
+				for (int i = 0; i < n; i++) dst[i] = x0 + static_cast<float>((size_t)(first + i)) * dx;
+				break;
+			case Op::Y:
+				for (int i = 0; i < n; i++) dst[i] = y;
+				break;
+			case Op::Z:
+				for (int i = 0; i < n; i++) dst[i] = z;
+				break;
+			case Op::Constant:
+				for (int i = 0; i < n; i++) dst[i] = p[0];
+				break;
+			case Op::Fbm:
+			case Op::Ridged:
+			case Op::Billow:
+				RunNoise(instruction, registers, temp, n);
+				break;
+			case Op::Add:
+				for (int i = 0; i < n; i++) dst[i] = a[i] + b[i];
+				break;
+			case Op::Mul:
+				for (int i = 0; i < n; i++) dst[i] = a[i] * b[i];
+				break;
+			case Op::ScaleBias:
+				for (int i = 0; i < n; i++) dst[i] = a[i] * p[0] + p[1];
+				break;
+			case Op::Blend:
+				for (int i = 0; i < n; i++) {
+					float t = c[i] < 0.f ? 0.f : (c[i] > 1.f ? 1.f : c[i]);
+					dst[i] = a[i] + (b[i] - a[i]) * t;
+				}
+				break;
+			case Op::Curve: {
+				const float* points = &curvePoints[(size_t)p[0] * 2];
+				const int pointCount = (int)p[1];
+				for (int i = 0; i < n; i++) {
+					float v = a[i];
+					if (pointCount == 0) { dst[i] = v; continue; }
+					if (v <= points[0]) { dst[i] = points[1]; continue; }
+					int k = 1;
+					while (k < pointCount && v > points[k * 2]) k++;
+					if (k == pointCount) { dst[i] = points[k * 2 - 1]; continue; }
+					float x0k = points[k * 2 - 2], x1k = points[k * 2];
+					float t = (x1k > x0k) ? (v - x0k) / (x1k - x0k) : 1.f;
+					dst[i] = points[k * 2 - 1] + (points[k * 2 + 1] - points[k * 2 - 1]) * t;
+				}
+				break;
+			}
+			case Op::Terrace:
+				for (int i = 0; i < n; i++) {
+					float v = a[i] * p[0];
+					float step = std::floor(v);
+					dst[i] = (step + std::pow(v - step, p[1])) / p[0];
+				}
+				break;
+			}
+		}
+
+		const float* result = registers + (size_t)outputRegister * blockSize;
+		for (int i = 0; i < n; i++) {
+			out[first + i] = result[i];
+		}
+	}
+}
+
+// Evaluating a range of rows of a grid, with one scratch buffer for the whole range
+void NoiseGraph::EvaluateRows(float x0, float dx, float y0, float dy, float z, float* out, int sizeX, int firstRow, int lastRow) const {
+	std::vector<float> scratch(ScratchSize());
+	for (int y = firstRow; y < lastRow; y++) {
+		EvaluateRow(x0, dx, y0 + y * dy, z, out + (size_t)(y - firstRow) * sizeX, sizeX, scratch.data());
+	}
+}
+
+// Building the built-in shapes over X, Y (and Z for a volume)
+NoiseGraph NoiseGraph::Preset(Shape shape, float frequency, int octaves, float persistence, bool volume, uint32_t seed) {
+	NoiseGraph graph(seed);
+	Node x = graph.X();
+	Node y = graph.Y();
+	Node z = volume ? graph.Z() : -1;
+	Node output;
+
+	switch (shape) {
+	case Shape::Ridged: {
+		// Ridges where a low frequency mask is high, plain fBm in the lowlands
+		Node mask = graph.Curve(graph.Fbm(x, y, z, 2, frequency * 0.25f), { -1.f, 0.f, -0.1f, 0.f, 0.4f, 1.f, 1.f, 1.f });
+		output = graph.Blend(graph.Fbm(x, y, z, octaves, frequency, persistence), graph.Ridged(x, y, z, octaves, frequency, persistence), mask);
+		break;
+	}
+	case Shape::Billow:
+		output = graph.Billow(x, y, z, octaves, frequency, persistence);
+		break;
+	case Shape::Warped: {
+		// Warp by about half a cell of the first octave
+		const float strength = (frequency != 0.f) ? 0.5f / std::fabs(frequency) : 0.f;
+		graph.DomainWarp(x, y, strength, 4, frequency);
+		output = graph.Fbm(x, y, z, octaves, frequency, persistence);
+		break;
+	}
+	case Shape::Terraced: {
+		Node height = graph.ScaleBias(graph.Fbm(x, y, z, octaves, frequency, persistence), 0.5f, 0.5f);
+		output = graph.ScaleBias(graph.Terrace(height, 8.f, 2.5f), 2.f, -1.f);
+		break;
+	}
+	default:
+		output = graph.Fbm(x, y, z, octaves, frequency, persistence);
+		break;
+	}
+
+	graph.Compile(output);
+	return graph;
+}
+
+// Names of the built-in shapes
+const char* NoiseGraph::GetShapeName(Shape shape) {
+	switch (shape) {
+	case Shape::Fbm: return "fBm";
+	case Shape::Ridged: return "Ridged";
+	case Shape::Billow: return "Billow";
+	case Shape::Warped: return "Domain-warped";
+	case Shape::Terraced: return "Terraced";
+	default: return "";
+	}
+}
+
+// Timing the hand-written fBm and the fBm graph over the same size x size samples (in ms)
+NoiseGraph::Benchmark NoiseGraph::BenchmarkFbm(int size, float frequency, int octaves, float spacing, ThreadPool* pool) {
+	if (frequency == 0) frequency = 0.001f;
+	std::vector<float> handWritten((size_t)size * size), graphed((size_t)size * size);
+	SimplexNoise noise = SimplexNoise(frequency);
+	NoiseGraph graph = Preset(Shape::Fbm, frequency, octaves, 0.5f, false);
+	Benchmark result;
+	result.instructions = graph.GetInstructionCount();
+	result.registers = graph.GetRegisterCount();
+
+	const int rowsPerBlock = 16;
+	auto handWrittenRows = [&](int firstRow, int lastRow) {
+		for (int y = firstRow; y < lastRow; y++) {
+			noise.fractalRow(octaves, 0.f, spacing, y * spacing, &handWritten[(size_t)y * size], size);
+		}
+	};
+	auto startTime = std::chrono::high_resolution_clock::now();
+	if (pool) pool->ParallelFor(size, rowsPerBlock, handWrittenRows);
+	else handWrittenRows(0, size);
+	result.handWrittenTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	auto graphRows = [&](int firstRow, int lastRow) {
+		graph.EvaluateRows(0.f, spacing, 0.f, spacing, 0.f, &graphed[(size_t)firstRow * size], size, firstRow, lastRow);
+	};
+	startTime = std::chrono::high_resolution_clock::now();
+	if (pool) pool->ParallelFor(size, rowsPerBlock, graphRows);
+	else graphRows(0, size);
+	result.graphTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	result.maxUlp = SimplexNoise::maxUlpDistance(handWritten.data(), graphed.data(), handWritten.size());
+	return result;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include "SimplexNoise.h"
+#include "ThreadPool.h"
+
+// Class for a composable noise graph
+// Nodes are added with the builder methods (each returns the node to pass as an input to later nodes), then Compile()
+// flattens the nodes the output depends on into an instruction stream, reusing registers once their values are dead.
+// Evaluation runs the instructions over blocks of samples of a row: the noise nodes use the batch (SIMD) simplex noise
+// and the other nodes are simple loops over the block, so a new shape needs no hand-written generation loop.
+// A compiled graph is only read by the evaluation methods, so several threads can evaluate it at once.
+class NoiseGraph {
+public:
+	// Index of a node (its output)
+	typedef int Node;
+
+	// Built-in shapes (see Preset)
+	enum class Shape {
+		Fbm,       // plain fBm (the same values as SimplexNoise::fractalRow)
+		Ridged,    // fBm blended into ridged fBm on the high ground of a low frequency mask
+		Billow,    // billowy fBm (absolute value of every octave)
+		Warped,    // fBm of domain-warped coordinates
+		Terraced,  // fBm remapped into smoothed terraces
+		Count
+	};
+
+	// Number of samples per block of evaluation (registers are one block each)
+	static const int blockSize = 256;
+
+	// Timings (in ms) of the hand-written fBm and of the equivalent graph over the same samples, their largest
+	// difference in ULP, and the size of the compiled graph
+	struct Benchmark {
+		float handWrittenTime, graphTime;
+		int maxUlp, instructions, registers;
+	};
+
+private:
+	enum class Op : unsigned char {
+		X, Y, Z, Constant,
+		Fbm, Ridged, Billow,
+		Add, Mul, ScaleBias, Blend, Curve, Terrace
+	};
+
+	// Node as built: op, input nodes (-1 when unused) and parameters
+	// Noise nodes: params are frequency, lacunarity, persistence. Curve: params[0] is the first control point, params[1] the count.
+	struct NodeDesc {
+		Op op;
+		Node inputs[3];
+		int octaves;
+		float params[4];
+	};
+
+	// Compiled instruction: the same op and parameters, with registers instead of nodes
+	struct Instruction {
+		Op op;
+		int dst, src[3];
+		int octaves;
+		float params[4];
+	};
+
+	SimplexNoise noise;  // noise of the seed of the graph (all noise nodes share it)
+	std::vector<NodeDesc> nodes;
+	std::vector<float> curvePoints;  // (input, output) control points of the Curve nodes
+	std::vector<Instruction> program;
+	int registerCount, outputRegister;
+
+	// method to add a node, returns it
+	Node AddNode(Op op, Node a, Node b, Node c, int octaves, float p0 = 0.f, float p1 = 0.f, float p2 = 0.f, float p3 = 0.f);
+
+	// method to run a noise instruction over a block (per octave: scale the coordinates, batch noise, shape and accumulate)
+	void RunNoise(const Instruction& instruction, float* registers, float* temp, int count) const;
+
+	// method to check if an op reads its inputs after writing its output (its output register cannot reuse an input's)
+	static bool ReadsAfterWrite(Op op) { return op == Op::Fbm || op == Op::Ridged || op == Op::Billow; }
+
+public:
+	// methods to add the sample coordinates and constants
+	Node X() { return AddNode(Op::X, -1, -1, -1, 0); }
+	Node Y() { return AddNode(Op::Y, -1, -1, -1, 0); }
+	Node Z() { return AddNode(Op::Z, -1, -1, -1, 0); }
+	Node Constant(float value) { return AddNode(Op::Constant, -1, -1, -1, 0, value); }
+
+	// methods to add fBm, ridged fBm (1 - |noise|)^2 and billow fBm 2|noise| - 1 of 2D or 3D noise, all in [-1, 1]
+	Node Fbm(Node x, Node y, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+	Node Fbm(Node x, Node y, Node z, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+	Node Ridged(Node x, Node y, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+	Node Ridged(Node x, Node y, Node z, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+	Node Billow(Node x, Node y, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+	Node Billow(Node x, Node y, Node z, int octaves, float frequency, float persistence = 0.5f, float lacunarity = 2.f);
+
+	// methods to combine and remap values
+	Node Add(Node a, Node b) { return AddNode(Op::Add, a, b, -1, 0); }
+	Node Mul(Node a, Node b) { return AddNode(Op::Mul, a, b, -1, 0); }
+	Node ScaleBias(Node a, float scale, float bias) { return AddNode(Op::ScaleBias, a, -1, -1, 0, scale, bias); }
+	Node Blend(Node a, Node b, Node t) { return AddNode(Op::Blend, a, b, t, 0); }  // a + (b - a) * t, t clamped to [0, 1]
+
+	// method to remap a value through a piecewise linear curve (points are (input, output) pairs sorted by input, clamped outside)
+	Node Curve(Node a, const std::vector<float>& points);
+
+	// method to remap a value in [0, 1] into steps terraces, sharpness > 1 flattens the terraces
+	Node Terrace(Node a, float steps, float sharpness) { return AddNode(Op::Terrace, a, -1, -1, 0, steps, sharpness); }
+
+	// method to displace the coordinates x and y by strength times two fBm (the nodes are replaced by the warped ones)
+	void DomainWarp(Node& x, Node& y, float strength, int octaves, float frequency);
+
+	// method to compile the nodes output depends on into the instruction stream
+	void Compile(Node output);
+
+	// method to get the number of instructions and registers of the compiled graph
+	int GetInstructionCount() { return (int)program.size(); }
+	int GetRegisterCount() { return registerCount; }
+
+	// method to evaluate a row, out[i] = graph(x0 + i * dx, y, z), using scratch (at least ScratchSize() floats)
+	void EvaluateRow(float x0, float dx, float y, float z, float* out, int count, float* scratch) const;
+	size_t ScratchSize() const { return (size_t)(registerCount + 4) * blockSize; }
+
+	// method to evaluate the rows [firstRow, lastRow) of a grid (row y at y0 + y * dy, stored at out + (y - firstRow) * sizeX)
+	void EvaluateRows(float x0, float dx, float y0, float dy, float z, float* out, int sizeX, int firstRow, int lastRow) const;
+
+	// method to build and compile a shape over X, Y (and Z for a volume), with the noise of seed
+	static NoiseGraph Preset(Shape shape, float frequency, int octaves, float persistence, bool volume, uint32_t seed = 0);
+
+	// method to compare SimplexNoise::fractalRow and the fBm preset on a size x size grid of the given sample spacing
+	static Benchmark BenchmarkFbm(int size, float frequency, int octaves, float spacing, ThreadPool* pool = nullptr);
+
+	// method to get the name of a shape
+	static const char* GetShapeName(Shape shape);
+
+	explicit NoiseGraph(uint32_t seed = 0);
+};
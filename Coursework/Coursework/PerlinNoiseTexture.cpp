@@ -1,7 +1,7 @@
 #include "PerlinNoiseTexture.h"
 
-// Constructor with initialisation
-PerlinNoiseTexture::PerlinNoiseTexture(int terrainS, int volumeSx, int volumeSy, int volumeSz) {
+// Constructor with initialisation (the map cache lives next to the executable's working directory)
+PerlinNoiseTexture::PerlinNoiseTexture(int terrainS, int volumeSx, int volumeSy, int volumeSz) : mapCache(L"MapCache", mapCacheMaxBytes) {
 	// Initialising the size for terrain height map and cloud density map
 	terrainSize = terrainS;
 	volumeSizeX = volumeSx;
@@ -10,83 +10,475 @@ PerlinNoiseTexture::PerlinNoiseTexture(int terrainS, int volumeSx, int volumeSy,
 
 	// Noise and density data vector initialisation
 	noiseData = std::vector<float>(terrainSize * terrainSize);
+	gradientData = std::vector<float>(2 * terrainSize * terrainSize);
+	normalData = std::vector<uint32_t>(terrainSize * terrainSize);
 	densityData = std::vector<float>(volumeSizeX * volumeSizeY * volumeSizeZ);
+	UpdateHeightField();
 
 	// Initialisation of texture and SRV pointers
 	noiseTexture = nullptr;
 	noiseTextureSRV = nullptr;
+	normalTexture = nullptr;
+	normalTextureSRV = nullptr;
+	horizonTexture = nullptr;
+	horizonTextureSRV = nullptr;
 	densityTexture = nullptr;
 	densityTextureSRV = nullptr;
+	for (int s = 0; s < densityRingSlices; s++) {
+		densityRingTextures[s] = nullptr;
+		densityRingSRVs[s] = nullptr;
+	}
+
+	// Initialisation of generation timings
+	generationTimeHM = 0.f;
+	generationTimeDM = 0.f;
+	generationTimeRing = 0.f;
+
+	// Initialisation of the background regeneration state (the worker thread starts on the first request)
+	regenStopping = false;
+	pendingHM = pendingDM = runningHM = runningDM = readyHM = readyDM = false;
+	pendingRing = runningRing = readyRing = false;
+	requestDMFreq = requestRingFreq = 0.f;
+	cancelHM = cancelDM = cancelRing = false;
+	readyTimeHM = readyTimeDM = readyTimeRing = 0.f;
+	readySavedHM = readySavedDM = readySavedRing = 0;
+	readyGeneratedHM = false;
+
+	// Initialisation of the octave cache (filled by the first height map generation)
+	octaveCacheFreq = 0.f;
+	octaveCacheSeed = 0;
+	octaveCacheLayers = 0;
+	octaveCacheValid = lastHMCached = false;
+	lastHMLoaded = lastDMLoaded = false;
+
+	// Specialised fBm kernels by default (within SimplexNoise::fractalMaxUlp of the runtime kernel)
+	specialisedFractal = true;
+
+	// Plain fBm shapes by default
+	heightShape = densityShape = (int)NoiseGraph::Shape::Fbm;
+
+	// Reference permutation by default
+	worldSeed = 0;
+
+	// Band-limited fBm with a faded last octave by default
+	bandLimited = bandLimitFade = true;
+	savedOctavesHM = savedOctavesDM = savedOctavesRing = 0;
 }
 
 // Destructor
 PerlinNoiseTexture::~PerlinNoiseTexture() {
+	StopRegeneration();
+
 	noiseTexture->Release();
 	noiseTextureSRV->Release();
 
+	normalTexture->Release();
+	normalTextureSRV->Release();
+
+	horizonTexture->Release();
+	horizonTextureSRV->Release();
+
 	densityTexture->Release();
 	densityTextureSRV->Release();
+
+	for (int s = 0; s < densityRingSlices; s++) {
+		if (densityRingSRVs[s]) densityRingSRVs[s]->Release();
+		if (densityRingTextures[s]) densityRingTextures[s]->Release();
+	}
 }
 
 // Smoothing method (Smoothing by averaging with neighbour values)
-void PerlinNoiseTexture::SmoothHeightMap(ID3D11Device* device, TextureManager* textureMgr) {
-	std::vector<float> smoothedHeights(terrainSize * terrainSize, 0.0f);
+// radius 1 with a box filter is the 3x3 neighbour average, averaging only the neighbours inside the map at the edges.
+void PerlinNoiseTexture::SmoothHeightMap(ID3D11Device* device, TextureManager* textureMgr, int radius, int passes, bool gaussian) {
+	SmoothHeightField(noiseData, gradientData, radius, passes, gaussian);
+	UpdateHeightField();
 
-	for (int j = 0; j < terrainSize; j++)
-	{
-		for (int i = 0; i < terrainSize; i++)
-		{
-			float sum = 0.0f;
-			int count = 0;
-
-			for (int y = -1; y <= 1; y++)
-			{
-				for (int x = -1; x <= 1; x++)
-				{
-					int neighborX = i + x;
-					int neighborY = j + y;
-
-					if (neighborX >= 0 && neighborX < terrainSize &&
-						neighborY >= 0 && neighborY < terrainSize)
-					{
-						int neighborIndex = (terrainSize * neighborY) + neighborX;
-						sum += noiseData[neighborIndex];
-						count++;
-					}
-				}
+	CreateTextureHM(device, textureMgr);
+}
+
+// Pointing the shared view at the live heights (swaps move them to another buffer) and marking them as changed
+// The terrain plane maps world x to u = x / size, so the centre of texel x (where its height is exact) is at world x + 0.5.
+// The pyramid is rebuilt on the calling thread: the thread pool may be held by a background regeneration.
+// The horizon map bake restarts, and completes when the height texture is created or over the next frames.
+void PerlinNoiseTexture::UpdateHeightField() {
+	heightField.heights = noiseData.data();
+	heightField.size = terrainSize;
+	heightField.spacing = 1.f;
+	heightField.originX = heightField.originZ = 0.5f;
+	heightField.version++;
+	heightPyramid.Refresh(heightField);
+	horizonMap.Begin(heightField, terrainWorldSize / terrainSize, terrainDisplacementScale);
+}
+
+// Smoothing the heights, then each gradient plane with the same filter
+void PerlinNoiseTexture::SmoothHeightField(std::vector<float>& heights, std::vector<float>& gradients, int radius, int passes, bool gaussian) {
+	const size_t plane = (size_t)terrainSize * terrainSize;
+	SmoothHeightData(heights.data(), radius, passes, gaussian);
+	SmoothHeightData(gradients.data(), radius, passes, gaussian);
+	SmoothHeightData(gradients.data() + plane, radius, passes, gaussian);
+}
+
+// Separable smoothing of the height values, all passes fused in one call
+// Each pass filters the rows into the scratch buffer, then the columns back into the height values.
+// The scratch buffers are shared, so only one smoothing runs at a time (render thread or regeneration worker).
+void PerlinNoiseTexture::SmoothHeightData(float* heights, int radius, int passes, bool gaussian) {
+	if (radius < 1 || passes < 1) return;
+	std::lock_guard<std::mutex> lock(smoothMutex);
+
+	const int size = terrainSize;
+	const int blocks = (size + smoothRowsPerBlock - 1) / smoothRowsPerBlock;
+	smoothScratch.resize((size_t)size * size);
+	smoothColumnSums.resize((size_t)blocks * size);
+
+	// Gaussian weights for offsets 0..radius (sigma = radius / 2), normalised per texel
+	std::vector<float> weights(radius + 1, 1.0f);
+	if (gaussian) {
+		float sigma = radius * 0.5f;
+		for (int k = 0; k <= radius; k++) {
+			weights[k] = expf(-(k * k) / (2.0f * sigma * sigma));
+		}
+	}
+
+	for (int pass = 0; pass < passes; pass++) {
+		// Horizontal pass, rows are independent
+		ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+			for (int y = firstRow; y < lastRow; y++) {
+				const float* src = &heights[(size_t)y * size];
+				float* dst = &smoothScratch[(size_t)y * size];
+				if (gaussian) SmoothRowGaussian(src, dst, size, radius, weights.data());
+				else SmoothRowBox(src, dst, size, radius);
 			}
+		};
+		if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+
+		// Vertical pass, SIMD across each row, blocks of rows are independent
+		ThreadPool::Task blocks = [&](int firstRow, int lastRow) {
+			float* sums = &smoothColumnSums[(size_t)(firstRow / smoothRowsPerBlock) * size];
+			if (gaussian) SmoothColumnsGaussian(smoothScratch.data(), heights, sums, size, radius, weights.data(), firstRow, lastRow);
+			else SmoothColumnsBox(smoothScratch.data(), heights, sums, size, radius, firstRow, lastRow);
+		};
+		if (!threadPool.TryParallelFor(size, smoothRowsPerBlock, blocks)) ThreadPool::SerialFor(size, smoothRowsPerBlock, blocks);
+	}
+}
+
+// Box filter of one row with a running sum, averaging only the texels inside the map
+void PerlinNoiseTexture::SmoothRowBox(const float* src, float* dst, int size, int radius) {
+	double sum = 0.0;
+	for (int x = 0; x <= radius && x < size; x++) {
+		sum += src[x];
+	}
+	for (int x = 0; x < size; x++) {
+		int first = x - radius < 0 ? 0 : x - radius;
+		int last = x + radius > size - 1 ? size - 1 : x + radius;
+		dst[x] = (float)(sum / (last - first + 1));
+
+		// Slide the window: add the texel entering on the right, remove the one leaving on the left
+		if (x + radius + 1 < size) sum += src[x + radius + 1];
+		if (x - radius >= 0) sum -= src[x - radius];
+	}
+}
 
-			int currentIndex = (terrainSize * j) + i;
-			smoothedHeights[currentIndex] = sum / count;
+// Gaussian filter of one row, normalised by the weights of the texels inside the map
+void PerlinNoiseTexture::SmoothRowGaussian(const float* src, float* dst, int size, int radius, const float* weights) {
+	for (int x = 0; x < size; x++) {
+		float sum = weights[0] * src[x];
+		float weightSum = weights[0];
+		for (int k = 1; k <= radius; k++) {
+			if (x - k >= 0) { sum += weights[k] * src[x - k]; weightSum += weights[k]; }
+			if (x + k < size) { sum += weights[k] * src[x + k]; weightSum += weights[k]; }
 		}
+		dst[x] = sum / weightSum;
 	}
+}
 
-	for (int j = 0; j < terrainSize; j++)
-	{
-		for (int i = 0; i < terrainSize; i++)
-		{
-			int index = (terrainSize * j) + i;
-			noiseData[index] = smoothedHeights[index];
+// Box filter of the columns of rows [firstRow, lastRow), with a running sum of whole rows (4 columns per SSE operation)
+// The sums are seeded directly at the first row of the block, so blocks are independent and rounding does not drift.
+void PerlinNoiseTexture::SmoothColumnsBox(const float* src, float* dst, float* sums, int size, int radius, int firstRow, int lastRow) {
+	for (int x = 0; x < size; x++) {
+		sums[x] = 0.0f;
+	}
+
+	int first = firstRow - radius < 0 ? 0 : firstRow - radius;
+	int last = firstRow + radius > size - 1 ? size - 1 : firstRow + radius;
+	for (int y = first; y <= last; y++) {
+		AddRow(sums, &src[(size_t)y * size], size, 1.0f);
+	}
+
+	for (int y = firstRow; y < lastRow; y++) {
+		first = y - radius < 0 ? 0 : y - radius;
+		last = y + radius > size - 1 ? size - 1 : y + radius;
+		ScaleRow(&dst[(size_t)y * size], sums, size, 1.0f / (last - first + 1));
+
+		// Slide the window: add the row entering below, remove the one leaving above
+		if (y + 1 < lastRow) {
+			if (y + radius + 1 < size) AddRow(sums, &src[(size_t)(y + radius + 1) * size], size, 1.0f);
+			if (y - radius >= 0) AddRow(sums, &src[(size_t)(y - radius) * size], size, -1.0f);
 		}
 	}
+}
 
-	CreateTextureHM(device, textureMgr);
+// Gaussian filter of the columns of rows [firstRow, lastRow), accumulating whole weighted rows (4 columns per SSE operation)
+void PerlinNoiseTexture::SmoothColumnsGaussian(const float* src, float* dst, float* sums, int size, int radius, const float* weights, int firstRow, int lastRow) {
+	for (int y = firstRow; y < lastRow; y++) {
+		float weightSum = weights[0];
+		for (int x = 0; x < size; x++) {
+			sums[x] = 0.0f;
+		}
+		AddRow(sums, &src[(size_t)y * size], size, weights[0]);
+		for (int k = 1; k <= radius; k++) {
+			if (y - k >= 0) { AddRow(sums, &src[(size_t)(y - k) * size], size, weights[k]); weightSum += weights[k]; }
+			if (y + k < size) { AddRow(sums, &src[(size_t)(y + k) * size], size, weights[k]); weightSum += weights[k]; }
+		}
+		ScaleRow(&dst[(size_t)y * size], sums, size, 1.0f / weightSum);
+	}
+}
+
+// sums[x] += weight * row[x]
+void PerlinNoiseTexture::AddRow(float* sums, const float* row, int size, float weight) {
+	const __m128 w = _mm_set1_ps(weight);
+	int x = 0;
+	for (; x + 4 <= size; x += 4) {
+		_mm_storeu_ps(sums + x, _mm_add_ps(_mm_loadu_ps(sums + x), _mm_mul_ps(w, _mm_loadu_ps(row + x))));
+	}
+	for (; x < size; x++) {
+		sums[x] += weight * row[x];
+	}
+}
+
+// dst[x] = sums[x] * scale
+void PerlinNoiseTexture::ScaleRow(float* dst, const float* sums, int size, float scale) {
+	const __m128 s = _mm_set1_ps(scale);
+	int x = 0;
+	for (; x + 4 <= size; x += 4) {
+		_mm_storeu_ps(dst + x, _mm_mul_ps(_mm_loadu_ps(sums + x), s));
+	}
+	for (; x < size; x++) {
+		dst[x] = sums[x] * scale;
+	}
 }
 
 // Generate Perlin noise texture height map (for terrain)
-void PerlinNoiseTexture::GeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq, float perlinAmp) {
+void PerlinNoiseTexture::GeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq, float perlinAmp, float persistence) {
+	auto startTime = std::chrono::high_resolution_clock::now();
+	savedOctavesHM = GenerateHeightDataCached(noiseData.data(), gradientData.data(), perlinFreq, perlinAmp, persistence);
+	generationTimeHM = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	lastHMLoaded = false;
+	UpdateHeightField();
+	
+	CreateTextureHM(device, textureMgr);
+}
+
+// Key of a smoothed height map: sizes, noise parameters, seed, shape, evaluation settings (they can change the last ULP)
+// and the smoothing applied after generation
+// The batch path is not part of it: the scalar, SSE4.1 and AVX2 kernels give the same bits.
+unsigned long long PerlinNoiseTexture::HeightMapKey(float perlinFreq, float perlinAmp, float persistence, int smoothRadius, int smoothPasses, bool gaussian) {
+	MapCache::Key key;
+	key.Add(mapCacheGenerator).Add('H').Add(terrainSize);
+	key.Add(perlinFreq).Add(perlinAmp).Add(persistence).Add(heightOctaves).Add(heightNoiseScale);
+	key.Add(GetSeed()).Add(GetHeightShape()).Add(GetBandLimited()).Add(GetBandLimitFade()).Add(GetSpecialisedFractal());
+	key.Add(smoothRadius).Add(smoothPasses).Add(gaussian);
+	return key.Get();
+}
+
+// Height map from the map cache, or generated and smoothed, then stored (the octave cache is only filled on a miss)
+void PerlinNoiseTexture::LoadOrGeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq, float perlinAmp, float persistence, int smoothRadius, int smoothPasses, bool gaussian) {
+	const unsigned long long key = HeightMapKey(perlinFreq, perlinAmp, persistence, smoothRadius, smoothPasses, gaussian);
+	if (mapCache.Load(key, { &noiseData, &gradientData })) {
+		generationTimeHM = mapCache.GetLastLoadTime();
+		savedOctavesHM = 0;
+		lastHMCached = false;
+		lastHMLoaded = true;
+		UpdateHeightField();
+		CreateTextureHM(device, textureMgr);
+		return;
+	}
+
+	GeneratePerlinNoiseTextureHM(device, textureMgr, perlinFreq, perlinAmp, persistence);
+	SmoothHeightMap(device, textureMgr, smoothRadius, smoothPasses, gaussian);
+	mapCache.Store(key, { &noiseData, &gradientData });
+}
+
+// Octaves to evaluate for samples spaced by spacing
+SimplexNoise::BandLimit PerlinNoiseTexture::OctaveLimit(const SimplexNoise& noise, int octaves, float spacing) {
+	if (bandLimited) return noise.bandLimit(octaves, spacing, bandLimitFade);
+	SimplexNoise::BandLimit all = { (size_t)octaves, 1.f };
+	return all;
+}
+
+// Generate the height values of a size x size map, in parallel over blocks of rows
+// Each row only depends on its own index, so the output is the same for any number of threads.
+// With gradients, each row is evaluated once with the analytic derivatives (same heights, same kernels).
+unsigned long long PerlinNoiseTexture::GenerateHeightData(float* heights, float* gradients, int size, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel) {
 	if (perlinFreq == 0) perlinFreq = 0.001;
 	if (perlinAmp == 0) perlinAmp = 0.001;
-	float perlinScale = 0.01f;
-	SimplexNoise noise = SimplexNoise(perlinFreq);
-	for (int y = 0; y < terrainSize; y++) {
-		for (int x = 0; x < terrainSize; x++) {
-			float height = perlinAmp * noise.fractal(15, x * perlinScale, y * perlinScale);  // .fractal is in [-1, 1]
-			noiseData[(y * terrainSize) + x] = height;
+	if (heightShape != (int)NoiseGraph::Shape::Fbm) {
+		GenerateHeightDataGraph(heights, gradients, size, perlinFreq, perlinAmp, persistence, cancel);
+		return 0;
+	}
+	SimplexNoise noise = SimplexNoise(perlinFreq, 1.0f, 2.0f, persistence, worldSeed);
+	const SimplexNoise::BandLimit limit = OctaveLimit(noise, heightOctaves, heightNoiseScale);
+	const bool allOctaves = limit.evaluated == heightOctaves && limit.lastWeight == 1.f;
+	const bool specialised = allOctaves && specialisedFractal && persistence == Fractal<heightOctaves, 2>::persistence;
+	const size_t plane = (size_t)size * size;
+	const float gradientScale = perlinAmp * heightNoiseScale;  // noise coordinates to texels, and fBm to height
+	ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+		if (cancel && *cancel) return;
+		for (int y = firstRow; y < lastRow; y++) {
+			// Evaluate the whole row at once with the batch (SIMD) fBm, then scale it to the terrain height
+			float* row = &heights[(size_t)y * size];
+			if (gradients) {
+				float* rowDx = &gradients[(size_t)y * size];
+				float* rowDy = &gradients[plane + (size_t)y * size];
+				if (specialised) Fractal<heightOctaves, 2>::rowDeriv(noise, 0.f, heightNoiseScale, y * heightNoiseScale, row, rowDx, rowDy, size);
+				else noise.fractalRowDeriv(heightOctaves, limit, 0.f, heightNoiseScale, y * heightNoiseScale, row, rowDx, rowDy, size);
+				for (int x = 0; x < size; x++) {
+					rowDx[x] = gradientScale * rowDx[x];
+					rowDy[x] = gradientScale * rowDy[x];
+				}
+			}
+			else if (specialised) Fractal<heightOctaves, 2>::row(noise, 0.f, heightNoiseScale, y * heightNoiseScale, row, size);
+			else noise.fractalRow(heightOctaves, limit, 0.f, heightNoiseScale, y * heightNoiseScale, row, size);  // .fractal is in [-1, 1]
+			for (int x = 0; x < size; x++) {
+				row[x] = perlinAmp * row[x];
+			}
+		}
+	};
+	if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+	return (unsigned long long)(heightOctaves - limit.evaluated) * size * size;
+}
+
+// Generate the height values through the noise graph of the height shape, in parallel over blocks of rows
+// The gradients are central differences of the heights (one-sided on the edges), in height units per texel.
+void PerlinNoiseTexture::GenerateHeightDataGraph(float* heights, float* gradients, int size, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel) {
+	const NoiseGraph graph = NoiseGraph::Preset(GetHeightShape(), perlinFreq, heightOctaves, persistence, false, worldSeed);
+	ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+		if (cancel && *cancel) return;
+		graph.EvaluateRows(0.f, heightNoiseScale, 0.f, heightNoiseScale, 0.f, &heights[(size_t)firstRow * size], size, firstRow, lastRow);
+		for (size_t i = (size_t)firstRow * size; i < (size_t)lastRow * size; i++) {
+			heights[i] = perlinAmp * heights[i];
+		}
+	};
+	if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+	if (!gradients || size < 2 || (cancel && *cancel)) return;
+	ComputeGradients(heights, gradients, size);
+}
+
+// Central differences of the heights, in parallel over blocks of rows
+void PerlinNoiseTexture::ComputeGradients(const float* heights, float* gradients, int size) {
+	const size_t plane = (size_t)size * size;
+	ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+		for (int y = firstRow; y < lastRow; y++) {
+			const int up = (y > 0) ? y - 1 : 0, down = (y < size - 1) ? y + 1 : size - 1;
+			for (int x = 0; x < size; x++) {
+				const int left = (x > 0) ? x - 1 : 0, right = (x < size - 1) ? x + 1 : size - 1;
+				gradients[(size_t)y * size + x] = (heights[(size_t)y * size + right] - heights[(size_t)y * size + left]) / (right - left);
+				gradients[plane + (size_t)y * size + x] = (heights[(size_t)down * size + x] - heights[(size_t)up * size + x]) / (down - up);
+			}
 		}
+	};
+	if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+}
+
+// Generate the height values through the octave cache
+// The layers are only evaluated when the frequency changes, otherwise the octaves are just re-weighted (SIMD),
+// which gives the same values as GenerateHeightData.
+// Only the octaves kept by band-limiting are cached.
+// The value layers are followed by the derivative layers along x then y (already multiplied by the octave frequency).
+unsigned long long PerlinNoiseTexture::GenerateHeightDataCached(float* heights, float* gradients, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel) {
+	const int size = terrainSize;
+	const size_t layerSize = (size_t)size * size;
+	const size_t fieldSize = layerSize * heightOctaves;
+	if (3 * fieldSize * sizeof(float) > octaveCacheMaxBytes || heightShape != (int)NoiseGraph::Shape::Fbm) {
+		lastHMCached = false;
+		return GenerateHeightData(heights, gradients, size, perlinFreq, perlinAmp, persistence, cancel);
 	}
-	
-	CreateTextureHM(device, textureMgr);
+
+	if (perlinFreq == 0) perlinFreq = 0.001;
+	if (perlinAmp == 0) perlinAmp = 0.001;
+	std::lock_guard<std::mutex> lock(octaveCacheMutex);
+
+	// Evaluating the kept octaves of every row into the layers (only when the frequency changed or more octaves are needed)
+	const uint32_t seed = worldSeed;
+	SimplexNoise noise = SimplexNoise(perlinFreq, 1.0f, 2.0f, persistence, seed);
+	const SimplexNoise::BandLimit limit = OctaveLimit(noise, heightOctaves, heightNoiseScale);
+	bool cached = octaveCacheValid && octaveCacheFreq == perlinFreq && octaveCacheSeed == seed && octaveCacheLayers >= limit.evaluated;
+	if (!cached) {
+		octaveCacheValid = false;
+		octaveCache.resize(3 * fieldSize);
+		ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+			if (cancel && *cancel) return;
+			for (int y = firstRow; y < lastRow; y++) {
+				const size_t row = (size_t)y * size;
+				noise.octaveRowsDeriv(limit.evaluated, 0.f, heightNoiseScale, y * heightNoiseScale,
+					&octaveCache[row], &octaveCache[fieldSize + row], &octaveCache[2 * fieldSize + row], layerSize, size);
+			}
+		};
+		if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+		if (cancel && *cancel) return 0;
+		octaveCacheFreq = perlinFreq;
+		octaveCacheSeed = seed;
+		octaveCacheLayers = limit.evaluated;
+		octaveCacheValid = true;
+	}
+
+	// Weighted recombination of the octaves (values and derivatives), then scaling to the terrain height
+	const float gradientScale = perlinAmp * heightNoiseScale;
+	ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+		if (cancel && *cancel) return;
+		for (int y = firstRow; y < lastRow; y++) {
+			const size_t offset = (size_t)y * size;
+			float* row = &heights[offset];
+			noise.fractalFromOctaves(heightOctaves, limit, &octaveCache[offset], layerSize, row, size);
+			for (int x = 0; x < size; x++) {
+				row[x] = perlinAmp * row[x];
+			}
+			for (int axis = 0; axis < 2; axis++) {
+				float* rowGradient = &gradients[axis * layerSize + offset];
+				noise.fractalFromOctaves(heightOctaves, limit, &octaveCache[(axis + 1) * fieldSize + offset], layerSize, rowGradient, size);
+				for (int x = 0; x < size; x++) {
+					rowGradient[x] = gradientScale * rowGradient[x];
+				}
+			}
+		}
+	};
+	if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+	lastHMCached = cached;
+	return (unsigned long long)(heightOctaves - limit.evaluated) * layerSize;
+}
+
+// Generate the heights of a size x size map into a new array (no gradients, smoothing or textures)
+std::vector<float> PerlinNoiseTexture::GenerateHeights(int size, float perlinFreq, float perlinAmp, float persistence) {
+	std::vector<float> heights((size_t)size * size);
+	GenerateHeightData(heights.data(), nullptr, size, perlinFreq, perlinAmp, persistence);
+	return heights;
+}
+
+// Time the generation of a size x size height map with its gradients (without creating a texture), in ms
+// This is the full evaluation the map takes on an octave cache miss, and that the terrain chunks take.
+float PerlinNoiseTexture::BenchmarkHeightMap(int size, float perlinFreq, float perlinAmp, float persistence) {
+	std::vector<float> heights((size_t)size * size), gradients(2 * (size_t)size * size);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	GenerateHeightData(heights.data(), gradients.data(), size, perlinFreq, perlinAmp, persistence);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Timing a smoothing of the current height values, which are restored afterwards
+float PerlinNoiseTexture::BenchmarkSmoothing(int radius, int passes, bool gaussian) {
+	std::vector<float> heights = noiseData;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	SmoothHeightData(heights.data(), radius, passes, gaussian);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// FNV-1a hash of the height values, to check the output does not depend on the thread count
+unsigned long long PerlinNoiseTexture::HashHeightData() {
+	unsigned long long hash = 14695981039346656037ull;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(noiseData.data());
+	for (size_t i = 0; i < noiseData.size() * sizeof(float); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
 }
 
 // Creating a 2D texture using the noise data from generate method
@@ -96,47 +488,418 @@ void PerlinNoiseTexture::CreateTextureHM(ID3D11Device* device, TextureManager* t
 	desc.Width = terrainSize;
 	desc.Height = terrainSize;
 	desc.MipLevels = desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R32_FLOAT;
+	desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	desc.SampleDesc.Count = 1;
 	desc.Usage = D3D11_USAGE_DYNAMIC;
 	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	desc.MiscFlags = 0;
 
+	// Releasing the previous texture (the texture manager only keeps the pointer, it is replaced below)
+	if (noiseTextureSRV) noiseTextureSRV->Release();
+	if (noiseTexture) noiseTexture->Release();
+
+	// Packing the heights with their gradients (.r stays the height for the shaders only displacing)
+	std::vector<float> texels((size_t)terrainSize * terrainSize * 4);
+	for (int y = 0; y < terrainSize; y++) {
+		PackHeightRow(y, &texels[(size_t)y * terrainSize * 4]);
+	}
+
 	D3D11_SUBRESOURCE_DATA texData{};
-	texData.pSysMem = noiseData.data();
-	texData.SysMemPitch = terrainSize * sizeof(float);
+	texData.pSysMem = texels.data();
+	texData.SysMemPitch = terrainSize * 4 * sizeof(float);
 	HRESULT hr = device->CreateTexture2D(&desc, &texData, &noiseTexture);
 
 	//Creating shader resource view
 	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
-	SRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	SRVDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	SRVDesc.Texture2D.MipLevels = 1;
 	hr = device->CreateShaderResourceView(noiseTexture, &SRVDesc, &noiseTextureSRV);
 	textureMgr->addTexture(L"perlinNoiseHeightMap", noiseTextureSRV);
+
+	// Baking the normal map from the gradients, in the same texel grid
+	BakeNormalData(gradientData.data(), normalData.data(), terrainSize);
+	if (normalTextureSRV) normalTextureSRV->Release();
+	if (normalTexture) normalTexture->Release();
+	desc.Format = DXGI_FORMAT_R8G8B8A8_SNORM;
+	texData.pSysMem = normalData.data();
+	texData.SysMemPitch = terrainSize * sizeof(uint32_t);
+	hr = device->CreateTexture2D(&desc, &texData, &normalTexture);
+	SRVDesc.Format = DXGI_FORMAT_R8G8B8A8_SNORM;
+	hr = device->CreateShaderResourceView(normalTexture, &SRVDesc, &normalTextureSRV);
+	textureMgr->addTexture(L"perlinNoiseNormalMap", normalTextureSRV);
+
+	// Finishing the horizon bake of these heights
+	horizonMap.Bake(&threadPool, -1.f);
+	CreateTextureHorizon(device, textureMgr);
+}
+
+// Creating the horizon map texture array (dynamic, updated when a bake completes)
+void PerlinNoiseTexture::CreateTextureHorizon(ID3D11Device* device, TextureManager* textureMgr) {
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Width = terrainSize;
+	desc.Height = terrainSize;
+	desc.MipLevels = 1;
+	desc.ArraySize = HorizonMap::sliceCount;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+
+	if (horizonTextureSRV) horizonTextureSRV->Release();
+	if (horizonTexture) horizonTexture->Release();
+
+	const size_t slicePitch = (size_t)terrainSize * terrainSize * 4;
+	D3D11_SUBRESOURCE_DATA sliceData[HorizonMap::sliceCount]{};
+	for (int s = 0; s < HorizonMap::sliceCount; s++) {
+		sliceData[s].pSysMem = horizonMap.GetTexels().data() + s * slicePitch;
+		sliceData[s].SysMemPitch = terrainSize * 4;
+	}
+	HRESULT hr = device->CreateTexture2D(&desc, sliceData, &horizonTexture);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	SRVDesc.Texture2DArray.MipLevels = 1;
+	SRVDesc.Texture2DArray.ArraySize = HorizonMap::sliceCount;
+	hr = device->CreateShaderResourceView(horizonTexture, &SRVDesc, &horizonTextureSRV);
+	textureMgr->addTexture(L"perlinNoiseHorizonMap", horizonTextureSRV);
+}
+
+// Uploading the last completed horizon bake into the existing horizon texture array
+void PerlinNoiseTexture::UploadTextureHorizon(ID3D11DeviceContext* deviceContext) {
+	const size_t slicePitch = (size_t)terrainSize * terrainSize * 4;
+	for (int s = 0; s < HorizonMap::sliceCount; s++) {
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		const UINT subresource = D3D11CalcSubresource(0, s, 1);
+		if (FAILED(deviceContext->Map(horizonTexture, subresource, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+		for (int y = 0; y < terrainSize; y++) {
+			memcpy((char*)mapped.pData + (size_t)y * mapped.RowPitch, horizonMap.GetTexels().data() + s * slicePitch + (size_t)y * terrainSize * 4, terrainSize * 4);
+		}
+		deviceContext->Unmap(horizonTexture, subresource);
+	}
+}
+
+// Starting an erosion run over the live heights, in the world units of the rendered terrain
+void PerlinNoiseTexture::StartErosion(const Erosion::Settings& settings) {
+	erosion.Begin(heightField, terrainWorldSize / terrainSize, terrainDisplacementScale, settings, worldSeed);
+	erosionPublishTime = std::chrono::high_resolution_clock::now();
+}
+
+// Continuing the erosion within the frame's budget, publishing its heights now and then (the pool is only used when no
+// regeneration holds it)
+bool PerlinNoiseTexture::UpdateErosion(ID3D11DeviceContext* deviceContext, float budgetMs) {
+	if (!erosion.IsRunning()) return false;
+	const bool completed = erosion.Run(&threadPool, budgetMs);
+	auto now = std::chrono::high_resolution_clock::now();
+	if (!completed && std::chrono::duration<float, std::milli>(now - erosionPublishTime).count() < erosionPublishMs) return false;
+	erosionPublishTime = now;
+	PublishErosion(deviceContext);
+	return true;
+}
+
+// Stopping the erosion after publishing what it has done
+void PerlinNoiseTexture::StopErosion(ID3D11DeviceContext* deviceContext) {
+	if (!erosion.IsRunning()) return;
+	PublishErosion(deviceContext);
+	erosion.Cancel();
+}
+
+// Replacing the live heights with the eroded heights (the gradients are central differences, as for the noise graph shapes)
+void PerlinNoiseTexture::PublishErosion(ID3D11DeviceContext* deviceContext) {
+	erosion.GetHeights(noiseData.data());
+	ComputeGradients(noiseData.data(), gradientData.data(), terrainSize);
+	BakeNormalData(gradientData.data(), normalData.data(), terrainSize);
+	lastHMLoaded = false;
+	UpdateHeightField();
+	UploadTextureHM(deviceContext);
+}
+
+// Continuing the horizon bake within the frame's budget (the pool is only used when no regeneration holds it)
+bool PerlinNoiseTexture::UpdateHorizonMap(ID3D11DeviceContext* deviceContext, float budgetMs) {
+	if (!horizonMap.Bake(&threadPool, budgetMs)) return false;
+	UploadTextureHorizon(deviceContext);
+	return true;
+}
+
+// Baking the normal map rows of a size x size map in parallel (gradients are per texel of a map covering terrainWorldSize)
+// Also used on the render thread, so the rows are baked on the calling thread when the pool is busy.
+void PerlinNoiseTexture::BakeNormalData(const float* gradients, uint32_t* normals, int size) {
+	const size_t plane = (size_t)size * size;
+	const float scale = terrainHeightScale * size / terrainWorldSize;
+	ThreadPool::Task rows = [&](int firstRow, int lastRow) {
+		for (int y = firstRow; y < lastRow; y++) {
+			const size_t row = (size_t)y * size;
+			BakeNormalRow(gradients + row, gradients + plane + row, normals + row, size, scale);
+		}
+	};
+	if (!threadPool.TryParallelFor(size, rowsPerTile, rows)) rows(0, size);
+}
+
+// Rounding a component in [-1, 1] times 127 to its 8-bit signed normalised byte
+// (lrintf rounds to nearest even like _mm_cvtps_epi32 in the default rounding mode, so both paths give the same bytes)
+static uint32_t NormalByte(float scaled) {
+	return (uint32_t)(uint8_t)(int8_t)lrintf(scaled);
+}
+
+// Baking normal map texels, 4 at a time
+// The normal of y = h(x, z) is (-dh/dx, 1, -dh/dz) normalised and the slope is 1 - its y, each scaled by 127 and rounded.
+void PerlinNoiseTexture::BakeNormalRow(const float* gradientsX, const float* gradientsY, uint32_t* normals, int count, float scale) {
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 full = _mm_set1_ps(127.f);
+	int x = 0;
+	for (; x + 4 <= count; x += 4) {
+		const __m128 slopeX = _mm_mul_ps(_mm_loadu_ps(gradientsX + x), s);
+		const __m128 slopeZ = _mm_mul_ps(_mm_loadu_ps(gradientsY + x), s);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(slopeX, slopeX), one), _mm_mul_ps(slopeZ, slopeZ)));
+		const __m128 ny = _mm_div_ps(full, length);
+		const __m128i ix = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), slopeX), ny));
+		const __m128i iy = _mm_cvtps_epi32(ny);
+		const __m128i iz = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), slopeZ), ny));
+		const __m128i is = _mm_cvtps_epi32(_mm_sub_ps(full, ny));
+
+		// Interleaving the four components per texel, then narrowing to bytes (x, y, z, slope per texel)
+		const __m128i xy0 = _mm_unpacklo_epi32(ix, iy), xy1 = _mm_unpackhi_epi32(ix, iy);
+		const __m128i zs0 = _mm_unpacklo_epi32(iz, is), zs1 = _mm_unpackhi_epi32(iz, is);
+		const __m128i texels01 = _mm_packs_epi32(_mm_unpacklo_epi64(xy0, zs0), _mm_unpackhi_epi64(xy0, zs0));
+		const __m128i texels23 = _mm_packs_epi32(_mm_unpacklo_epi64(xy1, zs1), _mm_unpackhi_epi64(xy1, zs1));
+		_mm_storeu_si128((__m128i*)(normals + x), _mm_packs_epi16(texels01, texels23));
+	}
+	for (; x < count; x++) {
+		const float slopeX = gradientsX[x] * scale, slopeZ = gradientsY[x] * scale;
+		const float ny = 127.f / sqrtf(slopeX * slopeX + 1.f + slopeZ * slopeZ);
+		normals[x] = NormalByte((0.f - slopeX) * ny) | (NormalByte(ny) << 8) | (NormalByte((0.f - slopeZ) * ny) << 16) | (NormalByte(127.f - ny) << 24);
+	}
+}
+
+// Unpacking a normal map texel the way the GPU reads 8-bit signed normalised values
+void PerlinNoiseTexture::DecodeNormal(uint32_t texel, float& nx, float& ny, float& nz, float& slope) {
+	nx = std::max((int8_t)(texel & 0xff) / 127.f, -1.f);
+	ny = std::max((int8_t)((texel >> 8) & 0xff) / 127.f, -1.f);
+	nz = std::max((int8_t)((texel >> 16) & 0xff) / 127.f, -1.f);
+	slope = std::max((int8_t)(texel >> 24) / 127.f, -1.f);
+}
+
+// Small vector maths for the port of the old five-tap shader normal
+struct NormalVector {
+	float x, y, z;
+};
+
+static NormalVector Normalise(const NormalVector& v) {
+	float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+	return { v.x / length, v.y / length, v.z / length };
+}
+
+static NormalVector Cross(const NormalVector& a, const NormalVector& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+// Angle between two vectors (in degrees)
+static float AngleBetween(const NormalVector& a, const NormalVector& b) {
+	float cosine = (a.x * b.x + a.y * b.y + a.z * b.z) / sqrtf((a.x * a.x + a.y * a.y + a.z * a.z) * (b.x * b.x + b.y * b.y + b.z * b.z));
+	return acosf(std::min(std::max(cosine, -1.f), 1.f)) * 57.2957795f;
+}
+
+// Baking the normal map of the live heights again, then comparing each baked normal with the normal the shader used to
+// compute at its texel: from the gradients (light_ps CalcNormal), and from five height taps (its previous version,
+// compared away from the edges, where the taps would leave the map)
+PerlinNoiseTexture::NormalMapCheck PerlinNoiseTexture::CheckNormalMap() {
+	NormalMapCheck result = {};
+	std::vector<uint32_t> normals(normalData.size());
+	auto startTime = std::chrono::high_resolution_clock::now();
+	BakeNormalData(gradientData.data(), normals.data(), terrainSize);
+	result.bakeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	const size_t plane = (size_t)terrainSize * terrainSize;
+	const float worldStep = terrainWorldSize / terrainSize;
+	auto height = [&](int x, int y) { return heightField.at(x, y) * terrainHeightScale; };
+	for (int y = 0; y < terrainSize; y++) {
+		for (int x = 0; x < terrainSize; x++) {
+			const size_t i = (size_t)y * terrainSize + x;
+			NormalVector baked;
+			float slope;
+			DecodeNormal(normals[i], baked.x, baked.y, baked.z, slope);
+
+			// Normal from the gradients
+			NormalVector gradient = { -gradientData[i] * terrainHeightScale / worldStep, 1.f, -gradientData[plane + i] * terrainHeightScale / worldStep };
+			result.maxErrorGradient = std::max(result.maxErrorGradient, AngleBetween(baked, gradient));
+
+			// Average of the four normals around the texel from its neighbours' heights
+			if (x == 0 || y == 0 || x == terrainSize - 1 || y == terrainSize - 1) continue;
+			const float h = height(x, y);
+			const NormalVector tan1 = Normalise({ worldStep, height(x + 1, y) - h, 0.f });
+			const NormalVector tan2 = Normalise({ -worldStep, height(x - 1, y) - h, 0.f });
+			const NormalVector bitan1 = Normalise({ 0.f, height(x, y + 1) - h, worldStep });
+			const NormalVector bitan2 = Normalise({ 0.f, height(x, y - 1) - h, -worldStep });
+			const NormalVector normal1 = Normalise(Cross(tan1, bitan2)), normal2 = Normalise(Cross(bitan2, tan2));
+			const NormalVector normal3 = Normalise(Cross(tan2, bitan1)), normal4 = Normalise(Cross(bitan1, tan1));
+			const NormalVector fiveTap = { normal1.x + normal2.x + normal3.x + normal4.x, normal1.y + normal2.y + normal3.y + normal4.y, normal1.z + normal2.z + normal3.z + normal4.z };
+			result.maxErrorFiniteDifference = std::max(result.maxErrorFiniteDifference, AngleBetween(baked, fiveTap));
+		}
+	}
+	return result;
 }
 
 // Generate Perlin noise texture density map (for cloud box)
 void PerlinNoiseTexture::GeneratePerlinNoiseTextureDM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq) {
-	float perlinScale = 0.5f;
-	SimplexNoise noise = SimplexNoise(perlinFreq);
-	for (int z = 0; z < volumeSizeZ; z++) {
-		for (int y = 0; y < volumeSizeY; y++) {
-			for (int x = 0; x < volumeSizeX; x++) {
-				float val = noise.fractal(10, x * perlinScale, y * perlinScale, z * perlinScale);
-				//val = (val * 0.5f) + 0.5f;
-				//val *= 5;
-				densityData[(z * volumeSizeZ * volumeSizeY) + (y * volumeSizeX) + x] = val;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	savedOctavesDM = GenerateDensityData(densityData.data(), volumeSizeX, volumeSizeY, volumeSizeZ, perlinFreq);
+	generationTimeDM = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	lastDMLoaded = false;
+
+	CreateTextureDM(device, textureMgr);
+}
+
+// Key of a density map: sizes, noise parameters, seed, shape and evaluation settings
+unsigned long long PerlinNoiseTexture::DensityMapKey(float perlinFreq) {
+	MapCache::Key key;
+	key.Add(mapCacheGenerator).Add('D').Add(volumeSizeX).Add(volumeSizeY).Add(volumeSizeZ);
+	key.Add(perlinFreq).Add(densityOctaves).Add(densityNoiseScale);
+	key.Add(GetSeed()).Add(GetDensityShape()).Add(GetBandLimited()).Add(GetBandLimitFade()).Add(GetSpecialisedFractal());
+	return key.Get();
+}
+
+// Density map from the map cache, or generated, then stored
+void PerlinNoiseTexture::LoadOrGeneratePerlinNoiseTextureDM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq) {
+	const unsigned long long key = DensityMapKey(perlinFreq);
+	if (mapCache.Load(key, { &densityData })) {
+		generationTimeDM = mapCache.GetLastLoadTime();
+		savedOctavesDM = 0;
+		lastDMLoaded = true;
+		CreateTextureDM(device, textureMgr);
+		return;
+	}
+
+	GeneratePerlinNoiseTextureDM(device, textureMgr, perlinFreq);
+	mapCache.Store(key, { &densityData });
+}
+
+// Generate the density values of a sizeX x sizeY x sizeZ volume, in parallel over Z slabs
+// Each X row only depends on its own (y, z), so the output is the same for any number of threads.
+unsigned long long PerlinNoiseTexture::GenerateDensityData(float* density, int sizeX, int sizeY, int sizeZ, float perlinFreq, const std::atomic<bool>* cancel) {
+	if (densityShape != (int)NoiseGraph::Shape::Fbm) {
+		// Shaped density: the noise graph evaluates all the Y rows of a Z slice at once
+		const NoiseGraph graph = NoiseGraph::Preset(GetDensityShape(), perlinFreq, densityOctaves, 0.5f, true, worldSeed);
+		ThreadPool::Task slices = [&](int firstSlice, int lastSlice) {
+			if (cancel && *cancel) return;
+			for (int z = firstSlice; z < lastSlice; z++) {
+				graph.EvaluateRows(0.f, densityNoiseScale, 0.f, densityNoiseScale, z * densityNoiseScale, &density[VolumeIndex(0, 0, z, sizeX, sizeY)], sizeX, 0, sizeY);
 			}
-		}
+		};
+		if (!threadPool.TryParallelFor(sizeZ, slicesPerSlab, slices)) slices(0, sizeZ);
+		return 0;
 	}
 
-	CreateTextureDM(device, textureMgr);
+	SimplexNoise noise = SimplexNoise(perlinFreq, 1.0f, 2.0f, 0.5f, worldSeed);
+	const SimplexNoise::BandLimit limit = OctaveLimit(noise, densityOctaves, densityNoiseScale);
+	const bool specialised = specialisedFractal && limit.evaluated == densityOctaves && limit.lastWeight == 1.f;
+	ThreadPool::Task slices = [&](int firstSlice, int lastSlice) {
+		if (cancel && *cancel) return;
+		for (int z = firstSlice; z < lastSlice; z++) {
+			for (int y = 0; y < sizeY; y++) {
+				// Evaluate the whole X row at once with the batch (SIMD) fBm
+				float* row = &density[VolumeIndex(0, y, z, sizeX, sizeY)];
+				if (specialised) Fractal<densityOctaves, 3>::row(noise, 0.f, densityNoiseScale, y * densityNoiseScale, z * densityNoiseScale, row, sizeX);
+				else noise.fractalRow(densityOctaves, limit, 0.f, densityNoiseScale, y * densityNoiseScale, z * densityNoiseScale, row, sizeX);
+			}
+		}
+	};
+	if (!threadPool.TryParallelFor(sizeZ, slicesPerSlab, slices)) slices(0, sizeZ);
+	return (unsigned long long)(densityOctaves - limit.evaluated) * sizeX * sizeY * sizeZ;
+}
+
+// Time the generation of a size^3 density volume (without creating a texture), in ms
+float PerlinNoiseTexture::BenchmarkDensityMap(int size, float perlinFreq) {
+	std::vector<float> density((size_t)size * size * size);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	GenerateDensityData(density.data(), size, size, size, perlinFreq);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Generate a density volume (without creating a texture)
+std::vector<float> PerlinNoiseTexture::GenerateDensity(int sizeX, int sizeY, int sizeZ, float perlinFreq) {
+	std::vector<float> density((size_t)sizeX * sizeY * sizeZ);
+	GenerateDensityData(density.data(), sizeX, sizeY, sizeZ, perlinFreq);
+	return density;
+}
+
+// Generate the looping animated density ring (for the cloud box)
+void PerlinNoiseTexture::GeneratePerlinNoiseTextureDMRing(ID3D11Device* device, float perlinFreq) {
+	densityRing.resize((size_t)densityRingSlices * densityData.size());
+	auto startTime = std::chrono::high_resolution_clock::now();
+	savedOctavesRing = GenerateDensityRing(densityRing.data(), volumeSizeX, volumeSizeY, volumeSizeZ, perlinFreq);
+	generationTimeRing = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / densityRingSlices;
+
+	CreateTexturesDMRing(device);
+}
+
+// Generate the time slices of the density ring, in parallel over Z slabs of every slice
+// Slice s is the 4D fBm at w = t * densityLoopLength crossfaded with w - densityLoopLength (t = s / densityRingSlices),
+// so slice densityRingSlices would be slice 0 again. The blend is rescaled to keep the variance of a single fBm.
+unsigned long long PerlinNoiseTexture::GenerateDensityRing(float* ring, int sizeX, int sizeY, int sizeZ, float perlinFreq, const std::atomic<bool>* cancel) {
+	SimplexNoise noise = SimplexNoise(perlinFreq, 1.0f, 2.0f, 0.5f, worldSeed);
+	const SimplexNoise::BandLimit limit = OctaveLimit(noise, densityOctaves, densityNoiseScale);
+	const size_t volumeSize = (size_t)sizeX * sizeY * sizeZ;
+	ThreadPool::Task slabs = [&](int firstSlab, int lastSlab) {
+		if (cancel && *cancel) return;
+		std::vector<float> previousLoop(sizeX);
+		for (int slab = firstSlab; slab < lastSlab; slab++) {
+			const int s = slab / sizeZ, z = slab % sizeZ;
+			const float t = (float)s / densityRingSlices;
+			const float w = t * densityLoopLength;
+			const float scale = 1.f / std::sqrt((1.f - t) * (1.f - t) + t * t);
+			for (int y = 0; y < sizeY; y++) {
+				float* row = &ring[s * volumeSize + VolumeIndex(0, y, z, sizeX, sizeY)];
+				noise.fractalRow(densityOctaves, limit, 0.f, densityNoiseScale, y * densityNoiseScale, z * densityNoiseScale, w, row, sizeX);
+				if (s == 0) continue;  // t = 0: the previous loop has no weight
+				noise.fractalRow(densityOctaves, limit, 0.f, densityNoiseScale, y * densityNoiseScale, z * densityNoiseScale, w - densityLoopLength, previousLoop.data(), sizeX);
+				for (int x = 0; x < sizeX; x++) {
+					row[x] = ((1.f - t) * row[x] + t * previousLoop[x]) * scale;
+				}
+			}
+		}
+	};
+	if (!threadPool.TryParallelFor(densityRingSlices * sizeZ, slicesPerSlab, slabs)) slabs(0, densityRingSlices * sizeZ);
+	return (unsigned long long)(densityOctaves - limit.evaluated) * (2 * densityRingSlices - 1) * volumeSize;
+}
+
+// Time the generation of a density ring of size^3 volumes (without creating the textures), in ms per time slice
+float PerlinNoiseTexture::BenchmarkDensityRing(int size, float perlinFreq) {
+	std::vector<float> ring((size_t)densityRingSlices * size * size * size);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	GenerateDensityRing(ring.data(), size, size, size, perlinFreq);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / densityRingSlices;
+}
+
+// Getting the two ring slices around a point of the loop, and how far the point is from the first one
+void PerlinNoiseTexture::GetDensityRingFrame(float loopPosition, ID3D11ShaderResourceView*& current, ID3D11ShaderResourceView*& next, float& blend) {
+	float position = (loopPosition - std::floor(loopPosition)) * densityRingSlices;
+	int slice = (int)position;
+	if (slice >= densityRingSlices) slice = densityRingSlices - 1;  // rounding of the fractional part
+	current = densityRingSRVs[slice];
+	next = densityRingSRVs[(slice + 1) % densityRingSlices];
+	blend = position - slice;
 }
 
 // Creating a 3D texture using the density data from generate method
 void PerlinNoiseTexture::CreateTextureDM(ID3D11Device* device, TextureManager* textureMgr) {
+	CreateVolumeTexture(device, densityData.data(), densityTexture, densityTextureSRV);
+	textureMgr->addTexture(L"densityVolumeTexture", densityTextureSRV);
+}
+
+// Creating the 3D textures of the density ring slices
+void PerlinNoiseTexture::CreateTexturesDMRing(ID3D11Device* device) {
+	for (int s = 0; s < densityRingSlices; s++) {
+		CreateVolumeTexture(device, &densityRing[s * densityData.size()], densityRingTextures[s], densityRingSRVs[s]);
+	}
+}
+
+// Creating a dynamic 3D texture (and SRV) of volumeSizeX x volumeSizeY x volumeSizeZ values, releasing the previous ones
+void PerlinNoiseTexture::CreateVolumeTexture(ID3D11Device* device, const float* volume, ID3D11Texture3D*& texture, ID3D11ShaderResourceView*& srv) {
 	//Creating texture
 	D3D11_TEXTURE3D_DESC texDesc{};
 	texDesc.Width = volumeSizeX;
@@ -150,18 +913,297 @@ void PerlinNoiseTexture::CreateTextureDM(ID3D11Device* device, TextureManager* t
 	texDesc.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = densityData.data();
-	initData.SysMemPitch = volumeSizeX * sizeof(float);           // bytes per row (X)
-	initData.SysMemSlicePitch = volumeSizeX * volumeSizeY * sizeof(float); // bytes per slice (Z)
-	densityTexture = nullptr;
-	HRESULT hr = device->CreateTexture3D(&texDesc, &initData, &densityTexture);
+	initData.pSysMem = volume;
+	initData.SysMemPitch = VolumeRowPitch(volumeSizeX);                      // bytes per row (X)
+	initData.SysMemSlicePitch = VolumeSlicePitch(volumeSizeX, volumeSizeY);  // bytes per slice (Z)
+
+	// The upload pitches must describe the same layout as VolumeIndex
+	assert(VolumeIndex(0, 1, 0, volumeSizeX, volumeSizeY) * sizeof(float) == initData.SysMemPitch);
+	assert(VolumeIndex(0, 0, 1, volumeSizeX, volumeSizeY) * sizeof(float) == initData.SysMemSlicePitch);
+	assert(VolumeIndex(volumeSizeX - 1, volumeSizeY - 1, volumeSizeZ - 1, volumeSizeX, volumeSizeY) + 1 == densityData.size());
+	// Releasing the previous texture (the texture manager only keeps the pointer, it is replaced by the caller)
+	if (srv) srv->Release();
+	if (texture) texture->Release();
+	texture = nullptr;
+	HRESULT hr = device->CreateTexture3D(&texDesc, &initData, &texture);
 
 	//Creating shader resource view
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
 	srvDesc.Texture3D.MipLevels = 1;
-	densityTextureSRV = nullptr;
-	hr = device->CreateShaderResourceView(densityTexture, &srvDesc, &densityTextureSRV);
-	textureMgr->addTexture(L"densityVolumeTexture", densityTextureSRV);
-}
\ No newline at end of file
+	srv = nullptr;
+	hr = device->CreateShaderResourceView(texture, &srvDesc, &srv);
+}
+
+// Packing a row of heights and gradients as (height, dh/dx, dh/dy, 0) texels
+void PerlinNoiseTexture::PackHeightRow(int y, float* texels) {
+	const size_t plane = (size_t)terrainSize * terrainSize;
+	const size_t row = (size_t)y * terrainSize;
+	for (int x = 0; x < terrainSize; x++) {
+		texels[x * 4 + 0] = noiseData[row + x];
+		texels[x * 4 + 1] = gradientData[row + x];
+		texels[x * 4 + 2] = gradientData[plane + row + x];
+		texels[x * 4 + 3] = 0.f;
+	}
+}
+
+// Uploading the live heights and gradients into the existing height map texture
+void PerlinNoiseTexture::UploadTextureHM(ID3D11DeviceContext* deviceContext) {
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(deviceContext->Map(noiseTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+	for (int y = 0; y < terrainSize; y++) {
+		PackHeightRow(y, (float*)((char*)mapped.pData + (size_t)y * mapped.RowPitch));
+	}
+	deviceContext->Unmap(noiseTexture, 0);
+
+	if (FAILED(deviceContext->Map(normalTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+	for (int y = 0; y < terrainSize; y++) {
+		memcpy((char*)mapped.pData + (size_t)y * mapped.RowPitch, &normalData[(size_t)y * terrainSize], terrainSize * sizeof(uint32_t));
+	}
+	deviceContext->Unmap(normalTexture, 0);
+}
+
+// Uploading the live density values into the existing density texture
+void PerlinNoiseTexture::UploadTextureDM(ID3D11DeviceContext* deviceContext) {
+	UploadVolume(deviceContext, densityTexture, densityData.data());
+}
+
+// Uploading the live density ring into the existing ring textures
+void PerlinNoiseTexture::UploadTexturesDMRing(ID3D11DeviceContext* deviceContext) {
+	if (!HasDensityRing()) return;
+	for (int s = 0; s < densityRingSlices; s++) {
+		UploadVolume(deviceContext, densityRingTextures[s], &densityRing[s * densityData.size()]);
+	}
+}
+
+// Uploading volume data into an existing volume texture (rows and slices follow VolumeIndex)
+void PerlinNoiseTexture::UploadVolume(ID3D11DeviceContext* deviceContext, ID3D11Texture3D* texture, const float* volume) {
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(deviceContext->Map(texture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+	for (int z = 0; z < volumeSizeZ; z++) {
+		for (int y = 0; y < volumeSizeY; y++) {
+			char* row = (char*)mapped.pData + (size_t)z * mapped.DepthPitch + (size_t)y * mapped.RowPitch;
+			memcpy(row, &volume[VolumeIndex(0, y, z, volumeSizeX, volumeSizeY)], VolumeRowPitch(volumeSizeX));
+		}
+	}
+	deviceContext->Unmap(texture, 0);
+}
+
+// Requesting new heights in the background
+// Replaces any pending height map request, and cancels the one in progress and any result not swapped in yet, as they are now stale.
+void PerlinNoiseTexture::RequestHeightMap(float perlinFreq, float perlinAmp, float persistence) {
+	std::lock_guard<std::mutex> lock(regenMutex);
+	requestHM.generate = true;
+	requestHM.perlinFreq = perlinFreq;
+	requestHM.perlinAmp = perlinAmp;
+	requestHM.persistence = persistence;
+	requestHM.smooths.clear();
+	requestHM.baseHeights.clear();
+	requestHM.baseGradients.clear();
+	pendingHM = true;
+	cancelHM = runningHM;
+	readyHM = false;
+	StartRegeneration();
+	regenStart.notify_one();
+}
+
+// Requesting a smoothing of the latest heights in the background
+// Smoothing is added to the pending request, or continues from the request in progress (or waiting to be swapped in),
+// otherwise it starts from the live heights.
+void PerlinNoiseTexture::RequestSmoothing(int radius, int passes, bool gaussian) {
+	std::lock_guard<std::mutex> lock(regenMutex);
+	if (!pendingHM) {
+		requestHM.generate = false;
+		requestHM.smooths.clear();
+		requestHM.baseHeights.clear();
+		requestHM.baseGradients.clear();
+		if (!runningHM && !readyHM) {
+			requestHM.baseHeights = noiseData;
+			requestHM.baseGradients = gradientData;
+		}
+		pendingHM = true;
+	}
+	requestHM.smooths.push_back({ radius, passes, gaussian });
+	StartRegeneration();
+	regenStart.notify_one();
+}
+
+// Requesting a new density volume in the background, replacing and cancelling any older request
+void PerlinNoiseTexture::RequestDensityMap(float perlinFreq) {
+	std::lock_guard<std::mutex> lock(regenMutex);
+	requestDMFreq = perlinFreq;
+	pendingDM = true;
+	cancelDM = runningDM;
+	readyDM = false;
+	StartRegeneration();
+	regenStart.notify_one();
+}
+
+// Requesting a new density ring in the background, replacing and cancelling any older request
+// The ring textures must exist already (GeneratePerlinNoiseTextureDMRing), the results are uploaded into them.
+void PerlinNoiseTexture::RequestDensityRing(float perlinFreq) {
+	std::lock_guard<std::mutex> lock(regenMutex);
+	requestRingFreq = perlinFreq;
+	pendingRing = true;
+	cancelRing = runningRing;
+	readyRing = false;
+	StartRegeneration();
+	regenStart.notify_one();
+}
+
+// Copying finished background results into the live data and uploading them to the textures
+// Only copies under the lock, so the frame never waits for a generation to finish.
+bool PerlinNoiseTexture::SwapRegeneratedMaps(ID3D11DeviceContext* deviceContext) {
+	bool swappedHM = false, swappedDM = false, swappedRing = false;
+	{
+		std::lock_guard<std::mutex> lock(regenMutex);
+		if (readyHM) {
+			noiseData.swap(readyHeights);
+			gradientData.swap(readyGradients);
+			normalData.swap(readyNormals);
+			generationTimeHM = readyTimeHM;
+			if (readyGeneratedHM) savedOctavesHM = readySavedHM;
+			lastHMLoaded = false;
+			readyHM = false;
+			swappedHM = true;
+		}
+		if (readyDM) {
+			densityData.swap(readyDensity);
+			generationTimeDM = readyTimeDM;
+			savedOctavesDM = readySavedDM;
+			lastDMLoaded = false;
+			readyDM = false;
+			swappedDM = true;
+		}
+		if (readyRing) {
+			densityRing.swap(readyDensityRing);
+			generationTimeRing = readyTimeRing;
+			savedOctavesRing = readySavedRing;
+			readyRing = false;
+			swappedRing = true;
+		}
+	}
+
+	if (swappedHM) {
+		erosion.Cancel();
+		UpdateHeightField();
+		UploadTextureHM(deviceContext);
+	}
+	if (swappedDM) UploadTextureDM(deviceContext);
+	if (swappedRing) UploadTexturesDMRing(deviceContext);
+	return swappedHM;
+}
+
+// Checking for background work not swapped in yet
+bool PerlinNoiseTexture::IsRegenerating() {
+	std::lock_guard<std::mutex> lock(regenMutex);
+	return pendingHM || pendingDM || runningHM || runningDM || readyHM || readyDM || pendingRing || runningRing || readyRing;
+}
+
+// Starting the regeneration worker thread (called with regenMutex held)
+void PerlinNoiseTexture::StartRegeneration() {
+	if (regenThread.joinable()) return;
+	workerHeights.resize(noiseData.size());
+	workerGradients.resize(gradientData.size());
+	workerNormals.resize(normalData.size());
+	workerDensity.resize(densityData.size());
+	workerRing.resize((size_t)densityRingSlices * densityData.size());
+	regenThread = std::thread(&PerlinNoiseTexture::RegenerationLoop, this);
+}
+
+// Stopping the regeneration worker thread, cancelling any request in progress
+void PerlinNoiseTexture::StopRegeneration() {
+	{
+		std::lock_guard<std::mutex> lock(regenMutex);
+		regenStopping = true;
+		cancelHM = cancelDM = cancelRing = true;
+	}
+	regenStart.notify_one();
+	if (regenThread.joinable()) regenThread.join();
+}
+
+// Regeneration worker thread: runs the latest request for each map (height map first) until stopped
+// A result is only kept if no newer request cancelled it while it was being generated.
+void PerlinNoiseTexture::RegenerationLoop() {
+	std::unique_lock<std::mutex> lock(regenMutex);
+	for (;;) {
+		regenStart.wait(lock, [this] { return regenStopping || pendingHM || pendingDM || pendingRing; });
+		if (regenStopping) return;
+
+		if (pendingHM) {
+			HeightMapRequest request = std::move(requestHM);
+			requestHM = HeightMapRequest();
+			pendingHM = false;
+			cancelHM = false;
+			runningHM = true;
+			lock.unlock();
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			unsigned long long saved = 0;
+			if (request.generate) saved = GenerateHeightDataCached(workerHeights.data(), workerGradients.data(), request.perlinFreq, request.perlinAmp, request.persistence, &cancelHM);
+			else if (!request.baseHeights.empty()) {
+				workerHeights.swap(request.baseHeights);
+				workerGradients.swap(request.baseGradients);
+			}
+			for (const SmoothRequest& smooth : request.smooths) {
+				if (cancelHM) break;
+				SmoothHeightField(workerHeights, workerGradients, smooth.radius, smooth.passes, smooth.gaussian);
+			}
+			if (!cancelHM) BakeNormalData(workerGradients.data(), workerNormals.data(), terrainSize);
+			float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			lock.lock();
+			runningHM = false;
+			if (!cancelHM) {
+				readyHeights = workerHeights;
+				readyGradients = workerGradients;
+				readyNormals = workerNormals;
+				readyTimeHM = time;
+				readySavedHM = saved;
+				readyGeneratedHM = request.generate;
+				readyHM = true;
+			}
+		}
+		else if (pendingDM) {
+			float perlinFreq = requestDMFreq;
+			pendingDM = false;
+			cancelDM = false;
+			runningDM = true;
+			lock.unlock();
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			unsigned long long saved = GenerateDensityData(workerDensity.data(), volumeSizeX, volumeSizeY, volumeSizeZ, perlinFreq, &cancelDM);
+			float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			lock.lock();
+			runningDM = false;
+			if (!cancelDM) {
+				readyDensity = workerDensity;
+				readyTimeDM = time;
+				readySavedDM = saved;
+				readyDM = true;
+			}
+		}
+		else {
+			float perlinFreq = requestRingFreq;
+			pendingRing = false;
+			cancelRing = false;
+			runningRing = true;
+			lock.unlock();
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			unsigned long long saved = GenerateDensityRing(workerRing.data(), volumeSizeX, volumeSizeY, volumeSizeZ, perlinFreq, &cancelRing);
+			float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / densityRingSlices;
+
+			lock.lock();
+			runningRing = false;
+			if (!cancelRing) {
+				readyDensityRing = workerRing;
+				readyTimeRing = time;
+				readySavedRing = saved;
+				readyRing = true;
+			}
+		}
+	}
+}
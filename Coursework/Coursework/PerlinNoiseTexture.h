@@ -6,8 +6,26 @@
 #include "DTK\include\DDSTextureLoader.h"
 #include "DTK\include\WICTextureLoader.h"
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <chrono>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "SimplexNoise.h"
+#include "NoiseGraph.h"
+#include "MapCache.h"
+#include "ThreadPool.h"
 #include "TextureManager.h"
+#include "HeightField.h"
+#include "HeightPyramid.h"
+#include "HorizonMap.h"
+#include "Erosion.h"
 
 // Class for perlin noise texture
 // This uses an implementation of Perlin's Simplex Noise.
@@ -19,53 +37,401 @@ private:
 
 	// vectors for noise and density data
 	std::vector<float> noiseData;
+
+	// Shared view of the live heights (the camera and the application keep a pointer to it instead of copying the heights).
+	// Updated in place, with a new version, every time the live heights change or move.
+	HeightField heightField;
+
+	// Min/max pyramid over the live heights for ray casts, refreshed with the view
+	HeightPyramid heightPyramid;
+
+	// Horizon angles of the live heights for the sun's terrain self-shadowing, rebaked (over frames) after every change
+	HorizonMap horizonMap;
+
+	// Erosion run over the live heights (over frames), and when its heights were last published into the live heights
+	// (published at most every erosionPublishMs, and when it completes)
+	Erosion erosion;
+	std::chrono::high_resolution_clock::time_point erosionPublishTime;
+	static constexpr float erosionPublishMs = 100.f;
+
+	// Analytic height gradients of the height map, in height units per texel (dh/dx plane, then dh/dy plane)
+	// Generated in the same pass as the heights and smoothed with them, so they always match the live heights.
+	std::vector<float> gradientData;
 	std::vector<float> densityData;
 
+	// Terrain normals baked from the gradients, with the slope (1 - normal y), as 8-bit signed normalised x, y, z, slope texels
+	// Baked whenever the gradients change, so the terrain pixel shader lights with one fetch of this map.
+	std::vector<uint32_t> normalData;
+
 	// texture and SRV for noise texture
 	ID3D11Texture2D* noiseTexture;
 	ID3D11ShaderResourceView* noiseTextureSRV;
 
+	// texture and SRV for the baked normal map
+	ID3D11Texture2D* normalTexture;
+	ID3D11ShaderResourceView* normalTextureSRV;
+
+	// texture array and SRV for the horizon map (one slice per 4 azimuths)
+	ID3D11Texture2D* horizonTexture;
+	ID3D11ShaderResourceView* horizonTextureSRV;
+
 	// texture and SRV for density texture
 	ID3D11Texture3D* densityTexture;
 	ID3D11ShaderResourceView* densityTextureSRV;
 
-	// method to create height map texture
+	// Animated density: a ring of volumes evenly spaced in time over one loop of 4D fBm (time along w).
+	// Each slice is crossfaded with the same time one loop earlier, so the last slice wraps seamlessly into the first.
+	// The loop length makes the time step between slices the same as the sample spacing, so the band limit holds along w too.
+	static const int densityRingSlices = 8;
+	static constexpr float densityLoopLength = densityRingSlices * 0.5f;
+	std::vector<float> densityRing;
+	ID3D11Texture3D* densityRingTextures[densityRingSlices];
+	ID3D11ShaderResourceView* densityRingSRVs[densityRingSlices];
+	float generationTimeRing;  // CPU time per slice of the last ring generation (in ms)
+	unsigned long long savedOctavesRing;
+
+	// CPU time of the last height map and density map generation (in ms)
+	float generationTimeHM, generationTimeDM;
+
+	// Worker threads for the generation, and number of rows (height map) or Z slices (density map) per block of work
+	// The generation also runs on the render thread, so it only uses the pool when it is free (TryParallelFor)
+	// and otherwise does the work on the calling thread, rather than waiting for a regeneration to finish.
+	ThreadPool threadPool;
+	static const int rowsPerTile = 16;
+	static const int slicesPerSlab = 2;
+
+	// Scratch buffers reused by the smoothing passes (row-filtered heights, and one row of column sums per block of rows)
+	std::vector<float> smoothScratch;
+	std::vector<float> smoothColumnSums;
+	static const int smoothRowsPerBlock = 64;
+	std::mutex smoothMutex;
+
+	// Full evaluations use the compile-time specialised fBm kernels (Fractal<Octaves, Dim>) when the persistence allows it
+	std::atomic<bool> specialisedFractal;
+
+	// Shapes of the height map and density volume (NoiseGraph::Shape). Shapes other than fBm are evaluated through
+	// a NoiseGraph preset: no octave cache, band-limiting or analytic gradients (the gradients are central differences).
+	std::atomic<int> heightShape, densityShape;
+
+	// Seed of the noise permutation of every map (0 is the reference permutation), read by each generation
+	std::atomic<uint32_t> worldSeed;
+
+	// Band-limited fBm: octaves above the Nyquist limit of the sample spacing are skipped (optionally fading the last one),
+	// and the number of octave evaluations saved by the last height map and density map generation
+	std::atomic<bool> bandLimited, bandLimitFade;
+	unsigned long long savedOctavesHM, savedOctavesDM;
+
+	// method to get the octaves evaluated for samples spaced by spacing (every octave when band-limiting is off)
+	SimplexNoise::BandLimit OctaveLimit(const SimplexNoise& noise, int octaves, float spacing);
+
+	// Per-octave cache of the raw height map noise (one terrainSize^2 layer per octave, for one frequency).
+	// Amplitude and persistence only re-weight the octaves, so changing them recombines the layers instead of
+	// evaluating the noise again. Maps whose layers would go over octaveCacheMaxBytes are always fully evaluated.
+	// The lacunarity is the SimplexNoise default, so the frequency is the only key.
+	std::vector<float> octaveCache;
+	float octaveCacheFreq;
+	uint32_t octaveCacheSeed;
+	size_t octaveCacheLayers;
+	bool octaveCacheValid, lastHMCached;
+	std::mutex octaveCacheMutex;
+	static const size_t octaveCacheMaxBytes = 256u << 20;
+
+	// Persistent cache of the startup maps (see MapCache), keyed by every parameter the maps depend on.
+	// mapCacheGenerator is part of every key: bump it when a change to the generation changes its output.
+	MapCache mapCache;
+	static const int mapCacheGenerator = 1;
+	static const unsigned long long mapCacheMaxBytes = 512ull << 20;
+	bool lastHMLoaded, lastDMLoaded;
+
+	// methods to build the map cache keys of a smoothed height map and of a density map
+	unsigned long long HeightMapKey(float perlinFreq, float perlinAmp, float persistence, int smoothRadius, int smoothPasses, bool gaussian);
+	unsigned long long DensityMapKey(float perlinFreq);
+
+	// Smoothing settings of one SmoothHeightMap call
+	struct SmoothRequest {
+		int radius, passes;
+		bool gaussian;
+	};
+
+	// Background height map request: new heights (or the latest heights) followed by any number of smoothing calls
+	struct HeightMapRequest {
+		bool generate;
+		float perlinFreq, perlinAmp, persistence;
+		std::vector<SmoothRequest> smooths;
+		std::vector<float> baseHeights;  // starting heights when not generating (empty: continue from the previous result)
+		std::vector<float> baseGradients;
+	};
+
+	// Background regeneration: one worker thread with one pending request per map.
+	// A newer generate request replaces the pending one and cancels the one in progress, results wait in the ready buffers
+	// until SwapRegeneratedMaps copies them into the live data at a frame boundary.
+	std::thread regenThread;
+	std::mutex regenMutex;
+	std::condition_variable regenStart;
+	bool regenStopping;
+	bool pendingHM, pendingDM, runningHM, runningDM, readyHM, readyDM;
+	bool pendingRing, runningRing, readyRing;
+	HeightMapRequest requestHM;
+	float requestDMFreq, requestRingFreq;
+	std::atomic<bool> cancelHM, cancelDM, cancelRing;
+	std::vector<float> workerHeights, workerGradients, workerDensity, workerRing;
+	std::vector<float> readyHeights, readyGradients, readyDensity, readyDensityRing;
+	std::vector<uint32_t> workerNormals, readyNormals;
+	float readyTimeHM, readyTimeDM, readyTimeRing;
+	unsigned long long readySavedHM, readySavedDM, readySavedRing;
+	bool readyGeneratedHM;
+
+	// method run by the regeneration worker thread
+	void RegenerationLoop();
+
+	// methods to start (on the first request) and stop the regeneration worker thread
+	void StartRegeneration();
+	void StopRegeneration();
+
+	// method to generate the height values of a size x size map into heights, and their gradients if gradients is not null
+	// (stops early once cancel is set). The generation methods return the number of octave evaluations saved by band-limiting.
+	unsigned long long GenerateHeightData(float* heights, float* gradients, int size, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel = nullptr);
+
+	// method to generate the terrainSize x terrainSize height values and gradients through the octave cache (full evaluation if over the cap)
+	unsigned long long GenerateHeightDataCached(float* heights, float* gradients, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel = nullptr);
+
+	// method to generate the height values (and gradients) of a size x size map through the noise graph of the height shape
+	void GenerateHeightDataGraph(float* heights, float* gradients, int size, float perlinFreq, float perlinAmp, float persistence, const std::atomic<bool>* cancel);
+
+	// method to compute the gradients of size x size heights as central differences (one-sided on the edges), in height units per texel
+	void ComputeGradients(const float* heights, float* gradients, int size);
+
+	// method to generate the density values of a sizeX x sizeY x sizeZ volume into density (stops early once cancel is set)
+	unsigned long long GenerateDensityData(float* density, int sizeX, int sizeY, int sizeZ, float perlinFreq, const std::atomic<bool>* cancel = nullptr);
+
+	// method to generate the densityRingSlices time slices of a sizeX x sizeY x sizeZ volume into ring (one volume after the other)
+	unsigned long long GenerateDensityRing(float* ring, int sizeX, int sizeY, int sizeZ, float perlinFreq, const std::atomic<bool>* cancel = nullptr);
+
+	// methods for the separable smoothing passes (rows into the scratch buffer, then columns back into the height values)
+	void SmoothHeightData(float* heights, int radius, int passes, bool gaussian);
+
+	// method to smooth the heights and their gradients together (the filter is linear, so the gradients stay those of the heights)
+	void SmoothHeightField(std::vector<float>& heights, std::vector<float>& gradients, int radius, int passes, bool gaussian);
+
+	// method to point the height field at the live heights and bump its version (after any change of noiseData)
+	void UpdateHeightField();
+
+	// method to copy the heights of the erosion run into the live heights, with their gradients, normals and textures
+	void PublishErosion(ID3D11DeviceContext* deviceContext);
+
+	// method to pack one row of heights and gradients into the height map texel layout (height, dh/dx, dh/dy, 0)
+	void PackHeightRow(int y, float* texels);
+	static void SmoothRowBox(const float* src, float* dst, int size, int radius);
+	static void SmoothRowGaussian(const float* src, float* dst, int size, int radius, const float* weights);
+	static void SmoothColumnsBox(const float* src, float* dst, float* sums, int size, int radius, int firstRow, int lastRow);
+	static void SmoothColumnsGaussian(const float* src, float* dst, float* sums, int size, int radius, const float* weights, int firstRow, int lastRow);
+	static void AddRow(float* sums, const float* row, int size, float weight);
+	static void ScaleRow(float* dst, const float* sums, int size, float scale);
+
+	// method to bake the normal map texels of a size x size map from its gradients (in parallel over rows)
+	void BakeNormalData(const float* gradients, uint32_t* normals, int size);
+
+	// method to create height map texture (and the normal map and horizon map textures baked with it)
 	void CreateTextureHM(ID3D11Device* device, TextureManager* textureMgr);
 
+	// method to create the horizon map texture array from the last completed horizon bake
+	void CreateTextureHorizon(ID3D11Device* device, TextureManager* textureMgr);
+
 	// method to create density texture
 	void CreateTextureDM(ID3D11Device* device, TextureManager* textureMgr);
 
+	// method to create the density ring textures (one 3D texture per time slice)
+	void CreateTexturesDMRing(ID3D11Device* device);
+
+	// method to (re)create a dynamic volume texture and its SRV from volume data
+	void CreateVolumeTexture(ID3D11Device* device, const float* volume, ID3D11Texture3D*& texture, ID3D11ShaderResourceView*& srv);
+
+	// methods to upload the live data into the existing (dynamic) textures
+	void UploadTextureHM(ID3D11DeviceContext* deviceContext);
+	void UploadTextureHorizon(ID3D11DeviceContext* deviceContext);
+	void UploadTextureDM(ID3D11DeviceContext* deviceContext);
+	void UploadTexturesDMRing(ID3D11DeviceContext* deviceContext);
+	void UploadVolume(ID3D11DeviceContext* deviceContext, ID3D11Texture3D* texture, const float* volume);
+
 public:
 	// method to generate the height map
-	void GeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq = 0.06, float perlinAmp = 12.5);
+	void GeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq = 0.06, float perlinAmp = 12.5, float persistence = 0.5);
 
 	// method to generate density map
 	void GeneratePerlinNoiseTextureDM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq = 0.1);
 
+	// methods to load the height map (generated, then smoothed once) or the density map from the map cache,
+	// or to generate them and store them in the cache on a miss
+	void LoadOrGeneratePerlinNoiseTextureHM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq, float perlinAmp, float persistence, int smoothRadius, int smoothPasses, bool gaussian);
+	void LoadOrGeneratePerlinNoiseTextureDM(ID3D11Device* device, TextureManager* textureMgr, float perlinFreq);
+
+	// method to generate the looping animated density ring (and its textures)
+	void GeneratePerlinNoiseTextureDMRing(ID3D11Device* device, float perlinFreq = 0.1);
+
+	// methods to regenerate the maps on the background worker thread (the live maps are unchanged until SwapRegeneratedMaps)
+	void RequestHeightMap(float perlinFreq, float perlinAmp, float persistence = 0.5);
+	void RequestSmoothing(int radius = 1, int passes = 1, bool gaussian = false);
+	void RequestDensityMap(float perlinFreq);
+	void RequestDensityRing(float perlinFreq);
+
+	// method to swap finished background results into the live maps and textures (call once per frame), returns true if the heights changed
+	bool SwapRegeneratedMaps(ID3D11DeviceContext* deviceContext);
+
+	// method to continue the horizon map bake of changed heights for about budgetMs (call once per frame),
+	// returns true when it completed and the horizon texture was updated
+	bool UpdateHorizonMap(ID3D11DeviceContext* deviceContext, float budgetMs);
+
+	// method to get the horizon map of the live heights
+	const HorizonMap& GetHorizonMap() { return horizonMap; }
+
+	// method to start eroding the live heights (seeded by the world seed), restarting any erosion in progress.
+	// New heights swapped in from the background regeneration stop the erosion.
+	void StartErosion(const Erosion::Settings& settings);
+
+	// method to continue the erosion for about budgetMs (call once per frame), returns true when its heights were published
+	// into the live heights and textures (every erosionPublishMs, and when it completes)
+	bool UpdateErosion(ID3D11DeviceContext* deviceContext, float budgetMs);
+
+	// method to stop the erosion in progress, keeping the heights eroded so far
+	void StopErosion(ID3D11DeviceContext* deviceContext);
+
+	// method to get the erosion run (progress and iterations per second)
+	const Erosion& GetErosion() { return erosion; }
+
+	// method to check if a background request is pending or in progress
+	bool IsRegenerating();
+
 	// method to fetch the noise texture SRV
 	ID3D11ShaderResourceView* getPerlinNoiseTextureSRV() { return noiseTextureSRV; }
 
-	// method to smooth out noise texture values
-	void SmoothHeightMap(ID3D11Device* device, TextureManager* textureMgr);
-
-	// method to get the height values at a grid location
-	float GetHeightAt(int x, int y) { 
-		if (x && y >= 0) {
-			if(x && y < terrainSize)
-				return noiseData[(y * terrainSize) + x];
-			else
-				return noiseData[((terrainSize - 1) * terrainSize) + (terrainSize - 1)];
-		}
-		else 
-			return noiseData[(0) + 0];
-	}
+	// method to smooth out noise texture values (radius 1 box is the 3x3 neighbour average, passes are fused in one call)
+	void SmoothHeightMap(ID3D11Device* device, TextureManager* textureMgr, int radius = 1, int passes = 1, bool gaussian = false);
+
+	// method to time smoothing the current height values (in ms, the height values are left unchanged)
+	float BenchmarkSmoothing(int radius, int passes, bool gaussian);
+
+	// method to get the height values at a grid location (clamped to the map, see GetHeightField for interpolated queries)
+	float GetHeightAt(int x, int y) { return heightField.at(x, y); }
 
 	// method to get the noise data vector
-	std::vector<float> GetHeightDataRaw() { return noiseData; }
+	const std::vector<float>& GetHeightDataRaw() { return noiseData; }
+
+	// method to get the baked normal map texels (8-bit signed normalised x, y, z, slope, see DecodeNormal)
+	const std::vector<uint32_t>& GetNormalDataRaw() { return normalData; }
+
+	// Octaves and sample spacing of the height map fBm
+	static const int heightOctaves = 15;
+	static constexpr float heightNoiseScale = 0.01f;
+
+	// Octaves and sample spacing of the density volume fBm
+	static const int densityOctaves = 10;
+	static constexpr float densityNoiseScale = 0.5f;
+
+	// World size of the terrain plane and height scale of its lighting (the height map strength of the terrain shaders)
+	static constexpr float terrainWorldSize = 50.f;
+	static constexpr float terrainHeightScale = 30.f;
+
+	// Height scale of the displaced geometry (the domain shader adds the heights unscaled, terrainHeightScale is the slope
+	// strength of the lighting), used by the erosion and the horizon map so that slopes, talus angles and horizons are
+	// those of the rendered terrain
+	static constexpr float terrainDisplacementScale = 1.f;
+
+	// method to bake count normal map texels from the dh/dx and dh/dy gradients of a row (scale turns them into world slopes)
+	static void BakeNormalRow(const float* gradientsX, const float* gradientsY, uint32_t* normals, int count, float scale);
+
+	// method to unpack a normal map texel into its normal and slope
+	static void DecodeNormal(uint32_t texel, float& nx, float& ny, float& nz, float& slope);
+
+	// Time to bake the normal map (in ms), and the largest angles (in degrees) between the baked normals and the normals of
+	// the shader maths: the analytic gradients (the baked normals before quantisation) and the old five-tap finite differences
+	struct NormalMapCheck {
+		float bakeTime;
+		float maxErrorGradient, maxErrorFiniteDifference;
+	};
+
+	// method to time baking the normal map of the live heights and compare it with the shader maths
+	NormalMapCheck CheckNormalMap();
+
+	// method to get the shared view of the live heights (stays valid and current for the lifetime of the generator)
+	const HeightField& GetHeightField() { return heightField; }
+
+	// method to get the min/max pyramid over the live heights (for ray casts against the terrain)
+	const HeightPyramid& GetHeightPyramid() { return heightPyramid; }
 
 	// method to get the terrain size
 	int GetTerrainSize() { return terrainSize; }
 
+	// methods to get the CPU time of the last generation (in ms)
+	float GetGenerationTimeHM() { return generationTimeHM; }
+	float GetGenerationTimeDM() { return generationTimeDM; }
+
+	// method to time the generation of a size x size height map and its gradients (in ms)
+	float BenchmarkHeightMap(int size, float perlinFreq, float perlinAmp, float persistence = 0.5);
+
+	// method to generate the heights of a size x size map with the current noise settings (for the benchmarks of the
+	// modules working on height maps)
+	std::vector<float> GenerateHeights(int size, float perlinFreq, float perlinAmp, float persistence = 0.5);
+
+	// method to check if the last height map was recombined from cached octaves (no noise evaluated)
+	bool WasHeightMapCached() { return lastHMCached; }
+
+	// methods to check if the last maps were loaded from the map cache, and to get the map cache
+	bool WasHeightMapLoaded() { return lastHMLoaded; }
+	bool WasDensityMapLoaded() { return lastDMLoaded; }
+	MapCache& GetMapCache() { return mapCache; }
+
+	// method to time the generation of a size^3 density volume (in ms)
+	float BenchmarkDensityMap(int size, float perlinFreq);
+
+	// method to generate a sizeX x sizeY x sizeZ density volume with the current noise settings (in the layout of VolumeIndex)
+	std::vector<float> GenerateDensity(int sizeX, int sizeY, int sizeZ, float perlinFreq);
+
+	// method to time the generation of a density ring of size^3 volumes (in ms per time slice)
+	float BenchmarkDensityRing(int size, float perlinFreq);
+
+	// methods to check for the density ring, and to get the two slices around a point of the loop and the blend between them
+	// (loopPosition is in loops, only its fractional part is used)
+	bool HasDensityRing() { return densityRingSRVs[0] != nullptr; }
+	int GetDensityRingSlices() { return densityRingSlices; }
+	void GetDensityRingFrame(float loopPosition, ID3D11ShaderResourceView*& current, ID3D11ShaderResourceView*& next, float& blend);
+	float GetGenerationTimeRing() { return generationTimeRing; }
+	unsigned long long GetSavedOctavesRing() { return savedOctavesRing; }
+
+	// Canonical layout of the density volume: X rows, Y rows per Z slice (the layout uploaded by CreateTextureDM)
+	static size_t VolumeIndex(int x, int y, int z, int sizeX, int sizeY) { return ((size_t)z * sizeY + y) * sizeX + x; }
+	static UINT VolumeRowPitch(int sizeX) { return (UINT)(sizeX * sizeof(float)); }
+	static UINT VolumeSlicePitch(int sizeX, int sizeY) { return (UINT)(sizeX * sizeY * sizeof(float)); }
+
+	// methods to get/set band-limiting (and fading the last octave), and to get the octave evaluations it saved in the last generations
+	bool GetBandLimited() { return bandLimited; }
+	void SetBandLimited(bool limited) { bandLimited = limited; }
+	bool GetBandLimitFade() { return bandLimitFade; }
+	void SetBandLimitFade(bool fade) { bandLimitFade = fade; }
+	unsigned long long GetSavedOctavesHM() { return savedOctavesHM; }
+	unsigned long long GetSavedOctavesDM() { return savedOctavesDM; }
+
+	// methods to get/set the seed of the noise of the maps (applied by the next generation)
+	uint32_t GetSeed() { return worldSeed; }
+	void SetSeed(uint32_t seed) { worldSeed = seed; }
+
+	// methods to get/set the shapes of the height map and the density volume (applied by the next generation)
+	NoiseGraph::Shape GetHeightShape() { return (NoiseGraph::Shape)(int)heightShape; }
+	void SetHeightShape(NoiseGraph::Shape shape) { heightShape = (int)shape; }
+	NoiseGraph::Shape GetDensityShape() { return (NoiseGraph::Shape)(int)densityShape; }
+	void SetDensityShape(NoiseGraph::Shape shape) { densityShape = (int)shape; }
+
+	// methods to get/set the use of the specialised fBm kernels
+	bool GetSpecialisedFractal() { return specialisedFractal; }
+	void SetSpecialisedFractal(bool specialised) { specialisedFractal = specialised; }
+
+	// method to hash the height values (same hash for any thread count)
+	unsigned long long HashHeightData();
+
+	// methods to get/set the number of generation threads
+	int GetThreadCount() { return threadPool.GetThreadCount(); }
+	void SetThreadCount(int threadCount) { threadPool.SetThreadCount(threadCount); }
+	ThreadPool& GetThreadPool() { return threadPool; }
+
 	// Constructor with size initialisation
 	PerlinNoiseTexture(int terrainSize, int volumeSx, int volumeSy, int volumeSz);
 	~PerlinNoiseTexture();
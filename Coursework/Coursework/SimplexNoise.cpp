@@ -1,6 +1,6 @@
 /**
  * @file    SimplexNoise.cpp
- * @brief   A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D).
+ * @brief   A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
  *
  * Copyright (c) 2014-2018 Sebastien Rombauts (sebastien.rombauts@gmail.com)
  *
@@ -27,7 +27,20 @@
 
 //#include "pch.h"
 #include <cstdint>  // int32_t/uint8_t
+#include <atomic>   // std::atomic
+#include <utility>  // std::index_sequence/std::swap
+#include <memory>   // std::make_shared
+#include <cmath>    // std::fabs/std::log
+#include <cstring>  // memcpy
+#include <chrono>   // std::chrono::high_resolution_clock
+#include <vector>   // std::vector
+#include <emmintrin.h>  // SSE2 intrinsics
+#if defined(_MSC_VER)
+#include <intrin.h> // __cpuid/__cpuidex
+#endif
 #include "SimplexNoise.h"
+#include "SimplexNoiseKernels.h"
+#include "ThreadPool.h"
 
 /**
  * Computes the largest integer value not greater than the float one
@@ -55,21 +68,14 @@ static inline int32_t fastfloor(float fp) {
  * that it is not a problem for graphic texture as the noise features disappear
  * at a distance far enough to be able to see a repeatable pattern of 256.
  *
- * This needs to be exactly the same for all instances on all platforms,
- * so it's easiest to just keep it as static explicit data.
- * This also removes the need for any initialisation of this class.
- *
- * Note that making this an uint32_t[] instead of a uint8_t[] might make the
- * code run faster on platforms with a high penalty for unaligned single
- * byte addressing. Intel x86 is generally single-byte-friendly, but
- * some other CPUs are faster with 4-aligned reads.
- * However, a char[] is smaller, which avoids cache trashing, and that
- * is probably the most important aspect on most architectures.
- * This array is accessed a *lot* by the noise functions.
- * A vector-valued noise over 3D accesses it 96 times, and a
- * float-valued 4D noise 64 times. We want this to fit in the cache!
- */
-static const uint8_t perm[256] = {
+ * This is the permutation of seed 0, kept as static explicit data so that seed 0
+ * is exactly the same on all platforms. The other seeds shuffle it (see Tables).
+ *
+ * The tables built from it are widened to int32_t, as the AVX2 gathers need 32-bit entries:
+ * the four 512-entry tables of a seed take 8KB, which still fits in the L1 cache.
+ * They are accessed a *lot* by the noise functions: a float-valued 4D noise reads them 25 times.
+ */
+static const uint8_t referencePerm[256] = {
     151, 160, 137, 91, 90, 15,
     131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
     190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33,
@@ -86,19 +92,68 @@ static const uint8_t perm[256] = {
 };
 
 /**
- * Helper function to hash an integer using the above permutation table
+ * Helper function to wrap a lattice coordinate into the period of the permutation
  *
- *  This inline function costs around 1ns, and is called N+1 times for a noise of N dimension.
+ *  The tables hold the permutation twice, so a wrapped coordinate plus a corner offset (0 or 1) plus the hash
+ * of the next coordinate (at most 255) is always a valid index: the nested lookups perm[i + perm[j]] need no
+ * masking of their own, and give the same values as hashing every lookup modulo 256.
  *
- *  Using a real hash function would be better to improve the "repeatability of 256" of the above permutation table,
+ *  Using a real hash function would be better to improve the "repeatability of 256" of the permutation table,
  * but fast integer Hash functions uses more time and have bad random properties.
  *
- * @param[in] i Integer value to hash
+ * @param[in] i Integer lattice coordinate
+ *
+ * @return i modulo 256
+ */
+static inline int32_t wrap(int32_t i) {
+    return i & 0xFF;
+}
+
+/**
+ * Builds the tables of a seed: the reference permutation for seed 0, otherwise a Fisher-Yates shuffle of it
+ * driven by a SplitMix64 sequence of the seed.
  *
- * @return 8-bits hashed value
+ * @param[in] seed  seed of the permutation
+ */
+SimplexNoise::Tables::Tables(uint32_t seed) {
+    uint8_t p[256];
+    for (int i = 0; i < 256; i++) {
+        p[i] = referencePerm[i];
+    }
+    if (seed != 0) {
+        uint64_t state = seed;
+        for (int i = 255; i > 0; i--) {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            std::swap(p[i], p[z % static_cast<uint64_t>(i + 1)]);
+        }
+    }
+    for (int i = 0; i < 512; i++) {
+        perm[i] = p[i & 0xFF];
+        grad2[i] = perm[i] & 0x3F;
+        grad3[i] = perm[i] & 15;
+        grad4[i] = perm[i] & 31;
+    }
+}
+
+/**
+ * Tables of a seed (seed 0 shares one static copy, built on first use)
  */
-static inline uint8_t hash(int32_t i) {
-    return perm[static_cast<uint8_t>(i)];
+static std::shared_ptr<const SimplexNoise::Tables> tablesOf(uint32_t seed) {
+    static const std::shared_ptr<const SimplexNoise::Tables> reference = std::make_shared<SimplexNoise::Tables>(0u);
+    return (seed == 0) ? reference : std::make_shared<SimplexNoise::Tables>(seed);
+}
+
+SimplexNoise::SimplexNoise(float frequency, float amplitude, float lacunarity, float persistence, uint32_t seed) :
+    mFrequency(frequency),
+    mAmplitude(amplitude),
+    mLacunarity(lacunarity),
+    mPersistence(persistence),
+    mSeed(seed),
+    mTables(tablesOf(seed)) {
 }
 
 /* NOTE Gradient table to test if lookup-table are more efficient than calculs
@@ -118,13 +173,13 @@ static const float gradients1D[16] = {
  * Note also that these noise functions are the most practical and useful
  * signed version of Perlin noise.
  *
- * @param[in] hash  hash value
+ * @param[in] hash  gradient index (from a gradient table)
  * @param[in] x     distance to the corner
  *
  * @return gradient value
  */
 static float grad(int32_t hash, float x) {
-    const int32_t h = hash & 0x0F;  // Convert low 4 bits of hash code
+    const int32_t h = hash;         // Low 4 bits of hash code (from the grad3 table)
     float grad = 1.0f + (h & 7);    // Gradient value 1.0, 2.0, ..., 8.0
     if ((h & 8) != 0) grad = -grad; // Set a random sign for the gradient
 //  float grad = gradients1D[h];    // NOTE : Test of Gradient look-up table instead of the above
@@ -134,14 +189,14 @@ static float grad(int32_t hash, float x) {
 /**
  * Helper functions to compute gradients-dot-residual vectors (2D)
  *
- * @param[in] hash  hash value
+ * @param[in] hash  gradient index (from a gradient table)
  * @param[in] x     x coord of the distance to the corner
  * @param[in] y     y coord of the distance to the corner
  *
  * @return gradient value
  */
 static float grad(int32_t hash, float x, float y) {
-    const int32_t h = hash & 0x3F;  // Convert low 3 bits of hash code
+    const int32_t h = hash;         // Low 6 bits of hash code (grad2 table), converted
     const float u = h < 4 ? x : y;  // into 8 simple gradient directions,
     const float v = h < 4 ? y : x;
     return ((h & 1) ? -u : u) + ((h & 2) ? -2.0f * v : 2.0f * v); // and compute the dot product with (x,y).
@@ -150,7 +205,7 @@ static float grad(int32_t hash, float x, float y) {
 /**
  * Helper functions to compute gradients-dot-residual vectors (3D)
  *
- * @param[in] hash  hash value
+ * @param[in] hash  gradient index (from a gradient table)
  * @param[in] x     x coord of the distance to the corner
  * @param[in] y     y coord of the distance to the corner
  * @param[in] z     z coord of the distance to the corner
@@ -158,12 +213,31 @@ static float grad(int32_t hash, float x, float y) {
  * @return gradient value
  */
 static float grad(int32_t hash, float x, float y, float z) {
-    int h = hash & 15;     // Convert low 4 bits of hash code into 12 simple
+    int h = hash;          // Low 4 bits of hash code (grad3 table) into 12 simple
     float u = h < 8 ? x : y; // gradient directions, and compute dot product.
     float v = h < 4 ? y : h == 12 || h == 14 ? x : z; // Fix repeats at h = 12 to 15
     return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
 }
 
+/**
+ * Helper functions to compute gradients-dot-residual vectors (4D)
+ *
+ * @param[in] hash  gradient index (from a gradient table)
+ * @param[in] x     x coord of the distance to the corner
+ * @param[in] y     y coord of the distance to the corner
+ * @param[in] z     z coord of the distance to the corner
+ * @param[in] w     w coord of the distance to the corner
+ *
+ * @return gradient value
+ */
+static float grad(int32_t hash, float x, float y, float z, float w) {
+    const int32_t h = hash;       // Low 5 bits of hash code (grad4 table) into 32 simple
+    const float u = h < 24 ? x : y; // gradient directions (the edges of a 4D hypercube),
+    const float v = h < 16 ? y : z; // and compute the dot product.
+    const float s = h < 8 ? z : w;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v) + ((h & 4) ? -s : s);
+}
+
 /**
  * 1D Perlin simplex noise
  *
@@ -173,7 +247,7 @@ static float grad(int32_t hash, float x, float y, float z) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x) {
+float SimplexNoise::noise(float x) const {
     float n0, n1;   // Noise contributions from the two "corners"
 
     // No need to skew the input space in 1D
@@ -189,13 +263,13 @@ float SimplexNoise::noise(float x) {
     float t0 = 1.0f - x0*x0;
 //  if(t0 < 0.0f) t0 = 0.0f; // not possible
     t0 *= t0;
-    n0 = t0 * t0 * grad(hash(i0), x0);
+    n0 = t0 * t0 * grad(mTables->grad3[wrap(i0)], x0);
 
     // Calculate the contribution from the second corner
     float t1 = 1.0f - x1*x1;
 //  if(t1 < 0.0f) t1 = 0.0f; // not possible
     t1 *= t1;
-    n1 = t1 * t1 * grad(hash(i1), x1);
+    n1 = t1 * t1 * grad(mTables->grad3[wrap(i1)], x1);
 
     // The maximum value of this noise is 8*(3/4)^4 = 2.53125
     // A factor of 0.395 scales to fit exactly within [-1,1]
@@ -212,7 +286,7 @@ float SimplexNoise::noise(float x) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y) {
+float SimplexNoise::noise(float x, float y) const {
     float n0, n1, n2;   // Noise contributions from the three corners
 
     // Skewing/Unskewing factors for 2D
@@ -254,9 +328,13 @@ float SimplexNoise::noise(float x, float y) {
     const float y2 = y0 - 1.0f + 2.0f * G2;
 
     // Work out the hashed gradient indices of the three simplex corners
-    const int gi0 = hash(i + hash(j));
-    const int gi1 = hash(i + i1 + hash(j + j1));
-    const int gi2 = hash(i + 1 + hash(j + 1));
+    const int32_t* perm = mTables->perm;
+    const int32_t* gradIndex = mTables->grad2;
+    const int32_t ii = wrap(i);
+    const int32_t jj = wrap(j);
+    const int gi0 = gradIndex[ii + perm[jj]];
+    const int gi1 = gradIndex[ii + i1 + perm[jj + j1]];
+    const int gi2 = gradIndex[ii + 1 + perm[jj + 1]];
 
     // Calculate the contribution from the first corner
     float t0 = 0.5f - x0*x0 - y0*y0;
@@ -300,7 +378,7 @@ float SimplexNoise::noise(float x, float y) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y, float z) {
+float SimplexNoise::noise(float x, float y, float z) const {
     float n0, n1, n2, n3; // Noise contributions from the four corners
 
     // Skewing/Unskewing factors for 3D
@@ -357,10 +435,15 @@ float SimplexNoise::noise(float x, float y, float z) {
     float z3 = z0 - 1.0f + 3.0f * G3;
 
     // Work out the hashed gradient indices of the four simplex corners
-    int gi0 = hash(i + hash(j + hash(k)));
-    int gi1 = hash(i + i1 + hash(j + j1 + hash(k + k1)));
-    int gi2 = hash(i + i2 + hash(j + j2 + hash(k + k2)));
-    int gi3 = hash(i + 1 + hash(j + 1 + hash(k + 1)));
+    const int32_t* perm = mTables->perm;
+    const int32_t* gradIndex = mTables->grad3;
+    int ii = wrap(i);
+    int jj = wrap(j);
+    int kk = wrap(k);
+    int gi0 = gradIndex[ii + perm[jj + perm[kk]]];
+    int gi1 = gradIndex[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+    int gi2 = gradIndex[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+    int gi3 = gradIndex[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
 
     // Calculate the contribution from the four corners
     float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0;
@@ -396,6 +479,322 @@ float SimplexNoise::noise(float x, float y, float z) {
     return 32.0f*(n0 + n1 + n2 + n3);
 }
 
+/**
+ * 4D Perlin simplex noise
+ *
+ * Uses Stefan Gustavson's rank ordering to find the simplex (one of 24 in the hypercube),
+ * the same comparisons are done lane-wise by the batch functions.
+ *
+ * @param[in] x float coordinate
+ * @param[in] y float coordinate
+ * @param[in] z float coordinate
+ * @param[in] w float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::noise(float x, float y, float z, float w) const {
+    float n0, n1, n2, n3, n4; // Noise contributions from the five corners
+
+    // Skewing/Unskewing factors for 4D
+    static const float F4 = 0.309016994f; // (sqrt(5) - 1) / 4
+    static const float G4 = 0.138196601f; // (5 - sqrt(5)) / 20
+
+    // Skew the input space to determine which simplex cell we're in
+    float s = (x + y + z + w) * F4;
+    int i = fastfloor(x + s);
+    int j = fastfloor(y + s);
+    int k = fastfloor(z + s);
+    int l = fastfloor(w + s);
+    float t = (i + j + k + l) * G4;
+    float X0 = i - t; // Unskew the cell origin back to (x,y,z,w) space
+    float Y0 = j - t;
+    float Z0 = k - t;
+    float W0 = l - t;
+    float x0 = x - X0; // The x,y,z,w distances from the cell origin
+    float y0 = y - Y0;
+    float z0 = z - Z0;
+    float w0 = w - W0;
+
+    // Rank the coordinates by magnitude: the corners are visited by stepping along
+    // the largest coordinate first, then the second largest, and so on.
+    int rankx = 0, ranky = 0, rankz = 0, rankw = 0;
+    if (x0 > y0) rankx++; else ranky++;
+    if (x0 > z0) rankx++; else rankz++;
+    if (x0 > w0) rankx++; else rankw++;
+    if (y0 > z0) ranky++; else rankz++;
+    if (y0 > w0) ranky++; else rankw++;
+    if (z0 > w0) rankz++; else rankw++;
+
+    // Offsets of the second, third and fourth corners in (i,j,k,l) coords
+    int i1 = rankx >= 3 ? 1 : 0, j1 = ranky >= 3 ? 1 : 0, k1 = rankz >= 3 ? 1 : 0, l1 = rankw >= 3 ? 1 : 0;
+    int i2 = rankx >= 2 ? 1 : 0, j2 = ranky >= 2 ? 1 : 0, k2 = rankz >= 2 ? 1 : 0, l2 = rankw >= 2 ? 1 : 0;
+    int i3 = rankx >= 1 ? 1 : 0, j3 = ranky >= 1 ? 1 : 0, k3 = rankz >= 1 ? 1 : 0, l3 = rankw >= 1 ? 1 : 0;
+
+    float x1 = x0 - i1 + G4; // Offsets for second corner in (x,y,z,w) coords
+    float y1 = y0 - j1 + G4;
+    float z1 = z0 - k1 + G4;
+    float w1 = w0 - l1 + G4;
+    float x2 = x0 - i2 + 2.0f * G4; // Offsets for third corner
+    float y2 = y0 - j2 + 2.0f * G4;
+    float z2 = z0 - k2 + 2.0f * G4;
+    float w2 = w0 - l2 + 2.0f * G4;
+    float x3 = x0 - i3 + 3.0f * G4; // Offsets for fourth corner
+    float y3 = y0 - j3 + 3.0f * G4;
+    float z3 = z0 - k3 + 3.0f * G4;
+    float w3 = w0 - l3 + 3.0f * G4;
+    float x4 = x0 - 1.0f + 4.0f * G4; // Offsets for last corner
+    float y4 = y0 - 1.0f + 4.0f * G4;
+    float z4 = z0 - 1.0f + 4.0f * G4;
+    float w4 = w0 - 1.0f + 4.0f * G4;
+
+    // Work out the hashed gradient indices of the five simplex corners
+    const int32_t* perm = mTables->perm;
+    const int32_t* gradIndex = mTables->grad4;
+    int ii = wrap(i);
+    int jj = wrap(j);
+    int kk = wrap(k);
+    int ll = wrap(l);
+    int gi0 = gradIndex[ii + perm[jj + perm[kk + perm[ll]]]];
+    int gi1 = gradIndex[ii + i1 + perm[jj + j1 + perm[kk + k1 + perm[ll + l1]]]];
+    int gi2 = gradIndex[ii + i2 + perm[jj + j2 + perm[kk + k2 + perm[ll + l2]]]];
+    int gi3 = gradIndex[ii + i3 + perm[jj + j3 + perm[kk + k3 + perm[ll + l3]]]];
+    int gi4 = gradIndex[ii + 1 + perm[jj + 1 + perm[kk + 1 + perm[ll + 1]]]];
+
+    // Calculate the contribution from the five corners
+    float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0 - w0*w0;
+    if (t0 < 0) {
+        n0 = 0.0;
+    } else {
+        t0 *= t0;
+        n0 = t0 * t0 * grad(gi0, x0, y0, z0, w0);
+    }
+    float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1 - w1*w1;
+    if (t1 < 0) {
+        n1 = 0.0;
+    } else {
+        t1 *= t1;
+        n1 = t1 * t1 * grad(gi1, x1, y1, z1, w1);
+    }
+    float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2 - w2*w2;
+    if (t2 < 0) {
+        n2 = 0.0;
+    } else {
+        t2 *= t2;
+        n2 = t2 * t2 * grad(gi2, x2, y2, z2, w2);
+    }
+    float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3 - w3*w3;
+    if (t3 < 0) {
+        n3 = 0.0;
+    } else {
+        t3 *= t3;
+        n3 = t3 * t3 * grad(gi3, x3, y3, z3, w3);
+    }
+    float t4 = 0.6f - x4*x4 - y4*y4 - z4*z4 - w4*w4;
+    if (t4 < 0) {
+        n4 = 0.0;
+    } else {
+        t4 *= t4;
+        n4 = t4 * t4 * grad(gi4, x4, y4, z4, w4);
+    }
+    // Sum up and scale the result to cover the range [-1,1]
+    return 27.0f*(n0 + n1 + n2 + n3 + n4);
+}
+
+
+/**
+ * Gradient vectors matching grad(hash, x, y) and grad(hash, x, y, z) (grad() is the dot product with them)
+ */
+static void gradVector(int32_t hash, float& gx, float& gy) {
+    const int32_t h = hash;
+    const float su = (h & 1) ? -1.0f : 1.0f;
+    const float sv = (h & 2) ? -2.0f : 2.0f;
+    gx = h < 4 ? su : sv;
+    gy = h < 4 ? sv : su;
+}
+
+static void gradVector(int32_t hash, float& gx, float& gy, float& gz) {
+    const int h = hash;
+    const float su = (h & 1) ? -1.0f : 1.0f;
+    const float sv = (h & 2) ? -1.0f : 1.0f;
+    gx = gy = gz = 0.0f;
+    if (h < 8) gx = su; else gy = su;
+    if (h < 4) gy = sv; else if (h == 12 || h == 14) gx = sv; else gz = sv;
+}
+
+/**
+ * Contribution of one simplex corner and its derivatives, n = t^4 * (g . d) with t = r - |d|^2
+ *
+ * The value uses the same operations as noise(), so it is bit-identical to the corner term there.
+ */
+static float cornerDeriv(float t, int32_t gi, float x, float y, float& dx, float& dy) {
+    if (t < 0.0f) return 0.0f;
+    float gx, gy;
+    gradVector(gi, gx, gy);
+    const float g = grad(gi, x, y);
+    const float t2 = t * t;
+    const float t4 = t2 * t2;
+    const float dt = -8.0f * t2 * t * g;  // d(t^4)/d|d| contribution: 4 t^3 * (-2 d) * g
+    dx += dt * x + t4 * gx;
+    dy += dt * y + t4 * gy;
+    return t4 * g;
+}
+
+static float cornerDeriv(float t, int32_t gi, float x, float y, float z, float& dx, float& dy, float& dz) {
+    if (t < 0.0f) return 0.0f;
+    float gx, gy, gz;
+    gradVector(gi, gx, gy, gz);
+    const float g = grad(gi, x, y, z);
+    const float t2 = t * t;
+    const float t4 = t2 * t2;
+    const float dt = -8.0f * t2 * t * g;
+    dx += dt * x + t4 * gx;
+    dy += dt * y + t4 * gy;
+    dz += dt * z + t4 * gz;
+    return t4 * g;
+}
+
+/**
+ * 2D Perlin simplex noise with its analytic gradient
+ *
+ * @param[in]  x   float coordinate
+ * @param[in]  y   float coordinate
+ * @param[out] dx  derivative of the noise along x
+ * @param[out] dy  derivative of the noise along y
+ *
+ * @return Noise value in the range[-1; 1], the same as noise(x, y).
+ */
+float SimplexNoise::noiseDeriv(float x, float y, float& dx, float& dy) const {
+    static const float F2 = 0.366025403f;  // F2 = (sqrt(3) - 1) / 2
+    static const float G2 = 0.211324865f;  // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
+
+    // Same cell, corner offsets and hashes as noise(x, y)
+    const float s = (x + y) * F2;
+    const float xs = x + s;
+    const float ys = y + s;
+    const int32_t i = fastfloor(xs);
+    const int32_t j = fastfloor(ys);
+
+    const float t = static_cast<float>(i + j) * G2;
+    const float X0 = i - t;
+    const float Y0 = j - t;
+    const float x0 = x - X0;
+    const float y0 = y - Y0;
+
+    int32_t i1, j1;
+    if (x0 > y0) {
+        i1 = 1;
+        j1 = 0;
+    } else {
+        i1 = 0;
+        j1 = 1;
+    }
+
+    const float x1 = x0 - i1 + G2;
+    const float y1 = y0 - j1 + G2;
+    const float x2 = x0 - 1.0f + 2.0f * G2;
+    const float y2 = y0 - 1.0f + 2.0f * G2;
+
+    const int32_t* perm = mTables->perm;
+    const int32_t* gradIndex = mTables->grad2;
+    const int32_t ii = wrap(i);
+    const int32_t jj = wrap(j);
+    const int gi0 = gradIndex[ii + perm[jj]];
+    const int gi1 = gradIndex[ii + i1 + perm[jj + j1]];
+    const int gi2 = gradIndex[ii + 1 + perm[jj + 1]];
+
+    // Corner contributions, accumulating the derivatives
+    dx = dy = 0.0f;
+    const float n0 = cornerDeriv(0.5f - x0*x0 - y0*y0, gi0, x0, y0, dx, dy);
+    const float n1 = cornerDeriv(0.5f - x1*x1 - y1*y1, gi1, x1, y1, dx, dy);
+    const float n2 = cornerDeriv(0.5f - x2*x2 - y2*y2, gi2, x2, y2, dx, dy);
+
+    dx *= 45.23065f;
+    dy *= 45.23065f;
+    return 45.23065f * (n0 + n1 + n2);
+}
+
+/**
+ * 3D Perlin simplex noise with its analytic gradient
+ *
+ * @param[in]  x   float coordinate
+ * @param[in]  y   float coordinate
+ * @param[in]  z   float coordinate
+ * @param[out] dx  derivative of the noise along x
+ * @param[out] dy  derivative of the noise along y
+ * @param[out] dz  derivative of the noise along z
+ *
+ * @return Noise value in the range[-1; 1], the same as noise(x, y, z).
+ */
+float SimplexNoise::noiseDeriv(float x, float y, float z, float& dx, float& dy, float& dz) const {
+    static const float F3 = 1.0f / 3.0f;
+    static const float G3 = 1.0f / 6.0f;
+
+    // Same cell, corner offsets and hashes as noise(x, y, z)
+    float s = (x + y + z) * F3;
+    int i = fastfloor(x + s);
+    int j = fastfloor(y + s);
+    int k = fastfloor(z + s);
+    float t = (i + j + k) * G3;
+    float X0 = i - t;
+    float Y0 = j - t;
+    float Z0 = k - t;
+    float x0 = x - X0;
+    float y0 = y - Y0;
+    float z0 = z - Z0;
+
+    int i1, j1, k1;
+    int i2, j2, k2;
+    if (x0 >= y0) {
+        if (y0 >= z0) {
+            i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+        } else if (x0 >= z0) {
+            i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1;
+        } else {
+            i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1;
+        }
+    } else {
+        if (y0 < z0) {
+            i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1;
+        } else if (x0 < z0) {
+            i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1;
+        } else {
+            i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+        }
+    }
+
+    float x1 = x0 - i1 + G3;
+    float y1 = y0 - j1 + G3;
+    float z1 = z0 - k1 + G3;
+    float x2 = x0 - i2 + 2.0f * G3;
+    float y2 = y0 - j2 + 2.0f * G3;
+    float z2 = z0 - k2 + 2.0f * G3;
+    float x3 = x0 - 1.0f + 3.0f * G3;
+    float y3 = y0 - 1.0f + 3.0f * G3;
+    float z3 = z0 - 1.0f + 3.0f * G3;
+
+    const int32_t* perm = mTables->perm;
+    const int32_t* gradIndex = mTables->grad3;
+    int ii = wrap(i);
+    int jj = wrap(j);
+    int kk = wrap(k);
+    int gi0 = gradIndex[ii + perm[jj + perm[kk]]];
+    int gi1 = gradIndex[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+    int gi2 = gradIndex[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+    int gi3 = gradIndex[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+
+    // Corner contributions, accumulating the derivatives
+    dx = dy = dz = 0.0f;
+    float n0 = cornerDeriv(0.6f - x0*x0 - y0*y0 - z0*z0, gi0, x0, y0, z0, dx, dy, dz);
+    float n1 = cornerDeriv(0.6f - x1*x1 - y1*y1 - z1*z1, gi1, x1, y1, z1, dx, dy, dz);
+    float n2 = cornerDeriv(0.6f - x2*x2 - y2*y2 - z2*z2, gi2, x2, y2, z2, dx, dy, dz);
+    float n3 = cornerDeriv(0.6f - x3*x3 - y3*y3 - z3*z3, gi3, x3, y3, z3, dx, dy, dz);
+
+    dx *= 32.0f;
+    dy *= 32.0f;
+    dz *= 32.0f;
+    return 32.0f*(n0 + n1 + n2 + n3);
+}
+
 
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 1D Perlin Simplex noise
@@ -474,3 +873,1159 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
 
     return (output / denom);
 }
+
+/**
+ * Fractal/Fractional Brownian Motion (fBm) summation of 4D Perlin Simplex noise
+ *
+ * @param[in] octaves   number of fraction of noise to sum
+ * @param[in] x         x float coordinate
+ * @param[in] y         y float coordinate
+ * @param[in] z         z float coordinate
+ * @param[in] w         w float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, float x, float y, float z, float w) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        output += (amplitude * noise(x * frequency, y * frequency, z * frequency, w * frequency));
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
+
+/**
+ * Smallest sample spacing (in noise lattice units) an octave may have to be kept by a band-limited fBm,
+ * half a lattice cell: higher octaves only alias at that sample spacing.
+ */
+static const float kBandLimitSpacing = 0.5f;
+
+/**
+ * Octaves kept by a band-limited fBm of samples spaced by spacing
+ *
+ * An octave is kept while its frequency times the spacing stays under kBandLimitSpacing (at least one octave is kept).
+ * With fade, the last kept octave fades out smoothly as it approaches the limit, so changing the frequency
+ * or the spacing never makes an octave pop in or out.
+ *
+ * @param[in] octaves   number of octaves requested
+ * @param[in] spacing   distance between two samples (before the frequency is applied)
+ * @param[in] fade      fade the last kept octave
+ *
+ * @return the number of octaves to evaluate and the weight of the last one
+ */
+SimplexNoise::BandLimit SimplexNoise::bandLimit(size_t octaves, float spacing, bool fade) const {
+    BandLimit limit = { 0, 1.f };
+    float frequency = mFrequency;
+    float lastSpacing = 0.f;
+    for (size_t i = 0; i < octaves; i++) {
+        const float octaveSpacing = std::fabs(spacing * frequency);
+        if (octaveSpacing >= kBandLimitSpacing) break;
+        lastSpacing = octaveSpacing;
+        limit.evaluated++;
+
+        frequency *= mLacunarity;
+    }
+
+    if (limit.evaluated == 0) {
+        limit.evaluated = (octaves > 0) ? 1 : 0;
+    }
+    else if (fade && limit.evaluated < octaves && lastSpacing > 0.f && mLacunarity > 1.f) {
+        // Octaves left below the limit (in (0, 1]), eased with a smoothstep
+        float t = std::log(kBandLimitSpacing / lastSpacing) / std::log(mLacunarity);
+        t = (t < 1.f) ? t : 1.f;
+        limit.lastWeight = t * t * (3.f - 2.f * t);
+    }
+    return limit;
+}
+
+/**
+ * Band-limited fBm summation of 2D Perlin Simplex noise
+ *
+ * Only limit.evaluated octaves are evaluated, but every requested octave counts in the normalisation,
+ * so the skipped octaves act as zero-mean detail and the range does not change.
+ *
+ * @param[in] octaves   number of fraction of noise requested
+ * @param[in] limit     octaves to evaluate (see bandLimit())
+ * @param[in] x         x float coordinate
+ * @param[in] y         y float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, const BandLimit& limit, float x, float y) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        if (i < limit.evaluated) {
+            const float weight = (i + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+            output += (weight * noise(x * frequency, y * frequency));
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
+
+/**
+ * Band-limited fBm summation of 3D Perlin Simplex noise (see the 2D version)
+ *
+ * @param[in] octaves   number of fraction of noise requested
+ * @param[in] limit     octaves to evaluate (see bandLimit())
+ * @param[in] x         x float coordinate
+ * @param[in] y         y float coordinate
+ * @param[in] z         z float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, const BandLimit& limit, float x, float y, float z) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        if (i < limit.evaluated) {
+            const float weight = (i + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+            output += (weight * noise(x * frequency, y * frequency, z * frequency));
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
+
+/**
+ * Band-limited fBm summation of 4D Perlin Simplex noise (see the 2D version)
+ *
+ * @param[in] octaves   number of fraction of noise requested
+ * @param[in] limit     octaves to evaluate (see bandLimit())
+ * @param[in] x         x float coordinate
+ * @param[in] y         y float coordinate
+ * @param[in] z         z float coordinate
+ * @param[in] w         w float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, const BandLimit& limit, float x, float y, float z, float w) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        if (i < limit.evaluated) {
+            const float weight = (i + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+            output += (weight * noise(x * frequency, y * frequency, z * frequency, w * frequency));
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
+
+
+/**
+ * Band-limited fBm summation of 2D Perlin Simplex noise with its analytic gradient
+ *
+ * Each octave's derivatives are scaled by its frequency (chain rule) and weighted like its value.
+ *
+ * @param[in]  octaves   number of fraction of noise requested
+ * @param[in]  limit     octaves to evaluate (see bandLimit())
+ * @param[in]  x         x float coordinate
+ * @param[in]  y         y float coordinate
+ * @param[out] dx        derivative of the fBm along x
+ * @param[out] dy        derivative of the fBm along y
+ *
+ * @return Noise value in the range[-1; 1], the same as fractal(octaves, limit, x, y).
+ */
+float SimplexNoise::fractalDeriv(size_t octaves, const BandLimit& limit, float x, float y, float& dx, float& dy) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+    dx = dy = 0.f;
+
+    for (size_t i = 0; i < octaves; i++) {
+        if (i < limit.evaluated) {
+            const float weight = (i + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+            float nx, ny;
+            output += (weight * noiseDeriv(x * frequency, y * frequency, nx, ny));
+            dx += (weight * frequency) * nx;
+            dy += (weight * frequency) * ny;
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    dx /= denom;
+    dy /= denom;
+    return (output / denom);
+}
+
+/**
+ * Band-limited fBm summation of 3D Perlin Simplex noise with its analytic gradient (see the 2D version)
+ *
+ * @param[in]  octaves   number of fraction of noise requested
+ * @param[in]  limit     octaves to evaluate (see bandLimit())
+ * @param[in]  x         x float coordinate
+ * @param[in]  y         y float coordinate
+ * @param[in]  z         z float coordinate
+ * @param[out] dx        derivative of the fBm along x
+ * @param[out] dy        derivative of the fBm along y
+ * @param[out] dz        derivative of the fBm along z
+ *
+ * @return Noise value in the range[-1; 1], the same as fractal(octaves, limit, x, y, z).
+ */
+float SimplexNoise::fractalDeriv(size_t octaves, const BandLimit& limit, float x, float y, float z, float& dx, float& dy, float& dz) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+    dx = dy = dz = 0.f;
+
+    for (size_t i = 0; i < octaves; i++) {
+        if (i < limit.evaluated) {
+            const float weight = (i + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+            float nx, ny, nz;
+            output += (weight * noiseDeriv(x * frequency, y * frequency, z * frequency, nx, ny, nz));
+            dx += (weight * frequency) * nx;
+            dy += (weight * frequency) * ny;
+            dz += (weight * frequency) * nz;
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    dx /= denom;
+    dy /= denom;
+    dz /= denom;
+    return (output / denom);
+}
+
+
+/*
+ * Batch (SIMD) evaluation
+ *
+ * The SSE4.1 and AVX2 kernels live in their own translation units (see SimplexNoiseKernels.h): the functions
+ * below pick the kernels of the detected instruction set, and evaluate the samples left over by their last
+ * whole lane with the scalar functions above, so every path is bit-identical to the scalar one.
+ */
+
+/**
+ * Detects the best instruction set supported by the CPU and the OS.
+ *
+ * AVX2 also needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2).
+ */
+SimplexNoise::BatchPath SimplexNoise::detectBatchPath() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    const bool sse41 = __builtin_cpu_supports("sse4.1");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return BatchPath::AVX2;
+    if (sse41) return BatchPath::SSE41;
+    return BatchPath::Scalar;
+}
+
+static std::atomic<int> sBatchPath(-1);
+
+SimplexNoise::BatchPath SimplexNoise::getBatchPath() {
+    int path = sBatchPath.load(std::memory_order_relaxed);
+    if (path < 0) {
+        path = static_cast<int>(detectBatchPath());
+        sBatchPath.store(path, std::memory_order_relaxed);
+    }
+    return static_cast<BatchPath>(path);
+}
+
+void SimplexNoise::setBatchPath(BatchPath path) {
+    const BatchPath supported = detectBatchPath();
+    if (static_cast<int>(path) > static_cast<int>(supported)) {
+        path = supported;
+    }
+    sBatchPath.store(static_cast<int>(path), std::memory_order_relaxed);
+}
+
+/**
+ * Distance between two floats in units in the last place, negative floats mapped so the integer order follows the float order.
+ */
+int SimplexNoise::ulpDistance(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(float));
+    memcpy(&ib, &b, sizeof(float));
+    if (ia < 0) ia = INT32_MIN - ia;
+    if (ib < 0) ib = INT32_MIN - ib;
+    const long long diff = (long long)ia - ib;
+    return (int)(diff < 0 ? -diff : diff);
+}
+
+int SimplexNoise::maxUlpDistance(const float* a, const float* b, size_t count) {
+    int maxUlp = 0;
+    for (size_t i = 0; i < count; i++) {
+        const int ulp = ulpDistance(a[i], b[i]);
+        if (ulp > maxUlp) maxUlp = ulp;
+    }
+    return maxUlp;
+}
+
+/**
+ * Evaluates noise(xs[i], y[, z[, w]]) for a row of samples with the kernels of the current batch path,
+ * the samples they leave over with the scalar function.
+ */
+static void noise2SpanBest(const SimplexNoise& noise, const float* xs, float y, float* out, size_t count) {
+    size_t i = 0;
+    switch (SimplexNoise::getBatchPath()) {
+    case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::noise2Span(noise.tables(), xs, y, out, count); break;
+    case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::noise2Span(noise.tables(), xs, y, out, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise.noise(xs[i], y);
+    }
+}
+
+static void noise2DerivSpanBest(const SimplexNoise& noise, const float* xs, float y, float* out, float* outDx, float* outDy, size_t count) {
+    size_t i = 0;
+    switch (SimplexNoise::getBatchPath()) {
+    case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::noise2DerivSpan(noise.tables(), xs, y, out, outDx, outDy, count); break;
+    case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::noise2DerivSpan(noise.tables(), xs, y, out, outDx, outDy, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise.noiseDeriv(xs[i], y, outDx[i], outDy[i]);
+    }
+}
+
+static void noise3SpanBest(const SimplexNoise& noise, const float* xs, float y, float z, float* out, size_t count) {
+    size_t i = 0;
+    switch (SimplexNoise::getBatchPath()) {
+    case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::noise3Span(noise.tables(), xs, y, z, out, count); break;
+    case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::noise3Span(noise.tables(), xs, y, z, out, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise.noise(xs[i], y, z);
+    }
+}
+
+static void noise4SpanBest(const SimplexNoise& noise, const float* xs, float y, float z, float w, float* out, size_t count) {
+    size_t i = 0;
+    switch (SimplexNoise::getBatchPath()) {
+    case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::noise4Span(noise.tables(), xs, y, z, w, out, count); break;
+    case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::noise4Span(noise.tables(), xs, y, z, w, out, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise.noise(xs[i], y, z, w);
+    }
+}
+
+/**
+ * Batch 2D Perlin simplex noise of arbitrary sample points
+ *
+ * @param[in]  xs     x float coordinates
+ * @param[in]  ys     y float coordinates
+ * @param[out] out    count noise values, out[i] = noise(xs[i], ys[i])
+ * @param[in]  count  number of samples
+ */
+void SimplexNoise::noisePoints(const float* xs, const float* ys, float* out, size_t count) const {
+    size_t i = 0;
+    switch (getBatchPath()) {
+    case BatchPath::AVX2:  i = SimplexNoiseAVX2::noise2Points(*mTables, xs, ys, out, count); break;
+    case BatchPath::SSE41: i = SimplexNoiseSSE41::noise2Points(*mTables, xs, ys, out, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise(xs[i], ys[i]);
+    }
+}
+
+/**
+ * Batch 3D Perlin simplex noise of arbitrary sample points
+ *
+ * @param[in]  xs     x float coordinates
+ * @param[in]  ys     y float coordinates
+ * @param[in]  zs     z float coordinates
+ * @param[out] out    count noise values, out[i] = noise(xs[i], ys[i], zs[i])
+ * @param[in]  count  number of samples
+ */
+void SimplexNoise::noisePoints(const float* xs, const float* ys, const float* zs, float* out, size_t count) const {
+    size_t i = 0;
+    switch (getBatchPath()) {
+    case BatchPath::AVX2:  i = SimplexNoiseAVX2::noise3Points(*mTables, xs, ys, zs, out, count); break;
+    case BatchPath::SSE41: i = SimplexNoiseSSE41::noise3Points(*mTables, xs, ys, zs, out, count); break;
+    default: break;
+    }
+    for (; i < count; i++) {
+        out[i] = noise(xs[i], ys[i], zs[i]);
+    }
+}
+
+/**
+ * Number of samples processed at once by the batch functions (fits the working set in L1)
+ */
+static const size_t kBatchBlock = 256;
+
+/**
+ * Fills xs[i] = x0 + (first + i) * dx, the sample coordinates of a block of a row
+ */
+static inline void rowCoordinates(float x0, float dx, size_t first, float* xs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = x0 + static_cast<float>(first + i) * dx;
+    }
+}
+
+/**
+ * Batch 2D Perlin simplex noise of a row of samples
+ *
+ * @param[in]  x0     x float coordinate of the first sample
+ * @param[in]  dx     x step between two samples
+ * @param[in]  y      y float coordinate of the row
+ * @param[out] out    count noise values, out[i] = noise(x0 + i * dx, y)
+ * @param[in]  count  number of samples
+ */
+void SimplexNoise::noiseRow(float x0, float dx, float y, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        noise2SpanBest(*this, xs, y, out + first, n);
+    }
+}
+
+/**
+ * Batch 3D Perlin simplex noise of a row of samples
+ *
+ * @param[in]  x0     x float coordinate of the first sample
+ * @param[in]  dx     x step between two samples
+ * @param[in]  y      y float coordinate of the row
+ * @param[in]  z      z float coordinate of the row
+ * @param[out] out    count noise values, out[i] = noise(x0 + i * dx, y, z)
+ * @param[in]  count  number of samples
+ */
+void SimplexNoise::noiseRow(float x0, float dx, float y, float z, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        noise3SpanBest(*this, xs, y, z, out + first, n);
+    }
+}
+
+/**
+ * Batch 4D Perlin simplex noise of a row of samples
+ *
+ * @param[in]  x0     x float coordinate of the first sample
+ * @param[in]  dx     x step between two samples
+ * @param[in]  y      y float coordinate of the row
+ * @param[in]  z      z float coordinate of the row
+ * @param[in]  w      w float coordinate of the row
+ * @param[out] out    count noise values, out[i] = noise(x0 + i * dx, y, z, w)
+ * @param[in]  count  number of samples
+ */
+void SimplexNoise::noiseRow(float x0, float dx, float y, float z, float w, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        noise4SpanBest(*this, xs, y, z, w, out + first, n);
+    }
+}
+
+/**
+ * Accumulates output[i] += amplitude * octave[i] (same operation order as fractal())
+ */
+static inline void accumulateOctave(float* output, const float* octave, float amplitude, size_t count) {
+    size_t i = 0;
+    const __m128 a = _mm_set1_ps(amplitude);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(a, _mm_loadu_ps(octave + i))));
+    }
+    for (; i < count; i++) {
+        output[i] += (amplitude * octave[i]);
+    }
+}
+
+/**
+ * Divides output[i] by the sum of the octave amplitudes
+ */
+static inline void normaliseOctaves(float* output, float denom, size_t count) {
+    size_t i = 0;
+    const __m128 d = _mm_set1_ps(denom);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(output + i, _mm_div_ps(_mm_loadu_ps(output + i), d));
+    }
+    for (; i < count; i++) {
+        output[i] = (output[i] / denom);
+    }
+}
+
+/**
+ * Batch fractal/fBm summation of 2D Perlin Simplex noise over a row of samples
+ *
+ * @param[in]  octaves  number of fraction of noise to sum
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, x0 + i * dx, y)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, float x0, float dx, float y, float* out, size_t count) const {
+    const BandLimit all = { octaves, 1.f };
+    fractalRow(octaves, all, x0, dx, y, out, count);
+}
+
+/**
+ * Band-limited batch fractal/fBm summation of 2D Perlin Simplex noise over a row of samples
+ *
+ * Only limit.evaluated octaves are evaluated (see fractal() with a BandLimit).
+ *
+ * @param[in]  octaves  number of fraction of noise requested
+ * @param[in]  limit    octaves to evaluate (see bandLimit())
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, limit, x0 + i * dx, ...)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+    float octave[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        float* output = out + first;
+        rowCoordinates(x0, dx, first, xs, n);
+        for (size_t i = 0; i < n; i++) {
+            output[i] = 0.f;
+        }
+
+        float denom     = 0.f;
+        float frequency = mFrequency;
+        float amplitude = mAmplitude;
+        for (size_t o = 0; o < octaves; o++) {
+            if (o < limit.evaluated) {
+                for (size_t i = 0; i < n; i++) {
+                    xf[i] = xs[i] * frequency;
+                }
+                noise2SpanBest(*this, xf, y * frequency, octave, n);
+                accumulateOctave(output, octave, (o + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude, n);
+            }
+            denom += amplitude;
+
+            frequency *= mLacunarity;
+            amplitude *= mPersistence;
+        }
+        normaliseOctaves(output, denom, n);
+    }
+}
+
+/**
+ * Band-limited batch fBm of 2D Perlin Simplex noise over a row of samples, with its analytic gradient
+ *
+ * The values are the same as fractalRow() with the same limit, the derivatives are along the noise
+ * coordinates (multiply by dx to get them per sample). Each octave gives its values and gradient in one pass
+ * of the batch kernels.
+ *
+ * @param[in]  octaves  number of fraction of noise requested
+ * @param[in]  limit    octaves to evaluate (see bandLimit())
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[out] out      count noise values
+ * @param[out] outDx    count derivatives along x
+ * @param[out] outDy    count derivatives along y
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRowDeriv(size_t octaves, const BandLimit& limit, float x0, float dx, float y,
+                                   float* out, float* outDx, float* outDy, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+    float octave[kBatchBlock];
+    float octaveDx[kBatchBlock];
+    float octaveDy[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        for (size_t i = 0; i < n; i++) {
+            out[first + i] = outDx[first + i] = outDy[first + i] = 0.f;
+        }
+
+        float denom     = 0.f;
+        float frequency = mFrequency;
+        float amplitude = mAmplitude;
+        for (size_t o = 0; o < octaves; o++) {
+            if (o < limit.evaluated) {
+                for (size_t i = 0; i < n; i++) {
+                    xf[i] = xs[i] * frequency;
+                }
+                noise2DerivSpanBest(*this, xf, y * frequency, octave, octaveDx, octaveDy, n);
+                const float weight = (o + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude;
+                accumulateOctave(out + first, octave, weight, n);
+                accumulateOctave(outDx + first, octaveDx, weight * frequency, n);
+                accumulateOctave(outDy + first, octaveDy, weight * frequency, n);
+            }
+            denom += amplitude;
+
+            frequency *= mLacunarity;
+            amplitude *= mPersistence;
+        }
+        normaliseOctaves(out + first, denom, n);
+        normaliseOctaves(outDx + first, denom, n);
+        normaliseOctaves(outDy + first, denom, n);
+    }
+}
+
+/**
+ * Raw 2D Perlin Simplex noise and analytic gradient of every octave of a row of samples
+ *
+ * The derivative layers are already multiplied by the octave frequency, so fractalFromOctaves() on them
+ * gives the derivatives of the fBm along the noise coordinates.
+ *
+ * @param[in]  octaves      number of octaves to evaluate
+ * @param[in]  x0           x float coordinate of the first sample
+ * @param[in]  dx           x step between two samples
+ * @param[in]  y            y float coordinate of the row
+ * @param[out] layers       octave values, the row of octave o starting at layers + o * layerStride
+ * @param[out] layersDx     octave derivatives along x (same layout)
+ * @param[out] layersDy     octave derivatives along y (same layout)
+ * @param[in]  layerStride  number of floats between the rows of two successive octaves
+ * @param[in]  count        number of samples
+ */
+void SimplexNoise::octaveRowsDeriv(size_t octaves, float x0, float dx, float y, float* layers, float* layersDx, float* layersDy,
+                                   size_t layerStride, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+
+        float frequency = mFrequency;
+        for (size_t o = 0; o < octaves; o++) {
+            const size_t offset = o * layerStride + first;
+            for (size_t i = 0; i < n; i++) {
+                xf[i] = xs[i] * frequency;
+            }
+            noise2DerivSpanBest(*this, xf, y * frequency, layers + offset, layersDx + offset, layersDy + offset, n);
+            for (size_t i = 0; i < n; i++) {
+                layersDx[offset + i] *= frequency;
+                layersDy[offset + i] *= frequency;
+            }
+
+            frequency *= mLacunarity;
+        }
+    }
+}
+
+/**
+ * Raw 2D Perlin Simplex noise of every octave of a row of samples (no amplitude weighting)
+ *
+ * @param[in]  octaves      number of octaves to evaluate
+ * @param[in]  x0           x float coordinate of the first sample
+ * @param[in]  dx           x step between two samples
+ * @param[in]  y            y float coordinate of the row
+ * @param[out] layers       octaves rows of count noise values, the row of octave o starting at layers + o * layerStride
+ * @param[in]  layerStride  number of floats between the rows of two successive octaves
+ * @param[in]  count        number of samples
+ */
+void SimplexNoise::octaveRows(size_t octaves, float x0, float dx, float y, float* layers, size_t layerStride, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+
+        float frequency = mFrequency;
+        for (size_t o = 0; o < octaves; o++) {
+            for (size_t i = 0; i < n; i++) {
+                xf[i] = xs[i] * frequency;
+            }
+            noise2SpanBest(*this, xf, y * frequency, layers + o * layerStride + first, n);
+
+            frequency *= mLacunarity;
+        }
+    }
+}
+
+/**
+ * Fractal/fBm summation of a row from its per-octave noise (as filled by octaveRows())
+ *
+ * @param[in]  octaves      number of octaves to sum
+ * @param[in]  layers       octaves rows of count noise values, the row of octave o starting at layers + o * layerStride
+ * @param[in]  layerStride  number of floats between the rows of two successive octaves
+ * @param[out] out          count noise values, the same as fractalRow() over the same samples
+ * @param[in]  count        number of samples
+ */
+void SimplexNoise::fractalFromOctaves(size_t octaves, const float* layers, size_t layerStride, float* out, size_t count) const {
+    const BandLimit all = { octaves, 1.f };
+    fractalFromOctaves(octaves, all, layers, layerStride, out, count);
+}
+
+/**
+ * Band-limited fractal/fBm summation of a row from its per-octave noise (only limit.evaluated layers are read)
+ *
+ * @param[in]  octaves      number of octaves requested
+ * @param[in]  limit        octaves to sum (see bandLimit())
+ * @param[in]  layers       limit.evaluated rows of count noise values, the row of octave o starting at layers + o * layerStride
+ * @param[in]  layerStride  number of floats between the rows of two successive octaves
+ * @param[out] out          count noise values, the same as fractalRow() with the same limit
+ * @param[in]  count        number of samples
+ */
+void SimplexNoise::fractalFromOctaves(size_t octaves, const BandLimit& limit, const float* layers, size_t layerStride, float* out, size_t count) const {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = 0.f;
+    }
+
+    float denom     = 0.f;
+    float amplitude = mAmplitude;
+    for (size_t o = 0; o < octaves; o++) {
+        if (o < limit.evaluated) {
+            accumulateOctave(out, layers + o * layerStride, (o + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude, count);
+        }
+        denom += amplitude;
+
+        amplitude *= mPersistence;
+    }
+    normaliseOctaves(out, denom, count);
+}
+
+/**
+ * Batch fractal/fBm summation of 3D Perlin Simplex noise over a row of samples
+ *
+ * @param[in]  octaves  number of fraction of noise to sum
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[in]  z        z float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, x0 + i * dx, y, z)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, float x0, float dx, float y, float z, float* out, size_t count) const {
+    const BandLimit all = { octaves, 1.f };
+    fractalRow(octaves, all, x0, dx, y, z, out, count);
+}
+
+/**
+ * Band-limited batch fractal/fBm summation of 3D Perlin Simplex noise over a row of samples
+ *
+ * Only limit.evaluated octaves are evaluated (see fractal() with a BandLimit).
+ *
+ * @param[in]  octaves  number of fraction of noise requested
+ * @param[in]  limit    octaves to evaluate (see bandLimit())
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[in]  z        z float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, limit, x0 + i * dx, ...)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float z, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+    float octave[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        float* output = out + first;
+        rowCoordinates(x0, dx, first, xs, n);
+        for (size_t i = 0; i < n; i++) {
+            output[i] = 0.f;
+        }
+
+        float denom     = 0.f;
+        float frequency = mFrequency;
+        float amplitude = mAmplitude;
+        for (size_t o = 0; o < octaves; o++) {
+            if (o < limit.evaluated) {
+                for (size_t i = 0; i < n; i++) {
+                    xf[i] = xs[i] * frequency;
+                }
+                noise3SpanBest(*this, xf, y * frequency, z * frequency, octave, n);
+                accumulateOctave(output, octave, (o + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude, n);
+            }
+            denom += amplitude;
+
+            frequency *= mLacunarity;
+            amplitude *= mPersistence;
+        }
+        normaliseOctaves(output, denom, n);
+    }
+}
+
+/**
+ * Batch fractal/fBm summation of 4D Perlin Simplex noise over a row of samples
+ *
+ * @param[in]  octaves  number of fraction of noise to sum
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[in]  z        z float coordinate of the row
+ * @param[in]  w        w float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, x0 + i * dx, y, z, w)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, float x0, float dx, float y, float z, float w, float* out, size_t count) const {
+    const BandLimit all = { octaves, 1.f };
+    fractalRow(octaves, all, x0, dx, y, z, w, out, count);
+}
+
+/**
+ * Band-limited batch fractal/fBm summation of 4D Perlin Simplex noise over a row of samples
+ *
+ * Only limit.evaluated octaves are evaluated (see fractal() with a BandLimit).
+ *
+ * @param[in]  octaves  number of fraction of noise requested
+ * @param[in]  limit    octaves to evaluate (see bandLimit())
+ * @param[in]  x0       x float coordinate of the first sample
+ * @param[in]  dx       x step between two samples
+ * @param[in]  y        y float coordinate of the row
+ * @param[in]  z        z float coordinate of the row
+ * @param[in]  w        w float coordinate of the row
+ * @param[out] out      count noise values, out[i] = fractal(octaves, limit, x0 + i * dx, ...)
+ * @param[in]  count    number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float z, float w, float* out, size_t count) const {
+    float xs[kBatchBlock];
+    float xf[kBatchBlock];
+    float octave[kBatchBlock];
+
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        float* output = out + first;
+        rowCoordinates(x0, dx, first, xs, n);
+        for (size_t i = 0; i < n; i++) {
+            output[i] = 0.f;
+        }
+
+        float denom     = 0.f;
+        float frequency = mFrequency;
+        float amplitude = mAmplitude;
+        for (size_t o = 0; o < octaves; o++) {
+            if (o < limit.evaluated) {
+                for (size_t i = 0; i < n; i++) {
+                    xf[i] = xs[i] * frequency;
+                }
+                noise4SpanBest(*this, xf, y * frequency, z * frequency, w * frequency, octave, n);
+                accumulateOctave(output, octave, (o + 1 == limit.evaluated) ? amplitude * limit.lastWeight : amplitude, n);
+            }
+            denom += amplitude;
+
+            frequency *= mLacunarity;
+            amplitude *= mPersistence;
+        }
+        normaliseOctaves(output, denom, n);
+    }
+}
+
+/**
+ * Scalar versions of the unrolled fBm, for the tail of a row and for CPUs without SSE4.1
+ */
+template <size_t Octaves, size_t... O>
+static inline float fractal2Scalar(const SimplexNoise& noise, float x, float y, float frequency, std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 2> K;
+    float output = 0.f;
+    ((output += (K::weight(O) * noise.noise(x * (frequency * K::frequencyScale(O)), y * (frequency * K::frequencyScale(O))))), ...);
+    return output * K::normalisation();
+}
+
+template <size_t Octaves, size_t... O>
+static inline float fractal2DerivScalar(const SimplexNoise& noise, float x, float y, float frequency, float& dx, float& dy,
+                                        std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 2> K;
+    float output = 0.f;
+    dx = dy = 0.f;
+    float nx, ny;
+    ((output += (K::weight(O) * noise.noiseDeriv(x * (frequency * K::frequencyScale(O)), y * (frequency * K::frequencyScale(O)), nx, ny)),
+      dx += ((K::weight(O) * (frequency * K::frequencyScale(O))) * nx),
+      dy += ((K::weight(O) * (frequency * K::frequencyScale(O))) * ny)), ...);
+    dx *= K::normalisation();
+    dy *= K::normalisation();
+    return output * K::normalisation();
+}
+
+template <size_t Octaves, size_t... O>
+static inline float fractal3Scalar(const SimplexNoise& noise, float x, float y, float z, float frequency, std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 3> K;
+    float output = 0.f;
+    ((output += (K::weight(O) * noise.noise(x * (frequency * K::frequencyScale(O)), y * (frequency * K::frequencyScale(O)),
+                                            z * (frequency * K::frequencyScale(O))))), ...);
+    return output * K::normalisation();
+}
+
+/**
+ * Compile-time specialised fBm summation of 2D Perlin Simplex noise over a row of samples
+ *
+ * @param[in]  noise      noise instance (frequency of the first octave and seed)
+ * @param[in]  x0         x float coordinate of the first sample
+ * @param[in]  dx         x step between two samples
+ * @param[in]  y          y float coordinate of the row
+ * @param[out] out        count noise values, out[i] = noise.fractal(Octaves, x0 + i * dx, y)
+ * @param[in]  count      number of samples
+ */
+template <size_t Octaves, size_t Dim>
+void Fractal<Octaves, Dim>::row(const SimplexNoise& noise, float x0, float dx, float y, float* out, size_t count) {
+    const float frequency = noise.mFrequency;
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        size_t i = 0;
+        switch (SimplexNoise::getBatchPath()) {
+        case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::fractal2Span<Octaves>(noise.tables(), xs, y, frequency, out + first, n); break;
+        case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::fractal2Span<Octaves>(noise.tables(), xs, y, frequency, out + first, n); break;
+        default: break;
+        }
+        for (; i < n; i++) {
+            out[first + i] = fractal2Scalar<Octaves>(noise, xs[i], y, frequency, std::make_index_sequence<Octaves>());
+        }
+    }
+}
+
+/**
+ * Compile-time specialised fBm summation of 2D Perlin Simplex noise over a row of samples, with its analytic gradient
+ *
+ * The values are the same as row(), the derivatives are along the noise coordinates (multiply by dx to get them per sample).
+ *
+ * @param[in]  noise      noise instance (frequency of the first octave and seed)
+ * @param[in]  x0         x float coordinate of the first sample
+ * @param[in]  dx         x step between two samples
+ * @param[in]  y          y float coordinate of the row
+ * @param[out] out        count noise values
+ * @param[out] outDx      count derivatives along x
+ * @param[out] outDy      count derivatives along y
+ * @param[in]  count      number of samples
+ */
+template <size_t Octaves, size_t Dim>
+void Fractal<Octaves, Dim>::rowDeriv(const SimplexNoise& noise, float x0, float dx, float y, float* out, float* outDx, float* outDy, size_t count) {
+    const float frequency = noise.mFrequency;
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        size_t i = 0;
+        switch (SimplexNoise::getBatchPath()) {
+        case SimplexNoise::BatchPath::AVX2:
+            i = SimplexNoiseAVX2::fractal2DerivSpan<Octaves>(noise.tables(), xs, y, frequency, out + first, outDx + first, outDy + first, n);
+            break;
+        case SimplexNoise::BatchPath::SSE41:
+            i = SimplexNoiseSSE41::fractal2DerivSpan<Octaves>(noise.tables(), xs, y, frequency, out + first, outDx + first, outDy + first, n);
+            break;
+        default: break;
+        }
+        for (; i < n; i++) {
+            out[first + i] = fractal2DerivScalar<Octaves>(noise, xs[i], y, frequency, outDx[first + i], outDy[first + i],
+                                                          std::make_index_sequence<Octaves>());
+        }
+    }
+}
+
+/**
+ * Compile-time specialised fBm summation of 3D Perlin Simplex noise over a row of samples
+ *
+ * @param[in]  noise      noise instance (frequency of the first octave and seed)
+ * @param[in]  x0         x float coordinate of the first sample
+ * @param[in]  dx         x step between two samples
+ * @param[in]  y          y float coordinate of the row
+ * @param[in]  z          z float coordinate of the row
+ * @param[out] out        count noise values, out[i] = noise.fractal(Octaves, x0 + i * dx, y, z)
+ * @param[in]  count      number of samples
+ */
+template <size_t Octaves, size_t Dim>
+void Fractal<Octaves, Dim>::row(const SimplexNoise& noise, float x0, float dx, float y, float z, float* out, size_t count) {
+    const float frequency = noise.mFrequency;
+    float xs[kBatchBlock];
+    for (size_t first = 0; first < count; first += kBatchBlock) {
+        const size_t n = (count - first < kBatchBlock) ? (count - first) : kBatchBlock;
+        rowCoordinates(x0, dx, first, xs, n);
+        size_t i = 0;
+        switch (SimplexNoise::getBatchPath()) {
+        case SimplexNoise::BatchPath::AVX2:  i = SimplexNoiseAVX2::fractal3Span<Octaves>(noise.tables(), xs, y, z, frequency, out + first, n); break;
+        case SimplexNoise::BatchPath::SSE41: i = SimplexNoiseSSE41::fractal3Span<Octaves>(noise.tables(), xs, y, z, frequency, out + first, n); break;
+        default: break;
+        }
+        for (; i < n; i++) {
+            out[first + i] = fractal3Scalar<Octaves>(noise, xs[i], y, z, frequency, std::make_index_sequence<Octaves>());
+        }
+    }
+}
+
+// Configurations used by PerlinNoiseTexture (15-octave height map, 10-octave density volume)
+template void Fractal<15, 2>::row(const SimplexNoise&, float, float, float, float*, size_t);
+template void Fractal<15, 2>::rowDeriv(const SimplexNoise&, float, float, float, float*, float*, float*, size_t);
+template void Fractal<10, 3>::row(const SimplexNoise&, float, float, float, float, float*, size_t);
+
+/**
+ * Runs rows(begin, end) over [0, count) in blocks on pool, or at once on the calling thread without a pool.
+ */
+static void benchmarkFor(ThreadPool* pool, int count, int blockSize, const ThreadPool::Task& rows) {
+    if (pool) {
+        pool->ParallelFor(count, blockSize, rows);
+    } else {
+        rows(0, count);
+    }
+}
+
+static float elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/**
+ * Both kernels evaluate the gradients as well, as the height map generation does (only the values are compared).
+ */
+SimplexNoise::FractalBenchmark SimplexNoise::benchmarkFractal2D(int size, float frequency, float spacing, ThreadPool* pool) {
+    const size_t octaves = 15;
+    const size_t plane = (size_t)size * size;
+    std::vector<float> runtime(plane), specialised(plane), gradients(2 * plane);
+    const BandLimit all = { octaves, 1.0f };
+    const SimplexNoise noise(frequency != 0.0f ? frequency : 0.001f);
+    FractalBenchmark result;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            const size_t row = (size_t)y * size;
+            noise.fractalRowDeriv(octaves, all, 0.0f, spacing, y * spacing, &runtime[row], &gradients[row], &gradients[plane + row], size);
+        }
+    });
+    result.runtimeTime = elapsedMs(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            const size_t row = (size_t)y * size;
+            Fractal<octaves, 2>::rowDeriv(noise, 0.0f, spacing, y * spacing, &specialised[row], &gradients[row], &gradients[plane + row], size);
+        }
+    });
+    result.specialisedTime = elapsedMs(start);
+
+    result.maxUlp = maxUlpDistance(runtime.data(), specialised.data(), plane);
+    return result;
+}
+
+SimplexNoise::FractalBenchmark SimplexNoise::benchmarkFractal3D(int size, float frequency, float spacing, ThreadPool* pool) {
+    const size_t octaves = 10;
+    const size_t volume = (size_t)size * size * size;
+    std::vector<float> runtime(volume), specialised(volume);
+    const SimplexNoise noise(frequency != 0.0f ? frequency : 0.001f);
+    FractalBenchmark result;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 2, [&](int firstSlice, int lastSlice) {
+        for (int z = firstSlice; z < lastSlice; z++) {
+            for (int y = 0; y < size; y++) {
+                noise.fractalRow(octaves, 0.0f, spacing, y * spacing, z * spacing, &runtime[((size_t)z * size + y) * size], size);
+            }
+        }
+    });
+    result.runtimeTime = elapsedMs(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 2, [&](int firstSlice, int lastSlice) {
+        for (int z = firstSlice; z < lastSlice; z++) {
+            for (int y = 0; y < size; y++) {
+                Fractal<octaves, 3>::row(noise, 0.0f, spacing, y * spacing, z * spacing, &specialised[((size_t)z * size + y) * size], size);
+            }
+        }
+    });
+    result.specialisedTime = elapsedMs(start);
+
+    result.maxUlp = maxUlpDistance(runtime.data(), specialised.data(), volume);
+    return result;
+}
+
+/**
+ * The single octave noise samples the grid at the frequency of the first fBm octave. Every path and the per-sample
+ * loop run with the same rows per block on pool, so the rates only differ by the evaluation of the samples.
+ */
+SimplexNoise::BatchBenchmark SimplexNoise::benchmarkBatchPaths(int size, float frequency, size_t octaves, float spacing, ThreadPool* pool) {
+    const size_t plane = (size_t)size * size;
+    const SimplexNoise noise(frequency != 0.0f ? frequency : 0.001f);
+    const float noiseSpacing = spacing * noise.mFrequency;
+    std::vector<float> noiseReference(plane), fractalReference(plane), batch(plane);
+    BatchBenchmark result = {};
+    result.identical = true;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            float* out = &noiseReference[(size_t)y * size];
+            for (int x = 0; x < size; x++) out[x] = noise.noise(static_cast<float>(x) * noiseSpacing, y * noiseSpacing);
+        }
+    });
+    result.noiseRate[0] = plane / (elapsedMs(start) * 0.001f);
+
+    start = std::chrono::high_resolution_clock::now();
+    benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            float* out = &fractalReference[(size_t)y * size];
+            for (int x = 0; x < size; x++) out[x] = noise.fractal(octaves, static_cast<float>(x) * spacing, y * spacing);
+        }
+    });
+    result.fractalRate[0] = plane / (elapsedMs(start) * 0.001f);
+
+    const BatchPath previous = getBatchPath();
+    const BatchPath paths[3] = { BatchPath::Scalar, BatchPath::SSE41, BatchPath::AVX2 };
+    for (int p = 0; p < 3; p++) {
+        if (static_cast<int>(paths[p]) > static_cast<int>(detectBatchPath())) continue;
+        setBatchPath(paths[p]);
+
+        start = std::chrono::high_resolution_clock::now();
+        benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++) {
+                noise.noiseRow(0.0f, noiseSpacing, y * noiseSpacing, &batch[(size_t)y * size], size);
+            }
+        });
+        result.noiseRate[p + 1] = plane / (elapsedMs(start) * 0.001f);
+        result.identical = result.identical && maxUlpDistance(noiseReference.data(), batch.data(), plane) == 0;
+
+        start = std::chrono::high_resolution_clock::now();
+        benchmarkFor(pool, size, 16, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++) {
+                noise.fractalRow(octaves, 0.0f, spacing, y * spacing, &batch[(size_t)y * size], size);
+            }
+        });
+        result.fractalRate[p + 1] = plane / (elapsedMs(start) * 0.001f);
+        result.identical = result.identical && maxUlpDistance(fractalReference.data(), batch.data(), plane) == 0;
+    }
+    setBatchPath(previous);
+    return result;
+}
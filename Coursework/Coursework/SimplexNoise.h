@@ -1,6 +1,6 @@
 /**
  * @file    SimplexNoise.h
- * @brief   A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D).
+ * @brief   A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
  *
  * Copyright (c) 2014-2018 Sebastien Rombauts (sebastien.rombauts@gmail.com)
  *
@@ -11,46 +11,229 @@
 
 //#include "pch.h"
 #include <cstddef>  // size_t
+#include <cstdint>  // uint32_t
+#include <memory>   // std::shared_ptr
+
+class ThreadPool;
 
 /**
  * @brief A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
+ *
+ * Every instance hashes the lattice with the permutation of its seed, so instances with different seeds
+ * are different worlds. Seed 0 is the reference permutation of Ken Perlin. The tables of a seed are
+ * read-only once built, so instances can be used (and copied) from several threads at once.
  */
 class SimplexNoise {
 public:
+    /**
+     * Permutation and gradient tables of a seed (defined in SimplexNoise.cpp).
+     *
+     * The permutation is stored twice (512 entries), so the nested corner hashes need no wrap-around masking
+     * beyond the one of the lattice coordinates, and the gradient tables hold the same permutation already
+     * reduced to the gradient index bits of each dimension.
+     */
+    struct Tables;
+
     // 1D Perlin simplex noise
-    static float noise(float x);
+    float noise(float x) const;
     // 2D Perlin simplex noise
-    static float noise(float x, float y);
+    float noise(float x, float y) const;
     // 3D Perlin simplex noise
-    static float noise(float x, float y, float z);
+    float noise(float x, float y, float z) const;
+    // 4D Perlin simplex noise
+    float noise(float x, float y, float z, float w) const;
+
+    // 2D and 3D Perlin simplex noise with its analytic gradient (same value as noise())
+    float noiseDeriv(float x, float y, float& dx, float& dy) const;
+    float noiseDeriv(float x, float y, float z, float& dx, float& dy, float& dz) const;
 
     // Fractal/Fractional Brownian Motion (fBm) noise summation
     float fractal(size_t octaves, float x) const;
     float fractal(size_t octaves, float x, float y) const;
     float fractal(size_t octaves, float x, float y, float z) const;
+    float fractal(size_t octaves, float x, float y, float z, float w) const;
+
+    /**
+     * Band-limited fBm: only the octaves whose frequency stays below the Nyquist limit of the sample spacing
+     * are evaluated (the last one optionally faded out), the skipped ones still count in the normalisation.
+     */
+    struct BandLimit {
+        size_t evaluated;   ///< Number of octaves evaluated (the lowest ones)
+        float  lastWeight;  ///< Weight of the last evaluated octave (1 without fade)
+    };
+    BandLimit bandLimit(size_t octaves, float spacing, bool fade = true) const;
+    float fractal(size_t octaves, const BandLimit& limit, float x, float y) const;
+    float fractal(size_t octaves, const BandLimit& limit, float x, float y, float z) const;
+    float fractal(size_t octaves, const BandLimit& limit, float x, float y, float z, float w) const;
+
+    // Band-limited fBm with its analytic gradient (the octave derivatives are accumulated with the values)
+    float fractalDeriv(size_t octaves, const BandLimit& limit, float x, float y, float& dx, float& dy) const;
+    float fractalDeriv(size_t octaves, const BandLimit& limit, float x, float y, float z, float& dx, float& dy, float& dz) const;
+
+    /**
+     * Batch evaluation of a row of samples, out[i] = noise(x0 + i * dx, ...).
+     *
+     * The rows are evaluated 8 (AVX2) or 4 (SSE4.1) samples at a time, with a scalar
+     * fallback for the remaining samples and for CPUs without those extensions.
+     * Every path produces results bit-identical to the scalar functions above.
+     */
+    void noiseRow(float x0, float dx, float y, float* out, size_t count) const;
+    void noiseRow(float x0, float dx, float y, float z, float* out, size_t count) const;
+    void noiseRow(float x0, float dx, float y, float z, float w, float* out, size_t count) const;
+
+    // Batch evaluation of arbitrary sample points, out[i] = noise(xs[i], ys[i][, zs[i]]) (same paths as noiseRow())
+    void noisePoints(const float* xs, const float* ys, float* out, size_t count) const;
+    void noisePoints(const float* xs, const float* ys, const float* zs, float* out, size_t count) const;
+
+    // Batch fractal/fBm summation of a row of samples, out[i] = fractal(octaves, x0 + i * dx, ...)
+    void fractalRow(size_t octaves, float x0, float dx, float y, float* out, size_t count) const;
+    void fractalRow(size_t octaves, float x0, float dx, float y, float z, float* out, size_t count) const;
+    void fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float* out, size_t count) const;
+    void fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float z, float* out, size_t count) const;
+    void fractalRow(size_t octaves, float x0, float dx, float y, float z, float w, float* out, size_t count) const;
+    void fractalRow(size_t octaves, const BandLimit& limit, float x0, float dx, float y, float z, float w, float* out, size_t count) const;
+
+    // Batch fBm of a row of samples with its analytic gradient along the noise coordinates (values as fractalRow())
+    void fractalRowDeriv(size_t octaves, const BandLimit& limit, float x0, float dx, float y,
+                         float* out, float* outDx, float* outDy, size_t count) const;
+
+    /**
+     * Per-octave batch evaluation, layers[o * layerStride + i] = raw noise of octave o at x0 + i * dx.
+     *
+     * fractalFromOctaves() re-weights the layers with the amplitude/persistence of this instance,
+     * bit-identical to fractalRow() with the same frequency and lacunarity.
+     */
+    void octaveRows(size_t octaves, float x0, float dx, float y, float* layers, size_t layerStride, size_t count) const;
+    void octaveRowsDeriv(size_t octaves, float x0, float dx, float y, float* layers, float* layersDx, float* layersDy,
+                         size_t layerStride, size_t count) const;
+    void fractalFromOctaves(size_t octaves, const float* layers, size_t layerStride, float* out, size_t count) const;
+    void fractalFromOctaves(size_t octaves, const BandLimit& limit, const float* layers, size_t layerStride, float* out, size_t count) const;
+
+    /// Instruction set used by the batch functions
+    enum class BatchPath {
+        Scalar,
+        SSE41,
+        AVX2
+    };
+
+    // Best instruction set supported by the running CPU (detected once)
+    static BatchPath detectBatchPath();
+    // Instruction set currently used by the batch functions (defaults to detectBatchPath())
+    static BatchPath getBatchPath();
+    // Force an instruction set, clamped to what the CPU supports (used to compare the paths)
+    static void setBatchPath(BatchPath path);
+
+    // Maximum difference (in ULP) between a Fractal row and the matching fractalRow()
+    static const int fractalMaxUlp = 2;
+    // Distance between two floats in units in the last place (0 when bit-identical), and the largest over two buffers
+    static int ulpDistance(float a, float b);
+    static int maxUlpDistance(const float* a, const float* b, size_t count);
+
+    /// Timings (in ms) of the runtime and specialised fBm kernels over the same samples, and their largest difference in ULP
+    struct FractalBenchmark {
+        float runtimeTime;
+        float specialisedTime;
+        int   maxUlp;
+    };
+
+    /**
+     * Compare fractalRowDeriv() with Fractal<15, 2>::rowDeriv() on a size x size grid, and fractalRow() with
+     * Fractal<10, 3>::row() on a size^3 volume, with the given first octave frequency and sample spacing.
+     * The rows are shared out on pool, or evaluated on the calling thread without one.
+     */
+    static FractalBenchmark benchmarkFractal2D(int size, float frequency, float spacing, ThreadPool* pool = nullptr);
+    static FractalBenchmark benchmarkFractal3D(int size, float frequency, float spacing, ThreadPool* pool = nullptr);
+
+    /// Samples per second of the per-sample functions and of the batch rows on each path (0 for a path the CPU lacks)
+    struct BatchBenchmark {
+        float noiseRate[4];    ///< noise() per sample, then noiseRow() on the Scalar, SSE41 and AVX2 paths
+        float fractalRate[4];  ///< fractal() per sample, then fractalRow() on the same paths
+        bool  identical;       ///< every batch path gave the per-sample values bit for bit
+    };
+
+    /**
+     * Compare the per-sample noise() and fractal() loops with noiseRow() and fractalRow() on every batch path,
+     * over the same size x size grid of the given sample spacing (the batch path is restored afterwards).
+     */
+    static BatchBenchmark benchmarkBatchPaths(int size, float frequency, size_t octaves, float spacing, ThreadPool* pool = nullptr);
+
+    // Seed of the permutation of this instance, and its tables (used by the batch kernels)
+    uint32_t getSeed() const { return mSeed; }
+    const Tables& tables() const { return *mTables; }
 
     /**
      * Constructor of to initialize a fractal noise summation
      *
+     * Building the tables of a seed is a shuffle of 256 entries; seed 0 shares one static copy of the reference tables.
+     *
      * @param[in] frequency    Frequency ("width") of the first octave of noise (default to 1.0)
      * @param[in] amplitude    Amplitude ("height") of the first octave of noise (default to 1.0)
      * @param[in] lacunarity   Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
      * @param[in] persistence  Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+     * @param[in] seed         Seed of the permutation (default to 0, the reference permutation)
      */
     explicit SimplexNoise(float frequency = 1.0f,
                           float amplitude = 1.0f,
                           float lacunarity = 2.0f,
-                          float persistence = 0.5f) :
-        mFrequency(frequency),
-        mAmplitude(amplitude),
-        mLacunarity(lacunarity),
-        mPersistence(persistence) {
-    }
+                          float persistence = 0.5f,
+                          uint32_t seed = 0);
 
 private:
+    template <size_t Octaves, size_t Dim> friend class Fractal;
+
     // Parameters of Fractional Brownian Motion (fBm) : sum of N "octaves" of noise
     float mFrequency;   ///< Frequency ("width") of the first octave of noise (default to 1.0)
     float mAmplitude;   ///< Amplitude ("height") of the first octave of noise (default to 1.0)
     float mLacunarity;  ///< Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
     float mPersistence; ///< Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+
+    uint32_t mSeed;                        ///< Seed of the permutation
+    std::shared_ptr<const Tables> mTables; ///< Permutation and gradient tables of the seed (shared by the copies)
+};
+
+/**
+ * @brief Compile-time specialised fBm summation of Octaves octaves of Dim-D simplex noise.
+ *
+ * Uses the SimplexNoise default lacunarity (2) and persistence (0.5), so the octave frequency
+ * multipliers, amplitude weights and normalisation are constexpr, and the octave loop is fully unrolled
+ * inside the SIMD kernels. The result is out[i] = noise.fractal(Octaves, ...) with the frequency and seed of noise,
+ * except the final division is a multiplication by the precomputed normalisation (within SimplexNoise::fractalMaxUlp).
+ * The lacunarity, persistence and amplitude of noise are not used.
+ *
+ * Only the configurations explicitly instantiated in SimplexNoise.cpp are available (15 x 2D, 10 x 3D).
+ */
+template <size_t Octaves, size_t Dim>
+class Fractal {
+public:
+    static_assert(Octaves > 0, "Fractal needs at least one octave");
+    static_assert(Dim == 2 || Dim == 3, "Fractal is only specialised for 2D and 3D noise");
+
+    static constexpr float lacunarity = 2.0f;
+    static constexpr float persistence = 0.5f;
+
+    // Frequency multiplier (lacunarity^octave) and amplitude weight (persistence^octave) of an octave
+    static constexpr float frequencyScale(size_t octave) {
+        float scale = 1.0f;
+        for (size_t o = 0; o < octave; o++) scale *= lacunarity;
+        return scale;
+    }
+    static constexpr float weight(size_t octave) {
+        float amplitude = 1.0f;
+        for (size_t o = 0; o < octave; o++) amplitude *= persistence;
+        return amplitude;
+    }
+
+    // Reciprocal of the sum of the amplitude weights (summed in the same order as fractal())
+    static constexpr float normalisation() {
+        float denom = 0.0f;
+        for (size_t o = 0; o < Octaves; o++) denom += weight(o);
+        return 1.0f / denom;
+    }
+
+    // Batch summation of a row of samples, out[i] = noise.fractal(Octaves, x0 + i * dx, y[, z])
+    static void row(const SimplexNoise& noise, float x0, float dx, float y, float* out, size_t count);
+    static void row(const SimplexNoise& noise, float x0, float dx, float y, float z, float* out, size_t count);
+
+    // Batch summation of a row of 2D samples with the gradient along the noise coordinates (see fractalRowDeriv())
+    static void rowDeriv(const SimplexNoise& noise, float x0, float dx, float y, float* out, float* outDx, float* outDy, size_t count);
 };
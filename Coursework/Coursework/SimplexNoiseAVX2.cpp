@@ -0,0 +1,120 @@
+/**
+ * @file    SimplexNoiseAVX2.cpp
+ * @brief   8-wide AVX2 kernels of the batch simplex noise functions.
+ *
+ * The only translation unit compiled for AVX2: /arch:AVX2 in the project for MSVC, the target pragma below
+ * for GCC and clang, so the rest of the program still runs on CPUs without it. SimplexNoise.cpp only calls in
+ * here when detectBatchPath() found AVX2. FMA is deliberately not enabled: the compiler could then contract
+ * the multiplications and additions of the kernels, which would no longer be bit-identical to the scalar functions.
+ *
+ * Distributed under the MIT License (MIT) (See accompanying file LICENSE.txt
+ * or copy at http://opensource.org/licenses/MIT)
+ */
+#include <cstddef>  // size_t
+#include <cstdint>  // int32_t
+#include <utility>  // std::index_sequence
+#include <immintrin.h>  // AVX2 intrinsics
+#include "SimplexNoiseKernels.h"
+
+// Everything below is compiled for AVX2, the headers above are not (their inline functions are shared with the other translation units)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace {
+
+/**
+ * 8-wide AVX2 lane helpers
+ */
+struct LanesAVX2 {
+    typedef __m256  F;
+    typedef __m256i I;
+    static const size_t width = 8;
+
+    static inline F set1(float v)                 { return _mm256_set1_ps(v); }
+    static inline F load(const float* p)          { return _mm256_loadu_ps(p); }
+    static inline void store(float* p, F v)       { _mm256_storeu_ps(p, v); }
+    static inline F add(F a, F b)                 { return _mm256_add_ps(a, b); }
+    static inline F sub(F a, F b)                 { return _mm256_sub_ps(a, b); }
+    static inline F mul(F a, F b)                 { return _mm256_mul_ps(a, b); }
+    static inline F div(F a, F b)                 { return _mm256_div_ps(a, b); }
+    static inline F bitAnd(F a, F b)              { return _mm256_and_ps(a, b); }
+    static inline F bitXor(F a, F b)              { return _mm256_xor_ps(a, b); }
+    static inline F cmpLt(F a, F b)               { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static inline F cmpGt(F a, F b)               { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline F cmpGe(F a, F b)               { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static inline F select(F mask, F a, F b)      { return _mm256_blendv_ps(b, a, mask); }
+    static inline I iset1(int32_t v)              { return _mm256_set1_epi32(v); }
+    static inline I iadd(I a, I b)                { return _mm256_add_epi32(a, b); }
+    static inline I iand(I a, I b)                { return _mm256_and_si256(a, b); }
+    static inline I ior(I a, I b)                 { return _mm256_or_si256(a, b); }
+    static inline I iandNot(I a, I b)             { return _mm256_andnot_si256(a, b); } // ~a & b
+    static inline I icmpLt(I a, I b)              { return _mm256_cmpgt_epi32(b, a); }
+    static inline I icmpEq(I a, I b)              { return _mm256_cmpeq_epi32(a, b); }
+    static inline I ishl(I a, int n)              { return _mm256_slli_epi32(a, n); }
+    static inline I truncate(F v)                 { return _mm256_cvttps_epi32(v); }
+    static inline F toFloat(I v)                  { return _mm256_cvtepi32_ps(v); }
+    static inline F asFloat(I v)                  { return _mm256_castsi256_ps(v); }
+    static inline I asInt(F v)                    { return _mm256_castps_si256(v); }
+    static inline I lookup(const int32_t* table, I i) {
+        return _mm256_i32gather_epi32(table, i, 4);
+    }
+};
+
+} // namespace
+
+#include "SimplexNoiseLanes.h"
+
+size_t SimplexNoiseAVX2::noise2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, size_t count) {
+    return noise2SpanLanes<LanesAVX2>(tables, xs, y, out, count);
+}
+
+size_t SimplexNoiseAVX2::noise3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float* out, size_t count) {
+    return noise3SpanLanes<LanesAVX2>(tables, xs, y, z, out, count);
+}
+
+size_t SimplexNoiseAVX2::noise4Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float w, float* out, size_t count) {
+    return noise4SpanLanes<LanesAVX2>(tables, xs, y, z, w, out, count);
+}
+
+size_t SimplexNoiseAVX2::noise2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, float* outDx, float* outDy, size_t count) {
+    return noise2DerivSpanLanes<LanesAVX2>(tables, xs, y, out, outDx, outDy, count);
+}
+
+size_t SimplexNoiseAVX2::noise2Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, float* out, size_t count) {
+    return noise2PointsLanes<LanesAVX2>(tables, xs, ys, out, count);
+}
+
+size_t SimplexNoiseAVX2::noise3Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, const float* zs, float* out, size_t count) {
+    return noise3PointsLanes<LanesAVX2>(tables, xs, ys, zs, out, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseAVX2::fractal2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency, float* out, size_t count) {
+    return fractal2SpanLanes<Octaves, LanesAVX2>(tables, xs, y, frequency, out, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseAVX2::fractal2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency,
+                                         float* out, float* outDx, float* outDy, size_t count) {
+    return fractal2DerivSpanLanes<Octaves, LanesAVX2>(tables, xs, y, frequency, out, outDx, outDy, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseAVX2::fractal3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float frequency, float* out, size_t count) {
+    return fractal3SpanLanes<Octaves, LanesAVX2>(tables, xs, y, z, frequency, out, count);
+}
+
+// Configurations of the Fractal rows instantiated in SimplexNoise.cpp
+template size_t SimplexNoiseAVX2::fractal2Span<15>(const SimplexNoise::Tables&, const float*, float, float, float*, size_t);
+template size_t SimplexNoiseAVX2::fractal2DerivSpan<15>(const SimplexNoise::Tables&, const float*, float, float, float*, float*, float*, size_t);
+template size_t SimplexNoiseAVX2::fractal3Span<10>(const SimplexNoise::Tables&, const float*, float, float, float, float*, size_t);
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file    SimplexNoiseKernels.h
+ * @brief   Tables and SIMD kernels of the batch simplex noise functions (internal to SimplexNoise).
+ *
+ * Each instruction set has its own translation unit, compiled for that instruction set only, so the rest of the
+ * program never runs an AVX2 instruction on a CPU without it: SimplexNoise.cpp calls these kernels after
+ * detectBatchPath(), and evaluates the samples left over by the last whole lane with the scalar functions.
+ * The kernels take the tables rather than the SimplexNoise instance, so they share no inline function
+ * with the other translation units.
+ *
+ * Every kernel evaluates the whole lanes of count samples (count rounded down to the lane width)
+ * and returns the number of samples evaluated.
+ *
+ * Distributed under the MIT License (MIT) (See accompanying file LICENSE.txt
+ * or copy at http://opensource.org/licenses/MIT)
+ */
+#pragma once
+
+#include <cstddef>  // size_t
+#include <cstdint>  // int32_t/uint32_t
+#include "SimplexNoise.h"
+
+/**
+ * Permutation and gradient tables of a seed
+ *
+ * The gradient tables are the permutation reduced to the bits read by grad(), so the last lookup of a corner
+ * directly gives its gradient index.
+ */
+struct SimplexNoise::Tables {
+    int32_t perm[512];   ///< Permutation of the seed, twice
+    int32_t grad2[512];  ///< perm & 0x3F, the gradient index of grad(hash, x, y)
+    int32_t grad3[512];  ///< perm & 15, the gradient index of grad(hash, x, y, z) and grad(hash, x)
+    int32_t grad4[512];  ///< perm & 31, the gradient index of grad(hash, x, y, z, w)
+
+    explicit Tables(uint32_t seed);
+};
+
+/**
+ * 4-wide SSE4.1 kernels (SimplexNoiseSSE41.cpp)
+ */
+namespace SimplexNoiseSSE41 {
+    size_t noise2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, size_t count);
+    size_t noise3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float* out, size_t count);
+    size_t noise4Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float w, float* out, size_t count);
+    size_t noise2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, float* outDx, float* outDy, size_t count);
+    size_t noise2Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, float* out, size_t count);
+    size_t noise3Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, const float* zs, float* out, size_t count);
+    template <size_t Octaves>
+    size_t fractal2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency, float* out, size_t count);
+    template <size_t Octaves>
+    size_t fractal2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency,
+                             float* out, float* outDx, float* outDy, size_t count);
+    template <size_t Octaves>
+    size_t fractal3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float frequency, float* out, size_t count);
+}
+
+/**
+ * 8-wide AVX2 kernels (SimplexNoiseAVX2.cpp)
+ */
+namespace SimplexNoiseAVX2 {
+    size_t noise2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, size_t count);
+    size_t noise3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float* out, size_t count);
+    size_t noise4Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float w, float* out, size_t count);
+    size_t noise2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, float* outDx, float* outDy, size_t count);
+    size_t noise2Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, float* out, size_t count);
+    size_t noise3Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, const float* zs, float* out, size_t count);
+    template <size_t Octaves>
+    size_t fractal2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency, float* out, size_t count);
+    template <size_t Octaves>
+    size_t fractal2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency,
+                             float* out, float* outDx, float* outDy, size_t count);
+    template <size_t Octaves>
+    size_t fractal3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float frequency, float* out, size_t count);
+}
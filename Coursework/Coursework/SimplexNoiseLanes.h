@@ -0,0 +1,559 @@
+/**
+ * @file    SimplexNoiseLanes.h
+ * @brief   Lane-wise simplex noise kernels, generic over the lane helpers L of an instruction set.
+ *
+ * The kernels are a lane-wise transcription of the scalar noise functions of SimplexNoise.cpp:
+ * every arithmetic operation is performed in the same order and with the same precision
+ * (no FMA contraction, no reciprocal approximations), and the branches are replaced by
+ * masks, so each lane is bit-identical to the matching scalar call.
+ *
+ * Only included by the translation unit of an instruction set (SimplexNoiseSSE41.cpp, SimplexNoiseAVX2.cpp),
+ * after its lane helpers and its target selection, so every function here is compiled for that instruction set.
+ * Everything is static (internal linkage), so no copy of these functions can be shared with another translation unit.
+ *
+ * The lane helpers L provide the float (F) and int32 (I) vector types, L::width, and the operations
+ * set1/load/store/add/sub/mul/div/bitAnd/bitXor/cmpLt/cmpGt/cmpGe/select and
+ * iset1/iadd/iand/ior/iandNot/icmpLt/icmpEq/ishl/truncate/toFloat/asFloat/asInt/lookup.
+ *
+ * Distributed under the MIT License (MIT) (See accompanying file LICENSE.txt
+ * or copy at http://opensource.org/licenses/MIT)
+ */
+#pragma once
+
+#include "SimplexNoiseKernels.h"
+
+/**
+ * Lane-wise fastfloor(): truncate, then step down where the truncation rounded up.
+ */
+template <class L>
+static inline typename L::I fastfloorLanes(typename L::F fp) {
+    const typename L::I i = L::truncate(fp);
+    return L::iadd(i, L::asInt(L::cmpLt(fp, L::toFloat(i)))); // mask is -1 where fp < i
+}
+
+/**
+ * Lane-wise sign flip of v where the selected bit of h is set.
+ */
+template <class L>
+static inline typename L::F flipSignLanes(typename L::F v, typename L::I h, int32_t bit, int shift) {
+    return L::bitXor(v, L::asFloat(L::ishl(L::iand(h, L::iset1(bit)), shift)));
+}
+
+/**
+ * Lane-wise grad(hash, x, y)
+ */
+template <class L>
+static inline typename L::F gradLanes(typename L::I hash, typename L::F x, typename L::F y) {
+    const typename L::I h = hash;
+    const typename L::F lt4 = L::asFloat(L::icmpLt(h, L::iset1(4)));
+    const typename L::F u = L::select(lt4, x, y);
+    const typename L::F v = L::select(lt4, y, x);
+    return L::add(flipSignLanes<L>(u, h, 1, 31), flipSignLanes<L>(L::mul(L::set1(2.0f), v), h, 2, 30));
+}
+
+/**
+ * Lane-wise grad(hash, x, y, z)
+ */
+template <class L>
+static inline typename L::F gradLanes(typename L::I hash, typename L::F x, typename L::F y, typename L::F z) {
+    const typename L::I h = hash;
+    const typename L::F lt8 = L::asFloat(L::icmpLt(h, L::iset1(8)));
+    const typename L::F lt4 = L::asFloat(L::icmpLt(h, L::iset1(4)));
+    const typename L::F is12or14 = L::asFloat(L::icmpEq(L::iand(h, L::iset1(13)), L::iset1(12)));
+    const typename L::F u = L::select(lt8, x, y);
+    const typename L::F v = L::select(lt4, y, L::select(is12or14, x, z));
+    return L::add(flipSignLanes<L>(u, h, 1, 31), flipSignLanes<L>(v, h, 2, 30));
+}
+
+/**
+ * Lane-wise grad(hash, x, y, z, w)
+ */
+template <class L>
+static inline typename L::F gradLanes(typename L::I hash, typename L::F x, typename L::F y, typename L::F z, typename L::F w) {
+    const typename L::I h = hash;
+    const typename L::F u = L::select(L::asFloat(L::icmpLt(h, L::iset1(24))), x, y);
+    const typename L::F v = L::select(L::asFloat(L::icmpLt(h, L::iset1(16))), y, z);
+    const typename L::F s = L::select(L::asFloat(L::icmpLt(h, L::iset1(8))), z, w);
+    return L::add(L::add(flipSignLanes<L>(u, h, 1, 31), flipSignLanes<L>(v, h, 2, 30)), flipSignLanes<L>(s, h, 4, 29));
+}
+
+/**
+ * Lane-wise wrap() of lattice coordinates
+ */
+template <class L>
+static inline typename L::I wrapLanes(typename L::I i) {
+    return L::iand(i, L::iset1(0xFF));
+}
+
+/**
+ * Lane-wise corner contribution: t < 0 ? 0 : t^4 * g
+ */
+template <class L>
+static inline typename L::F cornerLanes(typename L::F t, typename L::F g) {
+    const typename L::F t2 = L::mul(t, t);
+    return L::bitAnd(L::cmpGe(t, L::set1(0.0f)), L::mul(L::mul(t2, t2), g));
+}
+
+/**
+ * Corners of the 2D simplices of L::width samples: offsets from each corner and hashed gradient indices
+ */
+template <class L>
+struct Simplex2Lanes {
+    typename L::F x0, y0, x1, y1, x2, y2;
+    typename L::I gi0, gi1, gi2;
+};
+
+/**
+ * Simplex cell, corner offsets and hashes of noise(x, y) for L::width samples
+ */
+template <class L>
+static inline Simplex2Lanes<L> simplex2Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y) {
+    typedef typename L::F F;
+    typedef typename L::I I;
+    static const float F2 = 0.366025403f;
+    static const float G2 = 0.211324865f;
+    Simplex2Lanes<L> c;
+
+    const F s = L::mul(L::add(x, y), L::set1(F2));
+    const I i = fastfloorLanes<L>(L::add(x, s));
+    const I j = fastfloorLanes<L>(L::add(y, s));
+
+    const F t = L::mul(L::toFloat(L::iadd(i, j)), L::set1(G2));
+    c.x0 = L::sub(x, L::sub(L::toFloat(i), t));
+    c.y0 = L::sub(y, L::sub(L::toFloat(j), t));
+
+    // lower triangle where x0 > y0: i1 = 1, j1 = 0, otherwise i1 = 0, j1 = 1
+    const F lower = L::cmpGt(c.x0, c.y0);
+    const I one = L::iset1(1);
+    const I i1 = L::iand(L::asInt(lower), one);
+    const I j1 = L::iandNot(L::asInt(lower), one);
+
+    c.x1 = L::add(L::sub(c.x0, L::toFloat(i1)), L::set1(G2));
+    c.y1 = L::add(L::sub(c.y0, L::toFloat(j1)), L::set1(G2));
+    c.x2 = L::add(L::sub(c.x0, L::set1(1.0f)), L::set1(2.0f * G2));
+    c.y2 = L::add(L::sub(c.y0, L::set1(1.0f)), L::set1(2.0f * G2));
+
+    const I ii = wrapLanes<L>(i);
+    const I jj = wrapLanes<L>(j);
+    c.gi0 = L::lookup(tables.grad2, L::iadd(ii, L::lookup(tables.perm, jj)));
+    c.gi1 = L::lookup(tables.grad2, L::iadd(L::iadd(ii, i1), L::lookup(tables.perm, L::iadd(jj, j1))));
+    c.gi2 = L::lookup(tables.grad2, L::iadd(L::iadd(ii, one), L::lookup(tables.perm, L::iadd(jj, one))));
+    return c;
+}
+
+/**
+ * 2D Perlin simplex noise of L::width samples, at (xs[i], y)
+ */
+template <class L>
+static inline typename L::F noise2Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y) {
+    typedef typename L::F F;
+    const Simplex2Lanes<L> c = simplex2Lanes<L>(tables, x, y);
+
+    const F half = L::set1(0.5f);
+    const F n0 = cornerLanes<L>(L::sub(L::sub(half, L::mul(c.x0, c.x0)), L::mul(c.y0, c.y0)), gradLanes<L>(c.gi0, c.x0, c.y0));
+    const F n1 = cornerLanes<L>(L::sub(L::sub(half, L::mul(c.x1, c.x1)), L::mul(c.y1, c.y1)), gradLanes<L>(c.gi1, c.x1, c.y1));
+    const F n2 = cornerLanes<L>(L::sub(L::sub(half, L::mul(c.x2, c.x2)), L::mul(c.y2, c.y2)), gradLanes<L>(c.gi2, c.x2, c.y2));
+
+    return L::mul(L::set1(45.23065f), L::add(L::add(n0, n1), n2));
+}
+
+/**
+ * Lane-wise gradVector(hash): the gradient of grad(hash, x, y)
+ */
+template <class L>
+static inline void gradVectorLanes(typename L::I hash, typename L::F& gx, typename L::F& gy) {
+    const typename L::F lt4 = L::asFloat(L::icmpLt(hash, L::iset1(4)));
+    const typename L::F su = flipSignLanes<L>(L::set1(1.0f), hash, 1, 31);
+    const typename L::F sv = flipSignLanes<L>(L::set1(2.0f), hash, 2, 30);
+    gx = L::select(lt4, su, sv);
+    gy = L::select(lt4, sv, su);
+}
+
+/**
+ * Lane-wise cornerDeriv(): t < 0 ? 0 : t^4 * g, the derivatives only accumulated where t >= 0
+ * (a select rather than adding a masked zero, which could turn a -0 sum into +0)
+ */
+template <class L>
+static inline typename L::F cornerDerivLanes(typename L::F t, typename L::I gi, typename L::F x, typename L::F y,
+                                             typename L::F& dx, typename L::F& dy) {
+    typedef typename L::F F;
+    const F inside = L::cmpGe(t, L::set1(0.0f));
+    F gx, gy;
+    gradVectorLanes<L>(gi, gx, gy);
+    const F g = gradLanes<L>(gi, x, y);
+    const F t2 = L::mul(t, t);
+    const F t4 = L::mul(t2, t2);
+    const F dt = L::mul(L::mul(L::mul(L::set1(-8.0f), t2), t), g);
+    dx = L::select(inside, L::add(dx, L::add(L::mul(dt, x), L::mul(t4, gx))), dx);
+    dy = L::select(inside, L::add(dy, L::add(L::mul(dt, y), L::mul(t4, gy))), dy);
+    return L::bitAnd(inside, L::mul(t4, g));
+}
+
+/**
+ * 2D Perlin simplex noise of L::width samples with its analytic gradient (noiseDeriv(x, y, dx, dy))
+ */
+template <class L>
+static inline typename L::F noise2DerivLanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y,
+                                             typename L::F& dx, typename L::F& dy) {
+    typedef typename L::F F;
+    const Simplex2Lanes<L> c = simplex2Lanes<L>(tables, x, y);
+
+    dx = dy = L::set1(0.0f);
+    const F half = L::set1(0.5f);
+    const F n0 = cornerDerivLanes<L>(L::sub(L::sub(half, L::mul(c.x0, c.x0)), L::mul(c.y0, c.y0)), c.gi0, c.x0, c.y0, dx, dy);
+    const F n1 = cornerDerivLanes<L>(L::sub(L::sub(half, L::mul(c.x1, c.x1)), L::mul(c.y1, c.y1)), c.gi1, c.x1, c.y1, dx, dy);
+    const F n2 = cornerDerivLanes<L>(L::sub(L::sub(half, L::mul(c.x2, c.x2)), L::mul(c.y2, c.y2)), c.gi2, c.x2, c.y2, dx, dy);
+
+    const F scale = L::set1(45.23065f);
+    dx = L::mul(dx, scale);
+    dy = L::mul(dy, scale);
+    return L::mul(scale, L::add(L::add(n0, n1), n2));
+}
+
+/**
+ * 3D Perlin simplex noise of L::width samples
+ */
+template <class L>
+static inline typename L::F noise3Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, typename L::F z) {
+    typedef typename L::F F;
+    typedef typename L::I I;
+    static const float F3 = 1.0f / 3.0f;
+    static const float G3 = 1.0f / 6.0f;
+
+    const F s = L::mul(L::add(L::add(x, y), z), L::set1(F3));
+    const I i = fastfloorLanes<L>(L::add(x, s));
+    const I j = fastfloorLanes<L>(L::add(y, s));
+    const I k = fastfloorLanes<L>(L::add(z, s));
+    const F t = L::mul(L::toFloat(L::iadd(L::iadd(i, j), k)), L::set1(G3));
+    const F x0 = L::sub(x, L::sub(L::toFloat(i), t));
+    const F y0 = L::sub(y, L::sub(L::toFloat(j), t));
+    const F z0 = L::sub(z, L::sub(L::toFloat(k), t));
+
+    // Simplex corner offsets, the branch-free form of the rank ordering in noise(x, y, z)
+    const I xy = L::asInt(L::cmpGe(x0, y0));
+    const I yz = L::asInt(L::cmpGe(y0, z0));
+    const I xz = L::asInt(L::cmpGe(x0, z0));
+    const I nxy = L::asInt(L::cmpLt(x0, y0));
+    const I nyz = L::asInt(L::cmpLt(y0, z0));
+    const I nxz = L::asInt(L::cmpLt(x0, z0));
+    const I one = L::iset1(1);
+    const I i1 = L::iand(L::iand(xy, L::ior(yz, xz)), one);
+    const I j1 = L::iand(L::iand(nxy, yz), one);
+    const I k1 = L::iand(L::iand(nyz, L::ior(nxy, nxz)), one);
+    const I i2 = L::iand(L::ior(xy, L::iand(yz, xz)), one);
+    const I j2 = L::iand(L::ior(nxy, yz), one);
+    const I k2 = L::iand(L::ior(nyz, L::iand(nxy, nxz)), one);
+
+    const F x1 = L::add(L::sub(x0, L::toFloat(i1)), L::set1(G3));
+    const F y1 = L::add(L::sub(y0, L::toFloat(j1)), L::set1(G3));
+    const F z1 = L::add(L::sub(z0, L::toFloat(k1)), L::set1(G3));
+    const F x2 = L::add(L::sub(x0, L::toFloat(i2)), L::set1(2.0f * G3));
+    const F y2 = L::add(L::sub(y0, L::toFloat(j2)), L::set1(2.0f * G3));
+    const F z2 = L::add(L::sub(z0, L::toFloat(k2)), L::set1(2.0f * G3));
+    const F x3 = L::add(L::sub(x0, L::set1(1.0f)), L::set1(3.0f * G3));
+    const F y3 = L::add(L::sub(y0, L::set1(1.0f)), L::set1(3.0f * G3));
+    const F z3 = L::add(L::sub(z0, L::set1(1.0f)), L::set1(3.0f * G3));
+
+    const I ii = wrapLanes<L>(i);
+    const I jj = wrapLanes<L>(j);
+    const I kk = wrapLanes<L>(k);
+    const I gi0 = L::lookup(tables.grad3, L::iadd(ii, L::lookup(tables.perm, L::iadd(jj, L::lookup(tables.perm, kk)))));
+    const I gi1 = L::lookup(tables.grad3, L::iadd(L::iadd(ii, i1), L::lookup(tables.perm, L::iadd(L::iadd(jj, j1), L::lookup(tables.perm, L::iadd(kk, k1))))));
+    const I gi2 = L::lookup(tables.grad3, L::iadd(L::iadd(ii, i2), L::lookup(tables.perm, L::iadd(L::iadd(jj, j2), L::lookup(tables.perm, L::iadd(kk, k2))))));
+    const I gi3 = L::lookup(tables.grad3, L::iadd(L::iadd(ii, one), L::lookup(tables.perm, L::iadd(L::iadd(jj, one), L::lookup(tables.perm, L::iadd(kk, one))))));
+
+    const F r = L::set1(0.6f);
+    const F n0 = cornerLanes<L>(L::sub(L::sub(L::sub(r, L::mul(x0, x0)), L::mul(y0, y0)), L::mul(z0, z0)), gradLanes<L>(gi0, x0, y0, z0));
+    const F n1 = cornerLanes<L>(L::sub(L::sub(L::sub(r, L::mul(x1, x1)), L::mul(y1, y1)), L::mul(z1, z1)), gradLanes<L>(gi1, x1, y1, z1));
+    const F n2 = cornerLanes<L>(L::sub(L::sub(L::sub(r, L::mul(x2, x2)), L::mul(y2, y2)), L::mul(z2, z2)), gradLanes<L>(gi2, x2, y2, z2));
+    const F n3 = cornerLanes<L>(L::sub(L::sub(L::sub(r, L::mul(x3, x3)), L::mul(y3, y3)), L::mul(z3, z3)), gradLanes<L>(gi3, x3, y3, z3));
+
+    return L::mul(L::set1(32.0f), L::add(L::add(L::add(n0, n1), n2), n3));
+}
+
+/**
+ * Lane-wise corner offset: 1 where the (negated) rank count -rank is below threshold, i.e. rank > -threshold
+ */
+template <class L>
+static inline typename L::I rankOffsetLanes(typename L::I negRank, int32_t threshold) {
+    return L::iand(L::icmpLt(negRank, L::iset1(threshold)), L::iset1(1));
+}
+
+/**
+ * Lane-wise squared distance falloff r - x^2 - y^2 - z^2 - w^2 (same operation order as noise(x, y, z, w))
+ */
+template <class L>
+static inline typename L::F falloffLanes(typename L::F r, typename L::F x, typename L::F y, typename L::F z, typename L::F w) {
+    return L::sub(L::sub(L::sub(L::sub(r, L::mul(x, x)), L::mul(y, y)), L::mul(z, z)), L::mul(w, w));
+}
+
+/**
+ * 4D Perlin simplex noise of L::width samples
+ */
+template <class L>
+static inline typename L::F noise4Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, typename L::F z, typename L::F w) {
+    typedef typename L::F F;
+    typedef typename L::I I;
+    static const float F4 = 0.309016994f;
+    static const float G4 = 0.138196601f;
+
+    const F s = L::mul(L::add(L::add(L::add(x, y), z), w), L::set1(F4));
+    const I i = fastfloorLanes<L>(L::add(x, s));
+    const I j = fastfloorLanes<L>(L::add(y, s));
+    const I k = fastfloorLanes<L>(L::add(z, s));
+    const I l = fastfloorLanes<L>(L::add(w, s));
+    const F t = L::mul(L::toFloat(L::iadd(L::iadd(L::iadd(i, j), k), l)), L::set1(G4));
+    const F x0 = L::sub(x, L::sub(L::toFloat(i), t));
+    const F y0 = L::sub(y, L::sub(L::toFloat(j), t));
+    const F z0 = L::sub(z, L::sub(L::toFloat(k), t));
+    const F w0 = L::sub(w, L::sub(L::toFloat(l), t));
+
+    // Rank counts of noise(x, y, z, w), summed as comparison masks (-1 per win, so the sums are -rank)
+    const I xy = L::asInt(L::cmpGt(x0, y0)), yx = L::asInt(L::cmpGe(y0, x0));
+    const I xz = L::asInt(L::cmpGt(x0, z0)), zx = L::asInt(L::cmpGe(z0, x0));
+    const I xw = L::asInt(L::cmpGt(x0, w0)), wx = L::asInt(L::cmpGe(w0, x0));
+    const I yz = L::asInt(L::cmpGt(y0, z0)), zy = L::asInt(L::cmpGe(z0, y0));
+    const I yw = L::asInt(L::cmpGt(y0, w0)), wy = L::asInt(L::cmpGe(w0, y0));
+    const I zw = L::asInt(L::cmpGt(z0, w0)), wz = L::asInt(L::cmpGe(w0, z0));
+    const I rankx = L::iadd(L::iadd(xy, xz), xw);
+    const I ranky = L::iadd(L::iadd(yx, yz), yw);
+    const I rankz = L::iadd(L::iadd(zx, zy), zw);
+    const I rankw = L::iadd(L::iadd(wx, wy), wz);
+
+    const I i1 = rankOffsetLanes<L>(rankx, -2), j1 = rankOffsetLanes<L>(ranky, -2), k1 = rankOffsetLanes<L>(rankz, -2), l1 = rankOffsetLanes<L>(rankw, -2);
+    const I i2 = rankOffsetLanes<L>(rankx, -1), j2 = rankOffsetLanes<L>(ranky, -1), k2 = rankOffsetLanes<L>(rankz, -1), l2 = rankOffsetLanes<L>(rankw, -1);
+    const I i3 = rankOffsetLanes<L>(rankx, 0),  j3 = rankOffsetLanes<L>(ranky, 0),  k3 = rankOffsetLanes<L>(rankz, 0),  l3 = rankOffsetLanes<L>(rankw, 0);
+
+    const F g1 = L::set1(G4), g2 = L::set1(2.0f * G4), g3 = L::set1(3.0f * G4), g4 = L::set1(4.0f * G4);
+    const F x1 = L::add(L::sub(x0, L::toFloat(i1)), g1);
+    const F y1 = L::add(L::sub(y0, L::toFloat(j1)), g1);
+    const F z1 = L::add(L::sub(z0, L::toFloat(k1)), g1);
+    const F w1 = L::add(L::sub(w0, L::toFloat(l1)), g1);
+    const F x2 = L::add(L::sub(x0, L::toFloat(i2)), g2);
+    const F y2 = L::add(L::sub(y0, L::toFloat(j2)), g2);
+    const F z2 = L::add(L::sub(z0, L::toFloat(k2)), g2);
+    const F w2 = L::add(L::sub(w0, L::toFloat(l2)), g2);
+    const F x3 = L::add(L::sub(x0, L::toFloat(i3)), g3);
+    const F y3 = L::add(L::sub(y0, L::toFloat(j3)), g3);
+    const F z3 = L::add(L::sub(z0, L::toFloat(k3)), g3);
+    const F w3 = L::add(L::sub(w0, L::toFloat(l3)), g3);
+    const F x4 = L::add(L::sub(x0, L::set1(1.0f)), g4);
+    const F y4 = L::add(L::sub(y0, L::set1(1.0f)), g4);
+    const F z4 = L::add(L::sub(z0, L::set1(1.0f)), g4);
+    const F w4 = L::add(L::sub(w0, L::set1(1.0f)), g4);
+
+    const I one = L::iset1(1);
+    const I ii = wrapLanes<L>(i);
+    const I jj = wrapLanes<L>(j);
+    const I kk = wrapLanes<L>(k);
+    const I ll = wrapLanes<L>(l);
+    const int32_t* perm = tables.perm;
+    const int32_t* gradIndex = tables.grad4;
+    const I gi0 = L::lookup(gradIndex, L::iadd(ii, L::lookup(perm, L::iadd(jj, L::lookup(perm, L::iadd(kk, L::lookup(perm, ll)))))));
+    const I gi1 = L::lookup(gradIndex, L::iadd(L::iadd(ii, i1), L::lookup(perm, L::iadd(L::iadd(jj, j1), L::lookup(perm, L::iadd(L::iadd(kk, k1), L::lookup(perm, L::iadd(ll, l1))))))));
+    const I gi2 = L::lookup(gradIndex, L::iadd(L::iadd(ii, i2), L::lookup(perm, L::iadd(L::iadd(jj, j2), L::lookup(perm, L::iadd(L::iadd(kk, k2), L::lookup(perm, L::iadd(ll, l2))))))));
+    const I gi3 = L::lookup(gradIndex, L::iadd(L::iadd(ii, i3), L::lookup(perm, L::iadd(L::iadd(jj, j3), L::lookup(perm, L::iadd(L::iadd(kk, k3), L::lookup(perm, L::iadd(ll, l3))))))));
+    const I gi4 = L::lookup(gradIndex, L::iadd(L::iadd(ii, one), L::lookup(perm, L::iadd(L::iadd(jj, one), L::lookup(perm, L::iadd(L::iadd(kk, one), L::lookup(perm, L::iadd(ll, one))))))));
+
+    const F r = L::set1(0.6f);
+    const F n0 = cornerLanes<L>(falloffLanes<L>(r, x0, y0, z0, w0), gradLanes<L>(gi0, x0, y0, z0, w0));
+    const F n1 = cornerLanes<L>(falloffLanes<L>(r, x1, y1, z1, w1), gradLanes<L>(gi1, x1, y1, z1, w1));
+    const F n2 = cornerLanes<L>(falloffLanes<L>(r, x2, y2, z2, w2), gradLanes<L>(gi2, x2, y2, z2, w2));
+    const F n3 = cornerLanes<L>(falloffLanes<L>(r, x3, y3, z3, w3), gradLanes<L>(gi3, x3, y3, z3, w3));
+    const F n4 = cornerLanes<L>(falloffLanes<L>(r, x4, y4, z4, w4), gradLanes<L>(gi4, x4, y4, z4, w4));
+
+    return L::mul(L::set1(27.0f), L::add(L::add(L::add(L::add(n0, n1), n2), n3), n4));
+}
+
+/**
+ * Evaluates noise(xs[i], y) for the whole lanes of a row of samples, L::width at a time.
+ */
+template <class L>
+static size_t noise2SpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, size_t count) {
+    const typename L::F yv = L::set1(y);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, noise2Lanes<L>(tables, L::load(xs + i), yv));
+    }
+    return i;
+}
+
+/**
+ * Evaluates noiseDeriv(xs[i], y, outDx[i], outDy[i]) for the whole lanes of a row of samples, L::width at a time.
+ */
+template <class L>
+static size_t noise2DerivSpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y,
+                                   float* out, float* outDx, float* outDy, size_t count) {
+    const typename L::F yv = L::set1(y);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        typename L::F dx, dy;
+        L::store(out + i, noise2DerivLanes<L>(tables, L::load(xs + i), yv, dx, dy));
+        L::store(outDx + i, dx);
+        L::store(outDy + i, dy);
+    }
+    return i;
+}
+
+/**
+ * Evaluates noise(xs[i], y, z) for the whole lanes of a row of samples, L::width at a time.
+ */
+template <class L>
+static size_t noise3SpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float* out, size_t count) {
+    const typename L::F yv = L::set1(y);
+    const typename L::F zv = L::set1(z);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, noise3Lanes<L>(tables, L::load(xs + i), yv, zv));
+    }
+    return i;
+}
+
+/**
+ * Evaluates noise(xs[i], y, z, w) for the whole lanes of a row of samples, L::width at a time.
+ */
+template <class L>
+static size_t noise4SpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float w, float* out, size_t count) {
+    const typename L::F yv = L::set1(y);
+    const typename L::F zv = L::set1(z);
+    const typename L::F wv = L::set1(w);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, noise4Lanes<L>(tables, L::load(xs + i), yv, zv, wv));
+    }
+    return i;
+}
+
+/**
+ * Evaluates noise(xs[i], ys[i][, zs[i]]) for the whole lanes of arbitrary sample points, L::width at a time.
+ */
+template <class L>
+static size_t noise2PointsLanes(const SimplexNoise::Tables& tables, const float* xs, const float* ys, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, noise2Lanes<L>(tables, L::load(xs + i), L::load(ys + i)));
+    }
+    return i;
+}
+
+template <class L>
+static size_t noise3PointsLanes(const SimplexNoise::Tables& tables, const float* xs, const float* ys, const float* zs, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, noise3Lanes<L>(tables, L::load(xs + i), L::load(ys + i), L::load(zs + i)));
+    }
+    return i;
+}
+
+/**
+ * Fully unrolled fBm of L::width samples of 2D noise: one noise2Lanes() per octave, weights and
+ * frequency multipliers folded in as constants, and a single multiplication by the normalisation.
+ *
+ * The constants are evaluated at compile time, so the Fractal helpers are never emitted for this instruction set.
+ */
+template <size_t Octaves, class L, size_t... O>
+static inline typename L::F fractal2Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, float frequency, std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 2> K;
+    constexpr float weight[] = { K::weight(O)... };
+    constexpr float frequencyScale[] = { K::frequencyScale(O)... };
+    constexpr float normalisation = K::normalisation();
+    typename L::F output = L::set1(0.f);
+    ((output = L::add(output, L::mul(L::set1(weight[O]),
+        noise2Lanes<L>(tables, L::mul(x, L::set1(frequency * frequencyScale[O])), L::mul(y, L::set1(frequency * frequencyScale[O])))))), ...);
+    return L::mul(output, L::set1(normalisation));
+}
+
+/**
+ * Adds one octave of 2D noise and its gradient to an fBm of L::width samples (see fractal2DerivLanes())
+ */
+template <class L>
+static inline void accumulateDerivOctaveLanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, float frequency, float weight,
+                                              typename L::F& output, typename L::F& dx, typename L::F& dy) {
+    typename L::F nx, ny;
+    const typename L::F n = noise2DerivLanes<L>(tables, L::mul(x, L::set1(frequency)), L::mul(y, L::set1(frequency)), nx, ny);
+    output = L::add(output, L::mul(L::set1(weight), n));
+    dx = L::add(dx, L::mul(L::set1(weight * frequency), nx));
+    dy = L::add(dy, L::mul(L::set1(weight * frequency), ny));
+}
+
+/**
+ * Fully unrolled fBm of L::width samples of 2D noise with its gradient along the noise coordinates
+ * (the values are those of fractal2Lanes(), each octave's derivatives are scaled by its frequency)
+ */
+template <size_t Octaves, class L, size_t... O>
+static inline typename L::F fractal2DerivLanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, float frequency,
+                                               typename L::F& dx, typename L::F& dy, std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 2> K;
+    constexpr float weight[] = { K::weight(O)... };
+    constexpr float frequencyScale[] = { K::frequencyScale(O)... };
+    constexpr float normalisation = K::normalisation();
+    typename L::F output = L::set1(0.f);
+    dx = dy = L::set1(0.f);
+    (accumulateDerivOctaveLanes<L>(tables, x, y, frequency * frequencyScale[O], weight[O], output, dx, dy), ...);
+    dx = L::mul(dx, L::set1(normalisation));
+    dy = L::mul(dy, L::set1(normalisation));
+    return L::mul(output, L::set1(normalisation));
+}
+
+/**
+ * Fully unrolled fBm of L::width samples of 3D noise (see fractal2Lanes())
+ */
+template <size_t Octaves, class L, size_t... O>
+static inline typename L::F fractal3Lanes(const SimplexNoise::Tables& tables, typename L::F x, typename L::F y, typename L::F z, float frequency, std::index_sequence<O...>) {
+    typedef Fractal<Octaves, 3> K;
+    constexpr float weight[] = { K::weight(O)... };
+    constexpr float frequencyScale[] = { K::frequencyScale(O)... };
+    constexpr float normalisation = K::normalisation();
+    typename L::F output = L::set1(0.f);
+    ((output = L::add(output, L::mul(L::set1(weight[O]),
+        noise3Lanes<L>(tables, L::mul(x, L::set1(frequency * frequencyScale[O])), L::mul(y, L::set1(frequency * frequencyScale[O])),
+                       L::mul(z, L::set1(frequency * frequencyScale[O])))))), ...);
+    return L::mul(output, L::set1(normalisation));
+}
+
+/**
+ * Specialised fBm of the whole lanes of a span of 2D samples, L::width at a time.
+ */
+template <size_t Octaves, class L>
+static size_t fractal2SpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency, float* out, size_t count) {
+    const std::make_index_sequence<Octaves> octaves;
+    const typename L::F yv = L::set1(y);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, fractal2Lanes<Octaves, L>(tables, L::load(xs + i), yv, frequency, octaves));
+    }
+    return i;
+}
+
+/**
+ * Specialised fBm and gradient of the whole lanes of a span of 2D samples, L::width at a time.
+ */
+template <size_t Octaves, class L>
+static size_t fractal2DerivSpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency,
+                                     float* out, float* outDx, float* outDy, size_t count) {
+    const std::make_index_sequence<Octaves> octaves;
+    const typename L::F yv = L::set1(y);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        typename L::F dx, dy;
+        L::store(out + i, fractal2DerivLanes<Octaves, L>(tables, L::load(xs + i), yv, frequency, dx, dy, octaves));
+        L::store(outDx + i, dx);
+        L::store(outDy + i, dy);
+    }
+    return i;
+}
+
+/**
+ * Specialised fBm of the whole lanes of a span of 3D samples, L::width at a time.
+ */
+template <size_t Octaves, class L>
+static size_t fractal3SpanLanes(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float frequency, float* out, size_t count) {
+    const std::make_index_sequence<Octaves> octaves;
+    const typename L::F yv = L::set1(y);
+    const typename L::F zv = L::set1(z);
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        L::store(out + i, fractal3Lanes<Octaves, L>(tables, L::load(xs + i), yv, zv, frequency, octaves));
+    }
+    return i;
+}
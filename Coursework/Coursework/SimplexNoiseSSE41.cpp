@@ -0,0 +1,120 @@
+/**
+ * @file    SimplexNoiseSSE41.cpp
+ * @brief   4-wide SSE4.1 kernels of the batch simplex noise functions.
+ *
+ * MSVC needs no option for SSE4.1 intrinsics; GCC and clang compile this file for SSE4.1 through the target
+ * pragma below. SimplexNoise.cpp only calls in here when detectBatchPath() found SSE4.1.
+ *
+ * Distributed under the MIT License (MIT) (See accompanying file LICENSE.txt
+ * or copy at http://opensource.org/licenses/MIT)
+ */
+#include <cstddef>  // size_t
+#include <cstdint>  // int32_t
+#include <utility>  // std::index_sequence
+#include <immintrin.h>  // SSE4.1 intrinsics
+#include "SimplexNoiseKernels.h"
+
+// Everything below is compiled for SSE4.1, the headers above are not (their inline functions are shared with the other translation units)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace {
+
+/**
+ * 4-wide SSE4.1 lane helpers
+ */
+struct LanesSSE41 {
+    typedef __m128  F;
+    typedef __m128i I;
+    static const size_t width = 4;
+
+    static inline F set1(float v)                 { return _mm_set1_ps(v); }
+    static inline F load(const float* p)          { return _mm_loadu_ps(p); }
+    static inline void store(float* p, F v)       { _mm_storeu_ps(p, v); }
+    static inline F add(F a, F b)                 { return _mm_add_ps(a, b); }
+    static inline F sub(F a, F b)                 { return _mm_sub_ps(a, b); }
+    static inline F mul(F a, F b)                 { return _mm_mul_ps(a, b); }
+    static inline F div(F a, F b)                 { return _mm_div_ps(a, b); }
+    static inline F bitAnd(F a, F b)              { return _mm_and_ps(a, b); }
+    static inline F bitXor(F a, F b)              { return _mm_xor_ps(a, b); }
+    static inline F cmpLt(F a, F b)               { return _mm_cmplt_ps(a, b); }
+    static inline F cmpGt(F a, F b)               { return _mm_cmpgt_ps(a, b); }
+    static inline F cmpGe(F a, F b)               { return _mm_cmpge_ps(a, b); }
+    static inline F select(F mask, F a, F b)      { return _mm_blendv_ps(b, a, mask); }
+    static inline I iset1(int32_t v)              { return _mm_set1_epi32(v); }
+    static inline I iadd(I a, I b)                { return _mm_add_epi32(a, b); }
+    static inline I iand(I a, I b)                { return _mm_and_si128(a, b); }
+    static inline I ior(I a, I b)                 { return _mm_or_si128(a, b); }
+    static inline I iandNot(I a, I b)             { return _mm_andnot_si128(a, b); } // ~a & b
+    static inline I icmpLt(I a, I b)              { return _mm_cmplt_epi32(a, b); }
+    static inline I icmpEq(I a, I b)              { return _mm_cmpeq_epi32(a, b); }
+    static inline I ishl(I a, int n)              { return _mm_slli_epi32(a, n); }
+    static inline I truncate(F v)                 { return _mm_cvttps_epi32(v); }
+    static inline F toFloat(I v)                  { return _mm_cvtepi32_ps(v); }
+    static inline F asFloat(I v)                  { return _mm_castsi128_ps(v); }
+    static inline I asInt(F v)                    { return _mm_castps_si128(v); }
+    static inline I lookup(const int32_t* table, I i) {
+        alignas(16) int32_t idx[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx), i);
+        return _mm_setr_epi32(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+    }
+};
+
+} // namespace
+
+#include "SimplexNoiseLanes.h"
+
+size_t SimplexNoiseSSE41::noise2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, size_t count) {
+    return noise2SpanLanes<LanesSSE41>(tables, xs, y, out, count);
+}
+
+size_t SimplexNoiseSSE41::noise3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float* out, size_t count) {
+    return noise3SpanLanes<LanesSSE41>(tables, xs, y, z, out, count);
+}
+
+size_t SimplexNoiseSSE41::noise4Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float w, float* out, size_t count) {
+    return noise4SpanLanes<LanesSSE41>(tables, xs, y, z, w, out, count);
+}
+
+size_t SimplexNoiseSSE41::noise2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float* out, float* outDx, float* outDy, size_t count) {
+    return noise2DerivSpanLanes<LanesSSE41>(tables, xs, y, out, outDx, outDy, count);
+}
+
+size_t SimplexNoiseSSE41::noise2Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, float* out, size_t count) {
+    return noise2PointsLanes<LanesSSE41>(tables, xs, ys, out, count);
+}
+
+size_t SimplexNoiseSSE41::noise3Points(const SimplexNoise::Tables& tables, const float* xs, const float* ys, const float* zs, float* out, size_t count) {
+    return noise3PointsLanes<LanesSSE41>(tables, xs, ys, zs, out, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseSSE41::fractal2Span(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency, float* out, size_t count) {
+    return fractal2SpanLanes<Octaves, LanesSSE41>(tables, xs, y, frequency, out, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseSSE41::fractal2DerivSpan(const SimplexNoise::Tables& tables, const float* xs, float y, float frequency,
+                                         float* out, float* outDx, float* outDy, size_t count) {
+    return fractal2DerivSpanLanes<Octaves, LanesSSE41>(tables, xs, y, frequency, out, outDx, outDy, count);
+}
+
+template <size_t Octaves>
+size_t SimplexNoiseSSE41::fractal3Span(const SimplexNoise::Tables& tables, const float* xs, float y, float z, float frequency, float* out, size_t count) {
+    return fractal3SpanLanes<Octaves, LanesSSE41>(tables, xs, y, z, frequency, out, count);
+}
+
+// Configurations of the Fractal rows instantiated in SimplexNoise.cpp
+template size_t SimplexNoiseSSE41::fractal2Span<15>(const SimplexNoise::Tables&, const float*, float, float, float*, size_t);
+template size_t SimplexNoiseSSE41::fractal2DerivSpan<15>(const SimplexNoise::Tables&, const float*, float, float, float*, float*, float*, size_t);
+template size_t SimplexNoiseSSE41::fractal3Span<10>(const SimplexNoise::Tables&, const float*, float, float, float, float*, size_t);
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
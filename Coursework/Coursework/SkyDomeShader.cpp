@@ -47,8 +47,8 @@ void SkyDomeShaderClass::initShader(const wchar_t* vsFilename, const wchar_t* ps
     D3D11_SAMPLER_DESC samplerDesc;
     D3D11_BUFFER_DESC colourBufferDesc;
 
-    // Load the vertex and pixel shaders
-    loadVertexShader(vsFilename);
+    // Load the vertex and pixel shaders (the sky dome has packed vertices, of which the shaders read positions)
+    loadVertexShader(vsFilename, VertexPacking::PackedVertex);
     loadPixelShader(psFilename);
 
     // Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
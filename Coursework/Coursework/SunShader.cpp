@@ -48,8 +48,8 @@ void SunShader::initShader(const wchar_t* vsFilename, const wchar_t* psFilename)
     D3D11_BUFFER_DESC sunColorBufferDesc;
     D3D11_SAMPLER_DESC samplerDesc;
 
-    // Load the vertex and pixel shaders
-    loadVertexShader(vsFilename);
+    // Load the vertex and pixel shaders (the sun sphere has packed vertices, of which the shaders read positions and texture coordinates)
+    loadVertexShader(vsFilename, VertexPacking::PackedVertex);
     loadPixelShader(psFilename);
 
     // Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
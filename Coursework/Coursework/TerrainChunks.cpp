@@ -0,0 +1,307 @@
+#include "TerrainChunks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "PerlinNoiseTexture.h"
+
+// Constructor with initialisation, starting the worker threads (half the cores, up to maxWorkers)
+TerrainChunks::TerrainChunks(const Parameters& initialParameters) {
+	generation = 0;
+	loadDistance = 4.f * chunkCells;
+	uploadsPerUpdate = 4;
+	memoryBudget = 32u << 20;
+	updateCount = 0;
+	generatedCount = evictedCount = 0;
+	generationTime = 0.0;
+	stopping = false;
+	SetParameters(initialParameters);
+
+	const int workerCount = std::max(1, std::min(maxWorkers, (int)std::thread::hardware_concurrency() / 2));
+	for (int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&TerrainChunks::WorkerLoop, this);
+	}
+}
+
+// Stopping the workers, then releasing every chunk
+TerrainChunks::~TerrainChunks() {
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		stopping = true;
+	}
+	workStart.notify_all();
+	for (std::thread& worker : workers) worker.join();
+
+	for (Chunk* chunk : finished) ReleaseChunk(chunk);
+	for (auto& entry : resident) ReleaseChunk(entry.second);
+}
+
+// New parameters: the queue and the resident chunks are dropped, and chunks still being generated with the old
+// parameters are thrown away when they finish
+void TerrainChunks::SetParameters(const Parameters& newParameters) {
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		parameters = newParameters;
+		if (parameters.frequency == 0) parameters.frequency = 0.001f;
+		if (parameters.amplitude == 0) parameters.amplitude = 0.001f;
+		noise = SimplexNoise(parameters.frequency, 1.0f, 2.0f, parameters.persistence, parameters.seed);
+		generation++;
+		queue.clear();
+	}
+	for (auto& entry : resident) ReleaseChunk(entry.second);
+	resident.clear();
+	drawList.clear();
+}
+
+// Worker thread: generates the best queued chunk until stopped
+void TerrainChunks::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(workMutex);
+	for (;;) {
+		workStart.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (stopping) return;
+
+		const Request request = queue.back();
+		queue.pop_back();
+		generating.insert(Key(request.x, request.z));
+		const SimplexNoise chunkNoise = noise;
+		const Parameters chunkParameters = parameters;
+		Chunk* chunk = new Chunk();
+		chunk->x = request.x;
+		chunk->z = request.z;
+		chunk->generation = generation;
+		lock.unlock();
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		GenerateChunk(*chunk, chunkNoise, chunkParameters);
+		chunk->generationTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		lock.lock();
+		finished.push_back(chunk);
+	}
+}
+
+// Generating the samples of a chunk row by row with the batch fBm and its analytic gradient
+// Sample (i, j) is at world (originX - chunkBorder + i, originZ - chunkBorder + j): whole world units, so its noise
+// coordinates (world position times noiseScale, a power of two) are exact and do not depend on the chunk evaluating it.
+void TerrainChunks::GenerateChunk(Chunk& chunk, const SimplexNoise& chunkNoise, const Parameters& chunkParameters) const {
+	const int firstX = chunk.x * chunkCells - chunkBorder, firstZ = chunk.z * chunkCells - chunkBorder;
+	chunk.originX = (float)(chunk.x * chunkCells);
+	chunk.originZ = (float)(chunk.z * chunkCells);
+
+	const SimplexNoise::BandLimit limit = chunkNoise.bandLimit(heightOctaves, noiseScale);
+	const bool specialised = limit.evaluated == heightOctaves && limit.lastWeight == 1.f && chunkParameters.persistence == Fractal<heightOctaves, 2>::persistence;
+	const float amplitude = chunkParameters.amplitude;
+	const float gradientScale = amplitude * noiseScale;  // noise coordinates to world units, and fBm to height
+	const size_t count = (size_t)chunkSamples * chunkSamples;
+	chunk.heights.resize(count);
+	chunk.texels.resize(count * 4);
+	chunk.normals.resize(count);
+
+	float gradientsX[chunkSamples], gradientsZ[chunkSamples];
+	float minHeight = INFINITY, maxHeight = -INFINITY;
+	for (int j = 0; j < chunkSamples; j++) {
+		float* row = &chunk.heights[(size_t)j * chunkSamples];
+		if (specialised) Fractal<heightOctaves, 2>::rowDeriv(chunkNoise, firstX * noiseScale, noiseScale, (firstZ + j) * noiseScale, row, gradientsX, gradientsZ, chunkSamples);
+		else chunkNoise.fractalRowDeriv(heightOctaves, limit, firstX * noiseScale, noiseScale, (firstZ + j) * noiseScale, row, gradientsX, gradientsZ, chunkSamples);
+		float* texels = &chunk.texels[(size_t)j * chunkSamples * 4];
+		for (int i = 0; i < chunkSamples; i++) {
+			row[i] = amplitude * row[i];
+			gradientsX[i] = gradientScale * gradientsX[i];
+			gradientsZ[i] = gradientScale * gradientsZ[i];
+			texels[i * 4 + 0] = row[i];
+			texels[i * 4 + 1] = gradientsX[i];
+			texels[i * 4 + 2] = gradientsZ[i];
+			texels[i * 4 + 3] = 0.f;
+			minHeight = std::min(minHeight, row[i]);
+			maxHeight = std::max(maxHeight, row[i]);
+		}
+		// Samples are one world unit apart, so the gradients are already world slopes of heights in height units
+		PerlinNoiseTexture::BakeNormalRow(gradientsX, gradientsZ, &chunk.normals[(size_t)j * chunkSamples], chunkSamples, PerlinNoiseTexture::terrainHeightScale);
+	}
+	chunk.minHeight = minHeight;
+	chunk.maxHeight = maxHeight;
+}
+
+// Creating the immutable height map and normal map textures of a chunk, then freeing its texels
+void TerrainChunks::UploadChunk(ID3D11Device* device, Chunk& chunk) {
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Width = chunkSamples;
+	desc.Height = chunkSamples;
+	desc.MipLevels = desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA texData{};
+	texData.pSysMem = chunk.texels.data();
+	texData.SysMemPitch = chunkSamples * 4 * sizeof(float);
+	HRESULT hr = device->CreateTexture2D(&desc, &texData, &chunk.heightTexture);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	SRVDesc.Texture2D.MipLevels = 1;
+	hr = device->CreateShaderResourceView(chunk.heightTexture, &SRVDesc, &chunk.heightSRV);
+
+	desc.Format = DXGI_FORMAT_R8G8B8A8_SNORM;
+	texData.pSysMem = chunk.normals.data();
+	texData.SysMemPitch = chunkSamples * sizeof(uint32_t);
+	hr = device->CreateTexture2D(&desc, &texData, &chunk.normalTexture);
+	SRVDesc.Format = DXGI_FORMAT_R8G8B8A8_SNORM;
+	hr = device->CreateShaderResourceView(chunk.normalTexture, &SRVDesc, &chunk.normalSRV);
+
+	std::vector<float>().swap(chunk.texels);
+	std::vector<uint32_t>().swap(chunk.normals);
+}
+
+// Releasing the textures of a chunk and deleting it
+void TerrainChunks::ReleaseChunk(Chunk* chunk) {
+	if (chunk->heightSRV) chunk->heightSRV->Release();
+	if (chunk->heightTexture) chunk->heightTexture->Release();
+	if (chunk->normalSRV) chunk->normalSRV->Release();
+	if (chunk->normalTexture) chunk->normalTexture->Release();
+	delete chunk;
+}
+
+// Memory of a resident chunk: the heights kept for queries, the height map texture and the normal map texture
+size_t TerrainChunks::ChunkBytes() {
+	const size_t texels = (size_t)chunkSamples * chunkSamples;
+	return sizeof(Chunk) + texels * (sizeof(float) + 4 * sizeof(float) + sizeof(uint32_t));
+}
+
+// Distance from a world x/z to the nearest point of a chunk (0 inside it)
+float TerrainChunks::ChunkDistance(int x, int z, float worldX, float worldZ) {
+	const float minX = (float)(x * chunkCells), minZ = (float)(z * chunkCells);
+	const float dx = std::max(std::max(minX - worldX, worldX - (minX + chunkCells)), 0.f);
+	const float dz = std::max(std::max(minZ - worldZ, worldZ - (minZ + chunkCells)), 0.f);
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+// Streaming around the camera
+void TerrainChunks::Update(ID3D11Device* device, float cameraX, float cameraZ, float forwardX, float forwardZ) {
+	updateCount++;
+
+	// Step 1: Take the finished chunks, drop those of old parameters and upload a few (the rest wait for the next updates)
+	std::vector<Chunk*> ready;
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		ready.swap(finished);
+	}
+	// The keys of the chunks taken are kept rather than the chunks, as those of old parameters are deleted here
+	std::vector<Chunk*> waiting;
+	std::vector<uint64_t> done;
+	int uploads = 0;
+	for (Chunk* chunk : ready) {
+		if (chunk->generation != generation) {
+			done.push_back(Key(chunk->x, chunk->z));
+			ReleaseChunk(chunk);
+		}
+		else if (uploads < uploadsPerUpdate) {
+			UploadChunk(device, *chunk);
+			chunk->lastUsed = updateCount;
+			resident[Key(chunk->x, chunk->z)] = chunk;
+			generatedCount++;
+			generationTime += chunk->generationTime;
+			done.push_back(Key(chunk->x, chunk->z));
+			uploads++;
+		}
+		else waiting.push_back(chunk);
+	}
+
+	// Step 2: Mark the resident chunks within the load distance, and queue the missing ones
+	// Priority is the distance, stretched up to twice for chunks behind the camera, so the chunks in view come first.
+	float forwardLength = std::sqrt(forwardX * forwardX + forwardZ * forwardZ);
+	if (forwardLength > 0.f) {
+		forwardX /= forwardLength;
+		forwardZ /= forwardLength;
+	}
+	std::vector<Request> requests;
+	const int reach = (int)std::ceil(loadDistance / chunkCells);
+	const int cameraChunkX = (int)std::floor(cameraX / chunkCells), cameraChunkZ = (int)std::floor(cameraZ / chunkCells);
+	for (int z = cameraChunkZ - reach; z <= cameraChunkZ + reach; z++) {
+		for (int x = cameraChunkX - reach; x <= cameraChunkX + reach; x++) {
+			const float distance = ChunkDistance(x, z, cameraX, cameraZ);
+			if (distance > loadDistance) continue;
+			auto found = resident.find(Key(x, z));
+			if (found != resident.end()) {
+				found->second->lastUsed = updateCount;
+				continue;
+			}
+			const float toChunkX = (x + 0.5f) * chunkCells - cameraX, toChunkZ = (z + 0.5f) * chunkCells - cameraZ;
+			const float toChunkLength = std::sqrt(toChunkX * toChunkX + toChunkZ * toChunkZ);
+			const float facing = toChunkLength > 0.f ? (toChunkX * forwardX + toChunkZ * forwardZ) / toChunkLength : 1.f;
+			requests.push_back({ x, z, distance * (1.5f - 0.5f * facing) });
+		}
+	}
+	std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.priority > b.priority; });
+
+	// Step 3: Replace the queue (chunks that left the load distance before a worker took them are never generated)
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		for (uint64_t key : done) generating.erase(key);
+		finished.insert(finished.begin(), waiting.begin(), waiting.end());
+		queue.clear();
+		for (const Request& request : requests) {
+			if (!generating.count(Key(request.x, request.z))) queue.push_back(request);
+		}
+	}
+	workStart.notify_all();
+
+	// Step 4: Evict over the budget, and list the chunks to draw
+	Evict();
+	drawList.clear();
+	for (auto& entry : resident) {
+		if (entry.second->lastUsed == updateCount) drawList.push_back(entry.second);
+	}
+}
+
+// Evicting the least recently used chunks until the resident chunks fit the budget
+// Chunks needed by this update are never evicted, so the budget is exceeded while the load distance needs more.
+void TerrainChunks::Evict() {
+	if (GetMemoryBytes() <= memoryBudget) return;
+	std::vector<Chunk*> candidates;
+	for (auto& entry : resident) {
+		if (entry.second->lastUsed != updateCount) candidates.push_back(entry.second);
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Chunk* a, const Chunk* b) { return a->lastUsed < b->lastUsed; });
+	for (Chunk* chunk : candidates) {
+		if (GetMemoryBytes() <= memoryBudget) break;
+		resident.erase(Key(chunk->x, chunk->z));
+		ReleaseChunk(chunk);
+		evictedCount++;
+	}
+}
+
+// Bilinear height in the resident chunk under a world x/z (the cell is clamped into the chunk, which only matters
+// on its far edges, shared with the next chunk)
+bool TerrainChunks::sampleHeight(float x, float z, float& height) const {
+	const int chunkX = (int)std::floor(x / chunkCells), chunkZ = (int)std::floor(z / chunkCells);
+	auto found = resident.find(Key(chunkX, chunkZ));
+	if (found == resident.end()) return false;
+	const Chunk* chunk = found->second;
+
+	const float sx = x - chunk->originX, sz = z - chunk->originZ;
+	const int cx = std::min(std::max((int)sx, 0), chunkCells - 1), cz = std::min(std::max((int)sz, 0), chunkCells - 1);
+	const float tx = sx - (float)cx, tz = sz - (float)cz;
+	const float* row = &chunk->heights[(size_t)(cz + chunkBorder) * chunkSamples + cx + chunkBorder];
+	const float h0 = row[0] + (row[1] - row[0]) * tx;
+	const float h1 = row[chunkSamples] + (row[chunkSamples + 1] - row[chunkSamples]) * tx;
+	height = h0 + (h1 - h0) * tz;
+	return true;
+}
+
+// Heights at many positions (resident chunks only)
+int TerrainChunks::SampleHeights(const float* xs, const float* zs, float* heights, int count) const {
+	int found = 0;
+	for (int i = 0; i < count; i++) {
+		if (sampleHeight(xs[i], zs[i], heights[i])) found++;
+	}
+	return found;
+}
+
+// Chunks queued, being generated or waiting for upload
+int TerrainChunks::GetPendingCount() {
+	std::lock_guard<std::mutex> lock(workMutex);
+	return (int)(queue.size() + generating.size());
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "SimplexNoise.h"
+#include "HeightField.h"
+
+// Class for an unbounded terrain streamed in square chunks around the camera
+// Chunks are generated on worker threads (nearest first, and those in front of the camera before those behind it),
+// uploaded into their own textures a few per frame, and kept in an LRU cache under a memory budget, so walking anywhere
+// uses the same memory. Each chunk stores one ring of border texels around its cells (for the gradients at its edges)
+// and shares its edge samples with its neighbours: every sample is the fBm of its world position alone, at noise
+// coordinates that are exact in floats, so neighbours evaluate their shared samples to the same bits and never crack.
+// The heights (and gradients) are plain fBm of the height map parameters: no smoothing, erosion or noise graph shapes,
+// which all depend on the samples around the chunk.
+// Queries (the camera, gravity and the coins) read the chunks uploaded so far and report unknown ground elsewhere.
+class TerrainChunks : public TerrainSurface {
+public:
+	// Cells per chunk side (one world unit each), border texels around them, and texels per side of a chunk texture
+	static const int chunkCells = 64;
+	static const int chunkBorder = 1;
+	static const int chunkSamples = chunkCells + 1 + 2 * chunkBorder;
+
+	// Noise coordinates per world unit: a power of two close to the height map's, so that the noise coordinates of every
+	// sample (whole world units times the scale) are exact
+	static constexpr float noiseScale = 1.f / 128.f;
+
+	// A generated chunk, covering world x in [originX, originX + chunkCells] (and z likewise)
+	struct Chunk {
+		int x, z;
+		float originX, originZ;
+		unsigned int generation;  // parameters it was generated with (see SetParameters)
+
+		// Heights (chunkSamples^2, row-major along z, sample (chunkBorder, chunkBorder) at the origin), kept for queries,
+		// and the height map (height, dh/dx, dh/dz, 0) and normal map texels, freed once uploaded
+		std::vector<float> heights;
+		std::vector<float> texels;
+		std::vector<uint32_t> normals;
+		float minHeight, maxHeight;
+		float generationTime;  // time to generate it on a worker (in ms)
+
+		// Textures of the chunk (immutable, created on the render thread)
+		ID3D11Texture2D* heightTexture;
+		ID3D11ShaderResourceView* heightSRV;
+		ID3D11Texture2D* normalTexture;
+		ID3D11ShaderResourceView* normalSRV;
+
+		// Last update that needed the chunk (least recently used chunks are evicted first)
+		unsigned long long lastUsed;
+	};
+
+	// Parameters of the heights (as the height map's: fBm frequency, amplitude and persistence, and the world seed)
+	struct Parameters {
+		float frequency, amplitude, persistence;
+		uint32_t seed;
+	};
+
+private:
+	Parameters parameters;
+	unsigned int generation;
+
+	// Chunks uploaded and queryable, keyed by their coordinates (render thread only)
+	std::unordered_map<uint64_t, Chunk*> resident;
+
+	// Resident chunks within the load distance of the last update, to draw
+	std::vector<const Chunk*> drawList;
+
+	// Distance (in world units, to the nearest point of a chunk) within which chunks are generated and kept, chunks
+	// uploaded per update, and memory budget of the resident chunks (chunks within the load distance are never evicted)
+	float loadDistance;
+	int uploadsPerUpdate;
+	size_t memoryBudget;
+
+	// Update counter (for the LRU), and chunks generated and evicted so far
+	unsigned long long updateCount;
+	unsigned long long generatedCount, evictedCount;
+	double generationTime;  // total time spent generating them on the workers (in ms)
+
+	// Chunk to generate, with its priority (lower first)
+	struct Request {
+		int x, z;
+		float priority;
+	};
+
+	// Worker threads: they take the best request of the queue (rebuilt by every update), and leave the chunk in the
+	// finished list until an update uploads it. Keys of the chunks being generated or waiting for upload are in
+	// generating, so they are not requested again.
+	std::vector<std::thread> workers;
+	std::mutex workMutex;
+	std::condition_variable workStart;
+	bool stopping;
+	std::vector<Request> queue;  // sorted by priority, best last
+	std::unordered_set<uint64_t> generating;
+	std::vector<Chunk*> finished;
+	SimplexNoise noise;
+	static const int maxWorkers = 4;
+
+	// Octaves of the fBm (as the height map's)
+	static const int heightOctaves = 15;
+
+	// method to pack chunk coordinates into a key
+	static uint64_t Key(int x, int z) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z; }
+
+	// method run by the worker threads
+	void WorkerLoop();
+
+	// method to generate the heights, texels and normals of a chunk
+	void GenerateChunk(Chunk& chunk, const SimplexNoise& chunkNoise, const Parameters& chunkParameters) const;
+
+	// methods to create the textures of a chunk (and free its texels), and to release them
+	void UploadChunk(ID3D11Device* device, Chunk& chunk);
+	static void ReleaseChunk(Chunk* chunk);
+
+	// method to get the distance from a world x/z to the nearest point of a chunk
+	static float ChunkDistance(int x, int z, float worldX, float worldZ);
+
+	// method to evict the least recently used chunks (not needed by this update) until the resident chunks fit the budget
+	void Evict();
+
+public:
+	// method to set the parameters of the heights: every chunk is regenerated (the resident ones are dropped)
+	void SetParameters(const Parameters& newParameters);
+
+	// method to stream the chunks around the camera (call once per frame): uploads finished chunks, queues the missing
+	// ones by priority, evicts over the budget and builds the draw list. forwardX/Z is the camera's view direction.
+	void Update(ID3D11Device* device, float cameraX, float cameraZ, float forwardX, float forwardZ);
+
+	// method to get the height at a world x/z, false where no chunk is resident (TerrainSurface)
+	bool sampleHeight(float x, float z, float& height) const override;
+
+	// method to get the heights at count world x/z positions, leaving the heights where no chunk is resident unchanged,
+	// returns the number of heights found
+	int SampleHeights(const float* xs, const float* zs, float* heights, int count) const;
+
+	// method to get the resident chunks within the load distance of the last update
+	const std::vector<const Chunk*>& GetDrawList() const { return drawList; }
+
+	// methods to get/set the load distance and the memory budget (in bytes)
+	float GetLoadDistance() const { return loadDistance; }
+	void SetLoadDistance(float distance) { loadDistance = distance; }
+	size_t GetMemoryBudget() const { return memoryBudget; }
+	void SetMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+	// methods to get the memory of a resident chunk (heights kept for queries and both textures), and of all of them
+	static size_t ChunkBytes();
+	size_t GetMemoryBytes() const { return resident.size() * ChunkBytes(); }
+
+	// methods to get the resident chunks, the chunks queued or being generated, and the chunks generated and evicted so far
+	int GetResidentCount() const { return (int)resident.size(); }
+	int GetPendingCount();
+	unsigned long long GetGeneratedCount() const { return generatedCount; }
+	unsigned long long GetEvictedCount() const { return evictedCount; }
+
+	// method to get the mean generation time of a chunk (in ms, on one worker)
+	double GetMeanGenerationTime() const { return generatedCount > 0 ? generationTime / generatedCount : 0.0; }
+
+	// method to get the texture coordinate transform of a chunk mesh (PlaneMesh of chunkCells + 1), so that its vertices
+	// land on the texel centres of their samples
+	static float GetTextureScale() { return (float)(chunkCells + 1) / chunkSamples; }
+	static float GetTextureOffset() { return (chunkBorder + 0.5f) / chunkSamples; }
+
+	TerrainChunks(const Parameters& initialParameters);
+	~TerrainChunks();
+};
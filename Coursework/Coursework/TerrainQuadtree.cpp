@@ -0,0 +1,282 @@
+#include "TerrainQuadtree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Constructor with initialisation (the LODs are set up by the first selection over a built pyramid)
+TerrainQuadtree::TerrainQuadtree(const HeightPyramid* heightPyramid, const Settings& initialSettings) {
+	pyramid = heightPyramid;
+	leafLevel = 0;
+	lodCount = 0;
+	cells = 0;
+	stats = { 0, 0, 0 };
+	SetSettings(initialSettings);
+}
+
+// Setting the settings, the LODs are set up again by the next selection
+void TerrainQuadtree::SetSettings(const Settings& newSettings) {
+	settings = newSettings;
+	int leafCells = 4;
+	while (leafCells * 2 <= settings.leafCells) leafCells *= 2;
+	settings.leafCells = leafCells;
+	cells = 0;
+}
+
+// Setting up the LODs: the leaves are leafCells cells across (fewer levels on small terrains), the root is the top of the
+// pyramid, and the range of every LOD is twice the one below
+void TerrainQuadtree::SetUpLods() {
+	cells = pyramid->GetLevelWidth(0);
+	const int topLevel = pyramid->GetLevelCount();
+	leafLevel = 0;
+	while ((2 << leafLevel) <= settings.leafCells && leafLevel < topLevel) leafLevel++;
+	lodCount = topLevel - leafLevel + 1;
+
+	const HeightField& field = pyramid->GetHeightField();
+	lodRanges.resize(lodCount);
+	morphStarts.resize(lodCount);
+	float range = settings.lodRangeRatio * (1 << leafLevel) * field.spacing;
+	float previous = 0.f;
+	for (int lod = 0; lod < lodCount; lod++) {
+		lodRanges[lod] = range;
+		morphStarts[lod] = previous + (range - previous) * settings.morphStartRatio;
+		previous = range;
+		range *= 2.f;
+	}
+}
+
+// Rectangle of a node: the cells it covers, clipped to the terrain
+void TerrainQuadtree::NodeRect(int level, int i, int j, float& x0, float& z0, float& x1, float& z1) const {
+	const HeightField& field = pyramid->GetHeightField();
+	const int span = 1 << level;
+	x0 = field.originX + i * span * field.spacing;
+	z0 = field.originZ + j * span * field.spacing;
+	x1 = field.originX + std::min((i + 1) * span, cells) * field.spacing;
+	z1 = field.originZ + std::min((j + 1) * span, cells) * field.spacing;
+}
+
+// Range test: distance from the observer to the nearest point of the rectangle
+bool TerrainQuadtree::InRange(const Selection& selection, float range, float x0, float z0, float x1, float z1) {
+	const float dx = std::max(std::max(x0 - selection.observerX, selection.observerX - x1), 0.f);
+	const float dz = std::max(std::max(z0 - selection.observerZ, selection.observerZ - z1), 0.f);
+	return dx * dx + dz * dz <= range * range;
+}
+
+// Selecting a node (Strugar's CDLOD): out of its range it is left to the parent, out of the frustum it is culled (and
+// handled), out of range of the finer LOD it is drawn whole, otherwise its children are selected and the quadrants of
+// those out of their range are drawn at this LOD
+bool TerrainQuadtree::SelectNode(const Selection& selection, int lod, int i, int j, bool inRange) {
+	const int level = leafLevel + lod;
+	float x0, z0, x1, z1;
+	NodeRect(level, i, j, x0, z0, x1, z1);
+	stats.visited++;
+	if (!inRange && !InRange(selection, lodRanges[lod], x0, z0, x1, z1)) return false;
+
+	float lo, hi;
+	pyramid->GetNodeBounds(level, i, j, lo, hi);
+	if (!selection.frustum->IntersectsBox(x0, lo, z0, x1, hi, z1)) {
+		stats.culled++;
+		return true;
+	}
+
+	const HeightField& field = pyramid->GetHeightField();
+	const float size = (1 << level) * field.spacing;
+	if (lod == 0 || !InRange(selection, lodRanges[lod - 1], x0, z0, x1, z1)) {
+		selection.nodes->push_back({ field.originX + i * size, field.originZ + j * size, size, lod, false, lo, hi });
+		return true;
+	}
+
+	const int childWidth = pyramid->GetLevelWidth(level - 1);
+	for (int cj = 2 * j; cj < std::min(2 * j + 2, childWidth); cj++) {
+		for (int ci = 2 * i; ci < std::min(2 * i + 2, childWidth); ci++) {
+			if (SelectNode(selection, lod - 1, ci, cj, false)) continue;
+
+			// Child out of its range: its quadrant is drawn at this LOD
+			float cx0, cz0, cx1, cz1, clo, chi;
+			NodeRect(level - 1, ci, cj, cx0, cz0, cx1, cz1);
+			pyramid->GetNodeBounds(level - 1, ci, cj, clo, chi);
+			if (!selection.frustum->IntersectsBox(cx0, clo, cz0, cx1, chi, cz1)) {
+				stats.culled++;
+				continue;
+			}
+			const float half = size * 0.5f;
+			selection.nodes->push_back({ field.originX + ci * half, field.originZ + cj * half, half, lod, true, clo, chi });
+		}
+	}
+	return true;
+}
+
+// Selecting from the root, which is always in range (the top LOD covers the whole terrain)
+int TerrainQuadtree::Select(const Frustum& frustum, float observerX, float observerZ, std::vector<Node>& nodes) {
+	nodes.clear();
+	stats = { 0, 0, 0 };
+	if (!pyramid->GetHeightField().isValid() || pyramid->GetLevelWidth(0) < 1) return 0;
+	if (pyramid->GetLevelWidth(0) != cells) SetUpLods();
+
+	Selection selection = { &frustum, observerX, observerZ, &nodes };
+	SelectNode(selection, lodCount - 1, 0, 0, true);
+	stats.selected = (int)nodes.size();
+	return stats.selected;
+}
+
+// Constants of a node: its grid (quadrants have half the grid cells over half the side, the cells of their LOD), the
+// morph of its LOD (none for the top one, out of range of the far end) and the terrain
+void TerrainQuadtree::GetNodeConstants(const Node& node, float observerX, float observerY, float observerZ, float textureScale, NodeConstants& constants) const {
+	const HeightField& field = pyramid->GetHeightField();
+	const int gridCells = node.quadrant ? settings.leafCells / 2 : settings.leafCells;
+	constants.nodeTransform[0] = node.x;
+	constants.nodeTransform[1] = node.z;
+	constants.nodeTransform[2] = node.size / gridCells;
+	constants.nodeTransform[3] = 1.f;
+
+	const bool top = node.lod >= lodCount - 1;
+	constants.morphParams[0] = top ? 1e30f : morphStarts[node.lod];
+	constants.morphParams[1] = top ? 2e30f : lodRanges[node.lod];
+	constants.morphParams[2] = textureScale;
+	constants.morphParams[3] = 0.f;
+
+	constants.terrainBounds[0] = field.originX;
+	constants.terrainBounds[1] = field.originZ;
+	constants.terrainBounds[2] = field.originX + cells * field.spacing;
+	constants.terrainBounds[3] = field.originZ + cells * field.spacing;
+
+	constants.observer[0] = observerX;
+	constants.observer[1] = observerY;
+	constants.observer[2] = observerZ;
+	constants.observer[3] = 0.f;
+}
+
+// Frustum planes of a view-projection (Gribb and Hartmann): with clip = v M, each plane is a sum or difference of columns
+TerrainQuadtree::Frustum TerrainQuadtree::Frustum::FromMatrix(const float* m) {
+	Frustum frustum;
+	for (int c = 0; c < 4; c++) {
+		const float col0 = m[c * 4 + 0], col1 = m[c * 4 + 1], col2 = m[c * 4 + 2], col3 = m[c * 4 + 3];
+		frustum.planes[0][c] = col3 + col0;  // left
+		frustum.planes[1][c] = col3 - col0;  // right
+		frustum.planes[2][c] = col3 + col1;  // bottom
+		frustum.planes[3][c] = col3 - col1;  // top
+		frustum.planes[4][c] = col2;         // near
+		frustum.planes[5][c] = col3 - col2;  // far
+	}
+	return frustum;
+}
+
+// Left-handed look-to view (y up, or z up when looking straight up or down) times a projection, row-major
+static void ViewProjection(const float* eye, const float* direction, const float* projection, float* out) {
+	float z[3] = { direction[0], direction[1], direction[2] };
+	const float zLength = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	for (float& v : z) v /= zLength;
+	const float up[3] = { 0.f, std::fabs(z[1]) > 0.999f ? 0.f : 1.f, std::fabs(z[1]) > 0.999f ? 1.f : 0.f };
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	const float xLength = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	for (float& v : x) v /= xLength;
+	const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	const float view[16] = {
+		x[0], y[0], z[0], 0.f,
+		x[1], y[1], z[1], 0.f,
+		x[2], y[2], z[2], 0.f,
+		-(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.f
+	};
+	for (int r = 0; r < 4; r++) {
+		for (int c = 0; c < 4; c++) {
+			float sum = 0.f;
+			for (int k = 0; k < 4; k++) sum += view[r * 4 + k] * projection[k * 4 + c];
+			out[r * 4 + c] = sum;
+		}
+	}
+}
+
+// Perspective camera (as XMMatrixLookToLH times XMMatrixPerspectiveFovLH)
+TerrainQuadtree::Frustum TerrainQuadtree::Frustum::Perspective(const float* eye, const float* direction, float fovY, float aspect, float nearZ, float farZ) {
+	const float yScale = 1.f / std::tan(fovY * 0.5f), xScale = yScale / aspect, q = farZ / (farZ - nearZ);
+	const float projection[16] = {
+		xScale, 0.f, 0.f, 0.f,
+		0.f, yScale, 0.f, 0.f,
+		0.f, 0.f, q, 1.f,
+		0.f, 0.f, -q * nearZ, 0.f
+	};
+	float m[16];
+	ViewProjection(eye, direction, projection, m);
+	return FromMatrix(m);
+}
+
+// Orthographic camera (as XMMatrixLookToLH times XMMatrixOrthographicLH)
+TerrainQuadtree::Frustum TerrainQuadtree::Frustum::Orthographic(const float* eye, const float* direction, float width, float height, float nearZ, float farZ) {
+	const float q = 1.f / (farZ - nearZ);
+	const float projection[16] = {
+		2.f / width, 0.f, 0.f, 0.f,
+		0.f, 2.f / height, 0.f, 0.f,
+		0.f, 0.f, q, 0.f,
+		0.f, 0.f, -q * nearZ, 1.f
+	};
+	float m[16];
+	ViewProjection(eye, direction, projection, m);
+	return FromMatrix(m);
+}
+
+// Box against the frustum: outside when the corner furthest along a plane's normal is behind it
+bool TerrainQuadtree::Frustum::IntersectsBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const {
+	for (const float* plane : planes) {
+		const float x = plane[0] >= 0.f ? maxX : minX;
+		const float y = plane[1] >= 0.f ? maxY : minY;
+		const float z = plane[2] >= 0.f ? maxZ : minZ;
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.f) return false;
+	}
+	return true;
+}
+
+// Selecting the nodes of views over a height field (building the pyramid is not part of the timing)
+// Cameras stand at random points over the terrain (from a fixed seed), a little above the highest height, looking 15 degrees
+// down along random yaws as far as the terrain is wide; the light looks down slightly tilted onto all of the terrain.
+TerrainQuadtree::SelectionBenchmark TerrainQuadtree::BenchmarkSelection(const HeightField& heightField, int viewCount, ThreadPool* pool) {
+	SelectionBenchmark result = {};
+	const size_t count = (size_t)heightField.size * heightField.size;
+	const float maxHeight = *std::max_element(heightField.heights, heightField.heights + count);
+
+	HeightPyramid pyramid;
+	pyramid.Refresh(heightField, pool);
+	TerrainQuadtree quadtree(&pyramid, Settings());
+
+	uint32_t state = 54321u;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / 16777216.f;
+	};
+	const float degrees = 3.14159265f / 180.f;
+	const float extent = heightField.getExtent();
+	const float lightEye[3] = { heightField.originX + extent * 0.5f, maxHeight + extent, heightField.originZ + extent * 0.5f };
+	const float lightDirection[3] = { 0.2f, -1.f, 0.1f };
+	const Frustum lightFrustum = Frustum::Orthographic(lightEye, lightDirection, extent * 1.5f, extent * 1.5f, 0.1f, extent * 3.f);
+	std::vector<Node> nodes;
+	double cameraSeconds = 0.0, lightSeconds = 0.0;
+	for (int view = 0; view < viewCount; view++) {
+		const float eye[3] = { heightField.originX + random() * extent, maxHeight + 0.02f * heightField.size * heightField.spacing, heightField.originZ + random() * extent };
+		const float yaw = random() * 360.f * degrees, pitch = 15.f * degrees;
+		const float direction[3] = { sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch) };
+		const Frustum frustum = Frustum::Perspective(eye, direction, 45.f * degrees, 16.f / 9.f, 0.1f, extent);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		result.cameraSelected += quadtree.Select(frustum, eye[0], eye[2], nodes);
+		cameraSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		result.cameraVisited += quadtree.GetStats().visited;
+		result.cameraCulled += quadtree.GetStats().culled;
+
+		startTime = std::chrono::high_resolution_clock::now();
+		result.lightSelected += quadtree.Select(lightFrustum, eye[0], eye[2], nodes);
+		lightSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		result.lightVisited += quadtree.GetStats().visited;
+		result.lightCulled += quadtree.GetStats().culled;
+	}
+	const float views = (float)std::max(viewCount, 1);
+	result.lods = quadtree.GetLodCount();
+	result.cameraSelected /= views;
+	result.cameraVisited /= views;
+	result.cameraCulled /= views;
+	result.cameraTime = (float)(cameraSeconds * 1e6 / views);
+	result.lightSelected /= views;
+	result.lightVisited /= views;
+	result.lightCulled /= views;
+	result.lightTime = (float)(lightSeconds * 1e6 / views);
+	return result;
+}
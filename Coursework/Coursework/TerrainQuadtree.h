@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include "HeightPyramid.h"
+
+// Class for continuous distance-dependent LOD (CDLOD) selection of terrain patches, over a min/max height pyramid
+// Every node of the quadtree is drawn with the same grid mesh (leafCells x leafCells grid cells), so the grid cells of a
+// node are twice the size of its children's. LOD l reaches lodRanges[l] from the observer (doubling per LOD): a node is
+// drawn whole when it is out of range of the next finer LOD, otherwise its children are selected, and the quadrants whose
+// children are out of their range are drawn at this LOD with the quarter mesh. Nodes are culled against the frustum of
+// the view with the height range of the pyramid, so light views select (and cull) their own nodes around the camera.
+// Over the last part of its range (morph start to end) a vertex morphs into the grid of the next coarser LOD, so nodes of
+// neighbouring LODs meet without cracks and LODs change without popping. Distances are measured in the xz plane, on the
+// CPU and in the vertex shader alike, so the morph needs no height fetch.
+// Selection only reads the pyramid: it follows the heights as soon as the pyramid is refreshed, and needs no device.
+class TerrainQuadtree {
+public:
+	// Settings of the quadtree
+	struct Settings {
+		int leafCells = 8;              // pyramid cells per side of a leaf node, and grid cells per side of the node mesh (power of two, at least 4)
+		float lodRangeRatio = 3.f;      // range of the finest LOD in leaf node sizes (kept well over 2, so neighbouring nodes differ by one LOD at most and meet fully morphed)
+		float morphStartRatio = 0.66f;  // start of the morph, as a fraction of the way from the range of the LOD below to the range of the LOD
+	};
+
+	// Selected node (or quadrant of a node), in world units
+	struct Node {
+		float x, z, size;  // min corner and side
+		int lod;           // 0 is the finest
+		bool quadrant;     // drawn with the quarter mesh (one quadrant of a node of this LOD)
+		float minHeight, maxHeight;
+	};
+
+	// View frustum as 6 planes (a, b, c, d), inside where a x + b y + c z + d >= 0
+	struct Frustum {
+		float planes[6][4];
+
+		// method to get the frustum of a view-projection matrix (row-major, row vectors times the matrix, clip z in [0, w])
+		static Frustum FromMatrix(const float* viewProjection);
+
+		// methods to get the frustum of a left-handed perspective/orthographic camera at an eye looking along a direction
+		static Frustum Perspective(const float* eye, const float* direction, float fovY, float aspect, float nearZ, float farZ);
+		static Frustum Orthographic(const float* eye, const float* direction, float width, float height, float nearZ, float farZ);
+
+		// method to test an axis-aligned box against the frustum (false when it is entirely outside one plane)
+		bool IntersectsBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const;
+	};
+
+	// Constants of a selected node for the vertex shader (TerrainNodeBuffer of VertexManipulation_vs)
+	struct NodeConstants {
+		float nodeTransform[4];  // min corner x/z, world units per grid cell, 1 (0 leaves the positions of other meshes as they are)
+		float morphParams[4];    // morph start/end distance, texture coordinates per world unit, 0
+		float terrainBounds[4];  // min x/z and max x/z of the terrain (vertices past its edges are clamped onto them)
+		float observer[4];       // position the LOD distances are measured from
+	};
+
+	// Nodes visited, selected and culled by the last selection
+	struct SelectionStats {
+		int visited, selected, culled;
+	};
+
+	// LODs of the quadtree, and nodes selected, visited and culled per camera view (mean over the views) with the time per
+	// selection (in microseconds), then the same for a light view over the whole terrain (LODs from the cameras)
+	struct SelectionBenchmark {
+		int lods;
+		float cameraSelected, cameraVisited, cameraCulled, cameraTime;
+		float lightSelected, lightVisited, lightCulled, lightTime;
+	};
+
+private:
+	const HeightPyramid* pyramid;
+	Settings settings;
+
+	// Pyramid level of the leaf nodes, LODs (the root is the top one), and the range and morph start of every LOD
+	// (set up for the pyramid size they were computed for)
+	int leafLevel;
+	int lodCount;
+	int cells;
+	std::vector<float> lodRanges;
+	std::vector<float> morphStarts;
+
+	// State of the selection in progress
+	struct Selection {
+		const Frustum* frustum;
+		float observerX, observerZ;
+		std::vector<Node>* nodes;
+	};
+	SelectionStats stats;
+
+	// method to set up the LODs for the size of the pyramid (when it changed)
+	void SetUpLods();
+
+	// method to get the world rectangle of node (i, j) of a pyramid level (clipped to the terrain)
+	void NodeRect(int level, int i, int j, float& x0, float& z0, float& x1, float& z1) const;
+
+	// method to select node (i, j) of a LOD or its descendants, returns false if it is out of range of its LOD (the
+	// parent draws its area instead)
+	bool SelectNode(const Selection& selection, int lod, int i, int j, bool inRange);
+
+	// method to test a rectangle against the circle of a range around the observer
+	static bool InRange(const Selection& selection, float range, float x0, float z0, float x1, float z1);
+
+public:
+	// method to set the settings (leafCells is rounded down to a power of two)
+	void SetSettings(const Settings& newSettings);
+	const Settings& GetSettings() const { return settings; }
+
+	// method to select the nodes to draw for a view: the nodes in its frustum, at the LODs of their xz distance to the
+	// observer (the camera, for light views too), returns the number of nodes
+	int Select(const Frustum& frustum, float observerX, float observerZ, std::vector<Node>& nodes);
+
+	// method to get the constants of a node for the vertex shader (textureScale: texture coordinates per world unit)
+	void GetNodeConstants(const Node& node, float observerX, float observerY, float observerZ, float textureScale, NodeConstants& constants) const;
+
+	// methods to get the LODs, and the range and morph start of a LOD (the top LOD never morphs)
+	int GetLodCount() const { return lodCount; }
+	float GetLodRange(int lod) const { return lodRanges[lod]; }
+	float GetMorphStart(int lod) const { return morphStarts[lod]; }
+
+	// method to get the stats of the last selection
+	const SelectionStats& GetStats() const { return stats; }
+
+	// method to time the selection of viewCount views over a height field (with the default settings)
+	static SelectionBenchmark BenchmarkSelection(const HeightField& heightField, int viewCount, ThreadPool* pool = nullptr);
+
+	TerrainQuadtree(const HeightPyramid* heightPyramid, const Settings& initialSettings);
+};
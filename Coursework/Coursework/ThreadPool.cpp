@@ -0,0 +1,152 @@
+#include "ThreadPool.h"
+
+// Constructor with initialisation
+ThreadPool::ThreadPool(int threadCount) {
+	jobTask = nullptr;
+	jobCount = jobBlockSize = jobBlocks = 0;
+	nextBlock = 0;
+	blocksDone = activeWorkers = 0;
+	jobId = 0;
+	stopping = false;
+
+	StartWorkers(threadCount);
+}
+
+// Destructor
+ThreadPool::~ThreadPool() {
+	StopWorkers();
+}
+
+// Number of hardware threads (at least 1)
+int ThreadPool::GetHardwareThreadCount() {
+	unsigned int count = std::thread::hardware_concurrency();
+	return count > 0 ? (int)count : 1;
+}
+
+// Spawn threadCount - 1 workers, the calling thread being the last one
+void ThreadPool::StartWorkers(int threadCount) {
+	if (threadCount <= 0) threadCount = GetHardwareThreadCount();
+
+	stopping = false;
+	for (int i = 1; i < threadCount; i++) {
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+// Signal the workers to exit and wait for them
+void ThreadPool::StopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobStart.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+// Changing the thread count (waits for any running job first)
+void ThreadPool::SetThreadCount(int threadCount) {
+	if (threadCount <= 0) threadCount = GetHardwareThreadCount();
+	if (threadCount == GetThreadCount()) return;
+
+	std::lock_guard<std::mutex> call(callMutex);
+	StopWorkers();
+	StartWorkers(threadCount);
+}
+
+// Claiming and running blocks of the current job
+int ThreadPool::RunBlocks() {
+	int processed = 0;
+	for (;;) {
+		int block = nextBlock.fetch_add(1);
+		if (block >= jobBlocks) break;
+
+		int begin = block * jobBlockSize;
+		int end = begin + jobBlockSize < jobCount ? begin + jobBlockSize : jobCount;
+		(*jobTask)(begin, end);
+		processed++;
+	}
+	return processed;
+}
+
+// Worker thread: wait for a new job, help with it, report the blocks done
+void ThreadPool::WorkerLoop() {
+	unsigned long long seenJob = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobStart.wait(lock, [&] { return stopping || jobId != seenJob; });
+			if (stopping) return;
+			seenJob = jobId;
+			activeWorkers++;
+		}
+
+		int processed = RunBlocks();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			blocksDone += processed;
+			activeWorkers--;
+		}
+		jobDone.notify_all();
+	}
+}
+
+// Run task over [0, count) in blocks, using the workers and the calling thread
+void ThreadPool::ParallelFor(int count, int blockSize, const Task& task) {
+	if (count <= 0) return;
+	std::lock_guard<std::mutex> call(callMutex);
+	RunJob(count, blockSize, task);
+}
+
+// Run task over [0, count) in blocks if the pool is free, so a frame never waits on a long job from another thread
+bool ThreadPool::TryParallelFor(int count, int blockSize, const Task& task) {
+	std::unique_lock<std::mutex> call(callMutex, std::try_to_lock);
+	if (!call.owns_lock()) return false;
+	if (count > 0) RunJob(count, blockSize, task);
+	return true;
+}
+
+// Run task over [0, count) in blocks on the calling thread
+void ThreadPool::SerialFor(int count, int blockSize, const Task& task) {
+	if (blockSize < 1) blockSize = 1;
+	for (int begin = 0; begin < count; begin += blockSize) {
+		task(begin, begin + blockSize < count ? begin + blockSize : count);
+	}
+}
+
+// Run a job, handing its blocks to the workers and the calling thread
+void ThreadPool::RunJob(int count, int blockSize, const Task& task) {
+	if (blockSize < 1) blockSize = 1;
+	int blocks = (count + blockSize - 1) / blockSize;
+
+	// Running on the calling thread only, when there is nothing to share
+	if (workers.empty() || blocks == 1) {
+		SerialFor(count, blockSize, task);
+		return;
+	}
+
+	// Publishing the job
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobTask = &task;
+		jobCount = count;
+		jobBlockSize = blockSize;
+		jobBlocks = blocks;
+		nextBlock = 0;
+		blocksDone = 0;
+		jobId++;
+	}
+	jobStart.notify_all();
+
+	int processed = RunBlocks();
+
+	// Waiting until every block is done and no worker still looks at the job
+	std::unique_lock<std::mutex> lock(jobMutex);
+	blocksDone += processed;
+	jobDone.wait(lock, [&] { return blocksDone == jobBlocks && activeWorkers == 0; });
+	jobTask = nullptr;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Class for a small pool of worker threads
+// Splits a range of work items (rows, slabs, tiles) into fixed blocks that are handed out to the workers.
+// Every block is always processed by exactly one thread, so any work whose items are independent
+// produces the same result whatever the number of threads.
+class ThreadPool {
+public:
+	// Task called with a block of work items [begin, end)
+	typedef std::function<void(int begin, int end)> Task;
+
+private:
+	// Worker threads (the calling thread also takes part in ParallelFor)
+	std::vector<std::thread> workers;
+
+	// Lock and signals for handing a job to the workers and waiting for it to finish
+	std::mutex jobMutex;
+	std::condition_variable jobStart, jobDone;
+
+	// Serialises ParallelFor calls made from different threads
+	std::mutex callMutex;
+
+	// Current job
+	const Task* jobTask;
+	int jobCount, jobBlockSize, jobBlocks;
+	std::atomic<int> nextBlock;
+	int blocksDone, activeWorkers;
+	unsigned long long jobId;
+	bool stopping;
+
+	// method run by every worker thread
+	void WorkerLoop();
+
+	// method to process blocks of the current job until none are left, returns the number processed
+	int RunBlocks();
+
+	// method to run a job over [0, count) (called with callMutex held)
+	void RunJob(int count, int blockSize, const Task& task);
+
+	// methods to start and stop the worker threads
+	void StartWorkers(int threadCount);
+	void StopWorkers();
+
+public:
+	// method to run task over [0, count) in blocks of blockSize items, returns when every block is done
+	void ParallelFor(int count, int blockSize, const Task& task);
+
+	// method to run task like ParallelFor, unless another thread is in a ParallelFor (then returns false without running it)
+	bool TryParallelFor(int count, int blockSize, const Task& task);
+
+	// method to run task over [0, count) on the calling thread, in the same blocks as ParallelFor
+	// (the fallback of TryParallelFor for work whose result depends on the blocks)
+	static void SerialFor(int count, int blockSize, const Task& task);
+
+	// method to get the number of threads used (workers and the calling thread)
+	int GetThreadCount() { return (int)workers.size() + 1; }
+
+	// method to change the number of threads used (0 uses every hardware thread)
+	void SetThreadCount(int threadCount);
+
+	// method to get the number of hardware threads
+	static int GetHardwareThreadCount();
+
+	// Constructor with the number of threads (0 uses every hardware thread)
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+};
@@ -117,7 +117,7 @@ OutputType main(ConstantOutputType input, float3 uvwCoord : SV_DomainLocation, c
     output.depthPosition = output.position;
     
     // Set the vertex manipulation data (for passing through the height map strength)
-    output.vertexManipulationData = 30.f; // Height map strength value
+    output.vertexManipulationData = 30.f; // Height map strength value (the normal map is baked for it, PerlinNoiseTexture::terrainHeightScale)
 
     // Send the input color into the pixel shader.
     output.tex = UV; // Set texture coordinates
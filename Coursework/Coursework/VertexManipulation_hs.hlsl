@@ -47,7 +47,7 @@ struct OutputType
 // This function calculates the tessellation factor based on the distance between the camera and the midpoint of the triangle's edges.
 float CalculateTessellationFactor(float3 pointA, float3 pointB, float3 camPosition)
 {
-    float3 edgeMidpoint = (pointA + pointB) * 0.5; // Midpoint of the edge
+    float3 edgeMidpoint = mul(float4((pointA + pointB) * 0.5, 1.0f), worldMatrix).xyz; // Midpoint of the edge in world space (terrain chunks share one mesh)
 
     float distance = length(camPosition - edgeMidpoint); // Distance from the camera to the edge midpoint
 
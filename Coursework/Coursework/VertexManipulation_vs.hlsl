@@ -1,3 +1,12 @@
+// Terrain quadtree node being drawn (all zeros for other meshes, whose vertices pass through unchanged)
+cbuffer TerrainNodeBuffer : register(b0)
+{
+    float4 nodeTransform; // Min corner x/z of the node, world units per grid cell, 1 for a node
+    float4 morphParams; // Morph start/end distance of the node's LOD, texture coordinates per world unit
+    float4 terrainBounds; // Min x/z and max x/z of the terrain (vertices past its edges are clamped onto them)
+    float4 observerPosition; // Position the LOD distances are measured from (the camera, in the light views too)
+};
+
 // Input structure to hold the vertex data for each input element
 struct InputType
 {
@@ -27,11 +36,28 @@ OutputType main(InputType input)
     // Create an output structure to hold the processed vertex data
     OutputType output;
 
-    // Pass the vertex position from input to the output (no modification here)
-    output.position = input.position;
-    
-    // Pass the texture coordinates from input to the output (no modification here)
-    output.tex = input.tex;
+    if (nodeTransform.w > 0.f)
+    {
+        // Quadtree node: the mesh positions are grid coordinates, odd ones slide onto the grid of the next coarser LOD
+        // as the xz distance goes from the morph start to the end
+        float2 grid = input.position.xz;
+        float2 worldXZ = nodeTransform.xy + grid * nodeTransform.z;
+        float morph = saturate((distance(worldXZ, observerPosition.xz) - morphParams.x) / (morphParams.y - morphParams.x));
+        grid -= frac(grid * 0.5f) * 2.f * morph;
+        worldXZ = clamp(nodeTransform.xy + grid * nodeTransform.z, terrainBounds.xy, terrainBounds.zw);
+
+        // World position (the domain shader adds the height) and the height map coordinates there
+        output.position = float3(worldXZ.x, 0.f, worldXZ.y);
+        output.tex = worldXZ * morphParams.z;
+    }
+    else
+    {
+        // Pass the vertex position from input to the output (no modification here)
+        output.position = input.position;
+
+        // Pass the texture coordinates from input to the output (no modification here)
+        output.tex = input.tex;
+    }
     
     // Return the processed output structure
     return output;
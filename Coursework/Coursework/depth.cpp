@@ -36,6 +36,11 @@ DepthShader::~DepthShader()
         camBuffer = 0;
     }
 
+    if (nodeBuffer) {
+        nodeBuffer->Release();
+        nodeBuffer = 0;
+    }
+
     // Release base shader components
     BaseShader::~BaseShader();
 }
@@ -79,6 +84,8 @@ void DepthShader::initShader(const wchar_t* vsFilename, const wchar_t* psFilenam
     cameraBufferDesc.MiscFlags = 0;
     cameraBufferDesc.StructureByteStride = 0;
     renderer->CreateBuffer(&cameraBufferDesc, NULL, &camBuffer);
+
+    nodeBuffer = nullptr;
 }
 
 void DepthShader::initShader(const wchar_t* vsFilename, const wchar_t* hsFilename, const wchar_t* dsFilename, const wchar_t* psFilename) {
@@ -86,13 +93,37 @@ void DepthShader::initShader(const wchar_t* vsFilename, const wchar_t* hsFilenam
     initShader(vsFilename, psFilename);
     loadHullShader(hsFilename);
     loadDomainShader(dsFilename);
+
+    // Setup the terrain node buffer description for the vertex shader
+    D3D11_BUFFER_DESC nodeBufferDesc;
+    nodeBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    nodeBufferDesc.ByteWidth = sizeof(TerrainQuadtree::NodeConstants);
+    nodeBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    nodeBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    nodeBufferDesc.MiscFlags = 0;
+    nodeBufferDesc.StructureByteStride = 0;
+    renderer->CreateBuffer(&nodeBufferDesc, NULL, &nodeBuffer);
+}
+
+void DepthShader::setNodeParameters(ID3D11DeviceContext* deviceContext, const TerrainQuadtree::NodeConstants* node)
+{
+    // Zeros leave the vertices of other meshes as they are
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    deviceContext->Map(nodeBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+    TerrainQuadtree::NodeConstants* nodePtr = (TerrainQuadtree::NodeConstants*)mappedResource.pData;
+    if (node) *nodePtr = *node;
+    else *nodePtr = TerrainQuadtree::NodeConstants();
+    deviceContext->Unmap(nodeBuffer, 0);
+    deviceContext->VSSetConstantBuffers(0, 1, &nodeBuffer);
 }
 
-void DepthShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap)
+void DepthShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap, const TerrainQuadtree::NodeConstants* node)
 {
     D3D11_MAPPED_SUBRESOURCE mappedResource;
     MatrixBufferType* dataPtr;
 
+    setNodeParameters(deviceContext, node);
+
     // Transpose the matrices for shader compatibility (since shaders expect column-major order)
     XMMATRIX tworld = XMMatrixTranspose(worldMatrix);
     XMMATRIX tview = XMMatrixTranspose(viewMatrix);
@@ -130,11 +161,13 @@ void DepthShader::setShaderParametersTess(ID3D11DeviceContext* deviceContext, co
     deviceContext->DSSetSamplers(0, 1, &sampleState);
 }
 
-void DepthShader::setShaderParametersLinearDepthTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap)
+void DepthShader::setShaderParametersLinearDepthTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap, const TerrainQuadtree::NodeConstants* node)
 {
     D3D11_MAPPED_SUBRESOURCE mappedResource;
     MatrixBufferType* dataPtr;
 
+    setNodeParameters(deviceContext, node);
+
     // Transpose the matrices for shader compatibility (since shaders expect column-major order)
     XMMATRIX tworld = XMMatrixTranspose(worldMatrix);
     XMMATRIX tview = XMMatrixTranspose(viewMatrix);
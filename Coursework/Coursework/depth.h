@@ -4,6 +4,7 @@
 #pragma once
 
 #include "DXF.h" // Include base DirectX framework.
+#include "TerrainQuadtree.h" // Constants of the terrain quadtree nodes
 
 using namespace std;
 using namespace DirectX;
@@ -27,14 +28,15 @@ public:
     // Set shader parameters for tessellated rendering
     void setShaderParametersTess(ID3D11DeviceContext* deviceContext,
         const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection,
-        XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap);
+        XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap,
+        const TerrainQuadtree::NodeConstants* node = nullptr);  // quadtree node drawn with the node mesh, nullptr for other meshes
 
     // Set shader parameters for non-tessellated rendering
     void setShaderParameters(ID3D11DeviceContext* deviceContext,
         const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection);
 
     // Set shader parameters for linear depth of tessellated objects
-    void setShaderParametersLinearDepthTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap);
+    void setShaderParametersLinearDepthTess(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos, ID3D11ShaderResourceView* heightMap, const TerrainQuadtree::NodeConstants* node = nullptr);
 
     // Set shader parameters for linear depth of non-tessellated objects
     void setShaderParametersLinearDepth(ID3D11DeviceContext* deviceContext, const XMMATRIX& worldMatrix, const XMMATRIX& viewMatrix, const XMMATRIX& projectionMatrix, XMFLOAT3 camPos);
@@ -46,10 +48,14 @@ private:
     // Initialize the shader for non-tessellated rendering
     void initShader(const wchar_t* vs, const wchar_t* ps);
 
+    // Upload a terrain quadtree node for the vertex shader (zeros for other meshes)
+    void setNodeParameters(ID3D11DeviceContext* deviceContext, const TerrainQuadtree::NodeConstants* node);
+
 private:
     // Constant buffers
     ID3D11Buffer* camBuffer;      // Buffer for camera-specific data
     ID3D11Buffer* matrixBuffer;   // Buffer for transformation matrices
+    ID3D11Buffer* nodeBuffer;     // Buffer for the terrain quadtree node (tessellated only)
 
     // Sampler state for texture sampling
     ID3D11SamplerState* sampleState;
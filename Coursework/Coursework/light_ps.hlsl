@@ -6,11 +6,14 @@ Texture2D grassTexture : register(t0); // The main texture
 Texture2D rockTexture : register(t1); // The main texture
 Texture2D snowTexture : register(t2); // The main texture
 SamplerState sampler0 : register(s0); // The sampler for the texture
-Texture2D heightMap : register(t3); // The height map texture used for terrain manipulation
+Texture2D normalMap : register(t3); // The terrain normals (xyz) and slope (w) baked from the height map
 
 // Depth map textures for each light source (used for shadow mapping)
 Texture2D depthMapTexture[lightSize] : register(t4);
 
+// Horizon angles of the terrain towards 8 azimuths (every 45 degrees from +x towards +z, 4 per slice, in 90 degree units)
+Texture2DArray horizonMap : register(t6);
+
 // Constant buffer containing light properties
 cbuffer LightBuffer : register(b0)
 {
@@ -29,7 +32,8 @@ cbuffer TexturingHeights : register(b1)
     float2 grassHeights;
     float2 rockHeights;
     float2 snowHeights;
-    float2 padding;
+    float horizonShadows; // 1 to shadow the terrain from the directional light with the horizon map
+    float padding;
 }
 
 // Structure to hold the input data for the vertex shader
@@ -164,56 +168,33 @@ float4 calcDirectionalLighting(float4 lightDirection, float3 normal, float4 diff
     return colour; // return the final colour
 }
 
-// Function to get the height from the height map at the given UV coordinates.
-// Uses vertexManipulationData.x as a scaling factor for the height.
-float GetHeight(float2 UV, float4 vertexManipulationData)
+// Function to get the normal vector at a given UV coordinate from the normal map.
+// The normals are baked on the CPU from the analytic height gradients (for the domain shader's height scale of 30),
+// so one tap gives the normal; it is renormalised after filtering and 8-bit quantisation.
+float3 CalcNormal(float2 UV)
 {
-    // Sample the height map at the given UV coordinates.
-    float offset = heightMap.SampleLevel(sampler0, UV, 0).r;
-
-    // Return the height value scaled by the vertex manipulation factor (x component).
-    return offset * vertexManipulationData.x;
+    return normalize(normalMap.SampleLevel(sampler0, UV, 0).xyz);
 }
 
-// Function to calculate the normal vector at a given UV coordinate based on the height map.
-// Uses vertex manipulation data for scaling.
-float3 CalcNormal(float2 UV, float4 vertexManipulationData)
+// Function to get how much of the sun is above the terrain's horizon at the given UV coordinates (1 lit, 0 shadowed).
+// Blends the horizons of the two azimuths around the sun's, and softens the edge over 2 degrees of sun elevation.
+float HorizonVisibility(float2 UV, float3 toSun)
 {
-    float tw = 256.0f; // Texture width (height map dimensions)
-    float val;
-
-    // Get the dimensions of the height map (assuming square texture).
-    heightMap.GetDimensions(0, tw, tw, val);
-
-    // Calculate UV offset (sub-sampling rate).
-    float uvOff = 1.f / tw;
-
-    // World space step size, which affects the normal calculation.
-    float worldStep = 50.0f * uvOff;
-
-    // Get height values at adjacent points in world space.
-    float heightUp = GetHeight(float2(UV.x, UV.y + uvOff), vertexManipulationData);
-    float heightDown = GetHeight(float2(UV.x, UV.y - uvOff), vertexManipulationData);
-    float heightRight = GetHeight(float2(UV.x + uvOff, UV.y), vertexManipulationData);
-    float heightLeft = GetHeight(float2(UV.x - uvOff, UV.y), vertexManipulationData);
-
-    // Get the height at the current point.
-    float height = GetHeight(UV, vertexManipulationData);
-
-    // Calculate tangent vectors based on neighboring heights (for cross-product normal calculation).
-    float3 tan1 = normalize(float3(1.0f * worldStep, heightRight - height, 0)); // Right direction
-    float3 tan2 = normalize(float3(-1.0f * worldStep, heightLeft - height, 0)); // Left direction
-    float3 bitan1 = normalize(float3(0, heightUp - height, 1.0f * worldStep)); // Up direction
-    float3 bitan2 = normalize(float3(0, heightDown - height, -1.0f * worldStep)); // Down direction
-
-    // Calculate normals using cross products of tangent vectors.
-    float3 normal1 = normalize(cross(tan1, bitan2));
-    float3 normal2 = normalize(cross(bitan2, tan2));
-    float3 normal3 = normalize(cross(tan2, bitan1));
-    float3 normal4 = normalize(cross(bitan1, tan1));
-
-    // Combine the normals from all four cross products and normalize.
-    return (normal1 + normal2 + normal3 + normal4) * .25f;
+    // Azimuth of the sun in steps of 45 degrees
+    float azimuth = atan2(toSun.z, toSun.x) * (4.0f / 3.14159265f);
+    azimuth = azimuth < 0.0f ? azimuth + 8.0f : azimuth;
+    int first = (int)azimuth % 8;
+    int second = (first + 1) % 8;
+
+    // Horizon angles towards both azimuths (the channel of each azimuth picked with a mask)
+    float4 horizons0 = horizonMap.SampleLevel(sampler0, float3(UV, first / 4), 0);
+    float4 horizons1 = horizonMap.SampleLevel(sampler0, float3(UV, second / 4), 0);
+    float horizon0 = dot(horizons0, float4(int4(0, 1, 2, 3) == (first % 4)));
+    float horizon1 = dot(horizons1, float4(int4(0, 1, 2, 3) == (second % 4)));
+    float horizon = lerp(horizon0, horizon1, frac(azimuth)) * 1.5707963f;
+
+    float elevation = asin(saturate(toSun.y));
+    return smoothstep(horizon - 0.0175f, horizon + 0.0175f, elevation);
 }
 
 // Main pixel shader function
@@ -221,7 +202,7 @@ float3 CalcNormal(float2 UV, float4 vertexManipulationData)
 float4 main(InputType input) : SV_TARGET
 {
     // Calculate the normal using the texture and vertex manipulation data
-    float3 newNormal = CalcNormal(input.tex, input.vertexManipulationData);
+    float3 newNormal = CalcNormal(input.tex);
     float3 normal;
     normal = newNormal;
     
@@ -257,6 +238,13 @@ float4 main(InputType input) : SV_TARGET
         // Calculate projective texture coordinates for shadow mapping
         pTexCoord = getProjectiveCoords(input.lightViewPos[i]);
         
+        // Terrain self-shadowing from the directional light (the sun) by its horizon: the terrain is then left out of the
+        // sun's shadow map, which still holds the shadows of the objects
+        float visibility = 1.0f;
+        bool horizon = horizonShadows == 1.0f && type[i].y == 1.0f;
+        if (horizon)
+            visibility = HorizonVisibility(input.tex, -lightDirectionNor[i].xyz);
+
         // Check if the texture coordinates are within valid depth map range
         if (hasDepthData(pTexCoord))
         {
@@ -264,9 +252,9 @@ float4 main(InputType input) : SV_TARGET
             if (!isInShadow(depthMapTexture[i], pTexCoord, input.lightViewPos[i], shadowMapBias))
             {
                 // Add contributions from different types of lighting: directional, spot, and specular
-                lightColour = saturate(lightColour + calcDirectionalLighting(lightDirectionNor[i], normal, diffuseColour[i], type[i]));
+                lightColour = saturate(lightColour + calcDirectionalLighting(lightDirectionNor[i], normal, diffuseColour[i], type[i]) * visibility);
                 lightColour = saturate(lightColour + calcSpotLighting(lightDirectionNor[i], lightVector[i], normal, distance[i], diffuseColour[i], attFactors[i], type[i]));
-                lightColour = saturate(lightColour + calcSpecularLighting(lightDirectionNor[i].xyz, normal, input.viewVector, type[i], specularColour[i], specularPower[i]));
+                lightColour = saturate(lightColour + calcSpecularLighting(lightDirectionNor[i].xyz, normal, input.viewVector, type[i], specularColour[i], specularPower[i]) * visibility);
             }
         }
     }
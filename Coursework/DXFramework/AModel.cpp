@@ -11,6 +11,11 @@ AModel::~AModel()
 
 }
 
+size_t AModel::getCpuBytes()
+{
+	return vertices.capacity() * sizeof(VertexType) + indices.capacity() * sizeof(unsigned long);
+}
+
 void AModel::initBuffers(ID3D11Device* device)
 {
 	
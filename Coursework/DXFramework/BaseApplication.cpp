@@ -10,6 +10,12 @@ BaseApplication::BaseApplication()
 // Release resources.
 BaseApplication::~BaseApplication()
 {
+	// Meshes first, while the renderer is alive
+	if (meshMgr)
+	{
+		delete meshMgr;
+		meshMgr = 0;
+	}
 
 	if (timer)
 	{
@@ -65,6 +71,9 @@ void BaseApplication::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int
 	textureMgr = new TextureManager(renderer->getDevice(), renderer->getDeviceContext());
 	//textureMgr->loadTexture(L"default", L"res/DefaultDiffuse.png");
 
+	// Initialise mesh manager (meshes are registered by the application and built on first use)
+	meshMgr = new MeshManager(renderer->getDevice(), renderer->getDeviceContext());
+
 	//Initialise ImGUI
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -85,6 +94,9 @@ bool BaseApplication::frame()
 
 	timer->frame();
 
+	// Release meshes unused by the last frame while over the mesh budget
+	meshMgr->frame();
+
 	handleInput(timer->getTime());
 
 	ImGui_ImplDX11_NewFrame();
@@ -2,6 +2,7 @@
 // Base mesh class, for inheriting base mesh functionality.
 
 #include "basemesh.h"
+#include "VertexCache.h"
 
 BaseMesh::BaseMesh()
 {
@@ -9,6 +10,11 @@ BaseMesh::BaseMesh()
 	indexBuffer = nullptr;
 	vertexCount = 0;
 	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	acmr = 0.f;
+	atvr = 0.f;
+	vertexFormat = VertexPacking::FullVertex;
+	quantisation = { XMFLOAT3(1.f, 1.f, 1.f), XMFLOAT3(0.f, 0.f, 0.f) };
 
 }
 
@@ -33,6 +39,123 @@ int BaseMesh::getIndexCount()
 	return indexCount;
 }
 
+int BaseMesh::getVertexCount()
+{
+	return vertexCount;
+}
+
+size_t BaseMesh::getVertexBytes()
+{
+	return getVertexStride() * (size_t)vertexCount;
+}
+
+VertexPacking::Format BaseMesh::getVertexFormat()
+{
+	return vertexFormat;
+}
+
+unsigned int BaseMesh::getVertexStride()
+{
+	return VertexPacking::getStride(vertexFormat);
+}
+
+XMMATRIX BaseMesh::getPositionTransform()
+{
+	if (vertexFormat != VertexPacking::PackedVertex)
+	{
+		return XMMatrixIdentity();
+	}
+	return VertexPacking::getPositionTransform(quantisation);
+}
+
+size_t BaseMesh::getIndexBytes()
+{
+	return (indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int)) * (size_t)indexCount;
+}
+
+size_t BaseMesh::getCpuBytes()
+{
+	return 0;
+}
+
+float BaseMesh::getACMR()
+{
+	return acmr;
+}
+
+float BaseMesh::getATVR()
+{
+	return atvr;
+}
+
+// Create the buffers of an indexed triangle list, measuring its reuse on the post-transform cache.
+void BaseMesh::createIndexedBuffers(ID3D11Device* device, const VertexType* vertices, int lvertexCount, const std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned short> shortIndices;
+	std::vector<VertexPacking::Packed> packedVertices;
+	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA vertexData, indexData;
+
+	vertexCount = lvertexCount;
+	indexCount = (int)indices.size();
+	VertexCache::Stats stats = VertexCache::simulate(indices.data(), indexCount, vertexCount);
+	acmr = stats.acmr;
+	atvr = stats.atvr;
+
+	// 16-bit indices when every vertex can be addressed (0xFFFF is left out, it cuts strips).
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	if (vertexCount <= 0xFFFF)
+	{
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		shortIndices.assign(indices.begin(), indices.end());
+	}
+
+	// Packed vertices are quantised over the bounds of the mesh.
+	const void* vertexSource = vertices;
+	if (vertexFormat == VertexPacking::PackedVertex)
+	{
+		quantisation = VertexPacking::fitPositions(vertices, vertexCount);
+		packedVertices.resize(vertexCount);
+		VertexPacking::encode(vertices, vertexCount, quantisation, packedVertices.data());
+		vertexSource = packedVertices.data();
+	}
+
+	// Set up the description of the static vertex buffer.
+	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	vertexBufferDesc.ByteWidth = (UINT)getVertexBytes();
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+	// Give the subresource structure a pointer to the vertex data.
+	vertexData.pSysMem = vertexSource;
+	vertexData.SysMemPitch = 0;
+	vertexData.SysMemSlicePitch = 0;
+	// Now create the vertex buffer.
+	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
+
+	// Set up the description of the static index buffer.
+	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	indexBufferDesc.ByteWidth = (UINT)getIndexBytes();
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+	// Give the subresource structure a pointer to the index data.
+	if (indexFormat == DXGI_FORMAT_R16_UINT)
+	{
+		indexData.pSysMem = shortIndices.data();
+	}
+	else
+	{
+		indexData.pSysMem = indices.data();
+	}
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+	// Create the index buffer.
+	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
+}
+
 // Sends geometry data to the GPU. Default primitive topology is TriangleList.
 // To render alternative topologies this function needs to be overwritten.
 void BaseMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top)
@@ -41,11 +164,11 @@ void BaseMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLO
 	unsigned int offset;
 	
 	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
+	stride = getVertexStride();
 	offset = 0;
 
 	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 	deviceContext->IASetPrimitiveTopology(top);
 }
 
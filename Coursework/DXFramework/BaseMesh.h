@@ -14,6 +14,8 @@
 
 #include <d3d11.h>
 #include <directxmath.h>
+#include <vector>
+#include "VertexPacking.h"
 
 using namespace DirectX;
 
@@ -21,13 +23,8 @@ class BaseMesh
 {
 protected:
 
-	/// Default struct for general vertex data include position, texture coordinates and normals
-	struct VertexType
-	{
-		XMFLOAT3 position;
-		XMFLOAT2 texture;
-		XMFLOAT3 normal;
-	};
+	/// Default struct for general vertex data include position, texture coordinates and normals (packed by meshes of the packed format)
+	typedef VertexPacking::Vertex VertexType;
 
 	/// Default vertex struct for geometry with only position and colour
 	struct VertexType_Colour
@@ -46,19 +43,35 @@ protected:
 public:
 	/// Empty constructor
 	BaseMesh();
-	~BaseMesh();
+	virtual ~BaseMesh();
 
 	/// Transfers mesh data to the GPU.
 	virtual void sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	int getIndexCount();			///< Returns total index value of the mesh
+	int getVertexCount();			///< Returns the number of vertices in the vertex buffer
+	size_t getVertexBytes();		///< Returns the size of the vertex buffer in bytes
+	VertexPacking::Format getVertexFormat();	///< Returns the format of the vertex buffer (the input layout of the shaders drawing the mesh)
+	unsigned int getVertexStride();	///< Returns the bytes per vertex
+	XMMATRIX getPositionTransform();	///< Returns the transform dequantising packed positions, to apply ahead of the world matrix (identity for full vertices)
+	size_t getIndexBytes();			///< Returns the size of the index buffer in bytes
+	virtual size_t getCpuBytes();	///< Returns the size of the geometry kept in CPU memory once uploaded (none unless the mesh keeps it)
+	float getACMR();				///< Returns the vertices transformed per triangle as indexed (see VertexCache), 0 if not measured
+	float getATVR();				///< Returns the vertices transformed per vertex used as indexed (see VertexCache), 0 if not measured
 	//D3D11_INPUT_ELEMENT_DESC getInputLayout();
 
 protected:
 	virtual void initBuffers(ID3D11Device*) = 0;
 
+	/// Creates the vertex buffer (packed in the packed format) and the index buffer of a triangle list (16-bit when every vertex can be addressed), and measures its vertex reuse
+	void createIndexedBuffers(ID3D11Device* device, const VertexType* vertices, int vertexCount, const std::vector<unsigned int>& indices);
+
 	ID3D11Buffer *vertexBuffer, *indexBuffer;
 	//D3D11_INPUT_ELEMENT_DESC *inputLayout;
 	int vertexCount, indexCount;
+	DXGI_FORMAT indexFormat;		///< Format of the index buffer, DXGI_FORMAT_R32_UINT unless the mesh builds 16-bit indices
+	float acmr, atvr;				///< Vertex cache stats of the index buffer, set by the meshes that measure them
+	VertexPacking::Format vertexFormat;	///< Format of the vertex buffer, FullVertex unless set before creating the buffers with createIndexedBuffers
+	VertexPacking::Quantisation quantisation;	///< Dequantisation of the packed positions
 };
 
 #endif
\ No newline at end of file
@@ -51,7 +51,7 @@ BaseShader::~BaseShader()
 }
 
 // Given pre-compiled file, load and create vertex shader.
-void BaseShader::loadVertexShader(const wchar_t* filename)
+void BaseShader::loadVertexShader(const wchar_t* filename, VertexPacking::Format format)
 {
 	ID3DBlob* vertexShaderBuffer;
 	
@@ -95,16 +95,9 @@ void BaseShader::loadVertexShader(const wchar_t* filename)
 	// Create the vertex shader from the buffer.
 	renderer->CreateVertexShader(vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), NULL, &vertexShader);
 	
-	// Create the vertex input layout description.
-	// This setup needs to match the VertexType stucture in the MeshClass and in the shader.
-	D3D11_INPUT_ELEMENT_DESC polygonLayout[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	// Get a count of the elements in the layout.
-	numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
+	// Get the vertex input layout description, and its count of elements.
+	// This setup needs to match the vertex format of the meshes drawn with the shader (see VertexPacking) and the shader.
+	const D3D11_INPUT_ELEMENT_DESC* polygonLayout = VertexPacking::getInputLayout(format, numElements);
 
 	// Create the vertex input layout.
 	renderer->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), &layout);
@@ -1,6 +1,8 @@
 // Camera class
 // Represents a single 3D camera with basic movement.
 #include "camera.h"
+#include <chrono>
+#include <vector>
 
 // Configure defaul camera (including positions, rotation and ortho matrix)
 Camera::Camera()
@@ -116,7 +118,37 @@ float Camera::lerp(const float& a, const float& b, float t){
 	return a + t * (b - a);  // Linearly interpolate between a and b.
 }
 
-void Camera::moveForward(std::vector<float> heightData, int size, bool flightMode)
+void Camera::moveTo(const XMFLOAT3& predPos, const TerrainSurface* terrain, bool flightMode)
+{
+	if (flightMode) {
+		position.x = predPos.x;
+		position.z = predPos.z;
+		return;
+	}
+
+	// Walking needs terrain to follow
+	if (!terrain) {
+		return;
+	}
+
+	// Sample terrain height (bilinear, like the rendered surface), only known inside the terrain's bounds
+	// (the edge of a height field, or the chunks of a streamed terrain generated so far)
+	float terrainHeight;
+	if (terrain->sampleHeight(predPos.x, predPos.z, terrainHeight))
+	{
+		// Safe to move - update position
+		// Move XZ
+		position.x = predPos.x;
+		position.z = predPos.z;
+
+		// Smooth Y interpolation
+		float targetY = terrainHeight + 3.0f;
+		float smoothing = 0.05f;
+		position.y = lerp(position.y, targetY, smoothing);
+	}
+}
+
+void Camera::moveForward(const TerrainSurface* terrain, bool flightMode)
 {
 	float radians = rotation.y * 0.0174532f;
 
@@ -126,38 +158,10 @@ void Camera::moveForward(std::vector<float> heightData, int size, bool flightMod
 	predPos.x += sinf(radians) * speed;
 	predPos.z += cosf(radians) * speed;
 
-	if (!flightMode) {
-		// Terrain boundaries
-		bool insideBounds =
-			predPos.x >= 0 && predPos.x < (float)(size - 1) &&
-			predPos.z >= 0 && predPos.z < (float)(size - 1);
-
-		if (insideBounds)
-		{
-			// Safe to move  update position
-			int gridX = (int)predPos.x;
-			int gridZ = (int)predPos.z;
-
-			// Sample terrain height
-			float terrainHeight = heightData[(gridZ * size) + gridX];
-
-			// Move XZ
-			position.x = predPos.x;
-			position.z = predPos.z;
-
-			// Smooth Y interpolation
-			float targetY = terrainHeight + 3.0f;
-			float smoothing = 0.05f;
-			position.y = lerp(position.y, targetY, smoothing);
-		}
-	}
-	else {
-		position.x = predPos.x;
-		position.z = predPos.z;
-	}
+	moveTo(predPos, terrain, flightMode);
 }
 
-void Camera::moveBackward(std::vector<float> heightData, int size, bool flightMode)
+void Camera::moveBackward(const TerrainSurface* terrain, bool flightMode)
 {
 	float radians = rotation.y * 0.0174532f;
 
@@ -167,35 +171,7 @@ void Camera::moveBackward(std::vector<float> heightData, int size, bool flightMo
 	predPos.x -= sinf(radians) * speed;
 	predPos.z -= cosf(radians) * speed;
 
-	if (!flightMode) {
-		// Terrain boundaries
-		bool insideBounds =
-			predPos.x >= 0 && predPos.x < (float)(size - 1) &&
-			predPos.z >= 0 && predPos.z < (float)(size - 1);
-
-		if (insideBounds)
-		{
-			// Safe to move  update position
-			int gridX = (int)predPos.x;
-			int gridZ = (int)predPos.z;
-
-			// Sample terrain height
-			float terrainHeight = heightData[(gridZ * size) + gridX];
-
-			// Move XZ
-			position.x = predPos.x;
-			position.z = predPos.z;
-
-			// Smooth Y interpolation
-			float targetY = terrainHeight + 3.0f;
-			float smoothing = 0.05f;
-			position.y = lerp(position.y, targetY, smoothing);
-		}
-	}
-	else {
-		position.x = predPos.x;
-		position.z = predPos.z;
-	}
+	moveTo(predPos, terrain, flightMode);
 }
 
 void Camera::moveUpward()
@@ -291,7 +267,7 @@ void Camera::turn(int x, int y)
 	rotation.x += (float)y/lookSpeed;// m_speed * y;
 }
 
-void Camera::strafeRight(std::vector<float> heightData, int size, bool flightMode)
+void Camera::strafeRight(const TerrainSurface* terrain, bool flightMode)
 {
 	float radians = rotation.y * 0.0174532f;
 
@@ -301,75 +277,63 @@ void Camera::strafeRight(std::vector<float> heightData, int size, bool flightMod
 	predPos.x += cosf(radians) * speed;
 	predPos.z -= sinf(radians) * speed;
 
-	if (!flightMode) {
-		// Terrain boundaries
-		bool insideBounds =
-			predPos.x >= 0 && predPos.x < (float)(size - 1) &&
-			predPos.z >= 0 && predPos.z < (float)(size - 1);
-
-		if (insideBounds)
-		{
-			// Safe to move  update position
-			int gridX = (int)predPos.x;
-			int gridZ = (int)predPos.z;
-
-			// Sample terrain height
-			float terrainHeight = heightData[(gridZ * size) + gridX];
-
-			// Move XZ
-			position.x = predPos.x;
-			position.z = predPos.z;
-
-			// Smooth Y interpolation
-			float targetY = terrainHeight + 3.0f;
-			float smoothing = 0.05f;
-			position.y = lerp(position.y, targetY, smoothing);
-		}
-	}
-	else {
-		position.x = predPos.x;
-		position.z = predPos.z;
-	}
+	moveTo(predPos, terrain, flightMode);
 }
 
-void Camera::strafeLeft(std::vector<float> heightData, int size, bool flightMode)
+void Camera::strafeLeft(const TerrainSurface* terrain, bool flightMode)
 {
 	float radians = rotation.y * 0.0174532f;
 
 	// Predict next position
 	speed = frameTime * 10.f;
 	XMFLOAT3 predPos = position;
-	XMFLOAT3 right = { cosf(radians), 0, sinf(radians) };
 	predPos.x -= cosf(radians) * speed;
 	predPos.z += sinf(radians) * speed;
 
-	if (!flightMode) {
-		// Terrain boundaries
-		bool insideBounds =
-			predPos.x >= 0 && predPos.x < (float)(size - 1) &&
-			predPos.z >= 0 && predPos.z < (float)(size - 1);
-
-		if (insideBounds)
-		{
-			// Safe to move  update position
-			int gridX = (int)predPos.x;
-			int gridZ = (int)predPos.z;
-
-			// Sample terrain height
-			float terrainHeight = heightData[(gridZ * size) + gridX];
-
-			// Move XZ
-			position.x = predPos.x;
-			position.z = predPos.z;
-
-			// Smooth Y interpolation
-			float targetY = terrainHeight + 3.0f;
-			float smoothing = 0.05f;
-			position.y = lerp(position.y, targetY, smoothing);
-		}
+	moveTo(predPos, terrain, flightMode);
+}
+
+// Times the camera walking on a size x size terrain, in movement updates per second: reading the shared height field,
+// and copying the heights for every update (what passing the height vectors by value cost).
+Camera::MovementBenchmark Camera::benchmarkMovement(int size)
+{
+	std::vector<float> heights((size_t)size * size);
+	for (size_t i = 0; i < heights.size(); i++) heights[i] = (float)(i % 97) * 0.01f;
+	HeightField field;
+	field.heights = heights.data();
+	field.size = size;
+
+	Camera* walker = new Camera();
+	walker->setFrameTime(0.016f);
+	walker->setPosition(size * 0.5f, 0.f, size * 0.5f);
+	MovementBenchmark result;
+
+	// One WASD frame is four movement updates (forward, left, back, right leaves the walker where it started)
+	const int viewFrames = 250000;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < viewFrames; i++)
+	{
+		walker->moveForward(&field, false);
+		walker->strafeLeft(&field, false);
+		walker->moveBackward(&field, false);
+		walker->strafeRight(&field, false);
 	}
-	else {
-		position.x = predPos.x;
-		position.z = predPos.z;
+	float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	result.viewRate = 4 * viewFrames / seconds;
+
+	const int copyFrames = 4;
+	startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < copyFrames * 4; i++)
+	{
+		std::vector<float> copy = heights;
+		HeightField copied = field;
+		copied.heights = copy.data();
+		if (i % 2) walker->strafeLeft(&copied, false);
+		else walker->strafeRight(&copied, false);
 	}
-}
\ No newline at end of file
+	seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	result.copyRate = copyFrames * 4 / seconds;
+
+	delete walker;
+	return result;
+}
@@ -13,7 +13,7 @@
 #define _CAMERA_H_
 
 #include <directxmath.h>
-#include <vector>
+#include "HeightField.h"
 
 using namespace DirectX;
 
@@ -46,18 +46,27 @@ public:
 
 	void setFrameTime(float);
 
-	void moveForward(std::vector<float> heightData, int size, bool flightMode);///< default function for moving forward
-	void moveBackward(std::vector<float> heightData, int size, bool flightMode);///< default function for moving backward
+	void moveForward(const TerrainSurface* terrain, bool flightMode);///< default function for moving forward (following the terrain unless flying)
+	void moveBackward(const TerrainSurface* terrain, bool flightMode);///< default function for moving backward
 	void moveUpward();			///< default function for moving upward
 	void moveDownward();		///< default function for moving downward
 	void turnLeft();			///< default function for turning left
 	void turnRight();			///< default function for turning right
 	void turnUp();				///< default function for looking up
 	void turnDown();			///< default function for looking down
-	void strafeRight(std::vector<float> heightData, int size, bool flightMode);///< default function for moving right
-	void strafeLeft(std::vector<float> heightData, int size, bool flightMode);///< default function for moving left
+	void strafeRight(const TerrainSurface* terrain, bool flightMode);///< default function for moving right
+	void strafeLeft(const TerrainSurface* terrain, bool flightMode);///< default function for moving left
 	void turn(int x, int y);	///< default function for turning in both x/y axis
 
+	/// movement updates per second on a benchmark terrain: reading the shared height field, and copying the heights for every update
+	struct MovementBenchmark
+	{
+		float viewRate;
+		float copyRate;
+	};
+
+	static MovementBenchmark benchmarkMovement(int size);	///< times a camera walking on a size x size terrain
+
 private:
 	XMFLOAT3 position = XMFLOAT3(25, 14, 25);		///< float3 for position
 	XMFLOAT3 rotation;		///< float3 for rotation (angles)
@@ -67,6 +76,7 @@ private:
 	float lookSpeed;		///< rotation speed
 
 	float lerp(const float& a, const float& b, float t);
+	void moveTo(const XMFLOAT3& predPos, const TerrainSurface* terrain, bool flightMode);	///< move to a predicted position, walking on the terrain unless flying
 };
 
 #endif
\ No newline at end of file
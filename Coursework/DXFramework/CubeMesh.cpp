@@ -2,6 +2,7 @@
 // Generates cube mesh at set resolution. Default res is 20.
 // Mesh has texture coordinates and normals.
 #include "cubemesh.h"
+#include "PlaneMesh.h"
 
 // Initialise vertex data, buffers and load texture.
 CubeMesh::CubeMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution)
@@ -13,539 +14,65 @@ CubeMesh::CubeMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int
 
 CubeMesh::~CubeMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 
-// Initialise geometry buffers (vertex and index).
-// Generate and store cube vertices, normals and texture coordinates
-void CubeMesh::initBuffers(ID3D11Device* device)
+// Build the faces of the cube. Face vertex (i, j) is i quads along the face's right axis and j quads up its up axis, from
+// its bottom left corner, so the face is laid out as a plane whose triangles are those the cube always had.
+void CubeMesh::buildFaces(int resolution, std::vector<VertexType>& vertices, std::vector<unsigned int>& indices)
 {
-	VertexType* vertices;
-	unsigned long* indices;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-
-	// 6 vertices per quad, res*res is face, times 6 for each face
-	vertexCount = ((6 * resolution)*resolution) * 6;
-
-	indexCount = vertexCount;
-
-	// Create the vertex and index array.
-	vertices = new VertexType[vertexCount];
-	indices = new unsigned long[indexCount];
-
-	// Vertex variables
-	float yincrement = 2.0f / resolution;
-	float xincrement = 2.0f / resolution;
-	float ystart = 1.0f;
-	float xstart = -1.0f;
-	//UV variables
-	float txu = 0.0f;
-	float txv = 0.0f;
-	float txuinc = 1.0f / resolution;	// UV increment
-	float txvinc = 1.0f / resolution;
-	//Counters
-	int v = 0;	// vertex counter
-	int i = 0;	// index counter
-
-	//front face
-
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, -1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart, -1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart, ystart, -1.0f);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, -1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart - yincrement, -1.0f);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart, -1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart += xincrement;
-			txu += txuinc;
-			//ystart -= yincrement;
-
-		}
-
-		ystart -= yincrement;
-		xstart = -1;
-
-		txu = 0;
-		txv += txvinc;
-
-	}
-
-	txv = 0;
-
-	//back face
-	ystart = 1;
-	xstart = 1;
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, 1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart, 1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, ystart, 1.0f);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, 1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart - yincrement, 1.0f);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart, 1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart -= xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-
-		}
-
-		ystart -= yincrement;
-		xstart = 1;
-
-		txu = 0;
-		txv += txvinc;
-
-	}
-
-	txv = 0;
-
-	//right face
-	ystart = 1;
-	xstart = -1;
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart + xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart + xincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart + xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-
-		}
-
-		ystart -= yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
-	}
-
-	txv = 0;
-
-	//left face
-	ystart = 1;
-	xstart = 1;
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
+	// Normal, right and up axes of the front, back, right, left, top and bottom faces
+	static const XMFLOAT3 faces[6][3] = {
+		{ XMFLOAT3(0, 0, -1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(0, 0, 1), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1) },
+		{ XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1) }
+	};
+	const int side = resolution + 1;
+	std::vector<unsigned int> faceIndices;
+	PlaneMesh::buildIndices(side, PlaneMesh::bandQuads, faceIndices);
+
+	vertices.clear();
+	indices.clear();
+	vertices.reserve((size_t)6 * side * side);
+	indices.reserve(faceIndices.size() * 6);
+	for (int face = 0; face < 6; face++)
 	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
+		const XMFLOAT3& normal = faces[face][0];
+		const XMFLOAT3& right = faces[face][1];
+		const XMFLOAT3& up = faces[face][2];
+		const unsigned int first = (unsigned int)vertices.size();
+		for (int j = 0; j < side; j++)
 		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart - xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart - xincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart - xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart -= xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-		}
-
-		ystart -= yincrement;
-		xstart = 1;
-		txu = 0;
-		txv += txvinc;
-	}
-
-	txv = 0;
-
-	//top face
-	ystart = 1;
-	xstart = -1;
-
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart - yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart - yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart - yincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
+			for (int i = 0; i < side; i++)
+			{
+				// Coordinates from -1 to 1, exactly opposite at opposite grid points, so faces meet on the same positions.
+				float a = (float)(2 * i - resolution) / resolution;
+				float b = (float)(2 * j - resolution) / resolution;
+				VertexType vertex;
+				vertex.position = XMFLOAT3(normal.x + a * right.x + b * up.x, normal.y + a * right.y + b * up.y, normal.z + a * right.z + b * up.z);
+				vertex.texture = XMFLOAT2((float)i / resolution, (float)(resolution - j) / resolution);
+				vertex.normal = normal;
+				vertices.push_back(vertex);
+			}
 		}
-
-		ystart -= yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
-	}
-
-	txv = 0;
-
-	//bottom face
-	ystart = -1;
-	xstart = -1;
-
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
+		for (unsigned int index : faceIndices)
 		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart + yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//0
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart + yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart + yincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu + txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
+			indices.push_back(first + index);
 		}
-
-		ystart += yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
 	}
+}
 
-	
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
+// Initialise geometry buffers (vertex and index).
+// Generate and store cube vertices, normals and texture coordinates
+void CubeMesh::initBuffers(ID3D11Device* device)
+{
+	std::vector<VertexType> vertices;
+	std::vector<unsigned int> indices;
 
-	delete[] indices;
-	indices = 0;
+	buildFaces(resolution, vertices, indices);
+	createIndexedBuffers(device, vertices.data(), (int)vertices.size(), indices);
 }
-
@@ -21,22 +21,22 @@ void FPCamera::move(float dt)
 	if (input->isKeyDown('W'))
 	{
 		// forward
-		moveForward(noiseData, size, flightMode);
+		moveForward(terrain, flightMode);
 	}
 	if (input->isKeyDown('S'))
 	{
 		// back
-		moveBackward(noiseData, size, flightMode);
+		moveBackward(terrain, flightMode);
 	}
 	if (input->isKeyDown('A'))
 	{
 		// Strafe Left
-		strafeLeft(noiseData, size, flightMode);
+		strafeLeft(terrain, flightMode);
 	}
 	if (input->isKeyDown('D'))
 	{
 		// Strafe Right
-		strafeRight(noiseData, size, flightMode);
+		strafeRight(terrain, flightMode);
 	}
 	if (input->isKeyDown('Q') && flightMode)
 	{
@@ -10,8 +10,7 @@ using namespace DirectX;
 class FPCamera : public Camera
 {
 public:
-	std::vector<float> noiseData;
-	int size;
+	const TerrainSurface* terrain = nullptr;	///< terrain to walk on (not owned: the height map generator's shared view, or the streamed terrain)
 	bool flightMode = false;
 	/*void* operator new(size_t i)
 	{
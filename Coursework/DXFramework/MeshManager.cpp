@@ -0,0 +1,166 @@
+// Mesh manager
+// Builds registered meshes on first use, tracks their memory and releases the least recently used ones over a budget.
+#include "MeshManager.h"
+#include <chrono>
+
+MeshManager::MeshManager(ID3D11Device* ldevice, ID3D11DeviceContext* ldeviceContext, size_t lbudget)
+{
+	device = ldevice;
+	deviceContext = ldeviceContext;
+	budget = lbudget;
+	cpuBytes = 0;
+	gpuBytes = 0;
+	frameCount = 0;
+	evictedCount = 0;
+	buildTime = 0.f;
+}
+
+// Release the built meshes.
+MeshManager::~MeshManager()
+{
+	for (Entry& entry : entries)
+	{
+		release(entry);
+	}
+}
+
+void MeshManager::registerMesh(const std::string& uid, Builder builder)
+{
+	auto found = entryMap.find(uid);
+	if (found != entryMap.end())
+	{
+		Entry& entry = entries[found->second];
+		release(entry);
+		entry.builder = builder;
+		return;
+	}
+
+	Entry entry = { uid, builder, nullptr, 0, 0, 0, 0, 0.f };
+	entryMap.insert(std::make_pair(uid, (int)entries.size()));
+	entries.push_back(entry);
+}
+
+// Return the mesh, building it (and measuring it) on first use.
+BaseMesh* MeshManager::getMesh(const std::string& uid)
+{
+	auto found = entryMap.find(uid);
+	if (found == entryMap.end())
+	{
+		return nullptr;
+	}
+
+	Entry& entry = entries[found->second];
+	entry.lastUsed = frameCount;
+	if (!entry.mesh)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		entry.mesh = entry.builder(device, deviceContext);
+		entry.buildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		buildTime += entry.buildTime;
+		entry.builds++;
+
+		entry.cpuBytes = entry.mesh ? entry.mesh->getCpuBytes() : 0;
+		entry.gpuBytes = entry.mesh ? entry.mesh->getVertexBytes() + entry.mesh->getIndexBytes() : 0;
+		cpuBytes += entry.cpuBytes;
+		gpuBytes += entry.gpuBytes;
+	}
+	return entry.mesh;
+}
+
+void MeshManager::releaseMesh(const std::string& uid)
+{
+	auto found = entryMap.find(uid);
+	if (found != entryMap.end())
+	{
+		release(entries[found->second]);
+	}
+}
+
+// Evict the least recently used meshes (never those used during the last frame, which may still be drawn) until the built meshes fit the budget.
+void MeshManager::frame()
+{
+	while (cpuBytes + gpuBytes > budget)
+	{
+		Entry* oldest = nullptr;
+		for (Entry& entry : entries)
+		{
+			if (entry.mesh && entry.lastUsed < frameCount && (!oldest || entry.lastUsed < oldest->lastUsed))
+			{
+				oldest = &entry;
+			}
+		}
+		if (!oldest)
+		{
+			break;
+		}
+		release(*oldest);
+		evictedCount++;
+	}
+	frameCount++;
+}
+
+void MeshManager::release(Entry& entry)
+{
+	if (entry.mesh)
+	{
+		delete entry.mesh;
+		entry.mesh = nullptr;
+	}
+	cpuBytes -= entry.cpuBytes;
+	gpuBytes -= entry.gpuBytes;
+	entry.cpuBytes = 0;
+	entry.gpuBytes = 0;
+}
+
+void MeshManager::setBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
+size_t MeshManager::getBudget()
+{
+	return budget;
+}
+
+size_t MeshManager::getCpuBytes()
+{
+	return cpuBytes;
+}
+
+size_t MeshManager::getGpuBytes()
+{
+	return gpuBytes;
+}
+
+int MeshManager::getBuiltCount()
+{
+	int built = 0;
+	for (const Entry& entry : entries)
+	{
+		if (entry.mesh)
+		{
+			built++;
+		}
+	}
+	return built;
+}
+
+unsigned long long MeshManager::getEvictedCount()
+{
+	return evictedCount;
+}
+
+float MeshManager::getBuildTime()
+{
+	return buildTime;
+}
+
+int MeshManager::getEntryCount()
+{
+	return (int)entries.size();
+}
+
+const MeshManager::Entry& MeshManager::getEntry(int index)
+{
+	return entries[index];
+}
@@ -0,0 +1,84 @@
+/**
+* \class MeshManager
+*
+* \brief Builds meshes on first use and keeps them within a memory budget.
+*
+* Meshes are registered by name with a function that builds them, and only built the first time they are asked for.
+* The CPU and GPU bytes of every built mesh are tracked. At every frame, while the built meshes are over the budget,
+* the least recently used meshes not used during the last frame are released; they are built again when next asked for.
+* A mesh returned by getMesh stays valid until the next call to frame().
+*/
+
+#ifndef _MESHMANAGER_H_
+#define _MESHMANAGER_H_
+
+#include <d3d11.h>
+#include "BaseMesh.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+class MeshManager
+{
+public:
+	/// Function building a mesh with the renderer device and context
+	typedef std::function<BaseMesh*(ID3D11Device*, ID3D11DeviceContext*)> Builder;
+
+	/// A registered mesh
+	struct Entry
+	{
+		std::string uid;
+		Builder builder;
+		BaseMesh* mesh;					///< built mesh, nullptr until first used or once released
+		size_t cpuBytes, gpuBytes;		///< memory of the built mesh
+		unsigned long long lastUsed;	///< last frame the mesh was asked for
+		int builds;						///< times the mesh was built
+		float buildTime;				///< time of its last build (in ms)
+	};
+
+	static const size_t defaultBudget = 64 * 1024 * 1024;	///< budget of a new manager (in bytes)
+
+	MeshManager(ID3D11Device* device, ID3D11DeviceContext* deviceContext, size_t budget = defaultBudget);
+	~MeshManager();
+
+	/// Registers a mesh under a name (replacing and releasing a mesh already registered under it), it is built on first use
+	void registerMesh(const std::string& uid, Builder builder);
+
+	/// Returns a registered mesh, built now if needed, or nullptr if no mesh is registered under the name
+	BaseMesh* getMesh(const std::string& uid);
+
+	/// Releases a built mesh (it is built again when next asked for)
+	void releaseMesh(const std::string& uid);
+
+	/// Starts a frame: releases the least recently used meshes not used during the last frame while over the budget
+	void frame();
+
+	void setBudget(size_t bytes);		///< Sets the memory budget (in bytes), applied at the next frame
+	size_t getBudget();					///< Returns the memory budget (in bytes)
+	size_t getCpuBytes();				///< Returns the CPU memory of the built meshes (in bytes)
+	size_t getGpuBytes();				///< Returns the GPU memory of the built meshes (in bytes)
+	int getBuiltCount();				///< Returns the number of meshes built and not released
+	unsigned long long getEvictedCount();	///< Returns the number of meshes released over the budget so far
+	float getBuildTime();				///< Returns the time spent building meshes so far (in ms)
+
+	int getEntryCount();				///< Returns the number of registered meshes
+	const Entry& getEntry(int index);	///< Returns a registered mesh, in registration order
+
+private:
+	void release(Entry& entry);
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* deviceContext;
+
+	std::vector<Entry> entries;
+	std::map<std::string, int> entryMap;	///< index of the entry of every name
+
+	size_t budget;
+	size_t cpuBytes, gpuBytes;
+	unsigned long long frameCount;
+	unsigned long long evictedCount;
+	float buildTime;
+};
+
+#endif
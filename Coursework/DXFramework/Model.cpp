@@ -12,8 +12,7 @@ Model::Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const cha
 // Release resources.
 Model::~Model()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 
 	if (model)
 	{
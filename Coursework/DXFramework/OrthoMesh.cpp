@@ -17,7 +17,7 @@ OrthoMesh::OrthoMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, i
 // Release resources
 OrthoMesh::~OrthoMesh()
 {
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 // Based on provide dimensions and position, generate quad for orthographics rendering.
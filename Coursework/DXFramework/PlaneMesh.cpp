@@ -10,145 +10,88 @@ PlaneMesh::PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, i
 
 }
 
+// Initialise buffer with transformed texture coordinates.
+PlaneMesh::PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution, float ltextureScale, float ltextureOffset)
+{
+	resolution = lresolution;
+	textureScale = ltextureScale;
+	textureOffset = ltextureOffset;
+	initBuffers(device);
+}
+
 // Release resources.
 PlaneMesh::~PlaneMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
+}
+
+// Build the indices band by band, row by row within a band (two triangles per quad, as the plane always had).
+// The bands are evened out, so none is much narrower than the others.
+void PlaneMesh::buildIndices(int resolution, int bandWidth, std::vector<unsigned int>& indices)
+{
+	int quads = resolution - 1;
+	int bands = (quads + bandWidth - 1) / bandWidth;
+	bandWidth = bands > 0 ? (quads + bands - 1) / bands : bandWidth;
+	indices.clear();
+	indices.reserve((size_t)quads * quads * 6);
+	for (int band = 0; band < quads; band += bandWidth)
+	{
+		int bandEnd = band + bandWidth < quads ? band + bandWidth : quads;
+		for (int j = 0; j < quads; j++)
+		{
+			for (int i = band; i < bandEnd; i++)
+			{
+				unsigned int upperLeft = j * resolution + i;
+				unsigned int bottomRight = upperLeft + 1;
+				unsigned int lowerLeft = upperLeft + resolution;
+				unsigned int upperRight = lowerLeft + 1;
+
+				indices.push_back(upperLeft);
+				indices.push_back(upperRight);
+				indices.push_back(lowerLeft);
+				indices.push_back(upperLeft);
+				indices.push_back(bottomRight);
+				indices.push_back(upperRight);
+			}
+		}
+	}
 }
 
 // Generate plane (including texture coordinates and normals).
+// One vertex per grid point, shared by the quads around it.
 void PlaneMesh::initBuffers(ID3D11Device* device)
 {
 	VertexType* vertices;
-	unsigned long* indices;
+	std::vector<unsigned int> indices;
 	int index, i, j;
-	float positionX, positionZ, u, v, increment;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	
-	// Calculate the number of vertices in the terrain mesh.
-	vertexCount = (resolution - 1) * (resolution - 1) * 6;
-
+	float increment;
 
-	indexCount = vertexCount;
+	// Calculate the number of vertices in the terrain mesh.
+	vertexCount = resolution * resolution;
 	vertices = new VertexType[vertexCount];
-	indices = new unsigned long[indexCount];
-	
 
-	index = 0;
 	// UV coords.
-	u = 0;
-	v = 0;
 	increment = 1.0f / resolution;
 
-	for (j = 0; j<(resolution - 1); j++)
+	index = 0;
+	for (j = 0; j < resolution; j++)
 	{
-		for (i = 0; i<(resolution - 1); i++)
+		for (i = 0; i < resolution; i++)
 		{
-			// Upper left.
-			positionX = (float)i;
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			positionX = (float)(i + 1);
-			positionZ = (float)(j + 1);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v + increment);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-
-			// lower left
-			positionX = (float)(i);
-			positionZ = (float)(j + 1);
-			
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v + increment);
+			vertices[index].position = XMFLOAT3((float)i, 0.0f, (float)j);
+			vertices[index].texture = XMFLOAT2(i * increment * textureScale + textureOffset, j * increment * textureScale + textureOffset);
 			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
 			index++;
-
-			// Upper left
-			positionX = (float)(i);
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Bottom right
-			positionX = (float)(i + 1);
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			positionX = (float)(i + 1);
-			positionZ = (float)(j + 1);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v + increment);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			u += increment;
-	
 		}
-
-		u = 0;
-		v += increment;
 	}
 
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-	
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-	
-	// Release the arrays now that the buffers have been created and loaded.
+	// Index the quads in cache friendly bands, and create the buffers.
+	buildIndices(resolution, bandQuads, indices);
+	createIndexedBuffers(device, vertices, vertexCount, indices);
+
+	// Release the array now that the buffers have been created and loaded.
 	delete[] vertices;
 	vertices = 0;
-	delete[] indices;
-	indices = 0;
 }
 
 
@@ -12,8 +12,7 @@ PointMesh::PointMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
 // Release resources.
 PointMesh::~PointMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 // Generate point mesh. Simple triangle.
@@ -97,7 +96,7 @@ void PointMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOL
 	offset = 0;
 
 	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 	deviceContext->IASetPrimitiveTopology(top);
 }
 
@@ -12,8 +12,7 @@ QuadMesh::QuadMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
 // Release resources.
 QuadMesh::~QuadMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 // Build quad mesh.
@@ -1,572 +1,90 @@
 // Sphere Mesh
 // Generates a cube sphere.
 #include "spheremesh.h"
+#include "CubeMesh.h"
+#include <cmath>
 
 // Store shape resolution (default is 20), initialise buffers and load texture.
-SphereMesh::SphereMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution)
+SphereMesh::SphereMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution, bool lequalArea, VertexPacking::Format format)
 {
 	resolution = lresolution;
+	equalArea = lequalArea;
+	vertexFormat = format;
 	initBuffers(device);
 }
 
 // Release resources.
 SphereMesh::~SphereMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
-// Generate sphere. Generates a cube based on resolution provided. Then normalises vertex positions to create sphere.
-// Shape has texture coordinates and normals.
-void SphereMesh::initBuffers(ID3D11Device* device)
+// Map a point of a cube face onto the unit sphere.
+// The default mapping moves every coordinate towards the centre of the face by the others (cells are larger mid face).
+// The equal-area mapping (Rosca and Plonka, 2011) maps the face, with a and b its coordinates along two axes of the face,
+// onto a plane preserving areas, then onto the sphere by the inverse Lambert azimuthal projection (also area preserving).
+// It is symmetric in a and b and odd in each, so the axes of the face may be taken in any order or direction.
+XMFLOAT3 SphereMesh::mapToSphere(const XMFLOAT3& position, const XMFLOAT3& normal, bool equalArea)
 {
-	VertexType* vertices;
-	unsigned long* indices;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	
-	// 6 vertices per quad, res*res is face, times 6 for each face
-	vertexCount = ((6 * resolution)*resolution) * 6;
-	indexCount = vertexCount;
-
-	vertices = new VertexType[vertexCount];
-	indices = new unsigned long[indexCount];
-
-	// Vertex variables
-	float yincrement = 2.0f / resolution;
-	float xincrement = 2.0f / resolution;
-	float ystart = 1.0f;
-	float xstart = -1.0f;
-	//UV variables
-	float txu = 0.0f;
-	float txv = 0.0f;
-	float txuinc = 1.0f / resolution;	// UV increment
-	float txvinc = 1.0f / resolution;
-	//Counters
-	int v = 0;	// vertex counter
-	int i = 0;	// index counter
-
-	//front face
-
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, -1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv + txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart, -1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart, ystart, -1.0f);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, -1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart - yincrement, -1.0f);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart + xincrement, ystart, -1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			// increment
-			xstart += xincrement;
-			txu += txuinc;
-			//ystart -= yincrement;
-
-		}
-
-		ystart -= yincrement;
-		xstart = -1;
-
-		txu = 0;
-		txv += txvinc;
-
-	}
-
-	txv = 0;
-
-	//back face
-	ystart = 1;
-	xstart = 1;
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
-	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, 1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart, 1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, ystart, 1.0f);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(xstart, ystart - yincrement, 1.0f);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart - yincrement, 1.0f);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart - xincrement, ystart, 1.0f);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart -= xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-
-		}
-
-		ystart -= yincrement;
-		xstart = 1;
-
-		txu = 0;
-		txv += txvinc;
-
-	}
-
-	txv = 0;
-
-	//right face
-	ystart = 1;
-	xstart = -1;
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
+	float x = position.x;
+	float y = position.y;
+	float z = position.z;
+	if (!equalArea)
 	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart + xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//3
-			vertices[v].position = XMFLOAT3(1.0f, ystart - yincrement, xstart + xincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(1.0f, ystart, xstart + xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-
-		}
-
-		ystart -= yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
+		return XMFLOAT3(x * sqrtf(1.0f - (y*y / 2.0f) - (z*z / 2.0f) + (y*y*z*z / 3.0f)),
+			y * sqrtf(1.0f - (z*z / 2.0f) - (x*x / 2.0f) + (z*z*x*x / 3.0f)),
+			z * sqrtf(1.0f - (x*x / 2.0f) - (y*y / 2.0f) + (x*x*y*y / 3.0f)));
 	}
 
-	txv = 0;
-
-	//left face
-	ystart = 1;
-	xstart = 1;
-	for (int y = 0; y < resolution; y++)	// for each quad in the y direction
+	// Face coordinates along the two axes other than the normal's
+	float a = normal.x != 0.0f ? y : x;
+	float b = normal.z != 0.0f ? y : z;
+	float planeA = 0.0f;
+	float planeB = 0.0f;
+	if (a != 0.0f || b != 0.0f)
 	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart - xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(-1.0f, ystart - yincrement, xstart - xincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(-1.0f, ystart, xstart - xincrement);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(-1.0f, 0.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart -= xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-		}
-
-		ystart -= yincrement;
-		xstart = 1;
-		txu = 0;
-		txv += txvinc;
+		bool swap = fabsf(b) > fabsf(a);
+		float major = swap ? b : a;
+		float minor = swap ? a : b;
+		const float sqrt2 = 1.41421356f;
+		float angle = minor * XM_PI / (12.0f * major);
+		float scale = 1.18920712f * major / sqrtf(sqrt2 - cosf(angle));	// 2^(1/4)
+		float along = scale * (sqrt2 * cosf(angle) - 1.0f);
+		float across = scale * sqrt2 * sinf(angle);
+		planeA = swap ? across : along;
+		planeB = swap ? along : across;
 	}
-	
-	txv = 0;
-
-	//top face
-	ystart = 1;
-	xstart = -1;
 
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
+	// Inverse Lambert azimuthal projection around the normal
+	float r2 = planeA * planeA + planeB * planeB;
+	float s = sqrtf(fmaxf(1.0f - r2 / 4.0f, 0.0f));
+	float h = 1.0f - r2 / 2.0f;
+	float sa = s * planeA;
+	float sb = s * planeB;
+	if (normal.x != 0.0f)
 	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart - yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(xstart, 1.0f, ystart - yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart - yincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, 1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-		}
-
-		ystart -= yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
+		return XMFLOAT3(h * normal.x, sa, sb);
 	}
-
-	txv = 0;
-	
-	//bottom face
-	ystart = -1;
-	xstart = -1;
-
-	for (int y = 0; y<resolution; y++)	// for each quad in the y direction
+	if (normal.y != 0.0f)
 	{
-		for (int x = 0; x < resolution; x++)	// for each quad in the x direction
-		{
-			// Load the vertex array with data.
-			//0
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart + yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//1
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart);  // Top left.	-1.0, 1.0
-			vertices[v].texture = XMFLOAT2(txu, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-			
-			//0
-			vertices[v].position = XMFLOAT3(xstart, -1.0f, ystart + yincrement);  // Bottom left. -1. -1. 0
-			vertices[v].texture = XMFLOAT2(txu, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//3
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart + yincrement);  // Bottom right.	1.0, -1.0, 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv+txvinc);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			//2
-			vertices[v].position = XMFLOAT3(xstart + xincrement, -1.0f, ystart);  // Top right.	1.0, 1.0 0.0
-			vertices[v].texture = XMFLOAT2(txu+txuinc, txv);
-			vertices[v].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
-
-			indices[i] = i;
-			v++;
-			i++;
-
-			// increment
-			xstart += xincrement;
-			//ystart -= yincrement;
-			txu += txuinc;
-		}
-
-		ystart += yincrement;
-		xstart = -1;
-		txu = 0;
-		txv += txvinc;
+		return XMFLOAT3(sa, h * normal.y, sb);
 	}
+	return XMFLOAT3(sa, sb, h * normal.z);
+}
 
-	// now loop over every vertex and bend into a sphere (normalise the vertices)
-	float x = 0;
-	float y = 0;
-	float z = 0;
-	float dx = 0;
-	float dy = 0;
-	float dz = 0;
+// Generate sphere. Generates the faces of a cube based on resolution provided, then maps the vertices onto the sphere.
+// Shape has texture coordinates and normals (the position on the unit sphere).
+void SphereMesh::initBuffers(ID3D11Device* device)
+{
+	std::vector<VertexType> vertices;
+	std::vector<unsigned int> indices;
 
-	for (int counter = 0; counter < v; counter++)
+	CubeMesh::buildFaces(resolution, vertices, indices);
+	for (VertexType& vertex : vertices)
 	{
-		x = vertices[counter].position.x;
-		y = vertices[counter].position.y;
-		z = vertices[counter].position.z;
-
-		dx = x * sqrtf(1.0f - (y*y / 2.0f) - (z*z / 2.0f) + (y*y*z*z / 3.0f));
-		dy = y * sqrtf(1.0f - (z*z / 2.0f) - (x*x / 2.0f) + (z*z*x*x / 3.0f));
-		dz = z * sqrtf(1.0f - (x*x / 2.0f) - (y*y / 2.0f) + (x*x*y*y / 3.0f));
-
-		vertices[counter].position.x = dx;
-		vertices[counter].position.y = dy;
-		vertices[counter].position.z = dz;
-
-		vertices[counter].normal.x = dx;
-		vertices[counter].normal.y = dy;
-		vertices[counter].normal.z = dz;
+		vertex.position = mapToSphere(vertex.position, vertex.normal, equalArea);
+		vertex.normal = vertex.position;
 	}
 
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
-	delete[] indices;
-	indices = 0;
+	createIndexedBuffers(device, vertices.data(), (int)vertices.size(), indices);
 }
-
@@ -3,6 +3,9 @@
 // Uses the cube sphere normalisation method. First a cube is generated,
 // then the vertices are normalised creating a sphere.
 // Resolution specifies the number of segments in the sphere (top and bottom, matches equator).
+// Vertices are shared by the quads of a face, and only repeated on the seams between faces (where their texture
+// coordinates differ). The equal-area mapping gives every quad of a face the same area on the sphere.
+// The packed vertex format (see VertexPacking) halves the vertex buffer.
 
 #ifndef _SPHEREMESH_H_
 #define _SPHEREMESH_H_
@@ -15,12 +18,16 @@ class SphereMesh : public BaseMesh
 {
 
 public:
-	SphereMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
+	SphereMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20, bool equalArea = false, VertexPacking::Format format = VertexPacking::FullVertex);
 	~SphereMesh();
 
+	// Maps a point of a face of the -1 to 1 cube (with the face's normal) onto the unit sphere
+	static XMFLOAT3 mapToSphere(const XMFLOAT3& position, const XMFLOAT3& normal, bool equalArea);
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
+	bool equalArea;
 };
 
 #endif
\ No newline at end of file
@@ -12,8 +12,7 @@ TessellationMesh::TessellationMesh(ID3D11Device* device, ID3D11DeviceContext* de
 // Release resources.
 TessellationMesh::~TessellationMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 // Build triangle (with texture coordinates and normals).
@@ -93,7 +92,7 @@ void TessellationMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIV
 	offset = 0;
 
 	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case control patch for tessellation.
 	deviceContext->IASetPrimitiveTopology(top);
 }
@@ -17,8 +17,7 @@ TriangleMesh::TriangleMesh(ID3D11Device* device, ID3D11DeviceContext* deviceCont
 // Release resources.
 TriangleMesh::~TriangleMesh()
 {
-	// Run parent deconstructor
-	BaseMesh::~BaseMesh();
+	// Buffers are released by the parent destructor, which runs after this one
 }
 
 // Build shape and fill buffers.
@@ -0,0 +1,46 @@
+// Vertex cache simulator
+// FIFO post-transform cache: a vertex is a hit while fewer than cacheSize vertices were transformed since its own transform.
+#include "VertexCache.h"
+#include <vector>
+
+template <typename Index>
+static VertexCache::Stats simulateCache(const Index* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	VertexCache::Stats stats = { 0.f, 0.f };
+	if (indexCount < 3 || vertexCount <= 0)
+	{
+		return stats;
+	}
+
+	// Transform number of every vertex (-1 before the first), and vertices used
+	std::vector<long long> transformedAt(vertexCount, -1);
+	long long transforms = 0;
+	int used = 0;
+	for (int i = 0; i < indexCount; i++)
+	{
+		long long& at = transformedAt[indices[i]];
+		if (at < 0)
+		{
+			used++;
+		}
+		if (at < 0 || transforms - at >= cacheSize)
+		{
+			transforms++;
+			at = transforms;
+		}
+	}
+
+	stats.acmr = (float)transforms / (indexCount / 3);
+	stats.atvr = (float)transforms / used;
+	return stats;
+}
+
+VertexCache::Stats VertexCache::simulate(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	return simulateCache(indices, indexCount, vertexCount, cacheSize);
+}
+
+VertexCache::Stats VertexCache::simulate(const unsigned short* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	return simulateCache(indices, indexCount, vertexCount, cacheSize);
+}
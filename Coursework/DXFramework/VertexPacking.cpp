@@ -0,0 +1,393 @@
+// Vertex packing
+// Quantises positions and normals to 16-bit snorms and texture coordinates to half floats, 4 vertices at a time (SSE2).
+#include "VertexPacking.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+// Measured up to about 6.5e-5 over a million random normals, with a margin.
+const float VertexPacking::normalErrorBound = 1e-4f;
+
+static const D3D11_INPUT_ELEMENT_DESC fullLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const D3D11_INPUT_ELEMENT_DESC packedLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const float snormMax = 32767.f;
+
+// Lanes of a where the mask is set, of b elsewhere.
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Float to half (Giesen's round to nearest even): subnormal halves are aligned by adding a magic float, normal ones
+// rebias the exponent and round on the dropped mantissa bits, past the range gives infinity (NaN stays NaN).
+static inline __m128i floatToHalf(__m128 f)
+{
+	const __m128i denormMagicBits = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	__m128i bits = _mm_castps_si128(f);
+	__m128i sign = _mm_and_si128(bits, _mm_set1_epi32((int)0x80000000));
+	bits = _mm_xor_si128(bits, sign);
+
+	__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denormMagicBits))), denormMagicBits);
+
+	__m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(-(112 << 23) + 0xfff));
+	normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+	__m128i special = select(_mm_cmpgt_epi32(bits, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+
+	__m128i half = select(_mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23)), subnormal, normal);
+	half = select(_mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1)), special, half);
+	return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+}
+
+// Half to float: rebias the exponent, infinity and NaN keep an all-ones exponent, subnormals are renormalised with a magic float.
+static inline __m128 halfToFloat(__m128i half)
+{
+	const __m128i shiftedExponent = _mm_set1_epi32(0x7c00 << 13);
+	__m128i bits = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7fff)), 13);
+	__m128i exponent = _mm_and_si128(bits, shiftedExponent);
+	bits = _mm_add_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+	bits = _mm_add_epi32(bits, _mm_and_si128(_mm_cmpeq_epi32(exponent, shiftedExponent), _mm_set1_epi32((128 - 16) << 23)));
+
+	__m128 subnormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+	bits = select(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), _mm_castps_si128(subnormal), bits);
+	return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16)));
+}
+
+// Values in [-1, 1] to snorms (rounded to nearest).
+static inline __m128i floatToSnorm(__m128 f)
+{
+	f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-1.f)), _mm_set1_ps(1.f));
+	return _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(snormMax)));
+}
+
+// Snorms to values in [-1, 1] (-32768 is -1 too, as on the GPU).
+static inline __m128 snormToFloat(__m128i snorm)
+{
+	return _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(snorm), _mm_set1_ps(1.f / snormMax)), _mm_set1_ps(-1.f));
+}
+
+// Sign of every lane (as a mask of its sign bit).
+static inline __m128 signBits(__m128 f)
+{
+	return _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+}
+
+static inline __m128 absolute(__m128 f)
+{
+	return _mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)), f);
+}
+
+// Unit normals onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the upper one.
+static inline void octahedralEncode(__m128 x, __m128 y, __m128 z, __m128& u, __m128& v)
+{
+	__m128 length = _mm_add_ps(_mm_add_ps(absolute(x), absolute(y)), absolute(z));
+	x = _mm_div_ps(x, length);
+	y = _mm_div_ps(y, length);
+	__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+	__m128 foldedX = _mm_or_ps(_mm_sub_ps(_mm_set1_ps(1.f), absolute(y)), signBits(x));
+	__m128 foldedY = _mm_or_ps(_mm_sub_ps(_mm_set1_ps(1.f), absolute(x)), signBits(y));
+	u = select(lower, foldedX, x);
+	v = select(lower, foldedY, y);
+}
+
+static inline void octahedralDecode(__m128 u, __m128 v, __m128& x, __m128& y, __m128& z)
+{
+	z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.f), absolute(u)), absolute(v));
+	__m128 fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+	x = _mm_sub_ps(u, _mm_or_ps(fold, signBits(u)));
+	y = _mm_sub_ps(v, _mm_or_ps(fold, signBits(v)));
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	x = _mm_div_ps(x, length);
+	y = _mm_div_ps(y, length);
+	z = _mm_div_ps(z, length);
+}
+
+// Low 16 bits of every lane.
+static inline void store16(__m128i values, short* out)
+{
+	__m128i packed = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(values, 16), 16), _mm_setzero_si128());
+	_mm_storel_epi64((__m128i*)out, packed);
+}
+
+static inline __m128i load16(const short* in)
+{
+	return _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)in)), 16);
+}
+
+static inline __m128i loadUnsigned16(const unsigned short* in)
+{
+	return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)in), _mm_setzero_si128());
+}
+
+// Pack 4 vertices.
+static void encodeBlock(const VertexPacking::Vertex* v, const __m128 scale[3], const __m128 bias[3], VertexPacking::Packed* out)
+{
+	__m128 position[3] = {
+		_mm_setr_ps(v[0].position.x, v[1].position.x, v[2].position.x, v[3].position.x),
+		_mm_setr_ps(v[0].position.y, v[1].position.y, v[2].position.y, v[3].position.y),
+		_mm_setr_ps(v[0].position.z, v[1].position.z, v[2].position.z, v[3].position.z)
+	};
+	__m128 texU = _mm_setr_ps(v[0].texture.x, v[1].texture.x, v[2].texture.x, v[3].texture.x);
+	__m128 texV = _mm_setr_ps(v[0].texture.y, v[1].texture.y, v[2].texture.y, v[3].texture.y);
+	__m128 normalX = _mm_setr_ps(v[0].normal.x, v[1].normal.x, v[2].normal.x, v[3].normal.x);
+	__m128 normalY = _mm_setr_ps(v[0].normal.y, v[1].normal.y, v[2].normal.y, v[3].normal.y);
+	__m128 normalZ = _mm_setr_ps(v[0].normal.z, v[1].normal.z, v[2].normal.z, v[3].normal.z);
+
+	// Lanes of each component, then transposed into the vertices.
+	short components[5][4];
+	unsigned short halves[2][4];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		store16(floatToSnorm(_mm_div_ps(_mm_sub_ps(position[axis], bias[axis]), scale[axis])), components[axis]);
+	}
+	__m128 octU, octV;
+	octahedralEncode(normalX, normalY, normalZ, octU, octV);
+	store16(floatToSnorm(octU), components[3]);
+	store16(floatToSnorm(octV), components[4]);
+	store16(floatToHalf(texU), (short*)halves[0]);
+	store16(floatToHalf(texV), (short*)halves[1]);
+
+	for (int i = 0; i < 4; i++)
+	{
+		out[i].position[0] = components[0][i];
+		out[i].position[1] = components[1][i];
+		out[i].position[2] = components[2][i];
+		out[i].position[3] = (short)snormMax;
+		out[i].texture[0] = halves[0][i];
+		out[i].texture[1] = halves[1][i];
+		out[i].normal[0] = components[3][i];
+		out[i].normal[1] = components[4][i];
+	}
+}
+
+// Unpack 4 vertices.
+static void decodeBlock(const VertexPacking::Packed* p, const __m128 scale[3], const __m128 bias[3], VertexPacking::Vertex* out)
+{
+	short components[5][4];
+	unsigned short halves[2][4];
+	for (int i = 0; i < 4; i++)
+	{
+		components[0][i] = p[i].position[0];
+		components[1][i] = p[i].position[1];
+		components[2][i] = p[i].position[2];
+		components[3][i] = p[i].normal[0];
+		components[4][i] = p[i].normal[1];
+		halves[0][i] = p[i].texture[0];
+		halves[1][i] = p[i].texture[1];
+	}
+
+	float position[3][4], texture[2][4], normal[3][4];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		_mm_storeu_ps(position[axis], _mm_add_ps(_mm_mul_ps(snormToFloat(load16(components[axis])), scale[axis]), bias[axis]));
+	}
+	_mm_storeu_ps(texture[0], halfToFloat(loadUnsigned16(halves[0])));
+	_mm_storeu_ps(texture[1], halfToFloat(loadUnsigned16(halves[1])));
+	__m128 x, y, z;
+	octahedralDecode(snormToFloat(load16(components[3])), snormToFloat(load16(components[4])), x, y, z);
+	_mm_storeu_ps(normal[0], x);
+	_mm_storeu_ps(normal[1], y);
+	_mm_storeu_ps(normal[2], z);
+
+	for (int i = 0; i < 4; i++)
+	{
+		out[i].position = XMFLOAT3(position[0][i], position[1][i], position[2][i]);
+		out[i].texture = XMFLOAT2(texture[0][i], texture[1][i]);
+		out[i].normal = XMFLOAT3(normal[0][i], normal[1][i], normal[2][i]);
+	}
+}
+
+static void loadQuantisation(const VertexPacking::Quantisation& quantisation, __m128 scale[3], __m128 bias[3])
+{
+	scale[0] = _mm_set1_ps(quantisation.scale.x);
+	scale[1] = _mm_set1_ps(quantisation.scale.y);
+	scale[2] = _mm_set1_ps(quantisation.scale.z);
+	bias[0] = _mm_set1_ps(quantisation.bias.x);
+	bias[1] = _mm_set1_ps(quantisation.bias.y);
+	bias[2] = _mm_set1_ps(quantisation.bias.z);
+}
+
+unsigned int VertexPacking::getStride(Format format)
+{
+	return format == PackedVertex ? sizeof(Packed) : sizeof(Vertex);
+}
+
+const D3D11_INPUT_ELEMENT_DESC* VertexPacking::getInputLayout(Format format, unsigned int& elementCount)
+{
+	if (format == PackedVertex)
+	{
+		elementCount = sizeof(packedLayout) / sizeof(packedLayout[0]);
+		return packedLayout;
+	}
+	elementCount = sizeof(fullLayout) / sizeof(fullLayout[0]);
+	return fullLayout;
+}
+
+VertexPacking::Quantisation VertexPacking::fitPositions(const Vertex* vertices, int count)
+{
+	Quantisation quantisation = { XMFLOAT3(1.f, 1.f, 1.f), XMFLOAT3(0.f, 0.f, 0.f) };
+	if (count <= 0)
+	{
+		return quantisation;
+	}
+
+	XMFLOAT3 low = vertices[0].position, high = vertices[0].position;
+	for (int i = 1; i < count; i++)
+	{
+		const XMFLOAT3& p = vertices[i].position;
+		low = XMFLOAT3(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+		high = XMFLOAT3(std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z));
+	}
+	quantisation.scale = XMFLOAT3((high.x - low.x) * 0.5f, (high.y - low.y) * 0.5f, (high.z - low.z) * 0.5f);
+	quantisation.bias = XMFLOAT3((high.x + low.x) * 0.5f, (high.y + low.y) * 0.5f, (high.z + low.z) * 0.5f);
+	if (quantisation.scale.x <= 0.f) quantisation.scale.x = 1.f;
+	if (quantisation.scale.y <= 0.f) quantisation.scale.y = 1.f;
+	if (quantisation.scale.z <= 0.f) quantisation.scale.z = 1.f;
+	return quantisation;
+}
+
+XMMATRIX VertexPacking::getPositionTransform(const Quantisation& quantisation)
+{
+	return XMMatrixScaling(quantisation.scale.x, quantisation.scale.y, quantisation.scale.z) * XMMatrixTranslation(quantisation.bias.x, quantisation.bias.y, quantisation.bias.z);
+}
+
+void VertexPacking::encode(const Vertex* vertices, int count, const Quantisation& quantisation, Packed* packed)
+{
+	__m128 scale[3], bias[3];
+	loadQuantisation(quantisation, scale, bias);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		encodeBlock(vertices + i, scale, bias, packed + i);
+	}
+
+	// The last vertices, padded with copies of the last one.
+	if (i < count)
+	{
+		Vertex tail[4];
+		Packed packedTail[4];
+		for (int j = 0; j < 4; j++)
+		{
+			tail[j] = vertices[std::min(i + j, count - 1)];
+		}
+		encodeBlock(tail, scale, bias, packedTail);
+		std::copy(packedTail, packedTail + (count - i), packed + i);
+	}
+}
+
+void VertexPacking::decode(const Packed* packed, int count, const Quantisation& quantisation, Vertex* vertices)
+{
+	__m128 scale[3], bias[3];
+	loadQuantisation(quantisation, scale, bias);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		decodeBlock(packed + i, scale, bias, vertices + i);
+	}
+
+	if (i < count)
+	{
+		Packed tail[4];
+		Vertex decodedTail[4];
+		for (int j = 0; j < 4; j++)
+		{
+			tail[j] = packed[std::min(i + j, count - 1)];
+		}
+		decodeBlock(tail, scale, bias, decodedTail);
+		std::copy(decodedTail, decodedTail + (count - i), vertices + i);
+	}
+}
+
+VertexPacking::Errors VertexPacking::measure(const Vertex* vertices, const Packed* packed, int count, const Quantisation& quantisation)
+{
+	Errors errors = { 0.f, 0.f, 0.f };
+	if (count <= 0)
+	{
+		return errors;
+	}
+
+	std::vector<Vertex> decoded(count);
+	decode(packed, count, quantisation, decoded.data());
+	for (int i = 0; i < count; i++)
+	{
+		const Vertex& a = vertices[i];
+		const Vertex& b = decoded[i];
+		errors.position = std::max(errors.position, std::max(std::fabs(a.position.x - b.position.x), std::max(std::fabs(a.position.y - b.position.y), std::fabs(a.position.z - b.position.z))));
+		errors.texture = std::max(errors.texture, std::max(std::fabs(a.texture.x - b.texture.x), std::fabs(a.texture.y - b.texture.y)));
+
+		// Angle between the normals, from the sine and cosine (acos loses the small angles)
+		double crossX = (double)a.normal.y * b.normal.z - (double)a.normal.z * b.normal.y;
+		double crossY = (double)a.normal.z * b.normal.x - (double)a.normal.x * b.normal.z;
+		double crossZ = (double)a.normal.x * b.normal.y - (double)a.normal.y * b.normal.x;
+		double dot = (double)a.normal.x * b.normal.x + (double)a.normal.y * b.normal.y + (double)a.normal.z * b.normal.z;
+		errors.normal = std::max(errors.normal, (float)std::atan2(std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot));
+	}
+	return errors;
+}
+
+VertexPacking::Errors VertexPacking::getErrorBounds(const Quantisation& quantisation, float maxTexture)
+{
+	// Half a snorm step over the bounds, plus the rounding of the float arithmetic
+	const XMFLOAT3& scale = quantisation.scale;
+	const XMFLOAT3& bias = quantisation.bias;
+	float position = 0.f;
+	position = std::max(position, scale.x * 0.5f / snormMax + (scale.x + std::fabs(bias.x)) * 4.f * FLT_EPSILON);
+	position = std::max(position, scale.y * 0.5f / snormMax + (scale.y + std::fabs(bias.y)) * 4.f * FLT_EPSILON);
+	position = std::max(position, scale.z * 0.5f / snormMax + (scale.z + std::fabs(bias.z)) * 4.f * FLT_EPSILON);
+
+	// Half a unit in the last place of the largest texture coordinate (10 mantissa bits, subnormals below 2^-14)
+	int exponent = 0;
+	std::frexp(maxTexture, &exponent);
+	float texture = std::ldexp(1.f, std::max(exponent - 12, -25));
+
+	Errors bounds = { position, normalErrorBound, texture };
+	return bounds;
+}
+
+void VertexPacking::encodeHalf(const float* values, int count, unsigned short* halves)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		store16(floatToHalf(_mm_loadu_ps(values + i)), (short*)(halves + i));
+	}
+	for (; i < count; i++)
+	{
+		short half[4];
+		store16(floatToHalf(_mm_set1_ps(values[i])), half);
+		halves[i] = (unsigned short)half[0];
+	}
+}
+
+void VertexPacking::decodeHalf(const unsigned short* halves, int count, float* values)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(values + i, halfToFloat(loadUnsigned16(halves + i)));
+	}
+	for (; i < count; i++)
+	{
+		values[i] = _mm_cvtss_f32(halfToFloat(_mm_set1_epi32(halves[i])));
+	}
+}
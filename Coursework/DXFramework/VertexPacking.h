@@ -0,0 +1,92 @@
+/**
+* \class VertexPacking
+*
+* \brief Compact vertex format: quantised positions, octahedral normals and half-float texture coordinates.
+*
+* A full vertex is 32 bytes (float3 position, float2 texture coordinates, float3 normal), a packed vertex 16 bytes:
+* the position as 4 16-bit snorms (w is 1) over the mesh bounds, dequantised with a per-mesh scale and bias,
+* the texture coordinates as 2 half floats, and the unit normal folded onto an octahedron as 2 16-bit snorms.
+* The input assembler expands every packed element to floats, so a vertex shader reads a packed position unchanged,
+* to be dequantised by the position transform (scale then bias) ahead of the world matrix.
+* Arrays are encoded and decoded 4 vertices at a time with SSE2.
+*/
+
+#ifndef _VERTEXPACKING_H_
+#define _VERTEXPACKING_H_
+
+#include <d3d11.h>
+#include <directxmath.h>
+
+using namespace DirectX;
+
+class VertexPacking
+{
+public:
+	/// Vertex formats of a mesh
+	enum Format
+	{
+		FullVertex,		///< 32 bytes per vertex, all floats
+		PackedVertex	///< 16 bytes per vertex
+	};
+
+	/// Full vertex (position, texture coordinates and normal)
+	struct Vertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT2 texture;
+		XMFLOAT3 normal;
+	};
+
+	/// Packed vertex
+	struct Packed
+	{
+		short position[4];				///< snorm position over the bounds, w = 32767 (1)
+		unsigned short texture[2];		///< half floats
+		short normal[2];				///< snorm octahedral normal
+	};
+
+	/// Dequantisation of the positions: position = snorm * scale + bias
+	struct Quantisation
+	{
+		XMFLOAT3 scale;
+		XMFLOAT3 bias;
+	};
+
+	/// Largest errors of packed vertices (or their bounds)
+	struct Errors
+	{
+		float position;		///< distance from the position on any axis (in mesh units)
+		float normal;		///< angle from the normal (in radians)
+		float texture;		///< distance from the texture coordinates on any axis
+	};
+
+	static const float normalErrorBound;	///< largest angle of a decoded normal from a unit normal (in radians)
+
+	static unsigned int getStride(Format format);		///< Returns the bytes per vertex of a format
+
+	/// Returns the input layout of a format (POSITION, TEXCOORD and NORMAL, in the order of the vertex struct) and its element count
+	static const D3D11_INPUT_ELEMENT_DESC* getInputLayout(Format format, unsigned int& elementCount);
+
+	/// Returns the quantisation fitting the positions of vertices (the bounds, with a scale of 1 on empty axes)
+	static Quantisation fitPositions(const Vertex* vertices, int count);
+
+	/// Returns the transform dequantising packed positions (scale then bias), to apply ahead of the world matrix
+	static XMMATRIX getPositionTransform(const Quantisation& quantisation);
+
+	/// Packs vertices (normals are expected to be unit)
+	static void encode(const Vertex* vertices, int count, const Quantisation& quantisation, Packed* packed);
+
+	/// Unpacks vertices (normals are normalised)
+	static void decode(const Packed* packed, int count, const Quantisation& quantisation, Vertex* vertices);
+
+	/// Returns the largest errors of packed vertices from the vertices they were packed from
+	static Errors measure(const Vertex* vertices, const Packed* packed, int count, const Quantisation& quantisation);
+
+	/// Returns the error bounds of a quantisation, for texture coordinates up to maxTexture in magnitude
+	static Errors getErrorBounds(const Quantisation& quantisation, float maxTexture);
+
+	static void encodeHalf(const float* values, int count, unsigned short* halves);		///< Converts floats to half floats (round to nearest even)
+	static void decodeHalf(const unsigned short* halves, int count, float* values);		///< Converts half floats to floats
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "Tests.h"
+#include "HeightPyramid.h"
+#include "SimplexNoise.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Heights of a size x size test terrain (fBm of a few features across, up to about amplitude)
+std::vector<float> TestTerrain(int size, float amplitude) {
+	std::vector<float> heights((size_t)size * size);
+	SimplexNoise noise(4.f / size);
+	for (int y = 0; y < size; y++) {
+		noise.fractalRow(8, 0.f, 1.f, (float)y, &heights[(size_t)y * size], size);
+	}
+	for (float& height : heights) {
+		height *= amplitude;
+	}
+	return heights;
+}
+
+// Height range of the samples under node (i, j) of a level (the corners of the cells it covers), by brute force
+static void SampleBounds(const HeightField& field, int level, int i, int j, float& lo, float& hi) {
+	const int cells = field.size - 1;
+	const int x0 = i << level, z0 = j << level;
+	const int x1 = std::min((i + 1) << level, cells), z1 = std::min((j + 1) << level, cells);
+	lo = hi = field.heights[(size_t)z0 * field.size + x0];
+	for (int z = z0; z <= z1; z++) {
+		for (int x = x0; x <= x1; x++) {
+			lo = std::min(lo, field.heights[(size_t)z * field.size + x]);
+			hi = std::max(hi, field.heights[(size_t)z * field.size + x]);
+		}
+	}
+}
+
+// Every node of the pyramid holds the exact height range of its samples, also after an edit of a region of the heights
+// and its UpdateRegion (on a size that halves unevenly)
+void TestHeightPyramidBounds() {
+	const int size = 101;
+	std::vector<float> heights = TestTerrain(size, 10.f);
+	HeightField field;
+	field.heights = heights.data();
+	field.size = size;
+	field.spacing = 0.5f;
+	field.originX = 3.f;
+	field.originZ = -2.f;
+	field.version = 1;
+
+	HeightPyramid pyramid;
+	pyramid.Refresh(field);
+	for (int pass = 0; pass < 2; pass++) {
+		CHECK(pyramid.GetLevelWidth(pyramid.GetLevelCount()) == 1);
+		for (int level = 0; level <= pyramid.GetLevelCount(); level++) {
+			const int width = pyramid.GetLevelWidth(level);
+			CHECK(width == (size - 1 + (1 << level) - 1) >> level);
+			for (int j = 0; j < width; j++) {
+				for (int i = 0; i < width; i++) {
+					float lo, hi, expectedLo, expectedHi;
+					pyramid.GetNodeBounds(level, i, j, lo, hi);
+					SampleBounds(field, level, i, j, expectedLo, expectedHi);
+					CHECK(lo == expectedLo && hi == expectedHi);
+				}
+			}
+		}
+
+		// Raising a bump on a region, for the second pass
+		for (int z = 60; z <= 70; z++) {
+			for (int x = 30; x <= 45; x++) {
+				heights[(size_t)z * size + x] += 5.f;
+			}
+		}
+		pyramid.UpdateRegion(30, 60, 45, 70);
+	}
+}
+
+// Rays cast through the pyramid hit what marching every cell hits, at the same distance, on the surface
+void TestHeightPyramidRays() {
+	const int size = 257;
+	const std::vector<float> heights = TestTerrain(size, 20.f);
+	HeightField field;
+	field.heights = heights.data();
+	field.size = size;
+	field.originX = field.originZ = 0.5f;
+	field.version = 1;
+	HeightPyramid pyramid;
+	pyramid.Refresh(field);
+
+	uint32_t state = 13579u;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / 16777216.f;
+	};
+	const int rayCount = 1024;
+	const float extent = field.getExtent();
+	std::vector<HeightPyramid::Ray> rays(rayCount);
+	for (HeightPyramid::Ray& ray : rays) {
+		const float yaw = random() * 6.2831853f, pitch = (random() - 0.25f) * 1.2f;  // some rays point up
+		ray = { field.originX + random() * extent, 25.f, field.originZ + random() * extent, sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch), 1e30f };
+	}
+	rays[0].tMax = 0.5f;  // stops well above the terrain
+	rays[0].dirX = rays[0].dirZ = 0.f;
+	rays[0].dirY = -1.f;
+
+	std::vector<HeightPyramid::Hit> hits(rayCount);
+	pyramid.Intersect(rays.data(), hits.data(), rayCount);
+	CHECK(!hits[0].hit);
+	int hitCount = 0;
+	for (int r = 0; r < rayCount; r++) {
+		const HeightPyramid::Ray& ray = rays[r];
+		const HeightPyramid::Hit& hit = hits[r];
+		HeightPyramid::Hit march;
+		pyramid.IntersectMarch(ray, march);
+		CHECK(hit.hit == march.hit);
+		if (!hit.hit || !march.hit) continue;
+		hitCount++;
+		CHECK(fabsf(hit.t - march.t) <= 1e-3f * (1.f + march.t));
+
+		float height;
+		const float x = ray.originX + ray.dirX * hit.t, y = ray.originY + ray.dirY * hit.t, z = ray.originZ + ray.dirZ * hit.t;
+		CHECK(field.sampleHeight(x, z, height) && fabsf(height - y) <= 1e-3f * (1.f + hit.t));
+		CHECK(fabsf(hit.normalX * hit.normalX + hit.normalY * hit.normalY + hit.normalZ * hit.normalZ - 1.f) < 1e-4f && hit.normalY > 0.f);
+	}
+	CHECK(hitCount > rayCount / 4);  // the comparison is not vacuous
+}
@@ -0,0 +1,41 @@
+// Main.cpp
+// Runs every test and returns the number of failed checks (0 when all passed).
+#include "Tests.h"
+
+int failedChecks = 0;
+
+// Name and function of every test
+static const struct {
+	const char* name;
+	void (*run)();
+} tests[] = {
+	{ "Height map threads", TestHeightMapThreads },
+	{ "Density volume", TestDensityVolume },
+	{ "Normal map bake", TestNormalBake },
+	{ "Fractal kernels", TestFractalKernels },
+	{ "Height pyramid bounds", TestHeightPyramidBounds },
+	{ "Height pyramid rays", TestHeightPyramidRays },
+	{ "Noise graph fBm", TestNoiseGraphFbm },
+	{ "Noise graph rows", TestNoiseGraphRows },
+	{ "Noise graph nodes", TestNoiseGraphNodes },
+	{ "Quadtree coverage", TestQuadtreeCoverage },
+	{ "Quadtree culling", TestQuadtreeCulling },
+	{ "Vertex cache", TestVertexCache },
+	{ "Plane index order", TestPlaneIndexOrder },
+	{ "Cube faces", TestCubeFaces },
+	{ "Sphere mapping", TestSphereMapping },
+	{ "Vertex formats", TestVertexFormats },
+	{ "Vertex packing errors", TestVertexPackingErrors },
+	{ "Half floats", TestHalfFloats },
+};
+
+int main()
+{
+	for (const auto& test : tests) {
+		const int failedBefore = failedChecks;
+		test.run();
+		printf("%-24s %s\n", test.name, failedChecks == failedBefore ? "passed" : "FAILED");
+	}
+	printf("%d failed checks\n", failedChecks);
+	return failedChecks;
+}
@@ -0,0 +1,177 @@
+#include "Tests.h"
+#include "PlaneMesh.h"
+#include "CubeMesh.h"
+#include "SphereMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Triangles of a triangle list, each rotated to start at its smallest index (keeping the winding), sorted
+static std::vector<std::array<unsigned int, 3>> SortedTriangles(const std::vector<unsigned int>& indices) {
+	std::vector<std::array<unsigned int, 3>> triangles;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		std::array<unsigned int, 3> triangle = { indices[t], indices[t + 1], indices[t + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// The cache simulator on index lists of known misses, with 32-bit and 16-bit indices alike
+void TestVertexCache() {
+	const unsigned int triangle[3] = { 0, 1, 2 };
+	VertexCache::Stats stats = VertexCache::simulate(triangle, 3, 3);
+	CHECK(stats.acmr == 3.f && stats.atvr == 1.f);
+
+	// The same triangle twice: the second one hits
+	const unsigned int twice[6] = { 0, 1, 2, 2, 1, 0 };
+	stats = VertexCache::simulate(twice, 6, 3);
+	CHECK(stats.acmr == 1.5f && stats.atvr == 1.f);
+
+	// Two triangles then the first again: hits in a 16-entry cache, evicted from a 3-entry one (FIFO)
+	const unsigned int evicted[9] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	const unsigned short evicted16[9] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	stats = VertexCache::simulate(evicted, 9, 6);
+	CHECK(stats.acmr == 2.f && stats.atvr == 1.f);
+	stats = VertexCache::simulate(evicted, 9, 6, 3);
+	CHECK(stats.acmr == 3.f && stats.atvr == 1.5f);
+	stats = VertexCache::simulate(evicted16, 9, 6, 3);
+	CHECK(stats.acmr == 3.f && stats.atvr == 1.5f);
+
+	// A grid in both index sizes
+	std::vector<unsigned int> indices;
+	PlaneMesh::buildIndices(100, PlaneMesh::bandQuads, indices);
+	const std::vector<unsigned short> indices16(indices.begin(), indices.end());
+	const VertexCache::Stats stats32 = VertexCache::simulate(indices.data(), (int)indices.size(), 100 * 100);
+	stats = VertexCache::simulate(indices16.data(), (int)indices16.size(), 100 * 100);
+	CHECK(stats.acmr == stats32.acmr && stats.atvr == stats32.atvr);
+}
+
+// The banded index order holds the same triangles (with the same winding) as the row by row order, on grids that do and
+// do not split evenly into bands, and reuses more vertices
+void TestPlaneIndexOrder() {
+	const int resolutions[4] = { 2, 9, 50, 1000 };
+	for (int resolution : resolutions) {
+		const int quads = resolution - 1;
+		std::vector<unsigned int> rows, bands;
+		PlaneMesh::buildIndices(resolution, quads, rows);
+		PlaneMesh::buildIndices(resolution, PlaneMesh::bandQuads, bands);
+		CHECK(rows.size() == (size_t)quads * quads * 6);
+		CHECK(bands.size() == rows.size());
+		CHECK(*std::max_element(bands.begin(), bands.end()) == (unsigned int)(resolution * resolution - 1));
+		CHECK(SortedTriangles(bands) == SortedTriangles(rows));
+
+		// The first quad of the row order: upper left, upper right (a row down), lower left (one across)
+		CHECK(rows[0] == 0 && rows[1] == (unsigned int)resolution + 1 && rows[2] == (unsigned int)resolution);
+		CHECK(rows[3] == 0 && rows[4] == 1 && rows[5] == (unsigned int)resolution + 1);
+
+		if (resolution >= 50) {
+			const float rowACMR = VertexCache::simulate(rows.data(), (int)rows.size(), resolution * resolution).acmr;
+			const float bandACMR = VertexCache::simulate(bands.data(), (int)bands.size(), resolution * resolution).acmr;
+			CHECK(bandACMR < rowACMR);
+			CHECK(bandACMR < 0.65f);
+		}
+	}
+}
+
+// Cross product of the edges of triangle (a, b, c), along its normal with twice its area as length
+static XMFLOAT3 TriangleCross(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c) {
+	const float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+	const float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+	return XMFLOAT3(uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx);
+}
+
+// The cube faces: their counts, vertex reuse, every triangle wound the same way round its face's normal, texture
+// coordinates, and vertices repeated only where faces meet
+void TestCubeFaces() {
+	const int resolutions[3] = { 1, 7, 20 };
+	for (int resolution : resolutions) {
+		const int side = resolution + 1;
+		std::vector<VertexPacking::Vertex> vertices;
+		std::vector<unsigned int> indices;
+		CubeMesh::buildFaces(resolution, vertices, indices);
+		CHECK(vertices.size() == (size_t)6 * side * side);
+		CHECK(indices.size() == (size_t)36 * resolution * resolution);
+		CHECK(*std::max_element(indices.begin(), indices.end()) == vertices.size() - 1);
+		CHECK(VertexCache::simulate(indices.data(), (int)indices.size(), (int)vertices.size()).acmr < 3.f);
+
+		bool outward = true;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			const VertexPacking::Vertex& a = vertices[indices[t]];
+			const XMFLOAT3 cross = TriangleCross(a.position, vertices[indices[t + 1]].position, vertices[indices[t + 2]].position);
+			outward &= (cross.x * a.normal.x + cross.y * a.normal.y + cross.z * a.normal.z < 0.f);
+		}
+		CHECK(outward);
+
+		bool onFace = true, welded = true;
+		for (size_t v = 0; v < vertices.size(); v++) {
+			const VertexPacking::Vertex& vertex = vertices[v];
+			const XMFLOAT3& p = vertex.position;
+			onFace &= (p.x * vertex.normal.x + p.y * vertex.normal.y + p.z * vertex.normal.z == 1.f);
+			onFace &= (vertex.texture.x >= 0.f && vertex.texture.x <= 1.f && vertex.texture.y >= 0.f && vertex.texture.y <= 1.f);
+
+			// A vertex on an edge of the cube has a twin on each other face it touches, an inner one none
+			const int edges = (fabsf(p.x) == 1.f) + (fabsf(p.y) == 1.f) + (fabsf(p.z) == 1.f);
+			int twins = 0;
+			for (size_t w = 0; w < vertices.size(); w++) {
+				const XMFLOAT3& q = vertices[w].position;
+				twins += (w != v && q.x == p.x && q.y == p.y && q.z == p.z);
+			}
+			welded &= (twins == edges - 1);
+		}
+		CHECK(onFace);
+		CHECK(welded);
+	}
+}
+
+// The cube faces mapped onto the sphere: unit positions, the faces still meeting on the seams, the winding kept, and the
+// equal-area mapping giving every quad about the same area (unlike the plain one)
+void TestSphereMapping() {
+	const int resolution = 20;
+	std::vector<VertexPacking::Vertex> vertices;
+	std::vector<unsigned int> indices;
+	CubeMesh::buildFaces(resolution, vertices, indices);
+	float areaRatios[2];
+	for (int equalArea = 0; equalArea < 2; equalArea++) {
+		std::vector<XMFLOAT3> positions(vertices.size());
+		bool unit = true;
+		for (size_t v = 0; v < vertices.size(); v++) {
+			positions[v] = SphereMesh::mapToSphere(vertices[v].position, vertices[v].normal, equalArea != 0);
+			const XMFLOAT3& p = positions[v];
+			unit &= (fabsf(sqrtf(p.x * p.x + p.y * p.y + p.z * p.z) - 1.f) < 1e-5f);
+		}
+		CHECK(unit);
+
+		bool seams = true;
+		for (size_t v = 0; v < vertices.size(); v++) {
+			for (size_t w = v + 1; w < vertices.size(); w++) {
+				const XMFLOAT3& a = vertices[v].position;
+				const XMFLOAT3& b = vertices[w].position;
+				if (a.x != b.x || a.y != b.y || a.z != b.z) continue;
+				seams &= (fabsf(positions[v].x - positions[w].x) + fabsf(positions[v].y - positions[w].y) + fabsf(positions[v].z - positions[w].z) < 1e-6f);
+			}
+		}
+		CHECK(seams);
+
+		// Quads are 6 indices each (two triangles), their area that of the triangles between their mapped corners
+		bool outward = true;
+		float minArea = 1e30f, maxArea = 0.f;
+		for (size_t q = 0; q < indices.size(); q += 6) {
+			float area = 0.f;
+			for (size_t t = q; t < q + 6; t += 3) {
+				const XMFLOAT3& a = positions[indices[t]];
+				const XMFLOAT3 cross = TriangleCross(a, positions[indices[t + 1]], positions[indices[t + 2]]);
+				outward &= (cross.x * a.x + cross.y * a.y + cross.z * a.z < 0.f);
+				area += 0.5f * sqrtf(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+			}
+			minArea = std::min(minArea, area);
+			maxArea = std::max(maxArea, area);
+		}
+		CHECK(outward);
+		areaRatios[equalArea] = maxArea / minArea;
+	}
+	CHECK(areaRatios[1] < 1.1f);
+	CHECK(areaRatios[0] > areaRatios[1]);
+}
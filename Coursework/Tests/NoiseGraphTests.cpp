@@ -0,0 +1,77 @@
+#include "Tests.h"
+#include "NoiseGraph.h"
+
+#include <cmath>
+#include <cstring>
+
+// The fBm preset gives the values of SimplexNoise::fractalRow (2D and 3D), over a row longer than a block
+void TestNoiseGraphFbm() {
+	const int sizeX = NoiseGraph::blockSize + 37, sizeY = 4;
+	const float frequency = 0.5f, scale = 0.01f;
+	for (int volume = 0; volume < 2; volume++) {
+		const int octaves = volume ? 10 : 15;
+		const float z = volume ? 0.37f : 0.f;
+		SimplexNoise noise(frequency);
+		NoiseGraph graph = NoiseGraph::Preset(NoiseGraph::Shape::Fbm, frequency, octaves, 0.5f, volume != 0);
+		std::vector<float> expected((size_t)sizeX * sizeY), graphed((size_t)sizeX * sizeY);
+		for (int y = 0; y < sizeY; y++) {
+			if (volume) noise.fractalRow(octaves, 0.f, scale, y * scale, z, &expected[(size_t)y * sizeX], sizeX);
+			else noise.fractalRow(octaves, 0.f, scale, y * scale, &expected[(size_t)y * sizeX], sizeX);
+		}
+		graph.EvaluateRows(0.f, scale, 0.f, scale, z, graphed.data(), sizeX, 0, sizeY);
+
+		CHECK(SimplexNoise::maxUlpDistance(expected.data(), graphed.data(), expected.size()) <= SimplexNoise::fractalMaxUlp);
+	}
+}
+
+// Any range of rows of every shape equals the same rows of the whole grid, and the values stay in [-1, 1]
+void TestNoiseGraphRows() {
+	const int sizeX = 300, sizeY = 12, firstRow = 5, lastRow = 9;
+	for (int s = 0; s < (int)NoiseGraph::Shape::Count; s++) {
+		for (int volume = 0; volume < 2; volume++) {
+			NoiseGraph graph = NoiseGraph::Preset((NoiseGraph::Shape)s, 0.5f, 8, 0.5f, volume != 0, 7);
+			std::vector<float> grid((size_t)sizeX * sizeY), rows((size_t)sizeX * (lastRow - firstRow));
+			graph.EvaluateRows(-1.f, 0.02f, 3.f, 0.02f, 0.5f, grid.data(), sizeX, 0, sizeY);
+			graph.EvaluateRows(-1.f, 0.02f, 3.f, 0.02f, 0.5f, rows.data(), sizeX, firstRow, lastRow);
+			CHECK(memcmp(rows.data(), &grid[(size_t)firstRow * sizeX], rows.size() * sizeof(float)) == 0);
+
+			bool inRange = true;
+			for (float value : grid) {
+				inRange &= (value >= -1.f && value <= 1.f);
+			}
+			CHECK(inRange);
+		}
+	}
+}
+
+// The element-wise nodes on a known input, and the compiler dropping dead nodes and reusing registers
+void TestNoiseGraphNodes() {
+	const int count = 5;
+	std::vector<float> scratch, out(count);
+
+	// Curve of X through (0, 1), (1, 3), (3, -1), clamped outside, over x = -1, 0, 1, 2, 3
+	NoiseGraph curve;
+	curve.Compile(curve.Curve(curve.X(), { 0.f, 1.f, 1.f, 3.f, 3.f, -1.f }));
+	scratch.resize(curve.ScratchSize());
+	curve.EvaluateRow(-1.f, 1.f, 0.f, 0.f, out.data(), count, scratch.data());
+	CHECK(out[0] == 1.f && out[1] == 1.f && out[2] == 3.f && out[3] == 1.f && out[4] == -1.f);
+
+	// Blend of 2 and Y * X + 1 by X (clamped to [0, 1]), with an unused noise node
+	NoiseGraph blend;
+	NoiseGraph::Node x = blend.X();
+	NoiseGraph::Node y = blend.Y();
+	blend.Fbm(x, y, 4, 1.f);
+	blend.Compile(blend.Blend(blend.Constant(2.f), blend.ScaleBias(blend.Mul(y, x), 1.f, 1.f), x));
+	CHECK(blend.GetInstructionCount() == 6);
+	CHECK(blend.GetRegisterCount() < 6);
+	scratch.resize(blend.ScratchSize());
+	blend.EvaluateRow(-0.5f, 0.5f, 4.f, 0.f, out.data(), count, scratch.data());  // x = -0.5, 0, 0.5, 1, 1.5
+	CHECK(out[0] == 2.f && out[1] == 2.f && out[2] == 2.5f && out[3] == 5.f && out[4] == 7.f);
+
+	// Terraces of X over [0, 1]: flat steps (sharpness 2) at the multiples of 1/4
+	NoiseGraph terrace;
+	terrace.Compile(terrace.Terrace(terrace.Add(terrace.X(), terrace.Constant(0.f)), 4.f, 2.f));
+	scratch.resize(terrace.ScratchSize());
+	terrace.EvaluateRow(0.f, 0.125f, 0.f, 0.f, out.data(), count, scratch.data());  // x = 0, 1/8, 1/4, 3/8, 1/2
+	CHECK(out[0] == 0.f && out[1] == 0.0625f && out[2] == 0.25f && out[3] == 0.3125f && out[4] == 0.5f);
+}
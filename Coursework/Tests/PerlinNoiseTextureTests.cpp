@@ -0,0 +1,85 @@
+#include "Tests.h"
+#include "PerlinNoiseTexture.h"
+
+#include <cmath>
+#include <cstring>
+
+// The height map is the same, byte for byte, for any number of generation threads: on a size that is not a multiple of
+// the row blocks, through the batch fBm and through a noise graph shape
+void TestHeightMapThreads() {
+	PerlinNoiseTexture generator(64, 8, 8, 8);
+	const int size = 200;
+	const NoiseGraph::Shape shapes[2] = { NoiseGraph::Shape::Fbm, NoiseGraph::Shape::Ridged };
+	const int threadCounts[3] = { 2, 3, 8 };
+	for (NoiseGraph::Shape shape : shapes) {
+		generator.SetHeightShape(shape);
+		generator.SetThreadCount(1);
+		const std::vector<float> reference = generator.GenerateHeights(size, 0.06f, 12.5f);
+		for (int threads : threadCounts) {
+			generator.SetThreadCount(threads);
+			const std::vector<float> heights = generator.GenerateHeights(size, 0.06f, 12.5f);
+			CHECK(memcmp(heights.data(), reference.data(), reference.size() * sizeof(float)) == 0);
+		}
+	}
+}
+
+// The density volume is laid out as VolumeIndex and its pitches say (rows of a slice do not depend on the sizes of the
+// other axes, so the X rows of a smaller volume are the ones of a larger volume with the same X size), and is the same
+// for any number of generation threads
+void TestDensityVolume() {
+	CHECK(PerlinNoiseTexture::VolumeRowPitch(24) == (PerlinNoiseTexture::VolumeIndex(0, 1, 0, 24, 20) - PerlinNoiseTexture::VolumeIndex(0, 0, 0, 24, 20)) * sizeof(float));
+	CHECK(PerlinNoiseTexture::VolumeSlicePitch(24, 20) == (PerlinNoiseTexture::VolumeIndex(0, 0, 1, 24, 20) - PerlinNoiseTexture::VolumeIndex(0, 0, 0, 24, 20)) * sizeof(float));
+
+	PerlinNoiseTexture generator(64, 8, 8, 8);
+	const NoiseGraph::Shape shapes[2] = { NoiseGraph::Shape::Fbm, NoiseGraph::Shape::Billow };
+	for (NoiseGraph::Shape shape : shapes) {
+		generator.SetDensityShape(shape);
+		generator.SetThreadCount(1);
+		const std::vector<float> large = generator.GenerateDensity(24, 20, 13, 0.1f);
+		const std::vector<float> small = generator.GenerateDensity(24, 16, 8, 0.1f);
+		for (int z = 0; z < 8; z++) {
+			for (int y = 0; y < 16; y++) {
+				CHECK(memcmp(&small[PerlinNoiseTexture::VolumeIndex(0, y, z, 24, 16)], &large[PerlinNoiseTexture::VolumeIndex(0, y, z, 24, 20)], 24 * sizeof(float)) == 0);
+			}
+		}
+
+		generator.SetThreadCount(8);
+		const std::vector<float> threaded = generator.GenerateDensity(24, 20, 13, 0.1f);
+		CHECK(memcmp(threaded.data(), large.data(), large.size() * sizeof(float)) == 0);
+	}
+}
+
+// Baked normal map texels are within rounding of the normal and slope of their gradients, and the SSE path (4 texels at
+// a time) gives the same bytes as the scalar path (the texels left over)
+void TestNormalBake() {
+	const int count = 37;
+	const float scale = 2.f;
+	uint32_t state = 2468u;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / 16777216.f;
+	};
+	float gradientsX[count], gradientsY[count];
+	for (int x = 0; x < count; x++) {
+		gradientsX[x] = (random() - 0.5f) * 6.f;
+		gradientsY[x] = (random() - 0.5f) * 6.f;
+	}
+	gradientsX[0] = gradientsY[0] = 0.f;
+
+	uint32_t row[count];
+	PerlinNoiseTexture::BakeNormalRow(gradientsX, gradientsY, row, count, scale);
+	CHECK(row[0] == 0x00007f00u);  // flat: (0, 1, 0), slope 0
+	for (int x = 0; x < count; x++) {
+		uint32_t single;
+		PerlinNoiseTexture::BakeNormalRow(&gradientsX[x], &gradientsY[x], &single, 1, scale);
+		CHECK(single == row[x]);
+
+		float nx, ny, nz, slope;
+		PerlinNoiseTexture::DecodeNormal(row[x], nx, ny, nz, slope);
+		const float ex = -gradientsX[x] * scale, ez = -gradientsY[x] * scale;
+		const float length = sqrtf(ex * ex + 1.f + ez * ez);
+		const float cosine = (nx * ex + ny + nz * ez) / (length * sqrtf(nx * nx + ny * ny + nz * nz));
+		CHECK(acosf(fminf(cosine, 1.f)) * 57.2957795f < 0.5f);
+		CHECK(fabsf(slope - (1.f - 1.f / length)) <= 0.5f / 127.f + 1e-6f);
+	}
+}
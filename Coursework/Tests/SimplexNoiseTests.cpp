@@ -0,0 +1,31 @@
+#include "Tests.h"
+#include "SimplexNoise.h"
+
+// The specialised fBm kernels stay within SimplexNoise::fractalMaxUlp of the runtime ones on every batch path, values and
+// gradients alike, over rows the vector widths do not divide
+void TestFractalKernels() {
+	const size_t count = 203;
+	const float scale = 0.01f;
+	const SimplexNoise::BatchPath detected = SimplexNoise::detectBatchPath();
+	const SimplexNoise noise(0.5f);
+	const SimplexNoise::BandLimit all = { 15, 1.f };
+	std::vector<float> runtime(3 * count), specialised(3 * count);
+	for (int path = 0; path <= (int)detected; path++) {
+		SimplexNoise::setBatchPath((SimplexNoise::BatchPath)path);
+		for (int y = 0; y < 8; y++) {
+			const float rowY = -0.3f + y * 3.7f * scale;
+			noise.fractalRowDeriv(15, all, -1.f, scale, rowY, &runtime[0], &runtime[count], &runtime[2 * count], count);
+			Fractal<15, 2>::rowDeriv(noise, -1.f, scale, rowY, &specialised[0], &specialised[count], &specialised[2 * count], count);
+			CHECK(SimplexNoise::maxUlpDistance(runtime.data(), specialised.data(), 3 * count) <= SimplexNoise::fractalMaxUlp);
+
+			noise.fractalRow(15, -1.f, scale, rowY, runtime.data(), count);
+			Fractal<15, 2>::row(noise, -1.f, scale, rowY, specialised.data(), count);
+			CHECK(SimplexNoise::maxUlpDistance(runtime.data(), specialised.data(), count) <= SimplexNoise::fractalMaxUlp);
+
+			noise.fractalRow(10, -1.f, scale, rowY, 0.37f + y * scale, runtime.data(), count);
+			Fractal<10, 3>::row(noise, -1.f, scale, rowY, 0.37f + y * scale, specialised.data(), count);
+			CHECK(SimplexNoise::maxUlpDistance(runtime.data(), specialised.data(), count) <= SimplexNoise::fractalMaxUlp);
+		}
+	}
+	SimplexNoise::setBatchPath(detected);
+}
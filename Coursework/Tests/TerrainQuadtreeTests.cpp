@@ -0,0 +1,124 @@
+#include "Tests.h"
+#include "TerrainQuadtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Height field of the test terrain for the quadtree tests (size 201, so the pyramid levels halve unevenly)
+struct QuadtreeTerrain {
+	std::vector<float> heights;
+	HeightField field;
+	HeightPyramid pyramid;
+
+	QuadtreeTerrain() : heights(TestTerrain(201, 15.f)) {
+		field.heights = heights.data();
+		field.size = 201;
+		field.spacing = 2.f;
+		field.originX = -200.f;
+		field.originZ = -150.f;
+		field.version = 1;
+		pyramid.Refresh(field);
+	}
+
+	// Full view: an orthographic light looking straight down onto all of the terrain
+	TerrainQuadtree::Frustum FullView() const {
+		const float extent = field.getExtent();
+		const float eye[3] = { field.originX + extent * 0.5f, 100.f, field.originZ + extent * 0.5f };
+		const float direction[3] = { 0.f, -1.f, 0.f };
+		return TerrainQuadtree::Frustum::Orthographic(eye, direction, extent * 1.1f, extent * 1.1f, 1.f, 200.f);
+	}
+};
+
+// Distance in the xz plane from the observer to the nearest point of a node (clipped to the terrain)
+static float NodeDistance(const HeightField& field, const TerrainQuadtree::Node& node, float observerX, float observerZ) {
+	const float x1 = std::min(node.x + node.size, field.originX + field.getExtent());
+	const float z1 = std::min(node.z + node.size, field.originZ + field.getExtent());
+	const float dx = std::max(std::max(node.x - observerX, observerX - x1), 0.f);
+	const float dz = std::max(std::max(node.z - observerZ, observerZ - z1), 0.f);
+	return sqrtf(dx * dx + dz * dz);
+}
+
+// A full view selects nodes covering every cell of the terrain exactly once, each at the LOD of its distance, and
+// neighbouring nodes differ by one LOD at most
+void TestQuadtreeCoverage() {
+	const QuadtreeTerrain terrain;
+	const HeightField& field = terrain.field;
+	const int cells = field.size - 1;
+	TerrainQuadtree quadtree(&terrain.pyramid, TerrainQuadtree::Settings());
+	std::vector<TerrainQuadtree::Node> nodes;
+	const float observers[3][2] = { { 0.f, 0.f }, { field.originX + 3.f, field.originZ + 7.f }, { 500.f, 500.f } };  // the last one off the terrain
+	for (const auto& observer : observers) {
+		CHECK(quadtree.Select(terrain.FullView(), observer[0], observer[1], nodes) > 0);
+		CHECK(quadtree.GetStats().culled == 0);
+		const int topLod = quadtree.GetLodCount() - 1;
+
+		std::vector<int> cellLods((size_t)cells * cells, -1);
+		bool coveredOnce = true, inRange = true;
+		for (const TerrainQuadtree::Node& node : nodes) {
+			const int i0 = (int)lroundf((node.x - field.originX) / field.spacing);
+			const int j0 = (int)lroundf((node.z - field.originZ) / field.spacing);
+			const int span = (int)lroundf(node.size / field.spacing);
+			for (int j = j0; j < std::min(j0 + span, cells); j++) {
+				for (int i = i0; i < std::min(i0 + span, cells); i++) {
+					int& lod = cellLods[(size_t)j * cells + i];
+					coveredOnce &= (lod < 0);
+					lod = node.lod;
+				}
+			}
+
+			// Past the range of the finer LOD (whole nodes and quadrants alike), and whole nodes within their own range
+			const float distance = NodeDistance(field, node, observer[0], observer[1]);
+			if (node.lod > 0) inRange &= (distance > quadtree.GetLodRange(node.lod - 1));
+			if (!node.quadrant && node.lod < topLod) inRange &= (distance <= quadtree.GetLodRange(node.lod));
+			CHECK(node.minHeight <= node.maxHeight);
+		}
+		CHECK(coveredOnce);
+		CHECK(inRange);
+
+		bool covered = true, smooth = true;
+		for (int j = 0; j < cells; j++) {
+			for (int i = 0; i < cells; i++) {
+				const int lod = cellLods[(size_t)j * cells + i];
+				covered &= (lod >= 0);
+				if (i + 1 < cells) smooth &= (abs(lod - cellLods[(size_t)j * cells + i + 1]) <= 1);
+				if (j + 1 < cells) smooth &= (abs(lod - cellLods[(size_t)(j + 1) * cells + i]) <= 1);
+			}
+		}
+		CHECK(covered);
+		CHECK(smooth);
+	}
+}
+
+// Camera views select a subset of the full view's nodes (culling never changes a LOD), and none when looking away
+void TestQuadtreeCulling() {
+	const QuadtreeTerrain terrain;
+	const HeightField& field = terrain.field;
+	TerrainQuadtree quadtree(&terrain.pyramid, TerrainQuadtree::Settings());
+	std::vector<TerrainQuadtree::Node> fullNodes, nodes;
+	const float degrees = 3.14159265f / 180.f;
+	for (int view = 0; view < 8; view++) {
+		const float eye[3] = { field.originX + 50.f * (view + 1), 40.f, field.originZ + 37.f * (view + 1) };
+		const float yaw = view * 45.f * degrees, pitch = 15.f * degrees;
+		const float direction[3] = { sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch) };
+		quadtree.Select(terrain.FullView(), eye[0], eye[2], fullNodes);
+		CHECK(quadtree.Select(TerrainQuadtree::Frustum::Perspective(eye, direction, 45.f * degrees, 16.f / 9.f, 0.1f, 1000.f), eye[0], eye[2], nodes) > 0);
+		CHECK(nodes.size() < fullNodes.size());
+
+		bool subset = true;
+		for (const TerrainQuadtree::Node& node : nodes) {
+			subset &= std::any_of(fullNodes.begin(), fullNodes.end(), [&node](const TerrainQuadtree::Node& full) {
+				return full.x == node.x && full.z == node.z && full.size == node.size && full.lod == node.lod && full.quadrant == node.quadrant;
+			});
+		}
+		CHECK(subset);
+
+		// Looking up from above the highest point, and away from the terrain past its corner
+		const float up[3] = { 0.f, 1.f, 0.f };
+		const float high[3] = { eye[0], 100.f, eye[2] };
+		CHECK(quadtree.Select(TerrainQuadtree::Frustum::Perspective(high, up, 45.f * degrees, 1.f, 0.1f, 1000.f), eye[0], eye[2], nodes) == 0);
+		const float away[3] = { -1.f, 0.f, -1.f };
+		const float corner[3] = { field.originX - 1.f, 0.f, field.originZ - 1.f };
+		CHECK(quadtree.Select(TerrainQuadtree::Frustum::Perspective(corner, away, 45.f * degrees, 16.f / 9.f, 0.1f, 1000.f), eye[0], eye[2], nodes) == 0);
+		CHECK(quadtree.GetStats().culled > 0);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// Headless tests of the CPU side of the coursework (no window or device needed)
+// A failed check prints where it failed and is counted, and the test carries on, so one run lists every failure.
+extern int failedChecks;
+
+#define CHECK(condition) do { if (!(condition)) { failedChecks++; printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); } } while (0)
+
+// Heights of a size x size test terrain (fBm of a few features across, up to about amplitude)
+std::vector<float> TestTerrain(int size, float amplitude);
+
+// Tests (run by main in the order of its table)
+void TestHeightMapThreads();
+void TestDensityVolume();
+void TestNormalBake();
+void TestFractalKernels();
+void TestHeightPyramidBounds();
+void TestHeightPyramidRays();
+void TestNoiseGraphFbm();
+void TestNoiseGraphRows();
+void TestNoiseGraphNodes();
+void TestQuadtreeCoverage();
+void TestQuadtreeCulling();
+void TestVertexCache();
+void TestPlaneIndexOrder();
+void TestCubeFaces();
+void TestSphereMapping();
+void TestVertexFormats();
+void TestVertexPackingErrors();
+void TestHalfFloats();
@@ -0,0 +1,102 @@
+#include "Tests.h"
+#include "VertexPacking.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// The sizes of the two formats and their input layouts
+void TestVertexFormats() {
+	CHECK(sizeof(VertexPacking::Packed) == 16 && sizeof(VertexPacking::Vertex) == 32);
+	CHECK(VertexPacking::getStride(VertexPacking::PackedVertex) == 16);
+	CHECK(VertexPacking::getStride(VertexPacking::FullVertex) == 32);
+
+	unsigned int elementCount = 0;
+	const D3D11_INPUT_ELEMENT_DESC* layout = VertexPacking::getInputLayout(VertexPacking::PackedVertex, elementCount);
+	CHECK(elementCount == 3);
+	CHECK(layout[0].Format == DXGI_FORMAT_R16G16B16A16_SNORM && layout[1].Format == DXGI_FORMAT_R16G16_FLOAT && layout[2].Format == DXGI_FORMAT_R16G16_SNORM);
+	layout = VertexPacking::getInputLayout(VertexPacking::FullVertex, elementCount);
+	CHECK(elementCount == 3);
+	CHECK(strcmp(layout[0].SemanticName, "POSITION") == 0 && strcmp(layout[1].SemanticName, "TEXCOORD") == 0 && strcmp(layout[2].SemanticName, "NORMAL") == 0);
+}
+
+// Random vertices packed and unpacked again (a count the 4-wide loops do not divide), within the error bounds of their
+// quantisation, and the tail packed as the same vertices in the 4-wide loop would be
+void TestVertexPackingErrors() {
+	const int count = 1003;
+	uint32_t state = 97531u;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / 16777216.f;
+	};
+	std::vector<VertexPacking::Vertex> vertices(count);
+	for (int v = 0; v < count; v++) {
+		VertexPacking::Vertex& vertex = vertices[v];
+		vertex.position = XMFLOAT3(-3.f + 8.f * random(), 10.f + 0.5f * random(), 2.f);  // z is flat
+		vertex.texture = XMFLOAT2(2.f * random() - 1.f, random());
+		float x = 2.f * random() - 1.f, y = 2.f * random() - 1.f, z = 2.f * random() - 1.f;
+		if (v < 6) {
+			x = (v == 0) - (v == 1);  // the axes, where the octahedron folds
+			y = (v == 2) - (v == 3);
+			z = (v == 4) - (v == 5);
+		}
+		const float length = sqrtf(x * x + y * y + z * z);
+		vertex.normal = XMFLOAT3(x / length, y / length, z / length);
+	}
+
+	const VertexPacking::Quantisation quantisation = VertexPacking::fitPositions(vertices.data(), count);
+	CHECK(quantisation.scale.z == 1.f);
+	std::vector<VertexPacking::Packed> packed(count), tail(3);
+	VertexPacking::encode(vertices.data(), count, quantisation, packed.data());
+	VertexPacking::encode(&vertices[count - 3], 3, quantisation, tail.data());
+	CHECK(memcmp(tail.data(), &packed[count - 3], 3 * sizeof(VertexPacking::Packed)) == 0);
+
+	const VertexPacking::Errors errors = VertexPacking::measure(vertices.data(), packed.data(), count, quantisation);
+	const VertexPacking::Errors bounds = VertexPacking::getErrorBounds(quantisation, 1.f);
+	CHECK(errors.position <= bounds.position);
+	CHECK(errors.normal <= bounds.normal && bounds.normal == VertexPacking::normalErrorBound);
+	CHECK(errors.texture <= bounds.texture);
+
+	std::vector<VertexPacking::Vertex> decoded(count);
+	VertexPacking::decode(packed.data(), count, quantisation, decoded.data());
+	bool withinBounds = true;
+	for (int v = 0; v < count; v++) {
+		const XMFLOAT3& p = vertices[v].position;
+		const XMFLOAT3& q = decoded[v].position;
+		withinBounds &= (fabsf(p.x - q.x) <= bounds.position && fabsf(p.y - q.y) <= bounds.position && fabsf(p.z - q.z) <= bounds.position);
+		withinBounds &= (fabsf(vertices[v].texture.x - decoded[v].texture.x) <= bounds.texture && fabsf(vertices[v].texture.y - decoded[v].texture.y) <= bounds.texture);
+		const XMFLOAT3& n = vertices[v].normal;
+		const XMFLOAT3& m = decoded[v].normal;
+		const float cx = n.y * m.z - n.z * m.y, cy = n.z * m.x - n.x * m.z, cz = n.x * m.y - n.y * m.x;
+		withinBounds &= (atan2f(sqrtf(cx * cx + cy * cy + cz * cz), n.x * m.x + n.y * m.y + n.z * m.z) <= bounds.normal);  // acos is too coarse near 1
+		withinBounds &= (packed[v].position[3] == 32767);
+	}
+	CHECK(withinBounds);
+}
+
+// Half floats: exact values, rounding to nearest even, overflow, subnormals, and every finite half surviving a round trip
+void TestHalfFloats() {
+	const float values[13] = { 0.f, -0.f, 1.f, -2.f, 0.5f, 65504.f, 65520.f, 1e30f, ldexpf(1.f, -14), ldexpf(1.f, -24), 1.f + ldexpf(1.f, -11), 1.f + 3.f * ldexpf(1.f, -11), ldexpf(1.f, -26) };
+	const unsigned short expected[13] = { 0x0000, 0x8000, 0x3c00, 0xc000, 0x3800, 0x7bff, 0x7c00, 0x7c00, 0x0400, 0x0001, 0x3c00, 0x3c02, 0x0000 };
+	unsigned short halves[13];
+	VertexPacking::encodeHalf(values, 13, halves);
+	for (int i = 0; i < 13; i++) {
+		CHECK(halves[i] == expected[i]);
+	}
+
+	const unsigned short nan = 0x7e00;
+	float decoded;
+	VertexPacking::decodeHalf(&nan, 1, &decoded);
+	CHECK(decoded != decoded);
+
+	std::vector<unsigned short> finite, roundTrip(2 * 0x7c00);
+	for (unsigned int half = 0; half < 0x7c00; half++) {
+		finite.push_back((unsigned short)half);
+		finite.push_back((unsigned short)(half | 0x8000));
+	}
+	std::vector<float> floats(finite.size());
+	VertexPacking::decodeHalf(finite.data(), (int)finite.size(), floats.data());
+	VertexPacking::encodeHalf(floats.data(), (int)floats.size(), roundTrip.data());
+	CHECK(roundTrip == finite);
+	CHECK(floats[2 * 0x3c00] == 1.f && floats[2 * 0x0001] == ldexpf(1.f, -24));
+}
@@ -30,6 +30,8 @@ public:
 	AModel(ID3D11Device* device, const std::string& file);
 	~AModel();
 
+	size_t getCpuBytes();	///< Returns the size of the imported vertices and indices, kept after upload
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	void importModel(const std::string& pFile);
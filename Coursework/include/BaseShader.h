@@ -19,6 +19,7 @@
 #include <dxgi.h>
 #include <DirectXMath.h>
 #include <fstream>
+#include "VertexPacking.h"
 #include "imGUI/imgui.h"
 
 using namespace std;
@@ -60,7 +61,7 @@ public:
 
 protected:
 	virtual void initShader(const wchar_t*, const wchar_t*) = 0;
-	void loadVertexShader(const wchar_t* filename);		///< Load Vertex shader, for stand position, tex, normal geomtry
+	void loadVertexShader(const wchar_t* filename, VertexPacking::Format format = VertexPacking::FullVertex);		///< Load Vertex shader, for stand position, tex, normal geomtry (full or packed vertices)
 	void loadColourVertexShader(const wchar_t* filename);		///< Load Vertex shader, pre-made for position and colour only
 	void loadTextureVertexShader(const wchar_t* filename);		///< Load Vertex shader, pre-made for position and tex only
 	void loadHullShader(const wchar_t* filename);		///< Load Hull shader
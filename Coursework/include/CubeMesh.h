@@ -4,6 +4,7 @@
 * \brief Simple cube mesh object
 *
 * Inherits from Base Mesh, Builds a simple cube with texture coordinates and normals.
+* Vertices are shared by the quads of a face and indexed in a vertex cache friendly order (16-bit indices when they fit).
 *
 * \author Paul Robertson
 */
@@ -12,6 +13,7 @@
 #define _CUBEMESH_H_
 
 #include "BaseMesh.h"
+#include <vector>
 
 using namespace DirectX;
 
@@ -29,6 +31,17 @@ public:
 	CubeMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
 	~CubeMesh();
 
+	/** \brief Builds the faces of a cube from -1 to 1 on every axis, each face with texture coordinates from 0 to 1
+	*
+	* Every face has its own (resolution + 1)^2 vertices, shared by the quads of the face, so vertices are only repeated
+	* on the edges of the cube, where the texture coordinates (and normals) of the faces differ.
+	* Each face is indexed as a plane (see PlaneMesh::buildIndices), one after the other.
+	* @param resolution is the number of quads on each side of a face
+	* @param vertices receives the 6 * (resolution + 1)^2 vertices
+	* @param indices receives the 36 * resolution^2 indices
+	*/
+	static void buildFaces(int resolution, std::vector<VertexType>& vertices, std::vector<unsigned int>& indices);
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
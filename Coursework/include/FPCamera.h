@@ -4,13 +4,13 @@
 #include "input.h"
 #include <vector>
 
+
 using namespace DirectX;
 
 class FPCamera : public Camera
 {
 public:
-	std::vector<float> noiseData;
-	int size;
+	const TerrainSurface* terrain = nullptr;	///< terrain to walk on (not owned: the height map generator's shared view, or the streamed terrain)
 	bool flightMode = false;
 	/*void* operator new(size_t i)
 	{
@@ -27,6 +27,7 @@ public:
 
 	void move(float dt);	///< Move camera, handles basic camera movement
 
+
 private:
 	Input* input;
 	int winWidth, winHeight;///< stores window width and height
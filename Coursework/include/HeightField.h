@@ -0,0 +1,148 @@
+/**
+* \class HeightField
+*
+* \brief Non-owning view of a square height map, with height and normal queries.
+*
+* Points at heights owned elsewhere (size x size, row-major, rows along z, spacing world units apart,
+* sample (0, 0) at world (originX, originZ)).
+* The owner updates the view in place whenever the heights move or change and bumps the version,
+* so readers keep a pointer to the view instead of copying the heights.
+* Queries take world x/z and clamp to the map. Batched versions of the queries (SIMD) use exactly the same arithmetic.
+*/
+
+#ifndef _HEIGHTFIELD_H_
+#define _HEIGHTFIELD_H_
+
+#include <cmath>
+
+/**
+* \class TerrainSurface
+*
+* \brief Ground to walk on: the height under a world x/z, wherever it is known.
+*
+* Implemented by HeightField (over its samples) and by terrain streamed in pieces, so the camera can follow either.
+*/
+class TerrainSurface
+{
+public:
+	virtual ~TerrainSurface() {}
+
+	/// height at world x/z, false (height left unchanged) where the surface is not known
+	virtual bool sampleHeight(float x, float z, float& height) const = 0;
+};
+
+class HeightField : public TerrainSurface
+{
+public:
+	const float* heights = nullptr;	///< size * size heights (row-major), not owned
+	int size = 0;					///< samples per side
+	float spacing = 1.f;			///< world units between samples
+	float originX = 0.f, originZ = 0.f;	///< world position of sample (0, 0)
+	unsigned int version = 0;		///< bumped by the owner on every change of the heights
+
+	bool isValid() const { return heights != nullptr && size > 1; }	///< true once the view points at heights
+
+	float getExtent() const { return (size - 1) * spacing; }	///< world size covered by the samples
+
+	/// height at a sample, clamped to the map
+	float at(int x, int y) const
+	{
+		x = x < 0 ? 0 : (x >= size ? size - 1 : x);
+		y = y < 0 ? 0 : (y >= size ? size - 1 : y);
+		return heights[(y * size) + x];
+	}
+
+	/// cell (lower sample, at most size - 2) and fraction across it of a world coordinate, clamped to the map
+	void cellOf(float world, float origin, int& cell, float& t) const
+	{
+		float s = (world - origin) / spacing;
+		s = s > 0.f ? s : 0.f;
+		s = s < (float)(size - 1) ? s : (float)(size - 1);
+		cell = (int)s;
+		cell = cell < size - 2 ? cell : size - 2;
+		t = s - (float)cell;
+	}
+
+	/// bilinear height at world x/z
+	float sampleBilinear(float x, float z) const
+	{
+		int cx, cz;
+		float tx, tz;
+		cellOf(x, originX, cx, tx);
+		cellOf(z, originZ, cz, tz);
+		const float* row = heights + (cz * size) + cx;
+		float h0 = row[0] + (row[1] - row[0]) * tx;
+		float h1 = row[size] + (row[size + 1] - row[size]) * tx;
+		return h0 + (h1 - h0) * tz;
+	}
+
+	/// bilinear height at world x/z, false outside the samples (not clamped, the surface ends at the edge of the map)
+	bool sampleHeight(float x, float z, float& height) const override
+	{
+		if (!isValid()) return false;
+		if (x < originX || x >= originX + getExtent() || z < originZ || z >= originZ + getExtent()) return false;
+		height = sampleBilinear(x, z);
+		return true;
+	}
+
+	/// Catmull-Rom weights of the four samples around t, and their derivatives
+	static void cubicWeights(float t, float* w, float* d)
+	{
+		w[0] = ((-0.5f * t + 1.f) * t - 0.5f) * t;
+		w[1] = (1.5f * t - 2.5f) * t * t + 1.f;
+		w[2] = ((-1.5f * t + 2.f) * t + 0.5f) * t;
+		w[3] = (0.5f * t - 0.5f) * t * t;
+		d[0] = (-1.5f * t + 2.f) * t - 0.5f;
+		d[1] = (4.5f * t - 5.f) * t;
+		d[2] = (-4.5f * t + 4.f) * t + 0.5f;
+		d[3] = (1.5f * t - 1.f) * t;
+	}
+
+	/// bicubic (Catmull-Rom) height at world x/z, with its analytic slopes dh/dx and dh/dz (in height per world unit)
+	float sampleBicubic(float x, float z, float* dhdx = nullptr, float* dhdz = nullptr) const
+	{
+		int cx, cz;
+		float tx, tz, wx[4], dx[4], wz[4], dz[4];
+		cellOf(x, originX, cx, tx);
+		cellOf(z, originZ, cz, tz);
+		cubicWeights(tx, wx, dx);
+		cubicWeights(tz, wz, dz);
+
+		int columns[4];
+		for (int i = 0; i < 4; i++) {
+			int c = cx - 1 + i;
+			columns[i] = c < 0 ? 0 : (c > size - 1 ? size - 1 : c);
+		}
+
+		float height = 0.f, slopeX = 0.f, slopeZ = 0.f;
+		for (int j = 0; j < 4; j++) {
+			int r = cz - 1 + j;
+			r = r < 0 ? 0 : (r > size - 1 ? size - 1 : r);
+			const float* row = heights + (r * size);
+			float value = 0.f, derivative = 0.f;
+			for (int i = 0; i < 4; i++) {
+				value += wx[i] * row[columns[i]];
+				derivative += dx[i] * row[columns[i]];
+			}
+			height += wz[j] * value;
+			slopeX += wz[j] * derivative;
+			slopeZ += dz[j] * value;
+		}
+		if (dhdx) *dhdx = slopeX / spacing;
+		if (dhdz) *dhdz = slopeZ / spacing;
+		return height;
+	}
+
+	/// unit normal of the bicubic surface at world x/z (from its analytic slopes)
+	void sampleNormal(float x, float z, float& nx, float& ny, float& nz) const
+	{
+		float dhdx, dhdz;
+		sampleBicubic(x, z, &dhdx, &dhdz);
+		float length = std::sqrt(dhdx * dhdx + 1.f + dhdz * dhdz);
+		nx = -dhdx / length;
+		ny = 1.f / length;
+		nz = -dhdz / length;
+	}
+};
+
+#endif
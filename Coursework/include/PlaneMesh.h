@@ -5,7 +5,8 @@
 *
 * Inherits from Base Mesh, Builds a simple plane with texture coordinates and normals.
 * Provided resolution values deteremines the subdivisions of the plane.
-* Builds a plane from unit quads.
+* Builds a plane from unit quads, sharing the vertices between neighbouring quads (16-bit indices when they fit),
+* indexed in a vertex cache friendly order.
 *
 * \author Paul Robertson
 */
@@ -15,6 +16,8 @@
 #define _PLANEMESH_H_
 
 #include "BaseMesh.h"
+#include "VertexCache.h"
+#include <vector>
 
 class PlaneMesh : public BaseMesh
 {
@@ -28,11 +31,34 @@ public:
 	* @param resolution is a int for subdivision of the plane. The number of unit quad on each axis. Default is 100.
 	*/
 	PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 100);
+
+	/** \brief Initialises and builds a plane mesh with transformed texture coordinates
+	*
+	* Each texture coordinate u (and v) of the plane becomes u * textureScale + textureOffset,
+	* e.g. to land the vertices on the texel centres of a height map with border texels around the plane.
+	* @param textureScale is the scale of the texture coordinates
+	* @param textureOffset is the offset added to the scaled texture coordinates
+	*/
+	PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution, float textureScale, float textureOffset);
 	~PlaneMesh();
 
+	/// Quads across a band of the index order: the two rows of vertices of a band fit a 16-entry post-transform cache
+	static const int bandQuads = 7;
+
+	/** \brief Builds the triangle list indices of a plane of resolution x resolution vertices (row-major)
+	*
+	* The quads are indexed band by band, bandWidth quads across, and row by row within a band, so the vertices
+	* shared with the row before are still in the post-transform cache. A band as wide as the plane gives plain row order.
+	* @param resolution is the number of vertices on each axis
+	* @param bandWidth is the most quads across a band
+	* @param indices receives the (resolution - 1)^2 * 6 indices
+	*/
+	static void buildIndices(int resolution, int bandWidth, std::vector<unsigned int>& indices);
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
+	float textureScale = 1.f, textureOffset = 0.f;
 };
 
 #endif
\ No newline at end of file
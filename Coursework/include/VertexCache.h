@@ -0,0 +1,34 @@
+/**
+* \class VertexCache
+*
+* \brief Post-transform vertex cache simulator, to measure the vertex reuse of an index buffer.
+*
+* Runs the indices of a triangle list through a FIFO cache of cacheSize vertices (the classic post-transform cache)
+* and counts the vertices transformed, i.e. the indices that missed.
+* ACMR (average cache miss ratio) is the vertices transformed per triangle: 3 without any reuse, about 0.5 at best on a large grid.
+* ATVR (average transform to vertex ratio) is the vertices transformed per vertex used: 1 at best, whatever the mesh.
+*/
+
+#ifndef _VERTEXCACHE_H_
+#define _VERTEXCACHE_H_
+
+class VertexCache
+{
+public:
+	/// Vertex reuse of an index buffer
+	struct Stats
+	{
+		float acmr;		///< vertices transformed per triangle
+		float atvr;		///< vertices transformed per vertex used
+	};
+
+	static const int defaultCacheSize = 16;	///< entries of the simulated cache
+
+	/// simulate a triangle list of indexCount 32-bit indices into vertexCount vertices
+	static Stats simulate(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize = defaultCacheSize);
+
+	/// simulate a triangle list of indexCount 16-bit indices into vertexCount vertices
+	static Stats simulate(const unsigned short* indices, int indexCount, int vertexCount, int cacheSize = defaultCacheSize);
+};
+
+#endif